@@ -1,18 +1,283 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
 #include "lilc_compiler.hpp"
+#include "lilc_modules.hpp"
+#include "lilc_watch.hpp"
+#include "lilc_parallel.hpp"
+#include "inline.hpp"
+#include "loops.hpp"
 
 int 
 main( const int argc, const char **argv )
 {
-   if (argc != 3){
-	std::cout << "Usage: P3 <infile> <outfile>" << std::endl;
+   bool stats = false;
+   bool statsJson = false;
+   bool names = false;
+   bool types = false;
+   bool fold = false;
+   bool run = false;
+   bool vm = false;
+   bool jit = false;
+   bool disasm = false;
+   bool emitAsm = false;
+   bool opt = false;
+   bool dumpIR = false;
+   bool dce = false;
+   bool dse = false;
+   bool tailCalls = false;
+   bool warnUninit = false;
+   // Largest callee inlined; 0 for no inlining
+   size_t inlineThreshold = 0;
+   // Times an unrolled loop body is repeated; 0 for no loop optimization
+   size_t unrollFactor = 0;
+   size_t jobs = LILC::defaultJobs();
+   LILC::LilC_Compiler::ParserEngine engine = LILC::LilC_Compiler::BISON;
+   bool lazy = false;
+   bool diagnosticsJson = false;
+   size_t maxDiagnostics = LILC::Diagnostics::DEFAULT_LIMIT;
+   bool build = false;
+   bool watch = false;
+   std::string cacheDir;
+   const char * files[2];
+   int numFiles = 0;
+   for (int i = 1; i < argc; i++){
+	if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=text") == 0){
+		stats = true;
+	} else if (strcmp(argv[i], "--stats=json") == 0){
+		stats = true;
+		statsJson = true;
+	} else if (strcmp(argv[i], "--names") == 0){
+		names = true;
+	} else if (strcmp(argv[i], "--types") == 0){
+		names = true;
+		types = true;
+	} else if (strcmp(argv[i], "--fold") == 0){
+		names = true;
+		types = true;
+		fold = true;
+	} else if (strcmp(argv[i], "--run") == 0){
+		names = true;
+		types = true;
+		run = true;
+	} else if (strcmp(argv[i], "--vm") == 0){
+		names = true;
+		types = true;
+		run = true;
+		vm = true;
+	} else if (strcmp(argv[i], "--jit") == 0){
+		names = true;
+		types = true;
+		run = true;
+		jit = true;
+	} else if (strcmp(argv[i], "--disasm") == 0){
+		names = true;
+		types = true;
+		disasm = true;
+	} else if (strcmp(argv[i], "--opt") == 0){
+		names = true;
+		types = true;
+		opt = true;
+		dce = true;
+		dse = true;
+		tailCalls = true;
+		if (inlineThreshold == 0){
+			inlineThreshold = LILC::Inliner::DEFAULT_THRESHOLD;
+		}
+		if (unrollFactor == 0){
+			unrollFactor = LILC::LoopOptimizer::DEFAULT_FACTOR;
+		}
+	} else if (strcmp(argv[i], "--inline") == 0){
+		names = true;
+		types = true;
+		inlineThreshold = LILC::Inliner::DEFAULT_THRESHOLD;
+	} else if (strncmp(argv[i], "--inline=", 9) == 0){
+		names = true;
+		types = true;
+		inlineThreshold = atoi(argv[i] + 9);
+	} else if (strcmp(argv[i], "--unroll") == 0){
+		names = true;
+		types = true;
+		unrollFactor = LILC::LoopOptimizer::DEFAULT_FACTOR;
+	} else if (strncmp(argv[i], "--unroll=", 9) == 0 && atoi(argv[i] + 9) > 0){
+		names = true;
+		types = true;
+		unrollFactor = atoi(argv[i] + 9);
+	} else if (strcmp(argv[i], "--tail-calls") == 0){
+		names = true;
+		types = true;
+		tailCalls = true;
+	} else if (strcmp(argv[i], "--dce") == 0){
+		names = true;
+		types = true;
+		dce = true;
+	} else if (strcmp(argv[i], "--dse") == 0){
+		names = true;
+		types = true;
+		dse = true;
+	} else if (strcmp(argv[i], "--warn-uninit") == 0){
+		names = true;
+		types = true;
+		warnUninit = true;
+	} else if (strcmp(argv[i], "--ir") == 0){
+		names = true;
+		types = true;
+		dumpIR = true;
+	} else if (strcmp(argv[i], "--emit-asm") == 0){
+		names = true;
+		types = true;
+		emitAsm = true;
+	} else if (strcmp(argv[i], "--parser=bison") == 0){
+		engine = LILC::LilC_Compiler::BISON;
+	} else if (strcmp(argv[i], "--parser=descent") == 0){
+		engine = LILC::LilC_Compiler::DESCENT;
+	} else if (strcmp(argv[i], "--lazy") == 0){
+		lazy = true;
+	} else if (strcmp(argv[i], "--diagnostics=text") == 0){
+		diagnosticsJson = false;
+	} else if (strcmp(argv[i], "--diagnostics=json") == 0){
+		diagnosticsJson = true;
+	} else if (strncmp(argv[i], "--max-diagnostics=", 18) == 0){
+		maxDiagnostics = atoi(argv[i] + 18);
+	} else if (strcmp(argv[i], "--watch") == 0){
+		watch = true;
+	} else if (strcmp(argv[i], "--build") == 0){
+		build = true;
+	} else if (strncmp(argv[i], "--cache=", 8) == 0 && argv[i][8] != '\0'){
+		cacheDir = argv[i] + 8;
+	} else if (strncmp(argv[i], "--jobs=", 7) == 0 && atoi(argv[i] + 7) > 0){
+		jobs = atoi(argv[i] + 7);
+	} else if (numFiles < 2 && argv[i][0] != '-'){
+		files[numFiles++] = argv[i];
+	} else {
+		numFiles = -1;
+		break;
+	}
+   }
+   if (build && numFiles == 1){
+	// Modules are cached beside the root file unless told otherwise
+	if (cacheDir.empty()){
+		std::string root = files[0];
+		size_t slash = root.find_last_of('/');
+		cacheDir = (slash == std::string::npos ? std::string(".")
+			: root.substr(0, slash)) + "/.lilc-cache";
+	}
+	LILC::ModuleGraph graph;
+	if (!graph.load( files[0], std::cerr )){
+		return 1;
+	}
+	LILC::ModuleBuilder builder( cacheDir, jobs );
+	return builder.build( graph, std::cout ) ? 0 : 1;
+   }
+   if (watch && numFiles >= 1){
+	LILC::Watcher watcher( files[0], numFiles == 2 ? files[1] : "" );
+	watcher.setChecks( names, types );
+	watcher.setParserEngine( engine );
+	return watcher.run( std::cout ) ? 0 : 1;
+   }
+   if (numFiles != 2 && !((run || disasm || dumpIR) && numFiles == 1)){
+	std::cout << "Usage: P3 [--stats[=text|json]] [--parser=bison|descent] [--lazy] [--diagnostics=text|json] [--max-diagnostics=N] [--names] [--types [--jobs=N]] [--fold] <infile> <outfile>" << std::endl;
+	std::cout << "       P3 [--stats[=text|json]] [--fold] [--inline[=N]] [--unroll[=N]] [--tail-calls] [--dce] [--dse] [--warn-uninit] [--opt] [--ir] [--disasm] [--run|--vm|--jit] <infile> [<outfile>]" << std::endl;
+	std::cout << "       P3 [--stats[=text|json]] [--fold] [--inline[=N]] [--unroll[=N]] [--tail-calls] [--dce] [--dse] --emit-asm <infile> <asmfile>" << std::endl;
+	std::cout << "       P3 --build [--cache=DIR] [--jobs=N] <root.lilc>" << std::endl;
+	std::cout << "       P3 --watch [--parser=bison|descent] [--names] [--types] <dir> [<outdir>]" << std::endl;
 	return 1;
    }
 
    LILC::LilC_Compiler compiler;
-   compiler.parse( argv[1], argv[2] );
-   return 0;
+   if (stats){
+	compiler.enableStats();
+   }
+   compiler.setParserEngine( engine );
+   compiler.setLazyBodies( lazy );
+   compiler.getDiagnostics()->setLimit( maxDiagnostics );
+   if (diagnosticsJson){
+	compiler.getDiagnostics()->setFormat( LILC::Diagnostics::JSON );
+   }
+   if (!std::ifstream( files[0] ).good()){
+	std::cerr << files[0] << ": cannot read file" << std::endl;
+	return 1;
+   }
+   bool ok = compiler.parse( files[0] );
+   if (ok && names){
+	ok = compiler.nameAnalysis();
+   }
+   if (ok && types){
+	ok = compiler.typeCheck( jobs );
+   }
+   if (ok && warnUninit){
+	compiler.warnUninitialized();
+   }
+   if (ok && inlineThreshold > 0){
+	compiler.inlineCalls( inlineThreshold );
+   }
+   if (ok && tailCalls){
+	compiler.eliminateTailCalls();
+   }
+   if (ok && fold){
+	compiler.fold();
+   }
+   if (ok && unrollFactor > 0){
+	compiler.optimizeLoops( unrollFactor );
+   }
+   if (ok && dce){
+	compiler.eliminateDeadCode();
+   }
+   if (ok && dse){
+	compiler.eliminateDeadStores();
+   }
+   if (numFiles == 2 && emitAsm){
+	// Only a complete listing is written; a failed compile leaves no
+	// <asmfile> behind for make to take as up to date
+	std::ostringstream listing;
+	if (ok){
+		ok = compiler.emitAsm( listing );
+	}
+	if (ok){
+		std::ofstream out( files[1] );
+		out << listing.str();
+		out.close();
+	} else {
+		std::remove( files[1] );
+	}
+   } else if (numFiles == 2){
+	std::ofstream out( files[1] );
+	if (!compiler.unparse( out )){
+		ok = false;
+	}
+	out.close();
+   }
+   if (ok && (opt || dumpIR)){
+	ok = compiler.lowerIR();
+	if (ok && opt){
+		compiler.optimizeIR();
+	}
+   }
+   if (ok && dumpIR){
+	compiler.dumpIR( std::cout );
+   }
+   if (ok && (vm || jit || disasm)){
+	ok = compiler.lowerBytecode();
+   }
+   if (ok && disasm){
+	compiler.disassemble( std::cout );
+   }
+   if (ok && run){
+	if (jit){
+		ok = compiler.runJit();
+	} else {
+		ok = vm ? compiler.runBytecode() : compiler.run();
+	}
+   }
+   if (diagnosticsJson){
+	compiler.emitDiagnostics( std::cerr );
+   }
+   if (stats){
+	compiler.getStats()->report(std::cerr, statsJson);
+   }
+   return names && !ok ? 1 : 0;
 }
@@ -0,0 +1,484 @@
+#include <iostream>
+
+#include "asm.hpp"
+#include "ast.hpp"
+#include "lilc_runtime.hpp"
+#include "symbol_table.hpp"
+
+namespace LILC{
+
+// Buffered I/O, runtime errors and the C entry point. Everything the
+// generated functions call: lilc_read_int() -> eax, lilc_write_int(edi),
+// lilc_write_bytes(rdi, esi) and lilc_fail(rsi, edx), which writes the
+// message to stderr and exits with status 1. They only touch caller-saved
+// registers plus what they save themselves, and make no libc calls.
+// The native stack main runs on: this much for main and each of
+// MAX_CALL_DEPTH calls (lilc_runtime.hpp)
+static const size_t STACK_PER_CALL = 1 << 10;
+
+static const char * const RUNTIME = R"ASM(
+	.bss
+	.align	16
+lilc_inbuf:
+	.zero	65536
+lilc_outbuf:
+	.zero	65536
+	.align	8
+lilc_inpos:
+	.zero	8
+lilc_inend:
+	.zero	8
+lilc_outpos:
+	.zero	8
+lilc_stack_limit:
+	.zero	8
+lilc_depth:
+	.zero	8
+
+	.text
+# Writes out the output buffer
+lilc_flush:
+	movq	lilc_outpos(%rip), %rdx
+	testq	%rdx, %rdx
+	je	3f
+	leaq	lilc_outbuf(%rip), %rsi
+1:	movl	$1, %eax
+	movl	$1, %edi
+	syscall
+	testq	%rax, %rax
+	jle	2f
+	addq	%rax, %rsi
+	subq	%rax, %rdx
+	jne	1b
+2:	movq	$0, lilc_outpos(%rip)
+3:	ret
+
+# Appends the byte in dil to the output buffer
+lilc_putc:
+	movq	lilc_outpos(%rip), %rax
+	cmpq	$65536, %rax
+	jne	1f
+	pushq	%rdi
+	call	lilc_flush
+	popq	%rdi
+	xorl	%eax, %eax
+1:	leaq	lilc_outbuf(%rip), %rdx
+	movb	%dil, (%rdx,%rax)
+	incq	%rax
+	movq	%rax, lilc_outpos(%rip)
+	ret
+
+lilc_write_bytes:
+	pushq	%rbx
+	pushq	%r12
+	movq	%rdi, %rbx
+	movl	%esi, %r12d
+1:	testl	%r12d, %r12d
+	je	2f
+	movzbl	(%rbx), %edi
+	call	lilc_putc
+	incq	%rbx
+	decl	%r12d
+	jmp	1b
+2:	popq	%r12
+	popq	%rbx
+	ret
+
+# Decimal, negated as unsigned so INT_MIN works
+lilc_write_int:
+	subq	$24, %rsp
+	movl	%edi, %r9d
+	movl	%edi, %eax
+	testl	%eax, %eax
+	jns	1f
+	negl	%eax
+1:	leaq	16(%rsp), %rsi
+	movl	$10, %ecx
+2:	xorl	%edx, %edx
+	divl	%ecx
+	addl	$48, %edx
+	decq	%rsi
+	movb	%dl, (%rsi)
+	testl	%eax, %eax
+	jne	2b
+	testl	%r9d, %r9d
+	jns	3f
+	decq	%rsi
+	movb	$45, (%rsi)
+3:	movq	%rsi, %rdi
+	leaq	16(%rsp), %rsi
+	subq	%rdi, %rsi
+	call	lilc_write_bytes
+	addq	$24, %rsp
+	ret
+
+# The next input byte in eax without consuming it, or -1 at end of input
+lilc_peek:
+	movq	lilc_inpos(%rip), %rax
+	cmpq	lilc_inend(%rip), %rax
+	jne	2f
+	xorl	%eax, %eax
+	xorl	%edi, %edi
+	leaq	lilc_inbuf(%rip), %rsi
+	movl	$65536, %edx
+	syscall
+	movq	$0, lilc_inpos(%rip)
+	testq	%rax, %rax
+	jg	1f
+	movq	$0, lilc_inend(%rip)
+	movl	$-1, %eax
+	ret
+1:	movq	%rax, lilc_inend(%rip)
+	xorl	%eax, %eax
+2:	leaq	lilc_inbuf(%rip), %rdx
+	movzbl	(%rdx,%rax), %eax
+	ret
+
+# Skips white space, then reads an optionally signed decimal int that
+# wraps on overflow; 0 if there is no number
+lilc_read_int:
+	pushq	%rbx
+	pushq	%r12
+	subq	$8, %rsp
+	call	lilc_flush
+1:	call	lilc_peek
+	cmpl	$32, %eax
+	je	2f
+	cmpl	$9, %eax
+	jb	3f
+	cmpl	$13, %eax
+	ja	3f
+2:	incq	lilc_inpos(%rip)
+	jmp	1b
+3:	xorl	%r12d, %r12d
+	cmpl	$45, %eax
+	jne	4f
+	movl	$1, %r12d
+	jmp	5f
+4:	cmpl	$43, %eax
+	jne	6f
+5:	incq	lilc_inpos(%rip)
+	call	lilc_peek
+6:	xorl	%ebx, %ebx
+7:	subl	$48, %eax
+	cmpl	$9, %eax
+	ja	8f
+	imull	$10, %ebx, %ebx
+	addl	%eax, %ebx
+	incq	lilc_inpos(%rip)
+	call	lilc_peek
+	jmp	7b
+8:	movl	%ebx, %eax
+	testl	%r12d, %r12d
+	je	9f
+	negl	%eax
+9:	addq	$8, %rsp
+	popq	%r12
+	popq	%rbx
+	ret
+
+# Flushes the output, writes rsi[0..edx) to stderr and exits with status 1
+lilc_fail:
+	pushq	%rsi
+	pushq	%rdx
+	call	lilc_flush
+	popq	%rdx
+	popq	%rsi
+	movl	$1, %eax
+	movl	$2, %edi
+	syscall
+	movl	$1, %edi
+	movl	$231, %eax
+	syscall
+
+	.section	.rodata
+lilc_nostack:
+	.ascii	"***ERROR*** Cannot map memory for the stack\n"
+	.text
+
+# Runs lilc_fn_main on a stack of its own, lilc_stack_size bytes mapped
+# with mmap, and stops recursion 64KB above its end so the runtime always
+# has room
+	.globl	main
+	.type	main, @function
+main:
+	pushq	%rbp
+	movq	%rsp, %rbp
+	movl	$9, %eax
+	xorl	%edi, %edi
+	movq	$lilc_stack_size, %rsi
+	movl	$3, %edx
+	movl	$16418, %r10d
+	movq	$-1, %r8
+	xorl	%r9d, %r9d
+	syscall
+	cmpq	$-4096, %rax
+	ja	1f
+	leaq	65536(%rax), %rcx
+	movq	%rcx, lilc_stack_limit(%rip)
+	leaq	lilc_stack_size(%rax), %rsp
+	call	lilc_fn_main
+	call	lilc_flush
+	xorl	%eax, %eax
+	leave
+	ret
+1:	leaq	lilc_nostack(%rip), %rsi
+	movl	$44, %edx
+	call	lilc_fail
+	.size	main, .-main
+
+	.section	.note.GNU-stack,"",@progbits
+)ASM";
+
+void AsmGen::beginProgram(ProgramNode * program){
+	bool hasMain = false;
+	for (DeclNode * decl : program->getDeclList()->getDecls()){
+		FnDeclNode * fn = dynamic_cast<FnDeclNode *>(decl);
+		if (fn != nullptr && fn->getId()->getName() == "main"){
+			hasMain = true;
+		}
+	}
+	if (!hasMain){
+		std::cerr << "***ERROR*** No main function\n";
+		myFailed = true;
+	}
+	out() << "# Lil' C program compiled by P3 --emit-asm\n";
+}
+
+void AsmGen::endProgram(){
+	out() << "\n\t.section\t.rodata\n" << myRodata.str();
+	out() << "\n\t.set\tlilc_stack_size, " << STACK_PER_CALL * (MAX_CALL_DEPTH + 1)
+		<< "\n";
+	out() << RUNTIME;
+}
+
+void AsmGen::structLayout(StructDef * def){
+	out() << "\n# struct " << def->getName() << ": " << def->getSize()
+		<< " bytes, aligned to " << def->getAlignment() << "\n";
+	for (SemSymbol * field : def->getFields()){
+		out() << "#   " << field->getOffset() << "\t";
+		field->getType()->unparse(out(), 0);
+		out() << " " << field->getName() << "\n";
+	}
+}
+
+void AsmGen::global(const std::string& name, int size, int alignment){
+	std::string label = globalLabel(name);
+	out() << "\n\t.bss\n"
+		<< "\t.align\t" << alignment << "\n"
+		<< "\t.type\t" << label << ", @object\n"
+		<< "\t.size\t" << label << ", " << size << "\n"
+		<< label << ":\n"
+		<< "\t.zero\t" << size << "\n";
+}
+
+void AsmGen::beginFunction(FnDeclNode * fn){
+	std::string name = functionLabel(fn->getId()->getName());
+	myFunction = name;
+	myFrame = alignUp(fn->getFrameSize(), 16);
+	myDepth = 0;
+	myReturn = newLabel();
+	myFailures.clear();
+	out() << "\n\t.text\n"
+		<< "\t.type\t" << name << ", @function\n"
+		<< name << ":\n";
+	emit("pushq", "%rbp");
+	emit("movq", "%rsp, %rbp");
+	if (myFrame == 0){
+		return;
+	}
+	emit("subq", "$" + std::to_string(myFrame) + ", %rsp");
+	// Every variable starts out zero. Only rax is free: the arguments are
+	// still in their registers.
+	if (myFrame <= 64){
+		for (int offset = myFrame; offset > 0; offset -= 8){
+			emit("movq", "$0, -" + std::to_string(offset) + "(%rbp)");
+		}
+	} else {
+		emit("leaq", "-" + std::to_string(myFrame) + "(%rbp), %rax");
+		label("1");
+		emit("movq", "$0, (%rax)");
+		emit("addq", "$8, %rax");
+		emit("cmpq", "%rbp, %rax");
+		emit("jb", "1b");
+	}
+
+	if (fn->getFormals() == nullptr){
+		return;
+	}
+	static const char * const REGS32[] = { "%edi", "%esi", "%edx", "%ecx", "%r8d", "%r9d" };
+	static const char * const REGS8[] = { "%dil", "%sil", "%dl", "%cl", "%r8b", "%r9b" };
+	int index = 0;
+	for (FormalDeclNode * formal : fn->getFormals()->getFormals()){
+		IdNode * id = formal->getId();
+		std::string slot = location(id);
+		bool isBool = sizeOf(id) == 1;
+		if (index < 6){
+			emit(isBool ? "movb" : "movl",
+				std::string(isBool ? REGS8[index] : REGS32[index]) + ", " + slot);
+		} else {
+			emit("movl", std::to_string(16 + 8 * (index - 6)) + "(%rbp), %eax");
+			emit(isBool ? "movb" : "movl", std::string(isBool ? "%al" : "%eax") + ", " + slot);
+		}
+		index++;
+	}
+}
+
+void AsmGen::endFunction(){
+	label(myReturn);
+	emit("leave");
+	emit("ret");
+	for (auto& failure : myFailures){
+		size_t length;
+		std::string text = literal(failure.second, length);
+		label(failure.first);
+		emit("leaq", text + "(%rip), %rsi");
+		emit("movl", "$" + std::to_string(length) + ", %edx");
+		emit("jmp", "lilc_fail");
+	}
+	out() << "\t.size\t" << myFunction << ", .-" << myFunction << "\n";
+}
+
+void AsmGen::emit(const std::string& op, const std::string& operands){
+	out() << "\t" << op;
+	if (!operands.empty()){
+		out() << "\t" << operands;
+	}
+	out() << "\n";
+	myInstructions++;
+}
+
+void AsmGen::label(const std::string& name){
+	out() << name << ":\n";
+}
+
+std::string AsmGen::newLabel(){
+	return ".L" + std::to_string(myLabels++);
+}
+
+std::string AsmGen::functionLabel(const std::string& name){
+	return "lilc_fn_" + name;
+}
+
+std::string AsmGen::globalLabel(const std::string& name){
+	return "lilc_var_" + name;
+}
+
+std::string AsmGen::location(ExpNode * loc){
+	IdNode * base = loc->locId();
+	int offset = 0;
+	DotAccessNode * dot = dynamic_cast<DotAccessNode *>(loc);
+	if (dot != nullptr){
+		base = dot->getBase();
+		offset = dot->getOffset();
+	}
+	SemSymbol * sym = base->getSymbol();
+	if (sym->isGlobal()){
+		std::string label = globalLabel(base->getName());
+		if (offset != 0){
+			label += "+" + std::to_string(offset);
+		}
+		return label + "(%rip)";
+	}
+	return std::to_string(sym->getOffset() + offset - myFrame) + "(%rbp)";
+}
+
+int AsmGen::sizeOf(ExpNode * loc){
+	return loc->locId()->getSymbol()->getType()->getSize();
+}
+
+std::string AsmGen::operand(ExpNode * exp){
+	IntLitNode * lit = dynamic_cast<IntLitNode *>(exp);
+	if (lit != nullptr){
+		return "$" + std::to_string(lit->getValue());
+	}
+	if (exp->locId() != nullptr && sizeOf(exp) == 4){
+		return location(exp);
+	}
+	return "";
+}
+
+void AsmGen::push(){
+	emit("pushq", "%rax");
+	myDepth += 8;
+}
+
+void AsmGen::pop(const std::string& reg){
+	emit("popq", reg);
+	myDepth -= 8;
+}
+
+void AsmGen::adjust(int bytes){
+	if (bytes == 0){
+		return;
+	}
+	if (bytes < 0){
+		emit("subq", "$" + std::to_string(-bytes) + ", %rsp");
+	} else {
+		emit("addq", "$" + std::to_string(bytes) + ", %rsp");
+	}
+	myDepth -= bytes;
+}
+
+void AsmGen::call(const std::string& target){
+	int pad = myDepth % 16;
+	adjust(-pad);
+	emit("call", target);
+	adjust(pad);
+}
+
+std::string AsmGen::failure(ExpNode * at, const char * msg){
+	std::string label = newLabel();
+	myFailures.emplace_back(label, std::to_string(at->getLine()) + ":"
+		+ std::to_string(at->getCol()) + " ***RUNTIME ERROR*** " + msg + "\n");
+	return label;
+}
+
+std::string AsmGen::string(const std::string& lexeme, size_t& length){
+	// As RuntimeIO::writeString decodes it
+	std::string bytes;
+	for (size_t i = 1; i + 1 < lexeme.size(); i++){
+		char c = lexeme[i];
+		if (c == '\\'){
+			c = lexeme[++i];
+			if (c == 'n'){
+				c = '\n';
+			} else if (c == 't'){
+				c = '\t';
+			}
+		}
+		bytes += c;
+	}
+	return literal(bytes, length);
+}
+
+std::string AsmGen::literal(const std::string& bytes, size_t& length){
+	length = bytes.size();
+	auto found = myStrings.find(bytes);
+	if (found != myStrings.end()){
+		return found->second;
+	}
+	std::string label = newLabel();
+	myStrings[bytes] = label;
+	myRodata << label << ":\n\t.ascii\t\"";
+	for (unsigned char c : bytes){
+		if (c == '"' || c == '\\'){
+			myRodata << '\\' << c;
+		} else if (c < 32 || c >= 127){
+			myRodata << '\\' << (char)('0' + (c >> 6)) << (char)('0' + ((c >> 3) & 7))
+				<< (char)('0' + (c & 7));
+		} else {
+			myRodata << c;
+		}
+	}
+	myRodata << "\"\n";
+	return label;
+}
+
+void AsmGen::error(ExpNode * at, const char * msg){
+	std::cerr << at->getLine() << ":" << at->getCol()
+		<< " ***ERROR*** " << msg << "\n";
+	myFailed = true;
+}
+
+} //End namespace LIL' C
@@ -0,0 +1,110 @@
+#ifndef LILC_ASM_HPP
+#define LILC_ASM_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace LILC{
+
+class ProgramNode;
+class FnDeclNode;
+class StructDef;
+class ExpNode;
+
+// GNU-syntax x86-64 assembly for a whole program (asm_gen.cpp walks the
+// AST, asm.cpp holds the generator and the runtime it links against).
+// The output is one self-contained .s file: `cc -o prog prog.s` builds a
+// native executable that behaves like P3 --run on the same program.
+//
+// Storage is the layout name analysis assigned. Globals are zeroed
+// objects in .bss, one per variable; struct variables are their layout in
+// place, so a dot-access chain is the variable plus a constant offset.
+// Each function's formals and locals live in an rbp-based frame of
+// getFrameSize() bytes rounded up to 16, zeroed on entry.
+//
+// Functions follow the SysV AMD64 convention: the first six arguments in
+// edi, esi, edx, ecx, r8d, r9d, the rest on the stack, the result in eax
+// and rsp 16-byte aligned at every call. Expressions are evaluated into
+// eax, spilling the left operand of a binary operator to the stack only
+// when the right one is not a constant or a variable.
+//
+// The runtime does its own buffered I/O with read/write system calls
+// (Linux only) and reads, writes and reports runtime errors exactly like
+// RuntimeIO and the interpreter. main runs on a stack of its own, and a
+// call past MAX_CALL_DEPTH (lilc_runtime.hpp) or near the end of that
+// stack reports a stack overflow instead of crashing.
+class AsmGen{
+public:
+	AsmGen(std::ostream& out){ myOut = &out; }
+
+	// Writes the data, strings, runtime and entry point around the
+	// functions. Reports a missing main like the interpreter.
+	void beginProgram(ProgramNode * program);
+	void endProgram();
+	void structLayout(StructDef * def);
+	void global(const std::string& name, int size, int alignment);
+
+	void beginFunction(FnDeclNode * fn);
+	void endFunction();
+	const std::string& returnLabel(){ return myReturn; }
+
+	// One instruction, e.g. emit("addl", "$1, %eax")
+	void emit(const std::string& op, const std::string& operands = "");
+	void label(const std::string& name);
+	std::string newLabel();
+	size_t getInstructions(){ return myInstructions; }
+
+	static std::string functionLabel(const std::string& name);
+	static std::string globalLabel(const std::string& name);
+	// Memory operand of a location expression (an IdNode or DotAccessNode)
+	std::string location(ExpNode * loc);
+	// Bytes of the value a location expression holds: 4 or 1
+	static int sizeOf(ExpNode * loc);
+	// The expression as an operand of a 32-bit instruction if it needs no
+	// code: an int literal or an int variable. Empty otherwise.
+	std::string operand(ExpNode * exp);
+
+	// Spill %rax to the stack and get it back, keeping track of the depth
+	void push();
+	void pop(const std::string& reg);
+	// Moves rsp by bytes (negative grows the stack)
+	void adjust(int bytes);
+	int depth(){ return myDepth; }
+	// Calls target with rsp aligned
+	void call(const std::string& target);
+
+	// A label that reports msg at at's position and exits; the stubs are
+	// written after the function
+	std::string failure(ExpNode * at, const char * msg);
+	// The label of a decoded string literal in .rodata, and its length
+	std::string string(const std::string& lexeme, size_t& length);
+
+	// Reports something that cannot be compiled on cerr
+	void error(ExpNode * at, const char * msg);
+	bool failed(){ return myFailed; }
+private:
+	std::ostream& out(){ return *myOut; }
+	std::string literal(const std::string& bytes, size_t& length);
+
+	std::ostream * myOut;
+	size_t myLabels = 0;
+	size_t myInstructions = 0;
+	// Decoded bytes -> label
+	std::unordered_map<std::string, std::string> myStrings;
+	std::ostringstream myRodata;
+	// Labels of the current function's error stubs and their messages
+	std::vector<std::pair<std::string, std::string>> myFailures;
+	std::string myFunction;
+	std::string myReturn;
+	int myFrame = 0;
+	int myDepth = 0;
+	bool myFailed = false;
+};
+
+} //End namespace LIL' C
+
+#endif
@@ -0,0 +1,445 @@
+#include <algorithm>
+
+#include "asm.hpp"
+#include "ast.hpp"
+#include "lilc_runtime.hpp"
+#include "symbol_table.hpp"
+
+// x86-64 code generation for a type-checked AST (see asm.hpp).
+
+namespace LILC{
+
+// Declarations
+
+void ProgramNode::genAsm(AsmGen * gen){
+	gen->beginProgram(this);
+	myDeclList->genAsm(gen);
+	gen->endProgram();
+}
+
+void DeclListNode::genAsm(AsmGen * gen){
+	for (DeclNode * decl : myDecls){
+		decl->genAsm(gen);
+	}
+}
+
+// Only reached for globals; locals are part of their function's frame
+void VarDeclNode::genAsm(AsmGen * gen){
+	gen->global(myId->getName(), myType->getSize(), myType->getAlignment());
+}
+
+void StructDeclNode::genAsm(AsmGen * gen){
+	StructDef * def = myId->getSymbol()->getStruct();
+	if (def != nullptr){
+		gen->structLayout(def);
+	}
+}
+
+void FnDeclNode::genAsm(AsmGen * gen){
+	gen->beginFunction(this);
+	myBody->genAsm(gen);
+	// Falling off the end returns 0
+	gen->emit("xorl", "%eax, %eax");
+	gen->endFunction();
+}
+
+void FnBodyNode::genAsm(AsmGen * gen){
+	getStmts()->genAsm(gen);
+}
+
+// Statements
+
+void StmtListNode::genAsm(AsmGen * gen){
+	for (StmtNode * stmt : myList){
+		stmt->genAsm(gen);
+	}
+}
+
+// Stores eax, which holds an int or a 0/1 bool, to a location
+static void store(AsmGen * gen, ExpNode * loc){
+	if (AsmGen::sizeOf(loc) == 1){
+		gen->emit("movb", "%al, " + gen->location(loc));
+	} else {
+		gen->emit("movl", "%eax, " + gen->location(loc));
+	}
+}
+
+void AssignStmtNode::genAsm(AsmGen * gen){
+	myAssign->genAsm(gen);
+}
+
+void PostIncStmtNode::genAsm(AsmGen * gen){
+	gen->emit("addl", "$1, " + gen->location(myLoc));
+}
+
+void PostDecStmtNode::genAsm(AsmGen * gen){
+	gen->emit("subl", "$1, " + gen->location(myLoc));
+}
+
+void ReadStmtNode::genAsm(AsmGen * gen){
+	gen->call("lilc_read_int");
+	if (AsmGen::sizeOf(myLoc) == 1){
+		gen->emit("testl", "%eax, %eax");
+		gen->emit("setne", "%al");
+	}
+	store(gen, myLoc);
+}
+
+void WriteStmtNode::genAsm(AsmGen * gen){
+	StringLitNode * str = dynamic_cast<StringLitNode *>(myLoc);
+	if (str != nullptr){
+		size_t length;
+		std::string label = gen->string(str->getLexeme(), length);
+		gen->emit("leaq", label + "(%rip), %rdi");
+		gen->emit("movl", "$" + std::to_string(length) + ", %esi");
+		gen->call("lilc_write_bytes");
+		return;
+	}
+	myLoc->genAsm(gen);
+	gen->emit("movl", "%eax, %edi");
+	gen->call("lilc_write_int");
+}
+
+void ReturnStmtNode::genAsm(AsmGen * gen){
+	if (myLoc == nullptr){
+		gen->emit("xorl", "%eax, %eax");
+	} else {
+		myLoc->genAsm(gen);
+	}
+	gen->emit("jmp", gen->returnLabel());
+}
+
+void CallStmtNode::genAsm(AsmGen * gen){
+	myCall->genAsm(gen);
+}
+
+void IfStmtNode::genAsm(AsmGen * gen){
+	std::string end = gen->newLabel();
+	myExp->genAsmJump(gen, false, end);
+	myStmtList->genAsm(gen);
+	gen->label(end);
+}
+
+void IfElseStmtNode::genAsm(AsmGen * gen){
+	std::string toElse = gen->newLabel();
+	std::string end = gen->newLabel();
+	myExp->genAsmJump(gen, false, toElse);
+	myStmtList->genAsm(gen);
+	gen->emit("jmp", end);
+	gen->label(toElse);
+	myElseStmtList->genAsm(gen);
+	gen->label(end);
+}
+
+void WhileStmtNode::genAsm(AsmGen * gen){
+	// Tested at the bottom: one branch per iteration
+	std::string test = gen->newLabel();
+	std::string body = gen->newLabel();
+	gen->emit("jmp", test);
+	gen->label(body);
+	myStmtList->genAsm(gen);
+	gen->label(test);
+	myExp->genAsmJump(gen, true, body);
+}
+
+// Locations and assignment
+
+static void load(AsmGen * gen, ExpNode * loc){
+	if (AsmGen::sizeOf(loc) == 1){
+		gen->emit("movzbl", gen->location(loc) + ", %eax");
+	} else {
+		gen->emit("movl", gen->location(loc) + ", %eax");
+	}
+}
+
+void IdNode::genAsm(AsmGen * gen){
+	load(gen, this);
+}
+
+void DotAccessNode::genAsm(AsmGen * gen){
+	load(gen, this);
+}
+
+void AssignNode::genAsm(AsmGen * gen){
+	myRight->genAsm(gen);
+	store(gen, myLeft);
+}
+
+// Values
+
+void IntLitNode::genAsm(AsmGen * gen){
+	if (myVal == 0){
+		gen->emit("xorl", "%eax, %eax");
+	} else {
+		gen->emit("movl", "$" + std::to_string(myVal) + ", %eax");
+	}
+}
+
+void TrueNode::genAsm(AsmGen * gen){
+	gen->emit("movl", "$1, %eax");
+}
+
+void FalseNode::genAsm(AsmGen * gen){
+	gen->emit("xorl", "%eax, %eax");
+}
+
+void StringLitNode::genAsm(AsmGen * gen){
+	gen->error(this, "Strings can only be written");
+}
+
+void CallExpNode::genAsm(AsmGen * gen){
+	static const char * const REGS[] = { "%edi", "%esi", "%edx", "%ecx", "%r8d", "%r9d" };
+	FnDeclNode * fn = static_cast<FnDeclNode *>(myLoc->getSymbol()->getDecl());
+
+	// Room for the callee's frame and another call, checked before the
+	// actuals are evaluated like the interpreter does
+	std::string overflow = gen->failure(this, "Stack overflow");
+	int frame = alignUp(fn->getFrameSize(), 16) + 64;
+	gen->emit("leaq", "-" + std::to_string(frame) + "(%rsp), %rax");
+	gen->emit("cmpq", "lilc_stack_limit(%rip), %rax");
+	gen->emit("jb", overflow);
+	gen->emit("cmpq", "$" + std::to_string(MAX_CALL_DEPTH) + ", lilc_depth(%rip)");
+	gen->emit("jae", overflow);
+	gen->emit("incq", "lilc_depth(%rip)");
+
+	// Each actual gets an 8-byte slot: those passed on the stack at the
+	// bottom, in order, and the register ones above them
+	int count = myList == nullptr ? 0 : myList->getExps().size();
+	int onStack = std::max(count - 6, 0);
+	int area = 8 * count;
+	int pad = (16 - (gen->depth() + area) % 16) % 16;
+	gen->adjust(-(area + pad));
+	if (myList != nullptr){
+		int index = 0;
+		for (ExpNode * actual : myList->getExps()){
+			int slot = index < 6 ? 8 * (onStack + index) : 8 * (index - 6);
+			actual->genAsm(gen);
+			gen->emit("movl", "%eax, " + std::to_string(slot) + "(%rsp)");
+			index++;
+		}
+	}
+	for (int index = 0; index < count && index < 6; index++){
+		gen->emit("movl", std::to_string(8 * (onStack + index)) + "(%rsp), " + REGS[index]);
+	}
+	gen->emit("call", AsmGen::functionLabel(myLoc->getName()));
+	gen->emit("decq", "lilc_depth(%rip)");
+	gen->adjust(area + pad);
+}
+
+void ExpListNode::genAsm(AsmGen * gen){
+	for (ExpNode * exp : myList){
+		exp->genAsm(gen);
+	}
+}
+
+// Operators
+
+// Evaluates left into eax and returns right as an operand: itself if it
+// is a constant or variable, otherwise evaluated into ecx.
+static std::string operands(AsmGen * gen, ExpNode * left, ExpNode * right){
+	std::string rhs = gen->operand(right);
+	left->genAsm(gen);
+	if (!rhs.empty()){
+		return rhs;
+	}
+	gen->push();
+	right->genAsm(gen);
+	gen->emit("movl", "%eax, %ecx");
+	gen->pop("%rax");
+	return "%ecx";
+}
+
+static void binary(AsmGen * gen, const char * op, ExpNode * left, ExpNode * right){
+	std::string rhs = operands(gen, left, right);
+	gen->emit(op, rhs + ", %eax");
+}
+
+void PlusNode::genAsm(AsmGen * gen){
+	binary(gen, "addl", myLeft, myRight);
+}
+
+void MinusNode::genAsm(AsmGen * gen){
+	binary(gen, "subl", myLeft, myRight);
+}
+
+void TimesNode::genAsm(AsmGen * gen){
+	binary(gen, "imull", myLeft, myRight);
+}
+
+void DivideNode::genAsm(AsmGen * gen){
+	IntLitNode * lit = dynamic_cast<IntLitNode *>(myRight);
+	std::string rhs = operands(gen, myLeft, myRight);
+	if (lit != nullptr && lit->getValue() == -1){
+		// idiv traps on INT_MIN / -1, which wraps to INT_MIN
+		gen->emit("negl", "%eax");
+		return;
+	}
+	if (rhs != "%ecx"){
+		gen->emit("movl", rhs + ", %ecx");
+	}
+	if (lit != nullptr && lit->getValue() != 0){
+		gen->emit("cltd");
+		gen->emit("idivl", "%ecx");
+		return;
+	}
+	gen->emit("testl", "%ecx, %ecx");
+	gen->emit("je", gen->failure(this, "Division by zero"));
+	std::string divide = gen->newLabel();
+	std::string done = gen->newLabel();
+	gen->emit("cmpl", "$-1, %ecx");
+	gen->emit("jne", divide);
+	gen->emit("negl", "%eax");
+	gen->emit("jmp", done);
+	gen->label(divide);
+	gen->emit("cltd");
+	gen->emit("idivl", "%ecx");
+	gen->label(done);
+}
+
+void UnaryMinusNode::genAsm(AsmGen * gen){
+	myNode->genAsm(gen);
+	gen->emit("negl", "%eax");
+}
+
+void NotNode::genAsm(AsmGen * gen){
+	myNode->genAsm(gen);
+	gen->emit("xorl", "$1, %eax");
+}
+
+// Conditions
+
+void ExpNode::genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label){
+	genAsm(gen);
+	gen->emit("testl", "%eax, %eax");
+	gen->emit(ifTrue ? "jne" : "je", label);
+}
+
+void NotNode::genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label){
+	myNode->genAsmJump(gen, !ifTrue, label);
+}
+
+void TrueNode::genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label){
+	if (ifTrue){
+		gen->emit("jmp", label);
+	}
+}
+
+void FalseNode::genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label){
+	if (!ifTrue){
+		gen->emit("jmp", label);
+	}
+}
+
+void AndNode::genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label){
+	if (!ifTrue){
+		myLeft->genAsmJump(gen, false, label);
+		myRight->genAsmJump(gen, false, label);
+		return;
+	}
+	std::string skip = gen->newLabel();
+	myLeft->genAsmJump(gen, false, skip);
+	myRight->genAsmJump(gen, true, label);
+	gen->label(skip);
+}
+
+void OrNode::genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label){
+	if (ifTrue){
+		myLeft->genAsmJump(gen, true, label);
+		myRight->genAsmJump(gen, true, label);
+		return;
+	}
+	std::string skip = gen->newLabel();
+	myLeft->genAsmJump(gen, true, skip);
+	myRight->genAsmJump(gen, false, label);
+	gen->label(skip);
+}
+
+// The value of a condition: 1 or 0
+static void conditionValue(AsmGen * gen, ExpNode * cond){
+	std::string isFalse = gen->newLabel();
+	std::string done = gen->newLabel();
+	cond->genAsmJump(gen, false, isFalse);
+	gen->emit("movl", "$1, %eax");
+	gen->emit("jmp", done);
+	gen->label(isFalse);
+	gen->emit("xorl", "%eax, %eax");
+	gen->label(done);
+}
+
+void AndNode::genAsm(AsmGen * gen){
+	conditionValue(gen, this);
+}
+
+void OrNode::genAsm(AsmGen * gen){
+	conditionValue(gen, this);
+}
+
+// Comparisons, by condition code suffix
+enum Comparison { CMP_EQ, CMP_NE, CMP_LT, CMP_GT, CMP_LE, CMP_GE };
+static const char * const SUFFIX[] = { "e", "ne", "l", "g", "le", "ge" };
+static const Comparison NEGATED[] = { CMP_NE, CMP_EQ, CMP_GE, CMP_LE, CMP_GT, CMP_LT };
+
+static void compare(AsmGen * gen, Comparison cmp, ExpNode * left, ExpNode * right){
+	binary(gen, "cmpl", left, right);
+	gen->emit(std::string("set") + SUFFIX[cmp], "%al");
+	gen->emit("movzbl", "%al, %eax");
+}
+
+static void compareJump(AsmGen * gen, Comparison cmp, ExpNode * left,
+	ExpNode * right, bool ifTrue, const std::string& label){
+	if (!ifTrue){
+		cmp = NEGATED[cmp];
+	}
+	binary(gen, "cmpl", left, right);
+	gen->emit(std::string("j") + SUFFIX[cmp], label);
+}
+
+void EqualsNode::genAsm(AsmGen * gen){
+	compare(gen, CMP_EQ, myLeft, myRight);
+}
+
+void EqualsNode::genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label){
+	compareJump(gen, CMP_EQ, myLeft, myRight, ifTrue, label);
+}
+
+void NotEqualsNode::genAsm(AsmGen * gen){
+	compare(gen, CMP_NE, myLeft, myRight);
+}
+
+void NotEqualsNode::genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label){
+	compareJump(gen, CMP_NE, myLeft, myRight, ifTrue, label);
+}
+
+void LessNode::genAsm(AsmGen * gen){
+	compare(gen, CMP_LT, myLeft, myRight);
+}
+
+void LessNode::genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label){
+	compareJump(gen, CMP_LT, myLeft, myRight, ifTrue, label);
+}
+
+void GreaterNode::genAsm(AsmGen * gen){
+	compare(gen, CMP_GT, myLeft, myRight);
+}
+
+void GreaterNode::genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label){
+	compareJump(gen, CMP_GT, myLeft, myRight, ifTrue, label);
+}
+
+void LessEqNode::genAsm(AsmGen * gen){
+	compare(gen, CMP_LE, myLeft, myRight);
+}
+
+void LessEqNode::genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label){
+	compareJump(gen, CMP_LE, myLeft, myRight, ifTrue, label);
+}
+
+void GreaterEqNode::genAsm(AsmGen * gen){
+	compare(gen, CMP_GE, myLeft, myRight);
+}
+
+void GreaterEqNode::genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label){
+	compareJump(gen, CMP_GE, myLeft, myRight, ifTrue, label);
+}
+
+} //End namespace LIL' C
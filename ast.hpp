@@ -2,7 +2,10 @@
 #define LILC_AST_HPP
 
 #include <ostream>
+#include <iterator>
 #include <list>
+#include <vector>
+#include "lilc_alloc.hpp"
 #include "symbols.hpp"
 
 //Here is a suggestion for all the different kinds of AST nodes
@@ -102,7 +105,29 @@
 
 namespace LILC{
 
-class SymSymbol;
+class CompilerStats;
+class SemSymbol;
+class SymbolTable;
+class StructDef;
+class DataType;
+class BodyChecker;
+class TypeChecker;
+class Folder;
+class Interpreter;
+class BytecodeGen;
+class AsmGen;
+class IRBuilder;
+class Inliner;
+class CallGraph;
+class DeadCodeEliminator;
+class DeadStoreEliminator;
+class FlowGraph;
+class LoopOptimizer;
+class TailCallEliminator;
+struct LazyBody;
+class IRProgram;
+struct IRInstr;
+struct IRBlock;
 class DeclListNode;
 class DeclNode;
 class TypeNode;
@@ -121,6 +146,11 @@ class ExpListNode;
 class ASTNode{
 public:
 	virtual void unparse(std::ostream& out, int indent) = 0;
+	// Tallies this node and its children by class for --stats.
+	virtual void collectStats(CompilerStats& stats);
+	// Resolves names below this node against symTab (name_analysis.cpp).
+	// Reports each error on cerr and returns false if there were any.
+	virtual bool nameAnalysis(SymbolTable * symTab);
 	void doIndent(std::ostream& out, int indent){
 		for (int k = 0 ; k < indent; k++){ out << " "; }
 	}
@@ -130,58 +160,282 @@ class StmtNode : public ASTNode {
 public:
 	StmtNode() : ASTNode(){}
 	virtual void unparse(std::ostream& out, int indent) = 0;
+	// Reports type errors in this statement (type_check.cpp)
+	virtual void typeCheck(BodyChecker * checker) = 0;
+	// Folds constants in the statement's expressions (fold.cpp)
+	virtual void fold(Folder * folder) = 0;
+	// Runs the statement (interp.cpp). Returns true if it returned from
+	// the enclosing function.
+	virtual bool exec(Interpreter * interp) = 0;
+	// Lowers the statement to bytecode (bytecode_gen.cpp)
+	virtual void compile(BytecodeGen * gen) = 0;
+	// Generates x86-64 assembly for the statement (asm_gen.cpp)
+	virtual void genAsm(AsmGen * gen) = 0;
+	// Lowers the statement to SSA form at the builder's current block
+	// (ir_gen.cpp)
+	virtual void lowerIR(IRBuilder * ir) = 0;
+	// Number of nodes in the statement, nested blocks included
+	virtual size_t nodeCount() = 0;
+	// Adds the calls the statement makes to graph (callgraph.cpp)
+	virtual void collectCalls(CallGraph * graph) = 0;
+	// Inlining (inline.cpp): reports the returns and block locals in the
+	// statement to the inliner, copies it with the callee's variables
+	// renamed, and inlines calls in its nested blocks
+	virtual void survey(Inliner * inliner) = 0;
+	virtual StmtNode * clone(Inliner * inliner) = 0;
+	virtual void inlineCalls(Inliner * inliner){}
+	// The slot holding the call the inliner can expand before this
+	// statement runs (see ExpNode::leadingCall), or null
+	virtual ExpNode ** leadingCall(Inliner * inliner){ return nullptr; }
+	// Dead-code elimination (deadcode.cpp): removes dead statements from
+	// nested blocks
+	virtual void prune(DeadCodeEliminator * dce){}
+	// Adds the statement's reads, writes and branches to the function's
+	// control flow graph at its current block (dataflow.cpp)
+	virtual void buildFlow(FlowGraph * flow) = 0;
+	// Dead-store elimination (deadstore.cpp): removes dead stores from
+	// nested blocks
+	virtual void eraseStores(DeadStoreEliminator * dse){}
+	// Loop optimization (loops.cpp): optimizes the loops in nested
+	// blocks, reports the block locals and the variables the statement
+	// assigns while a loop body is surveyed, and replaces products of
+	// the loop's counter by the variables that track them
+	virtual void optimizeLoops(LoopOptimizer * loops){}
+	virtual void surveyLoop(LoopOptimizer * loops) = 0;
+	virtual void reduceStrength(LoopOptimizer * loops) = 0;
+	// Tail calls (tailcall.cpp): marks the tail calls in the statement,
+	// which is in tail position if tail, and returns whether it holds a
+	// self call that becomes a jump
+	virtual bool markTailCalls(TailCallEliminator * tce, bool tail){
+		return false;
+	}
+	// Whether control never continues after the statement: it returns on
+	// every path
+	virtual bool alwaysReturns(){ return false; }
+	// Whether the statement can never do anything: an if or while whose
+	// condition is the constant false
+	virtual bool isDead(){ return false; }
 };
 
 class ExpNode : public ASTNode {
 public:
 	ExpNode() : ASTNode() {}
 	virtual void unparse(std::ostream& out, int indent) = 0;
+	// Reports type errors in this expression and returns its type
+	// (type_check.cpp)
+	virtual DataType typeCheck(BodyChecker * checker) = 0;
+	// Where errors about this expression are reported: the position of
+	// its first identifier or literal.
+	virtual size_t getLine() = 0;
+	virtual size_t getCol() = 0;
+	// Returns the folded replacement for this expression, which may be
+	// the node itself or one of its children (fold.cpp)
+	virtual ExpNode * fold(Folder * folder){ return this; }
+	// Whether evaluating the expression can call or assign anything, or
+	// stop the program
+	virtual bool hasSideEffects(){ return false; }
+	// Number of nodes in the expression tree
+	virtual size_t nodeCount(){ return 1; }
+	// The IdNode a location expression names: the id itself, or the
+	// field of a dot access. Null for anything that is not a location.
+	virtual IdNode * locId(){ return nullptr; }
+	// Evaluates the expression; bools are 0 or 1 (interp.cpp)
+	virtual int eval(Interpreter * interp) = 0;
+	// Where a location expression is stored while interpreting
+	virtual char * address(Interpreter * interp){ return nullptr; }
+	// Lowers the expression to bytecode that leaves its value in register
+	// dest, or if dest is -1 in any register, and returns that register
+	// (bytecode_gen.cpp)
+	virtual int compile(BytecodeGen * gen, int dest) = 0;
+	// Lowers the expression as a condition: jumps whose positions are
+	// added to jumps are taken when its value is ifTrue, and control
+	// falls through otherwise.
+	virtual void compileJump(BytecodeGen * gen, bool ifTrue,
+		std::vector<size_t>& jumps);
+	// Generates x86-64 assembly that leaves the value in %eax, and as a
+	// condition, code that jumps to label when the value is ifTrue
+	// (asm_gen.cpp)
+	virtual void genAsm(AsmGen * gen) = 0;
+	virtual void genAsmJump(AsmGen * gen, bool ifTrue,
+		const std::string& label);
+	// Lowers the expression to SSA form and returns its value, and as a
+	// condition, ends the current block with a branch to ifTrue or
+	// ifFalse (ir_gen.cpp)
+	virtual IRInstr * lowerIR(IRBuilder * ir) = 0;
+	virtual void lowerIRBranch(IRBuilder * ir, IRBlock * ifTrue,
+		IRBlock * ifFalse);
+	// Adds the calls in the expression to graph (callgraph.cpp)
+	virtual void collectCalls(CallGraph * graph){}
+	// Adds the expression's reads and writes of variables to flow, in
+	// evaluation order (dataflow.cpp)
+	virtual void collectFlow(FlowGraph * flow){}
+	// Reports the variables the expression assigns to loops, and returns
+	// the expression with products of the loop's counter replaced
+	// (loops.cpp)
+	virtual void surveyLoop(LoopOptimizer * loops){}
+	virtual ExpNode * reduceStrength(LoopOptimizer * loops){ return this; }
+	// A copy of the expression with the callee's variables renamed
+	// (inline.cpp)
+	virtual ExpNode * clone(Inliner * inliner) = 0;
+	// Whether evaluating the expression can neither affect nor be
+	// affected by a call: it only reads locals and cannot fail
+	virtual bool isStable(){ return false; }
+	// The first call evaluated in this expression, which slot holds, if
+	// the inliner can expand it and everything evaluated before it is
+	// stable: the slot holding that call. Such a call can be replaced by
+	// its value, computed by the callee's body ahead of the statement.
+	virtual ExpNode ** leadingCall(ExpNode ** slot, Inliner * inliner){
+		return nullptr;
+	}
 };
 
 class UnaryExpNode : public ExpNode {
 public:
-	UnaryExpNode() : ExpNode() {}
+	UnaryExpNode(ExpNode * node) : ExpNode() {
+		myNode = node;
+	}
 	virtual void unparse(std::ostream& out, int indent) = 0;
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	size_t getLine(){ return myNode->getLine(); }
+	size_t getCol(){ return myNode->getCol(); }
+	bool hasSideEffects(){ return myNode->hasSideEffects(); }
+	size_t nodeCount(){ return 1 + myNode->nodeCount(); }
+	void collectCalls(CallGraph * graph){ myNode->collectCalls(graph); }
+	void collectFlow(FlowGraph * flow){ myNode->collectFlow(flow); }
+	void surveyLoop(LoopOptimizer * loops){ myNode->surveyLoop(loops); }
+	ExpNode * reduceStrength(LoopOptimizer * loops){
+		myNode = myNode->reduceStrength(loops);
+		return this;
+	}
+	bool isStable(){ return myNode->isStable(); }
+	ExpNode ** leadingCall(ExpNode ** slot, Inliner * inliner){
+		return myNode->leadingCall(&myNode, inliner);
+	}
+	ExpNode * getOperand(){ return myNode; }
+protected:
+	ExpNode * myNode;
 };
 
 class BinaryExpNode : public ExpNode {
 public:
-	BinaryExpNode() : ExpNode() {}
+	BinaryExpNode(ExpNode * left, ExpNode * right) : ExpNode() {
+		myLeft = left;
+		myRight = right;
+	}
 	virtual void unparse(std::ostream& out, int indent) = 0;
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	size_t getLine(){ return myLeft->getLine(); }
+	size_t getCol(){ return myLeft->getCol(); }
+	bool hasSideEffects(){
+		return myLeft->hasSideEffects() || myRight->hasSideEffects();
+	}
+	size_t nodeCount(){ return 1 + myLeft->nodeCount() + myRight->nodeCount(); }
+	void collectCalls(CallGraph * graph){
+		myLeft->collectCalls(graph);
+		myRight->collectCalls(graph);
+	}
+	void collectFlow(FlowGraph * flow){
+		myLeft->collectFlow(flow);
+		myRight->collectFlow(flow);
+	}
+	void surveyLoop(LoopOptimizer * loops){
+		myLeft->surveyLoop(loops);
+		myRight->surveyLoop(loops);
+	}
+	ExpNode * reduceStrength(LoopOptimizer * loops){
+		myLeft = myLeft->reduceStrength(loops);
+		myRight = myRight->reduceStrength(loops);
+		return this;
+	}
+	bool isStable(){ return myLeft->isStable() && myRight->isStable(); }
+	ExpNode ** leadingCall(ExpNode ** slot, Inliner * inliner);
+	ExpNode * getLeft(){ return myLeft; }
+	ExpNode * getRight(){ return myRight; }
+protected:
+	ExpNode * myLeft;
+	ExpNode * myRight;
 };
 
 class ProgramNode : public ASTNode{
 public:
+	ALLOC_TAGGED(ProgramNode)
 	ProgramNode(DeclListNode * L) : ASTNode(){
 		myDeclList = L;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	void collectSignatures(TypeChecker * checker);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRProgram * program);
+	DeclListNode * getDeclList(){ return myDeclList; }
+	// Bytes of storage for all globals, known after name analysis
+	int getGlobalSize(){ return myGlobalSize; }
 private:
 	DeclListNode * myDeclList;
+	int myGlobalSize = 0;
 
 };
 
 class DeclListNode : public ASTNode{
 public:
+	ALLOC_TAGGED(DeclListNode)
 	DeclListNode(std::list<DeclNode *> * decls) : ASTNode(){
+		ALLOC_SCOPE("std::list");
 		myDecls = *decls;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	void collectSignatures(TypeChecker * checker);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRProgram * program);
+	// Removes the functions the program cannot call (deadcode.cpp)
+	void prune(DeadCodeEliminator * dce);
+	const std::list<DeclNode *>& getDecls(){ return myDecls; }
+	// Declarations of imported modules (lilc_modules.hpp) go ahead of the
+	// file's own, after those imported before them, until dropped again
+	void addImported(const std::list<DeclNode *>& decls){
+		auto at = myDecls.begin();
+		std::advance(at, myImported);
+		myDecls.insert(at, decls.begin(), decls.end());
+		myImported += decls.size();
+	}
+	void dropImported(){
+		auto end = myDecls.begin();
+		std::advance(end, myImported);
+		myDecls.erase(myDecls.begin(), end);
+		myImported = 0;
+	}
 private:
 	std::list<DeclNode *> myDecls;
+	size_t myImported = 0;
 };
 
 class FormalsListNode : public ASTNode {
 public:
+	ALLOC_TAGGED(FormalsListNode)
 	FormalsListNode(std::list<FormalDeclNode *> * decls) : ASTNode() {
+		ALLOC_SCOPE("std::list");
 		myFormals = *decls;
 		count = 0;
 	}
 	void unparse(std::ostream& out, int indent);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	void compile(BytecodeGen * gen);
 	void add(FormalDeclNode * formal) {
+		ALLOC_SCOPE("std::list");
 		myFormals.push_back(formal);
 		count++;
 	}
+	const std::list<FormalDeclNode *>& getFormals(){ return myFormals; }
 private:
 	std::list<FormalDeclNode *> myFormals;
 	int count;
@@ -190,16 +444,36 @@ private:
 class DeclNode : public ASTNode{
 public:
 	virtual void unparse(std::ostream& out, int indent) = 0;
+	// What importing modules see of the declaration (lilc_modules.hpp)
+	virtual void unparseInterface(std::ostream& out){ unparse(out, 0); }
+	// Phase one of type checking: records global signatures
+	virtual void collectSignatures(TypeChecker * checker){}
+	virtual void fold(Folder * folder){}
+	// Gives variables their registers and lowers function bodies
+	virtual void compile(BytecodeGen * gen){}
+	// Emits globals, struct layouts and functions as assembly
+	virtual void genAsm(AsmGen * gen){}
+	virtual void lowerIR(IRProgram * program){}
 };
 
 class VarDeclNode : public DeclNode{
 public:
+	ALLOC_TAGGED(VarDeclNode)
 	VarDeclNode(TypeNode * type, IdNode * id, int size) : DeclNode(){
 		myType = type;
 		myId = id;
 		mySize = size;
 	}
 	void unparse(std::ostream& out, int indent);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	// Checks the declared type against symTab and links myId to a new
+	// VAR symbol without binding it anywhere. Null if the type is bad.
+	SemSymbol * makeSymbol(SymbolTable * symTab);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	IdNode * getId(){ return myId; }
+	TypeNode * getType(){ return myType; }
 	static const int NOT_STRUCT = -1; //Use this value for mySize
 					  // if this is not a struct type
 private:
@@ -210,12 +484,18 @@ private:
 
 class FormalDeclNode : public DeclNode {
 public:
+	ALLOC_TAGGED(FormalDeclNode)
 	FormalDeclNode(TypeNode * type, IdNode * id, int size) : DeclNode() {
 		myType = type;
 		myId = id;
 		mySize = size;
 	}
 	void unparse(std::ostream& out, int indent);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	void compile(BytecodeGen * gen);
+	TypeNode * getType(){ return myType; }
+	IdNode * getId(){ return myId; }
 private:
 	TypeNode * myType;
 	IdNode * myId;
@@ -224,11 +504,45 @@ private:
 
 class StmtListNode : public ASTNode {
 public:
+	ALLOC_TAGGED(StmtListNode)
 	StmtListNode(std::list<StmtNode *> * list) : ASTNode() {
+		ALLOC_SCOPE("std::list");
 		myList = *list;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	void typeCheck(BodyChecker * checker);
+	bool exec(Interpreter * interp);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRBuilder * ir);
+	size_t nodeCount();
+	void survey(Inliner * inliner);
+	StmtListNode * clone(Inliner * inliner);
+	// Inlines the calls of each statement in place
+	void inlineCalls(Inliner * inliner);
+	void collectCalls(CallGraph * graph);
+	// Removes statements that can never run or do anything
+	void prune(DeadCodeEliminator * dce);
+	void buildFlow(FlowGraph * flow);
+	// Removes the statements the eliminator found dead, here and nested
+	void eraseStores(DeadStoreEliminator * dse);
+	// Optimizes each while loop of the list after the loops nested in it
+	void optimizeLoops(LoopOptimizer * loops);
+	void surveyLoop(LoopOptimizer * loops);
+	void reduceStrength(LoopOptimizer * loops);
+	bool markTailCalls(TailCallEliminator * tce, bool tail);
+	// Replaces the self tail calls of a list in tail position by jumps and
+	// has it return where it used to fall off the body
+	void loopTailCalls(TailCallEliminator * tce);
+	// Makes the statements the body of a while loop on condition
+	void loopWhile(ExpNode * condition);
+	bool alwaysReturns();
+	const std::list<StmtNode *>& getStmts(){ return myList; }
 	void add(StmtNode * stmt) {
+		ALLOC_SCOPE("std::list");
 		myList.push_back(stmt);
 	}
 private:
@@ -237,18 +551,46 @@ private:
 
 class FnBodyNode : public ASTNode {
 public:
+	ALLOC_TAGGED(FnBodyNode)
 	FnBodyNode(VarDeclListNode * varDeclList, StmtListNode * stmtList) : ASTNode() {
 		myDecls = varDeclList;
 		myStmts = stmtList;
+		myLazy = nullptr;
+	}
+	// A body whose declarations and statements are parsed from its span of
+	// the source the first time they are asked for (lilc_rdparser.hpp)
+	FnBodyNode(LazyBody * lazy) : ASTNode() {
+		myDecls = nullptr;
+		myStmts = nullptr;
+		myLazy = lazy;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	void typeCheck(BodyChecker * checker);
+	bool exec(Interpreter * interp);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRBuilder * ir);
+	VarDeclListNode * getDecls(){ parse(); return myDecls; }
+	StmtListNode * getStmts(){ parse(); return myStmts; }
+	bool isParsed(){ return myLazy == nullptr; }
 private:
+	void parse(){
+		if (myLazy != nullptr){
+			parseLazy();
+		}
+	}
+	void parseLazy();
 	VarDeclListNode * myDecls;
 	StmtListNode * myStmts;
+	LazyBody * myLazy;
 };
 
 class FnDeclNode : public DeclNode {
 public:
+	ALLOC_TAGGED(FnDeclNode)
 	FnDeclNode(TypeNode * type, IdNode * id, FormalsListNode * formals, FnBodyNode * body, int size) : DeclNode() {
 		myType = type;
 		myId = id;
@@ -256,6 +598,28 @@ public:
 		myBody = body;
 		mySize = size;	}
 	void unparse(std::ostream& out, int indent);
+	// The signature, with an empty body
+	void unparseInterface(std::ostream& out);
+	void fold(Folder * folder);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	void collectSignatures(TypeChecker * checker);
+	void typeCheckBody(BodyChecker * checker);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRProgram * program);
+	IdNode * getId(){ return myId; }
+	// The return type
+	TypeNode * getType(){ return myType; }
+	// Null if the function takes no formals
+	FormalsListNode * getFormals(){ return myFormals; }
+	FnBodyNode * getBody(){ return myBody; }
+	// Bytes of storage for the formals and every local of the body,
+	// known after name analysis
+	int getFrameSize(){ return mySize; }
+	// Declares a local of the body after name analysis, giving its
+	// symbol storage at the end of the frame (inline.cpp)
+	void addLocal(VarDeclNode * decl);
 
 private:
 	TypeNode * myType;
@@ -266,25 +630,40 @@ private:
 };
 class VarDeclListNode : public ASTNode{
 public:
+	ALLOC_TAGGED(VarDeclListNode)
 	VarDeclListNode(std::list<VarDeclNode *> * varDecls) : ASTNode(){
+		ALLOC_SCOPE("std::list");
 		myVarDecls = *varDecls;
 	}
 	void unparse(std::ostream& out, int indent);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	void compile(BytecodeGen * gen);
+	// An empty list: the copied locals become locals of the caller's
+	// whole body (inline.cpp)
+	VarDeclListNode * clone(Inliner * inliner);
 	void add(VarDeclNode * decl) {
+		ALLOC_SCOPE("std::list");
 		myVarDecls.push_back(decl);
 	}
+	const std::list<VarDeclNode *>& getDecls(){ return myVarDecls; }
 private:
 	std::list<VarDeclNode *> myVarDecls;
 };
 
 class StructDeclNode : public DeclNode {
 public:
+	ALLOC_TAGGED(StructDeclNode)
 	StructDeclNode(IdNode * id, VarDeclListNode * varDecls, int size) : DeclNode(){
 		myId = id;
 		mySize = size;
 		myDecls = varDecls;
 	}
 	void unparse(std::ostream& out, int indent);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	void genAsm(AsmGen * gen);
+	IdNode * getId(){ return myId; }
 private:
 	IdNode * myId;
 	int mySize;
@@ -294,82 +673,233 @@ private:
 
 class AssignStmtNode : public StmtNode {
 public:
+	ALLOC_TAGGED(AssignStmtNode)
 	AssignStmtNode(AssignNode * assign) : StmtNode() {
 		myAssign = assign;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void typeCheck(BodyChecker * checker);
+	bool exec(Interpreter * interp);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRBuilder * ir);
+	size_t nodeCount();
+	void collectCalls(CallGraph * graph);
+	void buildFlow(FlowGraph * flow);
+	void surveyLoop(LoopOptimizer * loops);
+	void reduceStrength(LoopOptimizer * loops);
+	void survey(Inliner * inliner);
+	StmtNode * clone(Inliner * inliner);
+	ExpNode ** leadingCall(Inliner * inliner);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	AssignNode * getAssign(){ return myAssign; }
 private:
 	AssignNode * myAssign;
 };
 
 class PostIncStmtNode : public StmtNode {
 public:
+	ALLOC_TAGGED(PostIncStmtNode)
 	PostIncStmtNode(ExpNode * loc) : StmtNode() {
 		myLoc = loc;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void typeCheck(BodyChecker * checker);
+	bool exec(Interpreter * interp);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRBuilder * ir);
+	size_t nodeCount();
+	void collectCalls(CallGraph * graph);
+	void buildFlow(FlowGraph * flow);
+	void surveyLoop(LoopOptimizer * loops);
+	void reduceStrength(LoopOptimizer * loops);
+	void survey(Inliner * inliner);
+	StmtNode * clone(Inliner * inliner);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	ExpNode * getLoc(){ return myLoc; }
 private:
 	ExpNode * myLoc;
 };
 
 class PostDecStmtNode : public StmtNode {
 public:
+	ALLOC_TAGGED(PostDecStmtNode)
 	PostDecStmtNode(ExpNode * loc) : StmtNode() {
 		myLoc = loc;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void typeCheck(BodyChecker * checker);
+	bool exec(Interpreter * interp);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRBuilder * ir);
+	size_t nodeCount();
+	void collectCalls(CallGraph * graph);
+	void buildFlow(FlowGraph * flow);
+	void surveyLoop(LoopOptimizer * loops);
+	void reduceStrength(LoopOptimizer * loops);
+	void survey(Inliner * inliner);
+	StmtNode * clone(Inliner * inliner);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	ExpNode * getLoc(){ return myLoc; }
 private:
 	ExpNode * myLoc;
 };
 
 class ReadStmtNode : public StmtNode {
 public:
+	ALLOC_TAGGED(ReadStmtNode)
 	ReadStmtNode(ExpNode * loc) : StmtNode() {
 		myLoc = loc;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void typeCheck(BodyChecker * checker);
+	bool exec(Interpreter * interp);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRBuilder * ir);
+	size_t nodeCount();
+	void collectCalls(CallGraph * graph);
+	void buildFlow(FlowGraph * flow);
+	void surveyLoop(LoopOptimizer * loops);
+	void reduceStrength(LoopOptimizer * loops);
+	void survey(Inliner * inliner);
+	StmtNode * clone(Inliner * inliner);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
 private:
 	ExpNode * myLoc;
 };
 
 class WriteStmtNode : public StmtNode {
 public:
+	ALLOC_TAGGED(WriteStmtNode)
 	WriteStmtNode(ExpNode * loc) : StmtNode() {
 		myLoc = loc;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void typeCheck(BodyChecker * checker);
+	bool exec(Interpreter * interp);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRBuilder * ir);
+	size_t nodeCount();
+	void collectCalls(CallGraph * graph);
+	void buildFlow(FlowGraph * flow);
+	void surveyLoop(LoopOptimizer * loops);
+	void reduceStrength(LoopOptimizer * loops);
+	void survey(Inliner * inliner);
+	StmtNode * clone(Inliner * inliner);
+	ExpNode ** leadingCall(Inliner * inliner);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
 private:
 	ExpNode * myLoc;
 };
 
 class ReturnStmtNode : public StmtNode {
 public:
+	ALLOC_TAGGED(ReturnStmtNode)
 	ReturnStmtNode(ExpNode * loc) : StmtNode() {
 		myLoc = loc;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void typeCheck(BodyChecker * checker);
+	bool exec(Interpreter * interp);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRBuilder * ir);
+	size_t nodeCount();
+	void collectCalls(CallGraph * graph);
+	void buildFlow(FlowGraph * flow);
+	void surveyLoop(LoopOptimizer * loops);
+	void reduceStrength(LoopOptimizer * loops);
+	void survey(Inliner * inliner);
+	StmtNode * clone(Inliner * inliner);
+	ExpNode ** leadingCall(Inliner * inliner);
+	bool markTailCalls(TailCallEliminator * tce, bool tail);
+	bool alwaysReturns(){ return true; }
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	// Null for a return without a value
+	ExpNode * getExp(){ return myLoc; }
 private:
 	ExpNode * myLoc;
 };
 
 class CallStmtNode : public StmtNode {
 public:
+	ALLOC_TAGGED(CallStmtNode)
 	CallStmtNode(CallExpNode * call) : StmtNode() {
 		myCall = call;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void typeCheck(BodyChecker * checker);
+	bool exec(Interpreter * interp);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRBuilder * ir);
+	size_t nodeCount();
+	void collectCalls(CallGraph * graph);
+	void buildFlow(FlowGraph * flow);
+	void surveyLoop(LoopOptimizer * loops);
+	void reduceStrength(LoopOptimizer * loops);
+	void survey(Inliner * inliner);
+	StmtNode * clone(Inliner * inliner);
+	ExpNode ** leadingCall(Inliner * inliner);
+	bool markTailCalls(TailCallEliminator * tce, bool tail);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	CallExpNode * getCall(){ return myCall; }
 private:
 	CallExpNode * myCall;
 };
 
 class IfStmtNode : public StmtNode {
 public:
+	ALLOC_TAGGED(IfStmtNode)
 	IfStmtNode(ExpNode * exp, VarDeclListNode * varList, StmtListNode * stmtList) : StmtNode() {
 		myExp = exp;
 		myVarList = varList;
 		myStmtList = stmtList;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void typeCheck(BodyChecker * checker);
+	bool exec(Interpreter * interp);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRBuilder * ir);
+	size_t nodeCount();
+	void collectCalls(CallGraph * graph);
+	void buildFlow(FlowGraph * flow);
+	void eraseStores(DeadStoreEliminator * dse);
+	void optimizeLoops(LoopOptimizer * loops);
+	void surveyLoop(LoopOptimizer * loops);
+	void reduceStrength(LoopOptimizer * loops);
+	void survey(Inliner * inliner);
+	StmtNode * clone(Inliner * inliner);
+	void inlineCalls(Inliner * inliner);
+	ExpNode ** leadingCall(Inliner * inliner);
+	void prune(DeadCodeEliminator * dce);
+	bool isDead();
+	bool markTailCalls(TailCallEliminator * tce, bool tail);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	ExpNode * getCondition(){ return myExp; }
+	VarDeclListNode * getDecls(){ return myVarList; }
+	StmtListNode * getBody(){ return myStmtList; }
 private:
 	ExpNode * myExp;
 	VarDeclListNode * myVarList;
@@ -378,6 +908,7 @@ private:
 
 class IfElseStmtNode : public StmtNode {
 public:
+	ALLOC_TAGGED(IfElseStmtNode)
 	IfElseStmtNode(ExpNode * exp, VarDeclListNode * varList, StmtListNode * stmtList, VarDeclListNode * elseVarList, StmtListNode * elseStmtList) : StmtNode() {
 		myExp = exp;
 		myVarList = varList;
@@ -386,6 +917,34 @@ public:
 		myElseStmtList = elseStmtList;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void typeCheck(BodyChecker * checker);
+	bool exec(Interpreter * interp);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRBuilder * ir);
+	size_t nodeCount();
+	void collectCalls(CallGraph * graph);
+	void buildFlow(FlowGraph * flow);
+	void eraseStores(DeadStoreEliminator * dse);
+	void optimizeLoops(LoopOptimizer * loops);
+	void surveyLoop(LoopOptimizer * loops);
+	void reduceStrength(LoopOptimizer * loops);
+	void survey(Inliner * inliner);
+	StmtNode * clone(Inliner * inliner);
+	void inlineCalls(Inliner * inliner);
+	ExpNode ** leadingCall(Inliner * inliner);
+	void prune(DeadCodeEliminator * dce);
+	bool alwaysReturns();
+	bool markTailCalls(TailCallEliminator * tce, bool tail);
+	// Rewrites both branches as statement lists in tail position
+	void loopTailCalls(TailCallEliminator * tce);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	VarDeclListNode * getDecls(){ return myVarList; }
+	StmtListNode * getBody(){ return myStmtList; }
+	VarDeclListNode * getElseDecls(){ return myElseVarList; }
+	StmtListNode * getElseBody(){ return myElseStmtList; }
 private:
 	ExpNode * myExp;
 	VarDeclListNode * myVarList;
@@ -396,12 +955,37 @@ private:
 
 class WhileStmtNode : public StmtNode {
 public:
+	ALLOC_TAGGED(WhileStmtNode)
 	WhileStmtNode(ExpNode * exp, VarDeclListNode * varList, StmtListNode * stmtList) : StmtNode() {
 		myExp = exp;
 		myVarList = varList;
 		myStmtList = stmtList;
 	}
 	void unparse(std::ostream& out, int indent);
+	void fold(Folder * folder);
+	void typeCheck(BodyChecker * checker);
+	bool exec(Interpreter * interp);
+	void compile(BytecodeGen * gen);
+	void genAsm(AsmGen * gen);
+	void lowerIR(IRBuilder * ir);
+	size_t nodeCount();
+	void collectCalls(CallGraph * graph);
+	void buildFlow(FlowGraph * flow);
+	void eraseStores(DeadStoreEliminator * dse);
+	void optimizeLoops(LoopOptimizer * loops);
+	void surveyLoop(LoopOptimizer * loops);
+	void reduceStrength(LoopOptimizer * loops);
+	void survey(Inliner * inliner);
+	StmtNode * clone(Inliner * inliner);
+	void prune(DeadCodeEliminator * dce);
+	bool isDead();
+	void inlineCalls(Inliner * inliner);
+	bool markTailCalls(TailCallEliminator * tce, bool tail);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	ExpNode * getCondition(){ return myExp; }
+	VarDeclListNode * getDecls(){ return myVarList; }
+	StmtListNode * getBody(){ return myStmtList; }
 private:
 	ExpNode * myExp;
 	VarDeclListNode * myVarList;
@@ -414,11 +998,32 @@ private:
 
 class AssignNode : public ExpNode {
 public:
+	ALLOC_TAGGED(AssignNode)
 	AssignNode(ExpNode * left, ExpNode * right) : ExpNode() {
 		myLeft = left;
 		myRight = right;
 	}
 	void unparse(std::ostream& out, int indent);
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	AssignNode * clone(Inliner * inliner);
+	void collectCalls(CallGraph * graph);
+	void collectFlow(FlowGraph * flow);
+	void surveyLoop(LoopOptimizer * loops);
+	ExpNode * reduceStrength(LoopOptimizer * loops);
+	ExpNode ** leadingCall(ExpNode ** slot, Inliner * inliner);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	size_t getLine(){ return myLeft->getLine(); }
+	size_t getCol(){ return myLeft->getCol(); }
+	bool hasSideEffects(){ return true; }
+	size_t nodeCount(){ return 1 + myLeft->nodeCount() + myRight->nodeCount(); }
+	ExpNode * getLeft(){ return myLeft; }
+	ExpNode * getRight(){ return myRight; }
 private:
 	ExpNode * myLeft;
 	ExpNode * myRight;
@@ -426,35 +1031,104 @@ private:
 
 class DotAccessNode : public ExpNode {
 public:
+	ALLOC_TAGGED(DotAccessNode)
 	DotAccessNode(ExpNode * left, IdNode * right) : ExpNode() {
 		myLeft = left;
 		myRight = right;
 	}
 	void unparse(std::ostream& out, int indent);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	bool isStable();
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	IdNode * locId(){ return myRight; }
+	char * address(Interpreter * interp);
+	size_t getLine(){ return myLeft->getLine(); }
+	size_t getCol(){ return myLeft->getCol(); }
+	size_t nodeCount(){ return 2 + myLeft->nodeCount(); }
+	// After name analysis the whole chain a.b.c is also available as its
+	// base variable (a) and the byte offset of c within it.
+	IdNode * getBase(){ return myBase; }
+	int getOffset(){ return myOffset; }
 private:
 	ExpNode * myLeft;
 	IdNode * myRight;
+	IdNode * myBase = nullptr;
+	int myOffset = 0;
 };
 
 class CallExpNode : public ExpNode {
 public:
+	ALLOC_TAGGED(CallExpNode)
 	CallExpNode(IdNode * loc, ExpListNode * list) : ExpNode() {
 		myLoc = loc;
 		myList = list;
 	}
 	void unparse(std::ostream& out, int indent);
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	CallExpNode * clone(Inliner * inliner);
+	void collectCalls(CallGraph * graph);
+	void collectFlow(FlowGraph * flow);
+	void surveyLoop(LoopOptimizer * loops);
+	ExpNode * reduceStrength(LoopOptimizer * loops);
+	ExpNode ** leadingCall(ExpNode ** slot, Inliner * inliner);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	size_t getLine();
+	size_t getCol();
+	bool hasSideEffects(){ return true; }
+	size_t nodeCount();
+	IdNode * getId(){ return myLoc; }
+	// Null if the call has no actuals
+	ExpListNode * getArgs(){ return myList; }
+	// A tail call may reuse the caller's frame (tailcall.cpp)
+	void setTail(){ myTail = true; }
+	bool isTail(){ return myTail; }
 private:
 	IdNode * myLoc;
 	ExpListNode * myList;
+	bool myTail = false;
 };
 
 class ExpListNode : public ExpNode {
 public:
+	ALLOC_TAGGED(ExpListNode)
 	ExpListNode(std::list<ExpNode *> * list) : ExpNode() {
+		ALLOC_SCOPE("std::list");
 		myList = *list;
 	}
 	void unparse(std::ostream& out, int indent);
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpListNode * clone(Inliner * inliner);
+	void collectCalls(CallGraph * graph);
+	void collectFlow(FlowGraph * flow);
+	void surveyLoop(LoopOptimizer * loops);
+	ExpNode * reduceStrength(LoopOptimizer * loops);
+	ExpNode ** leadingCall(ExpNode ** slot, Inliner * inliner);
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	size_t getLine(){ return myList.front()->getLine(); }
+	size_t getCol(){ return myList.front()->getCol(); }
+	const std::list<ExpNode *>& getExps(){ return myList; }
+	bool hasSideEffects();
+	size_t nodeCount();
 	void add(ExpNode * exp) {
+		ALLOC_SCOPE("std::list");
 		myList.push_back(exp);
 	}
 private:
@@ -463,178 +1137,287 @@ private:
 
 class PlusNode : public BinaryExpNode {
 public:
-	PlusNode(ExpNode * left, ExpNode * right) : BinaryExpNode() {
-		myLeft = left;
-		myRight = right;
-	}
+	ALLOC_TAGGED(PlusNode)
+	PlusNode(ExpNode * left, ExpNode * right) : BinaryExpNode(left, right) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myLeft;
-	ExpNode * myRight;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
 };
 
 class MinusNode : public BinaryExpNode {
 public:
-	MinusNode(ExpNode * left, ExpNode * right) : BinaryExpNode() {
-		myLeft = left;
-		myRight = right;
-	}
+	ALLOC_TAGGED(MinusNode)
+	MinusNode(ExpNode * left, ExpNode * right) : BinaryExpNode(left, right) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myLeft;
-	ExpNode * myRight;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
 };
 
 class TimesNode : public BinaryExpNode {
 public:
-	TimesNode(ExpNode * left, ExpNode * right) : BinaryExpNode() {
-		myLeft = left;
-		myRight = right;
-	}
+	ALLOC_TAGGED(TimesNode)
+	TimesNode(ExpNode * left, ExpNode * right) : BinaryExpNode(left, right) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myLeft;
-	ExpNode * myRight;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	// A product of a loop counter and a literal becomes the variable
+	// tracking it
+	ExpNode * reduceStrength(LoopOptimizer * loops);
 };
 
 class DivideNode : public BinaryExpNode {
 public:
-	DivideNode(ExpNode * left, ExpNode * right) : BinaryExpNode() {
-		myLeft = left;
-		myRight = right;
-	}
+	ALLOC_TAGGED(DivideNode)
+	DivideNode(ExpNode * left, ExpNode * right) : BinaryExpNode(left, right) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myLeft;
-	ExpNode * myRight;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	// Can stop the program, unless the divisor is a nonzero literal
+	bool hasSideEffects();
+	bool isStable(){ return false; }
 };
 
 class UnaryMinusNode : public UnaryExpNode {
 public:
-	UnaryMinusNode(ExpNode * node) : UnaryExpNode() {
-		myNode = node;
-	}
+	ALLOC_TAGGED(UnaryMinusNode)
+	UnaryMinusNode(ExpNode * node) : UnaryExpNode(node) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myNode;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
 };
 
 class NotNode : public UnaryExpNode {
 public:
-	NotNode(ExpNode * node) : UnaryExpNode() {
-		myNode = node;
-	}
+	ALLOC_TAGGED(NotNode)
+	NotNode(ExpNode * node) : UnaryExpNode(node) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myNode;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	void compileJump(BytecodeGen * gen, bool ifTrue, std::vector<size_t>& jumps);
+	void genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label);
+	void lowerIRBranch(IRBuilder * ir, IRBlock * ifTrue, IRBlock * ifFalse);
 };
 
 class AndNode : public BinaryExpNode {
 public:
-	AndNode(ExpNode * left, ExpNode * right) : BinaryExpNode() {
-		myLeft = left;
-		myRight = right;
-	}
+	ALLOC_TAGGED(AndNode)
+	AndNode(ExpNode * left, ExpNode * right) : BinaryExpNode(left, right) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myLeft;
-	ExpNode * myRight;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	// Only the left operand is always evaluated
+	ExpNode ** leadingCall(ExpNode ** slot, Inliner * inliner);
+	void collectFlow(FlowGraph * flow);
+	void compileJump(BytecodeGen * gen, bool ifTrue, std::vector<size_t>& jumps);
+	void genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label);
+	void lowerIRBranch(IRBuilder * ir, IRBlock * ifTrue, IRBlock * ifFalse);
 };
 
 class OrNode : public BinaryExpNode {
 public:
-	OrNode(ExpNode * left, ExpNode * right) : BinaryExpNode() {
-		myLeft = left;
-		myRight = right;
-	}
+	ALLOC_TAGGED(OrNode)
+	OrNode(ExpNode * left, ExpNode * right) : BinaryExpNode(left, right) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myLeft;
-	ExpNode * myRight;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	// Only the left operand is always evaluated
+	ExpNode ** leadingCall(ExpNode ** slot, Inliner * inliner);
+	void collectFlow(FlowGraph * flow);
+	void compileJump(BytecodeGen * gen, bool ifTrue, std::vector<size_t>& jumps);
+	void genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label);
+	void lowerIRBranch(IRBuilder * ir, IRBlock * ifTrue, IRBlock * ifFalse);
 };
 
 class EqualsNode : public BinaryExpNode {
 public:
-	EqualsNode(ExpNode * left, ExpNode * right) : BinaryExpNode() {
-		myLeft = left;
-		myRight = right;
-	}
+	ALLOC_TAGGED(EqualsNode)
+	EqualsNode(ExpNode * left, ExpNode * right) : BinaryExpNode(left, right) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myLeft;
-	ExpNode * myRight;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	void compileJump(BytecodeGen * gen, bool ifTrue, std::vector<size_t>& jumps);
+	void genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label);
 };
 
 class NotEqualsNode : public BinaryExpNode {
 public:
-	NotEqualsNode(ExpNode * left, ExpNode * right) : BinaryExpNode() {
-		myLeft = left;
-		myRight = right;
-	}
+	ALLOC_TAGGED(NotEqualsNode)
+	NotEqualsNode(ExpNode * left, ExpNode * right) : BinaryExpNode(left, right) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myLeft;
-	ExpNode * myRight;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	void compileJump(BytecodeGen * gen, bool ifTrue, std::vector<size_t>& jumps);
+	void genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label);
 };
 
 class LessNode : public BinaryExpNode {
 public:
-	LessNode(ExpNode * left, ExpNode * right) : BinaryExpNode() {
-		myLeft = left;
-		myRight = right;
-	}
+	ALLOC_TAGGED(LessNode)
+	LessNode(ExpNode * left, ExpNode * right) : BinaryExpNode(left, right) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myLeft;
-	ExpNode * myRight;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	void compileJump(BytecodeGen * gen, bool ifTrue, std::vector<size_t>& jumps);
+	void genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label);
 };
 
 class GreaterNode : public BinaryExpNode {
 public:
-	GreaterNode(ExpNode * left, ExpNode * right) : BinaryExpNode() {
-		myLeft = left;
-		myRight = right;
-	}
+	ALLOC_TAGGED(GreaterNode)
+	GreaterNode(ExpNode * left, ExpNode * right) : BinaryExpNode(left, right) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myLeft;
-	ExpNode * myRight;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	void compileJump(BytecodeGen * gen, bool ifTrue, std::vector<size_t>& jumps);
+	void genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label);
 };
 
 class LessEqNode : public BinaryExpNode {
 public:
-	LessEqNode(ExpNode * left, ExpNode * right) : BinaryExpNode() {
-		myLeft = left;
-		myRight = right;
-	}
+	ALLOC_TAGGED(LessEqNode)
+	LessEqNode(ExpNode * left, ExpNode * right) : BinaryExpNode(left, right) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myLeft;
-	ExpNode * myRight;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	void compileJump(BytecodeGen * gen, bool ifTrue, std::vector<size_t>& jumps);
+	void genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label);
 };
 
 class GreaterEqNode : public BinaryExpNode {
 public:
-	GreaterEqNode(ExpNode * left, ExpNode * right) : BinaryExpNode() {
-		myLeft = left;
-		myRight = right;
-	}
+	ALLOC_TAGGED(GreaterEqNode)
+	GreaterEqNode(ExpNode * left, ExpNode * right) : BinaryExpNode(left, right) {}
 	void unparse(std::ostream& out, int indent);
-private:
-	ExpNode * myLeft;
-	ExpNode * myRight;
+	ExpNode * fold(Folder * folder);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	void compileJump(BytecodeGen * gen, bool ifTrue, std::vector<size_t>& jumps);
+	void genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label);
 };
 
 class TrueNode : public ExpNode {
 public:
-	TrueNode() : ExpNode() {}
+	ALLOC_TAGGED(TrueNode)
+	TrueNode(SynSymbol * token) : ExpNode() {
+		myLine = token->line;
+		myCol = token->column;
+	}
+	TrueNode(size_t line, size_t col) : ExpNode() {
+		myLine = line;
+		myCol = col;
+	}
 	void unparse(std::ostream& out, int indent);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	bool isStable(){ return true; }
+	void compileJump(BytecodeGen * gen, bool ifTrue, std::vector<size_t>& jumps);
+	void genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label);
+	size_t getLine(){ return myLine; }
+	size_t getCol(){ return myCol; }
+private:
+	size_t myLine;
+	size_t myCol;
 };
 
 class FalseNode : public ExpNode {
 public:
-	FalseNode() : ExpNode() {}
+	ALLOC_TAGGED(FalseNode)
+	FalseNode(SynSymbol * token) : ExpNode() {
+		myLine = token->line;
+		myCol = token->column;
+	}
+	FalseNode(size_t line, size_t col) : ExpNode() {
+		myLine = line;
+		myCol = col;
+	}
 	void unparse(std::ostream& out, int indent);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	bool isStable(){ return true; }
+	void compileJump(BytecodeGen * gen, bool ifTrue, std::vector<size_t>& jumps);
+	void genAsmJump(AsmGen * gen, bool ifTrue, const std::string& label);
+	size_t getLine(){ return myLine; }
+	size_t getCol(){ return myCol; }
+private:
+	size_t myLine;
+	size_t myCol;
 };
 
 
@@ -643,22 +1426,60 @@ public:
 
 class IntLitNode : public ExpNode {
 public:
+	ALLOC_TAGGED(IntLitNode)
 	IntLitNode(IntLitToken * token) : ExpNode() {
 		myVal = token->value();
+		myLine = token->line;
+		myCol = token->column;
+	}
+	// A literal computed by the compiler, reported at line:col
+	IntLitNode(int value, size_t line, size_t col) : ExpNode() {
+		myVal = value;
+		myLine = line;
+		myCol = col;
 	}
 	void unparse(std::ostream& out, int indent);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	bool isStable(){ return true; }
+	size_t getLine(){ return myLine; }
+	size_t getCol(){ return myCol; }
+	int getValue(){ return myVal; }
 private:
 	int myVal;
+	size_t myLine;
+	size_t myCol;
 };
 
 class StringLitNode : public ExpNode {
 public:
+	ALLOC_TAGGED(StringLitNode)
 	StringLitNode(StringLitToken * token) : ExpNode() {
+		ALLOC_SCOPE("std::string");
 		myVal = token->value();
+		myLine = token->line;
+		myCol = token->column;
 	}
 	void unparse(std::ostream& out, int indent);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	ExpNode * clone(Inliner * inliner);
+	bool isStable(){ return true; }
+	size_t getLine(){ return myLine; }
+	size_t getCol(){ return myCol; }
+	// The literal as written, quotes and escapes included
+	const std::string& getLexeme(){ return myVal; }
 private:
 	std::string myVal;
+	size_t myLine;
+	size_t myCol;
 };
 
 
@@ -667,37 +1488,107 @@ public:
 	TypeNode() : ASTNode(){
 	}
 	virtual void unparse(std::ostream& out, int indent) = 0;
+	virtual bool isVoid(){ return false; }
+	virtual DataType getDataType() = 0;
+	// Storage for a value of this type in bytes (layout.cpp)
+	virtual int getSize() = 0;
+	virtual int getAlignment() = 0;
+	// The struct a struct type names, once name analysis resolved it
+	virtual StructDef * getStruct(){ return nullptr; }
 };
 
 class IdNode : public ExpNode{
 public:
+	ALLOC_TAGGED(IdNode)
 	IdNode(IDToken * token) : ExpNode(){
+		ALLOC_SCOPE("std::string");
 		myStrVal = token->value();
+		myLine = token->line;
+		myCol = token->column;
+	}
+	// A name made up by the compiler, reported at line:col
+	IdNode(const std::string& name, size_t line, size_t col) : ExpNode(){
+		ALLOC_SCOPE("std::string");
+		myStrVal = name;
+		myLine = line;
+		myCol = col;
 	}
 	void unparse(std::ostream& out, int indent);
+	DataType typeCheck(BodyChecker * checker);
+	int eval(Interpreter * interp);
+	int compile(BytecodeGen * gen, int dest);
+	void genAsm(AsmGen * gen);
+	IRInstr * lowerIR(IRBuilder * ir);
+	IdNode * clone(Inliner * inliner);
+	bool isStable();
+	void collectFlow(FlowGraph * flow);
+	bool nameAnalysis(SymbolTable * symTab);
+	IdNode * locId(){ return this; }
+	char * address(Interpreter * interp);
+	const std::string& getName(){ return myStrVal; }
+	size_t getLine(){ return myLine; }
+	size_t getCol(){ return myCol; }
+	// The declaration this name resolved to; null before name analysis
+	// or if it is undeclared.
+	SemSymbol * getSymbol(){ return mySymbol; }
+	void setSymbol(SemSymbol * symbol){ mySymbol = symbol; }
 private:
 	std::string myStrVal;
+	size_t myLine;
+	size_t myCol;
+	SemSymbol * mySymbol = nullptr;
 };
 
 class IntNode : public TypeNode{
 public:
+	ALLOC_TAGGED(IntNode)
 	IntNode(): TypeNode(){
 	}
 	void unparse(std::ostream& out, int indent);
+	DataType getDataType();
+	int getSize();
+	int getAlignment();
 };
 
 class BoolNode : public TypeNode{
 public:
+	ALLOC_TAGGED(BoolNode)
 	BoolNode(): TypeNode(){
 	}
 	void unparse(std::ostream& out, int indent);
+	DataType getDataType();
+	int getSize();
+	int getAlignment();
 };
 
 class VoidNode : public TypeNode{
 public:
+	ALLOC_TAGGED(VoidNode)
 	VoidNode(): TypeNode(){
 	}
 	void unparse(std::ostream& out, int indent);
+	DataType getDataType();
+	int getSize();
+	int getAlignment();
+	bool isVoid(){ return true; }
+};
+
+class StructNode : public TypeNode{
+public:
+	ALLOC_TAGGED(StructNode)
+	StructNode(IdNode * id): TypeNode(){
+		myId = id;
+	}
+	void unparse(std::ostream& out, int indent);
+	DataType getDataType();
+	int getSize();
+	int getAlignment();
+	void collectStats(CompilerStats& stats);
+	bool nameAnalysis(SymbolTable * symTab);
+	StructDef * getStruct();
+	IdNode * getId(){ return myId; }
+private:
+	IdNode * myId;
 };
 
 } //End namespace LIL' C
@@ -0,0 +1,64 @@
+#include <iomanip>
+
+#include "bytecode.hpp"
+
+namespace LILC{
+
+static const OpcodeInfo OPCODE_INFO[] = {
+#define LILC_OPCODE_INFO(name, a, b, c) { #name, { OPND_##a, OPND_##b, OPND_##c } },
+	LILC_OPCODES(LILC_OPCODE_INFO)
+#undef LILC_OPCODE_INFO
+};
+
+const OpcodeInfo& opcodeInfo(int op){
+	return OPCODE_INFO[op];
+}
+
+size_t BytecodeProgram::codeSize() const{
+	size_t size = 0;
+	for (const BytecodeFunction& fn : functions){
+		size += fn.code.size();
+	}
+	return size;
+}
+
+static void operand(std::ostream& out, const BytecodeProgram& program,
+	OperandKind kind, int32_t value){
+	switch (kind){
+		case OPND_R: out << "r" << value; break;
+		case OPND_K: out << value; break;
+		case OPND_G: out << "g" << value; break;
+		case OPND_L: out << "@" << value; break;
+		case OPND_F: out << program.functions[value].name; break;
+		case OPND_S: out << program.strings[value]; break;
+		default: break;
+	}
+}
+
+void BytecodeProgram::disassemble(std::ostream& out) const{
+	out << "; " << functions.size() << " functions, " << codeSize()
+		<< " instructions, " << numGlobals << " globals\n";
+	for (const BytecodeFunction& fn : functions){
+		out << "\n" << fn.name << ": ; " << fn.numParams << " params, "
+			<< fn.numRegs << " registers\n";
+		for (size_t pc = 0; pc < fn.code.size(); pc++){
+			const Insn& insn = fn.code[pc];
+			const OpcodeInfo& info = opcodeInfo(insn.op);
+			out << std::setw(6) << pc << "  " << std::left << std::setw(7)
+				<< info.name << std::right;
+			const int32_t values[3] = { insn.a, insn.b, insn.c };
+			const char * sep = " ";
+			for (int k = 0; k < 3; k++){
+				if (info.operands[k] == OPND_NONE){
+					continue;
+				}
+				out << sep;
+				operand(out, *this, info.operands[k], values[k]);
+				sep = ", ";
+			}
+			out << "\n";
+		}
+	}
+}
+
+} //End namespace LIL' C
@@ -0,0 +1,185 @@
+#ifndef LILC_BYTECODE_HPP
+#define LILC_BYTECODE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace LILC{
+
+class ProgramNode;
+class FnDeclNode;
+class SemSymbol;
+class StructDef;
+class ExpNode;
+class IRProgram;
+
+// Register bytecode (bytecode_gen.cpp lowers the AST to it, vm.cpp runs
+// it, bytecode.cpp disassembles it).
+//
+// Every function gets a frame of 32-bit registers: one per scalar
+// variable, with a struct variable taking one register per int or bool
+// leaf, followed by temporaries. Formals are registers 0..n-1. Globals
+// live in a separate array and are only reached through LOADG/STOREG.
+// Bools are 0 or 1. Operands are resolved register, global, function and
+// string indices, constants (K) and jump targets (L, an index into the
+// function's code), always in field c.
+//
+// Conditions of if and while compile to fused compare-and-branch
+// instructions (JLT a, b, L: jump if a < b; JLTI a, k, L: jump if a < k)
+// and while loops test at the bottom, so a loop iteration costs one
+// branch.
+
+// Operand kinds, for the disassembler and for renumbering temporaries
+enum OperandKind : uint8_t { OPND_NONE, OPND_R, OPND_K, OPND_G, OPND_L, OPND_F, OPND_S };
+
+#define LILC_OPCODES(X) \
+	X(MOV,    R, R, NONE) /* a = b */ \
+	X(LOADK,  R, K, NONE) /* a = k */ \
+	X(LOADG,  R, G, NONE) /* a = globals[g] */ \
+	X(STOREG, R, G, NONE) /* globals[g] = a */ \
+	X(ADD,    R, R, R) \
+	X(SUB,    R, R, R) \
+	X(MUL,    R, R, R) \
+	X(DIV,    R, R, R) \
+	X(ADDI,   R, R, K) /* a = b + k */ \
+	X(NEG,    R, R, NONE) \
+	X(NOT,    R, R, NONE) \
+	X(EQ,     R, R, R) /* a = b == c */ \
+	X(NE,     R, R, R) \
+	X(LT,     R, R, R) \
+	X(GT,     R, R, R) \
+	X(LE,     R, R, R) \
+	X(GE,     R, R, R) \
+	X(JMP,    NONE, NONE, L) \
+	X(JT,     R, NONE, L) /* jump if a */ \
+	X(JF,     R, NONE, L) \
+	X(JEQ,    R, R, L) /* jump if a == b */ \
+	X(JNE,    R, R, L) \
+	X(JLT,    R, R, L) \
+	X(JGT,    R, R, L) \
+	X(JLE,    R, R, L) \
+	X(JGE,    R, R, L) \
+	X(JEQI,   R, K, L) /* jump if a == k */ \
+	X(JNEI,   R, K, L) \
+	X(JLTI,   R, K, L) \
+	X(JGTI,   R, K, L) \
+	X(JLEI,   R, K, L) \
+	X(JGEI,   R, K, L) \
+	X(CALL,   R, F, R) /* a = f(registers c..), arguments in c.. */ \
+	X(TCALL,  R, F, R) /* return f(registers c..) in this frame */ \
+	X(RET,    R, NONE, NONE) \
+	X(RET0,   NONE, NONE, NONE) \
+	X(READ,   R, NONE, NONE) \
+	X(READB,  R, NONE, NONE) \
+	X(WRITE,  R, NONE, NONE) \
+	X(WRITES, S, NONE, NONE)
+
+enum Opcode : uint8_t {
+#define LILC_OPCODE_ENUM(name, a, b, c) OP_##name,
+	LILC_OPCODES(LILC_OPCODE_ENUM)
+#undef LILC_OPCODE_ENUM
+	NUM_OPCODES
+};
+
+struct Insn {
+	uint8_t op;
+	int32_t a;
+	int32_t b;
+	int32_t c;
+};
+
+struct OpcodeInfo {
+	const char * name;
+	OperandKind operands[3];
+};
+
+const OpcodeInfo& opcodeInfo(int op);
+
+struct BytecodeFunction {
+	std::string name;
+	int numParams = 0;
+	int numRegs = 0;
+	std::vector<Insn> code;
+	// Source position of each instruction, for runtime errors
+	std::vector<std::pair<size_t, size_t>> positions;
+};
+
+struct BytecodeProgram {
+	std::vector<BytecodeFunction> functions;
+	std::vector<std::string> strings;
+	int numGlobals = 0;
+	int main = -1;
+
+	size_t codeSize() const;
+	void disassemble(std::ostream& out) const;
+};
+
+// Lowers one program. The AST nodes call back into it (bytecode_gen.cpp).
+class BytecodeGen{
+public:
+	BytecodeGen(BytecodeProgram * program){ myProgram = program; }
+
+	// Functions with SSA form in ir are lowered from it (ir.cpp) instead
+	// of from their AST
+	void useIR(IRProgram * ir){ myIR = ir; }
+	IRProgram * getIR(){ return myIR; }
+
+	// Where a variable or one leaf of a struct variable lives
+	struct Location {
+		bool global;
+		int index;
+	};
+
+	void beginFunction(FnDeclNode * fn);
+	void endFunction();
+	int functionIndex(FnDeclNode * fn);
+	// Gives a variable its registers, or its globals at the outermost level
+	void declare(SemSymbol * sym);
+	Location locate(SemSymbol * sym, int offset);
+	int string(const std::string& lexeme);
+
+	size_t emit(Opcode op, int a, int b, int c, ExpNode * at = nullptr);
+	size_t pc(){ return myFn->code.size(); }
+	void patch(const std::vector<size_t>& jumps, size_t target);
+
+	// Temporaries are allocated stack-like within a statement
+	int temp();
+	int mark(){ return myTemps; }
+	void release(int mark){ myTemps = mark; }
+	// The first of n consecutive temporaries
+	int temps(int n);
+	// dest, or a new temporary if dest is -1
+	int target(int dest){ return dest < 0 ? temp() : dest; }
+	bool isTemp(int reg){ return reg >= TEMP_BASE; }
+
+	// Reports something that cannot be lowered on cerr
+	void error(ExpNode * at, const char * msg);
+	bool failed(){ return myFailed; }
+private:
+	static const int TEMP_BASE = 1 << 24;
+
+	// Leaf index of every byte offset a scalar field of def starts at,
+	// -1 elsewhere; nested structs are flattened in layout order
+	const std::vector<int>& leaves(StructDef * def);
+	int leafCount(StructDef * def);
+
+	BytecodeProgram * myProgram;
+	IRProgram * myIR = nullptr;
+	BytecodeFunction * myFn = nullptr;
+	std::unordered_map<FnDeclNode *, int> myFunctions;
+	std::unordered_map<SemSymbol *, int> mySlots;
+	std::unordered_map<std::string, int> myStrings;
+	std::unordered_map<StructDef *, std::vector<int>> myLeaves;
+	int myVars = 0;
+	int myTemps = 0;
+	int myMaxTemps = 0;
+	bool myFailed = false;
+};
+
+} //End namespace LIL' C
+
+#endif
@@ -0,0 +1,650 @@
+#include <algorithm>
+#include <iostream>
+
+#include "ast.hpp"
+#include "bytecode.hpp"
+#include "ir.hpp"
+#include "lilc_arith.hpp"
+#include "symbol_table.hpp"
+
+// Lowering a type-checked AST to register bytecode (see bytecode.hpp).
+
+namespace LILC{
+
+// BytecodeGen
+
+void BytecodeGen::beginFunction(FnDeclNode * fn){
+	myFn = &myProgram->functions[functionIndex(fn)];
+	if (fn->getFormals() != nullptr){
+		myFn->numParams = fn->getFormals()->getFormals().size();
+	}
+	myVars = 0;
+	myTemps = 0;
+	myMaxTemps = 0;
+}
+
+void BytecodeGen::endFunction(){
+	// Temporaries go after the last variable, now that it is known
+	for (Insn& insn : myFn->code){
+		const OpcodeInfo& info = opcodeInfo(insn.op);
+		int32_t * fields[3] = { &insn.a, &insn.b, &insn.c };
+		for (int k = 0; k < 3; k++){
+			if (info.operands[k] == OPND_R && *fields[k] >= TEMP_BASE){
+				*fields[k] += myVars - TEMP_BASE;
+			}
+		}
+	}
+	myFn->numRegs = myVars + myMaxTemps;
+	myFn = nullptr;
+}
+
+int BytecodeGen::functionIndex(FnDeclNode * fn){
+	auto found = myFunctions.find(fn);
+	if (found != myFunctions.end()){
+		return found->second;
+	}
+	int index = myProgram->functions.size();
+	myProgram->functions.emplace_back();
+	myProgram->functions.back().name = fn->getId()->getName();
+	myFunctions[fn] = index;
+	if (fn->getId()->getName() == "main"){
+		myProgram->main = index;
+	}
+	return index;
+}
+
+const std::vector<int>& BytecodeGen::leaves(StructDef * def){
+	auto found = myLeaves.find(def);
+	if (found != myLeaves.end()){
+		return found->second;
+	}
+	std::vector<int> map(def->getSize(), -1);
+	int count = 0;
+	for (SemSymbol * field : def->getFields()){
+		StructDef * nested = field->getStruct();
+		if (nested == nullptr){
+			map[field->getOffset()] = count++;
+			continue;
+		}
+		const std::vector<int>& inner = leaves(nested);
+		int innerCount = 0;
+		for (size_t offset = 0; offset < inner.size(); offset++){
+			if (inner[offset] >= 0){
+				map[field->getOffset() + offset] = count + inner[offset];
+				innerCount++;
+			}
+		}
+		count += innerCount;
+	}
+	return myLeaves[def] = std::move(map);
+}
+
+int BytecodeGen::leafCount(StructDef * def){
+	const std::vector<int>& map = leaves(def);
+	return std::count_if(map.begin(), map.end(), [](int leaf){ return leaf >= 0; });
+}
+
+void BytecodeGen::declare(SemSymbol * sym){
+	int count = sym->getStruct() == nullptr ? 1 : leafCount(sym->getStruct());
+	if (sym->isGlobal()){
+		mySlots[sym] = myProgram->numGlobals;
+		myProgram->numGlobals += count;
+	} else {
+		mySlots[sym] = myVars;
+		myVars += count;
+	}
+}
+
+BytecodeGen::Location BytecodeGen::locate(SemSymbol * sym, int offset){
+	int index = mySlots[sym];
+	if (sym->getStruct() != nullptr){
+		index += leaves(sym->getStruct())[offset];
+	}
+	return Location{ sym->isGlobal(), index };
+}
+
+int BytecodeGen::string(const std::string& lexeme){
+	auto found = myStrings.find(lexeme);
+	if (found != myStrings.end()){
+		return found->second;
+	}
+	int index = myProgram->strings.size();
+	myProgram->strings.push_back(lexeme);
+	myStrings[lexeme] = index;
+	return index;
+}
+
+size_t BytecodeGen::emit(Opcode op, int a, int b, int c, ExpNode * at){
+	Insn insn = { (uint8_t)op, a, b, c };
+	myFn->code.push_back(insn);
+	if (at != nullptr){
+		myFn->positions.emplace_back(at->getLine(), at->getCol());
+	} else {
+		myFn->positions.emplace_back(0, 0);
+	}
+	return myFn->code.size() - 1;
+}
+
+void BytecodeGen::patch(const std::vector<size_t>& jumps, size_t target){
+	for (size_t jump : jumps){
+		myFn->code[jump].c = target;
+	}
+}
+
+int BytecodeGen::temp(){
+	return temps(1);
+}
+
+int BytecodeGen::temps(int n){
+	int first = TEMP_BASE + myTemps;
+	myTemps += n;
+	myMaxTemps = std::max(myMaxTemps, myTemps);
+	return first;
+}
+
+void BytecodeGen::error(ExpNode * at, const char * msg){
+	std::cerr << at->getLine() << ":" << at->getCol()
+		<< " ***ERROR*** " << msg << "\n";
+	myFailed = true;
+}
+
+// Declarations
+
+void ProgramNode::compile(BytecodeGen * gen){
+	// Numbered up front so calls can refer to any function
+	for (DeclNode * decl : myDeclList->getDecls()){
+		FnDeclNode * fn = dynamic_cast<FnDeclNode *>(decl);
+		if (fn != nullptr){
+			gen->functionIndex(fn);
+		}
+	}
+	myDeclList->compile(gen);
+}
+
+void DeclListNode::compile(BytecodeGen * gen){
+	for (DeclNode * decl : myDecls){
+		decl->compile(gen);
+	}
+}
+
+void VarDeclListNode::compile(BytecodeGen * gen){
+	for (VarDeclNode * decl : myVarDecls){
+		decl->compile(gen);
+	}
+}
+
+void FormalsListNode::compile(BytecodeGen * gen){
+	for (FormalDeclNode * formal : myFormals){
+		formal->compile(gen);
+	}
+}
+
+void VarDeclNode::compile(BytecodeGen * gen){
+	gen->declare(myId->getSymbol());
+}
+
+void FormalDeclNode::compile(BytecodeGen * gen){
+	gen->declare(myId->getSymbol());
+}
+
+void FnDeclNode::compile(BytecodeGen * gen){
+	gen->beginFunction(this);
+	IRFunction * ir = gen->getIR() == nullptr ? nullptr : gen->getIR()->find(this);
+	if (ir != nullptr){
+		ir->toBytecode(gen);
+		gen->endFunction();
+		return;
+	}
+	if (myFormals != nullptr){
+		myFormals->compile(gen);
+	}
+	myBody->compile(gen);
+	gen->emit(OP_RET0, 0, 0, 0);
+	gen->endFunction();
+}
+
+void FnBodyNode::compile(BytecodeGen * gen){
+	getDecls()->compile(gen);
+	getStmts()->compile(gen);
+}
+
+// Statements
+
+void StmtListNode::compile(BytecodeGen * gen){
+	for (StmtNode * stmt : myList){
+		int mark = gen->mark();
+		stmt->compile(gen);
+		gen->release(mark);
+	}
+}
+
+static BytecodeGen::Location locationOf(BytecodeGen * gen, ExpNode * loc){
+	DotAccessNode * dot = dynamic_cast<DotAccessNode *>(loc);
+	if (dot != nullptr){
+		return gen->locate(dot->getBase()->getSymbol(), dot->getOffset());
+	}
+	return gen->locate(loc->locId()->getSymbol(), 0);
+}
+
+void AssignStmtNode::compile(BytecodeGen * gen){
+	myAssign->compile(gen, -1);
+}
+
+static void addTo(BytecodeGen * gen, ExpNode * loc, int amount){
+	BytecodeGen::Location where = locationOf(gen, loc);
+	if (!where.global){
+		gen->emit(OP_ADDI, where.index, where.index, amount);
+		return;
+	}
+	int reg = gen->temp();
+	gen->emit(OP_LOADG, reg, where.index, 0);
+	gen->emit(OP_ADDI, reg, reg, amount);
+	gen->emit(OP_STOREG, reg, where.index, 0);
+}
+
+void PostIncStmtNode::compile(BytecodeGen * gen){
+	addTo(gen, myLoc, 1);
+}
+
+void PostDecStmtNode::compile(BytecodeGen * gen){
+	addTo(gen, myLoc, -1);
+}
+
+void ReadStmtNode::compile(BytecodeGen * gen){
+	BytecodeGen::Location where = locationOf(gen, myLoc);
+	bool isBool = myLoc->locId()->getSymbol()->getType()->getSize() == 1;
+	Opcode op = isBool ? OP_READB : OP_READ;
+	if (!where.global){
+		gen->emit(op, where.index, 0, 0);
+		return;
+	}
+	int reg = gen->temp();
+	gen->emit(op, reg, 0, 0);
+	gen->emit(OP_STOREG, reg, where.index, 0);
+}
+
+void WriteStmtNode::compile(BytecodeGen * gen){
+	StringLitNode * str = dynamic_cast<StringLitNode *>(myLoc);
+	if (str != nullptr){
+		gen->emit(OP_WRITES, gen->string(str->getLexeme()), 0, 0);
+		return;
+	}
+	gen->emit(OP_WRITE, myLoc->compile(gen, -1), 0, 0);
+}
+
+void ReturnStmtNode::compile(BytecodeGen * gen){
+	if (myLoc == nullptr){
+		gen->emit(OP_RET0, 0, 0, 0);
+		return;
+	}
+	gen->emit(OP_RET, myLoc->compile(gen, -1), 0, 0);
+}
+
+void CallStmtNode::compile(BytecodeGen * gen){
+	myCall->compile(gen, -1);
+}
+
+void IfStmtNode::compile(BytecodeGen * gen){
+	std::vector<size_t> skip;
+	myExp->compileJump(gen, false, skip);
+	myVarList->compile(gen);
+	myStmtList->compile(gen);
+	gen->patch(skip, gen->pc());
+}
+
+void IfElseStmtNode::compile(BytecodeGen * gen){
+	std::vector<size_t> toElse;
+	std::vector<size_t> toEnd;
+	myExp->compileJump(gen, false, toElse);
+	myVarList->compile(gen);
+	myStmtList->compile(gen);
+	toEnd.push_back(gen->emit(OP_JMP, 0, 0, -1));
+	gen->patch(toElse, gen->pc());
+	myElseVarList->compile(gen);
+	myElseStmtList->compile(gen);
+	gen->patch(toEnd, gen->pc());
+}
+
+void WhileStmtNode::compile(BytecodeGen * gen){
+	// Tested at the bottom: one branch per iteration
+	std::vector<size_t> toTest;
+	std::vector<size_t> toBody;
+	toTest.push_back(gen->emit(OP_JMP, 0, 0, -1));
+	size_t body = gen->pc();
+	myVarList->compile(gen);
+	myStmtList->compile(gen);
+	gen->patch(toTest, gen->pc());
+	myExp->compileJump(gen, true, toBody);
+	gen->patch(toBody, body);
+}
+
+// Locations and assignment
+
+static int load(BytecodeGen * gen, ExpNode * loc, int dest){
+	BytecodeGen::Location where = locationOf(gen, loc);
+	if (where.global){
+		int reg = gen->target(dest);
+		gen->emit(OP_LOADG, reg, where.index, 0);
+		return reg;
+	}
+	if (dest < 0 || dest == where.index){
+		return where.index;
+	}
+	gen->emit(OP_MOV, dest, where.index, 0);
+	return dest;
+}
+
+int IdNode::compile(BytecodeGen * gen, int dest){
+	return load(gen, this, dest);
+}
+
+int DotAccessNode::compile(BytecodeGen * gen, int dest){
+	return load(gen, this, dest);
+}
+
+int AssignNode::compile(BytecodeGen * gen, int dest){
+	BytecodeGen::Location where = locationOf(gen, myLeft);
+	if (where.global){
+		int value = myRight->compile(gen, dest);
+		gen->emit(OP_STOREG, value, where.index, 0);
+		return value;
+	}
+	// Straight into the variable's register
+	int value = myRight->compile(gen, where.index);
+	if (dest >= 0 && dest != value){
+		gen->emit(OP_MOV, dest, value, 0);
+		return dest;
+	}
+	return value;
+}
+
+// Values
+
+int IntLitNode::compile(BytecodeGen * gen, int dest){
+	int reg = gen->target(dest);
+	gen->emit(OP_LOADK, reg, myVal, 0);
+	return reg;
+}
+
+int TrueNode::compile(BytecodeGen * gen, int dest){
+	int reg = gen->target(dest);
+	gen->emit(OP_LOADK, reg, 1, 0);
+	return reg;
+}
+
+int FalseNode::compile(BytecodeGen * gen, int dest){
+	int reg = gen->target(dest);
+	gen->emit(OP_LOADK, reg, 0, 0);
+	return reg;
+}
+
+int StringLitNode::compile(BytecodeGen * gen, int dest){
+	gen->error(this, "Strings can only be written");
+	return gen->target(dest);
+}
+
+int CallExpNode::compile(BytecodeGen * gen, int dest){
+	FnDeclNode * fn = static_cast<FnDeclNode *>(myLoc->getSymbol()->getDecl());
+	int mark = gen->mark();
+	int count = myList == nullptr ? 0 : myList->getExps().size();
+	// Actuals go to consecutive registers, which become the formals
+	int args = gen->temps(count);
+	if (myList != nullptr){
+		int arg = args;
+		for (ExpNode * actual : myList->getExps()){
+			actual->compile(gen, arg++);
+		}
+	}
+	gen->release(mark);
+	int reg = gen->target(dest);
+	// A tail call's callee takes over the frame and never comes back
+	gen->emit(myTail ? OP_TCALL : OP_CALL, reg, gen->functionIndex(fn), args,
+		this);
+	return reg;
+}
+
+int ExpListNode::compile(BytecodeGen * gen, int dest){
+	int reg = dest;
+	for (ExpNode * exp : myList){
+		reg = exp->compile(gen, dest);
+	}
+	return reg;
+}
+
+// Operators
+
+// Evaluates left then right into registers. A variable read on the left
+// is copied first if the right side could assign it.
+static void operands(BytecodeGen * gen, ExpNode * left, ExpNode * right,
+	int& a, int& b){
+	a = left->compile(gen, -1);
+	if (!gen->isTemp(a) && right->hasSideEffects()){
+		int copy = gen->temp();
+		gen->emit(OP_MOV, copy, a, 0);
+		a = copy;
+	}
+	b = right->compile(gen, -1);
+}
+
+static int binary(BytecodeGen * gen, Opcode op, ExpNode * left,
+	ExpNode * right, int dest, ExpNode * at = nullptr){
+	int mark = gen->mark();
+	int a, b;
+	operands(gen, left, right, a, b);
+	gen->release(mark);
+	int reg = gen->target(dest);
+	gen->emit(op, reg, a, b, at);
+	return reg;
+}
+
+// left + k
+static int addImmediate(BytecodeGen * gen, ExpNode * left, int k, int dest){
+	int mark = gen->mark();
+	int a = left->compile(gen, -1);
+	gen->release(mark);
+	int reg = gen->target(dest);
+	gen->emit(OP_ADDI, reg, a, k);
+	return reg;
+}
+
+static int unary(BytecodeGen * gen, Opcode op, ExpNode * operand, int dest){
+	int mark = gen->mark();
+	int a = operand->compile(gen, -1);
+	gen->release(mark);
+	int reg = gen->target(dest);
+	gen->emit(op, reg, a, 0);
+	return reg;
+}
+
+int PlusNode::compile(BytecodeGen * gen, int dest){
+	IntLitNode * lit = dynamic_cast<IntLitNode *>(myRight);
+	if (lit != nullptr){
+		return addImmediate(gen, myLeft, lit->getValue(), dest);
+	}
+	return binary(gen, OP_ADD, myLeft, myRight, dest);
+}
+
+int MinusNode::compile(BytecodeGen * gen, int dest){
+	IntLitNode * lit = dynamic_cast<IntLitNode *>(myRight);
+	if (lit != nullptr){
+		return addImmediate(gen, myLeft, lilcNeg(lit->getValue()), dest);
+	}
+	return binary(gen, OP_SUB, myLeft, myRight, dest);
+}
+
+int TimesNode::compile(BytecodeGen * gen, int dest){
+	return binary(gen, OP_MUL, myLeft, myRight, dest);
+}
+
+int DivideNode::compile(BytecodeGen * gen, int dest){
+	return binary(gen, OP_DIV, myLeft, myRight, dest, this);
+}
+
+int UnaryMinusNode::compile(BytecodeGen * gen, int dest){
+	return unary(gen, OP_NEG, myNode, dest);
+}
+
+int NotNode::compile(BytecodeGen * gen, int dest){
+	return unary(gen, OP_NOT, myNode, dest);
+}
+
+// Conditions
+
+void ExpNode::compileJump(BytecodeGen * gen, bool ifTrue,
+	std::vector<size_t>& jumps){
+	int mark = gen->mark();
+	int reg = compile(gen, -1);
+	gen->release(mark);
+	jumps.push_back(gen->emit(ifTrue ? OP_JT : OP_JF, reg, 0, -1));
+}
+
+void NotNode::compileJump(BytecodeGen * gen, bool ifTrue,
+	std::vector<size_t>& jumps){
+	myNode->compileJump(gen, !ifTrue, jumps);
+}
+
+void TrueNode::compileJump(BytecodeGen * gen, bool ifTrue,
+	std::vector<size_t>& jumps){
+	if (ifTrue){
+		jumps.push_back(gen->emit(OP_JMP, 0, 0, -1));
+	}
+}
+
+void FalseNode::compileJump(BytecodeGen * gen, bool ifTrue,
+	std::vector<size_t>& jumps){
+	if (!ifTrue){
+		jumps.push_back(gen->emit(OP_JMP, 0, 0, -1));
+	}
+}
+
+void AndNode::compileJump(BytecodeGen * gen, bool ifTrue,
+	std::vector<size_t>& jumps){
+	if (!ifTrue){
+		myLeft->compileJump(gen, false, jumps);
+		myRight->compileJump(gen, false, jumps);
+		return;
+	}
+	std::vector<size_t> skip;
+	myLeft->compileJump(gen, false, skip);
+	myRight->compileJump(gen, true, jumps);
+	gen->patch(skip, gen->pc());
+}
+
+void OrNode::compileJump(BytecodeGen * gen, bool ifTrue,
+	std::vector<size_t>& jumps){
+	if (ifTrue){
+		myLeft->compileJump(gen, true, jumps);
+		myRight->compileJump(gen, true, jumps);
+		return;
+	}
+	std::vector<size_t> skip;
+	myLeft->compileJump(gen, true, skip);
+	myRight->compileJump(gen, false, jumps);
+	gen->patch(skip, gen->pc());
+}
+
+// The value of a condition: 1 or 0
+static int conditionValue(BytecodeGen * gen, ExpNode * cond, int dest){
+	std::vector<size_t> isFalse;
+	std::vector<size_t> done;
+	cond->compileJump(gen, false, isFalse);
+	int reg = gen->target(dest);
+	gen->emit(OP_LOADK, reg, 1, 0);
+	done.push_back(gen->emit(OP_JMP, 0, 0, -1));
+	gen->patch(isFalse, gen->pc());
+	gen->emit(OP_LOADK, reg, 0, 0);
+	gen->patch(done, gen->pc());
+	return reg;
+}
+
+int AndNode::compile(BytecodeGen * gen, int dest){
+	return conditionValue(gen, this, dest);
+}
+
+int OrNode::compile(BytecodeGen * gen, int dest){
+	return conditionValue(gen, this, dest);
+}
+
+// Comparisons, in the order of their opcodes
+enum Comparison { CMP_EQ, CMP_NE, CMP_LT, CMP_GT, CMP_LE, CMP_GE };
+static const Comparison NEGATED[] = { CMP_NE, CMP_EQ, CMP_GE, CMP_LE, CMP_GT, CMP_LT };
+
+static int compare(BytecodeGen * gen, Comparison cmp, ExpNode * left,
+	ExpNode * right, int dest){
+	return binary(gen, Opcode(OP_EQ + cmp), left, right, dest);
+}
+
+// Fused compare-and-branch, against a constant if the right side is one
+static void compareJump(BytecodeGen * gen, Comparison cmp, ExpNode * left,
+	ExpNode * right, bool ifTrue, std::vector<size_t>& jumps){
+	if (!ifTrue){
+		cmp = NEGATED[cmp];
+	}
+	int mark = gen->mark();
+	IntLitNode * lit = dynamic_cast<IntLitNode *>(right);
+	if (lit != nullptr){
+		int a = left->compile(gen, -1);
+		jumps.push_back(gen->emit(Opcode(OP_JEQI + cmp), a, lit->getValue(), -1));
+	} else {
+		int a, b;
+		operands(gen, left, right, a, b);
+		jumps.push_back(gen->emit(Opcode(OP_JEQ + cmp), a, b, -1));
+	}
+	gen->release(mark);
+}
+
+int EqualsNode::compile(BytecodeGen * gen, int dest){
+	return compare(gen, CMP_EQ, myLeft, myRight, dest);
+}
+
+void EqualsNode::compileJump(BytecodeGen * gen, bool ifTrue,
+	std::vector<size_t>& jumps){
+	compareJump(gen, CMP_EQ, myLeft, myRight, ifTrue, jumps);
+}
+
+int NotEqualsNode::compile(BytecodeGen * gen, int dest){
+	return compare(gen, CMP_NE, myLeft, myRight, dest);
+}
+
+void NotEqualsNode::compileJump(BytecodeGen * gen, bool ifTrue,
+	std::vector<size_t>& jumps){
+	compareJump(gen, CMP_NE, myLeft, myRight, ifTrue, jumps);
+}
+
+int LessNode::compile(BytecodeGen * gen, int dest){
+	return compare(gen, CMP_LT, myLeft, myRight, dest);
+}
+
+void LessNode::compileJump(BytecodeGen * gen, bool ifTrue,
+	std::vector<size_t>& jumps){
+	compareJump(gen, CMP_LT, myLeft, myRight, ifTrue, jumps);
+}
+
+int GreaterNode::compile(BytecodeGen * gen, int dest){
+	return compare(gen, CMP_GT, myLeft, myRight, dest);
+}
+
+void GreaterNode::compileJump(BytecodeGen * gen, bool ifTrue,
+	std::vector<size_t>& jumps){
+	compareJump(gen, CMP_GT, myLeft, myRight, ifTrue, jumps);
+}
+
+int LessEqNode::compile(BytecodeGen * gen, int dest){
+	return compare(gen, CMP_LE, myLeft, myRight, dest);
+}
+
+void LessEqNode::compileJump(BytecodeGen * gen, bool ifTrue,
+	std::vector<size_t>& jumps){
+	compareJump(gen, CMP_LE, myLeft, myRight, ifTrue, jumps);
+}
+
+int GreaterEqNode::compile(BytecodeGen * gen, int dest){
+	return compare(gen, CMP_GE, myLeft, myRight, dest);
+}
+
+void GreaterEqNode::compileJump(BytecodeGen * gen, bool ifTrue,
+	std::vector<size_t>& jumps){
+	compareJump(gen, CMP_GE, myLeft, myRight, ifTrue, jumps);
+}
+
+} //End namespace LIL' C
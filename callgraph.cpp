@@ -0,0 +1,150 @@
+#include <algorithm>
+
+#include "ast.hpp"
+#include "callgraph.hpp"
+#include "symbol_table.hpp"
+
+namespace LILC{
+
+// CallGraph
+
+void CallGraph::build(ProgramNode * program){
+	for (DeclNode * decl : program->getDeclList()->getDecls()){
+		FnDeclNode * fn = dynamic_cast<FnDeclNode *>(decl);
+		if (fn == nullptr){
+			continue;
+		}
+		myFunctions.push_back(fn);
+		if (fn->getId()->getName() == "main"){
+			myEntry = fn;
+		}
+		myCaller = fn;
+		myNodes[fn];
+		fn->getBody()->getStmts()->collectCalls(this);
+	}
+	myCaller = nullptr;
+	// Tarjan's algorithm completes the components callees first
+	for (FnDeclNode * fn : myFunctions){
+		if (myNodes[fn].index < 0){
+			findComponents(fn);
+		}
+	}
+}
+
+void CallGraph::noteCall(CallExpNode * call){
+	myCallSites++;
+	SemSymbol * sym = call->getId()->getSymbol();
+	FnDeclNode * callee = sym == nullptr ? nullptr
+		: dynamic_cast<FnDeclNode *>(sym->getDecl());
+	if (callee == nullptr){
+		return;
+	}
+	std::vector<FnDeclNode *>& callees = myNodes[myCaller].callees;
+	if (std::find(callees.begin(), callees.end(), callee) == callees.end()){
+		callees.push_back(callee);
+	}
+}
+
+void CallGraph::findComponents(FnDeclNode * fn){
+	Node& node = myNodes[fn];
+	node.index = node.lowLink = myNextIndex++;
+	node.onStack = true;
+	myStack.push_back(fn);
+	for (FnDeclNode * callee : node.callees){
+		Node& next = myNodes[callee];
+		if (callee == fn){
+			node.recursive = true;
+		} else if (next.index < 0){
+			findComponents(callee);
+			node.lowLink = std::min(node.lowLink, next.lowLink);
+		} else if (next.onStack){
+			node.lowLink = std::min(node.lowLink, next.index);
+		}
+	}
+	if (node.lowLink != node.index){
+		return;
+	}
+	bool cycle = myStack.back() != fn;
+	FnDeclNode * member;
+	do {
+		member = myStack.back();
+		myStack.pop_back();
+		Node& done = myNodes[member];
+		done.onStack = false;
+		done.recursive = done.recursive || cycle;
+		myBottomUp.push_back(member);
+	} while (member != fn);
+}
+
+std::unordered_set<FnDeclNode *> CallGraph::reachableFrom(FnDeclNode * fn){
+	std::unordered_set<FnDeclNode *> reached = { fn };
+	std::vector<FnDeclNode *> work = { fn };
+	while (!work.empty()){
+		FnDeclNode * next = work.back();
+		work.pop_back();
+		for (FnDeclNode * callee : myNodes[next].callees){
+			if (reached.insert(callee).second){
+				work.push_back(callee);
+			}
+		}
+	}
+	return reached;
+}
+
+// Statements
+
+void StmtListNode::collectCalls(CallGraph * graph){
+	for (StmtNode * stmt : myList){
+		stmt->collectCalls(graph);
+	}
+}
+
+void AssignStmtNode::collectCalls(CallGraph * graph){ myAssign->collectCalls(graph); }
+void PostIncStmtNode::collectCalls(CallGraph * graph){}
+void PostDecStmtNode::collectCalls(CallGraph * graph){}
+void ReadStmtNode::collectCalls(CallGraph * graph){}
+void WriteStmtNode::collectCalls(CallGraph * graph){ myLoc->collectCalls(graph); }
+void CallStmtNode::collectCalls(CallGraph * graph){ myCall->collectCalls(graph); }
+
+void ReturnStmtNode::collectCalls(CallGraph * graph){
+	if (myLoc != nullptr){
+		myLoc->collectCalls(graph);
+	}
+}
+
+void IfStmtNode::collectCalls(CallGraph * graph){
+	myExp->collectCalls(graph);
+	myStmtList->collectCalls(graph);
+}
+
+void IfElseStmtNode::collectCalls(CallGraph * graph){
+	myExp->collectCalls(graph);
+	myStmtList->collectCalls(graph);
+	myElseStmtList->collectCalls(graph);
+}
+
+void WhileStmtNode::collectCalls(CallGraph * graph){
+	myExp->collectCalls(graph);
+	myStmtList->collectCalls(graph);
+}
+
+// Expressions
+
+void AssignNode::collectCalls(CallGraph * graph){
+	myRight->collectCalls(graph);
+}
+
+void CallExpNode::collectCalls(CallGraph * graph){
+	graph->noteCall(this);
+	if (myList != nullptr){
+		myList->collectCalls(graph);
+	}
+}
+
+void ExpListNode::collectCalls(CallGraph * graph){
+	for (ExpNode * exp : myList){
+		exp->collectCalls(graph);
+	}
+}
+
+} //End namespace LIL' C
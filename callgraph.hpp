@@ -0,0 +1,65 @@
+#ifndef LILC_CALLGRAPH_HPP
+#define LILC_CALLGRAPH_HPP
+
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace LILC{
+
+class ProgramNode;
+class FnDeclNode;
+class CallExpNode;
+
+// Which functions of a program call which (callgraph.cpp), read off the
+// CallExpNodes in their bodies. Calls resolve to their FnDeclNode through
+// the symbol name analysis gave the callee's name.
+class CallGraph{
+public:
+	void build(ProgramNode * program);
+
+	// Every function, in declaration order
+	const std::vector<FnDeclNode *>& functions(){ return myFunctions; }
+	// The functions fn calls, each once, in order of first call
+	const std::vector<FnDeclNode *>& callees(FnDeclNode * fn){
+		return myNodes[fn].callees;
+	}
+	// The function named main, or null
+	FnDeclNode * entry(){ return myEntry; }
+	// fn and every function it can reach through calls
+	std::unordered_set<FnDeclNode *> reachableFrom(FnDeclNode * fn);
+	// Whether fn can reach itself through calls
+	bool isRecursive(FnDeclNode * fn){ return myNodes[fn].recursive; }
+	// Every function, callees before their callers except within cycles
+	const std::vector<FnDeclNode *>& bottomUp(){ return myBottomUp; }
+	size_t callSites(){ return myCallSites; }
+
+	// Called by the AST nodes while building
+	void noteCall(CallExpNode * call);
+private:
+	struct Node {
+		std::vector<FnDeclNode *> callees;
+		bool recursive = false;
+		// Tarjan's algorithm
+		int index = -1;
+		int lowLink = 0;
+		bool onStack = false;
+	};
+
+	void findComponents(FnDeclNode * fn);
+
+	std::vector<FnDeclNode *> myFunctions;
+	std::unordered_map<FnDeclNode *, Node> myNodes;
+	FnDeclNode * myEntry = nullptr;
+	// While building: the function whose body is being read
+	FnDeclNode * myCaller = nullptr;
+	std::vector<FnDeclNode *> myBottomUp;
+	std::vector<FnDeclNode *> myStack;
+	int myNextIndex = 0;
+	size_t myCallSites = 0;
+};
+
+} //End namespace LIL' C
+
+#endif
@@ -0,0 +1,483 @@
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+#include "ast.hpp"
+#include "dataflow.hpp"
+#include "symbol_table.hpp"
+
+#if defined(__GNUC__)
+#define LILC_BITSET_VECTOR 1
+// Four words a step; becomes AVX2 or pairs of SSE2 operations on x86-64
+typedef uint64_t Words4 __attribute__((vector_size(32)));
+#endif
+
+namespace LILC{
+
+// BitSet
+
+void BitSet::clear(){
+	std::fill(myWords.begin(), myWords.end(), 0);
+}
+
+size_t BitSet::count() const {
+	size_t total = 0;
+	for (uint64_t word : myWords){
+		total += __builtin_popcountll(word);
+	}
+	return total;
+}
+
+bool BitSet::unite(const BitSet& other){
+	uint64_t * words = myWords.data();
+	const uint64_t * add = other.myWords.data();
+	size_t n = myWords.size();
+	size_t w = 0;
+	uint64_t changed = 0;
+#ifdef LILC_BITSET_VECTOR
+	for (; w + 4 <= n; w += 4){
+		Words4 old, more;
+		memcpy(&old, words + w, sizeof(old));
+		memcpy(&more, add + w, sizeof(more));
+		Words4 diff = more & ~old;
+		changed |= diff[0] | diff[1] | diff[2] | diff[3];
+		old |= more;
+		memcpy(words + w, &old, sizeof(old));
+	}
+#endif
+	for (; w < n; w++){
+		changed |= add[w] & ~words[w];
+		words[w] |= add[w];
+	}
+	return changed != 0;
+}
+
+void BitSet::subtract(const BitSet& other){
+	for (size_t w = 0; w < myWords.size(); w++){
+		myWords[w] &= ~other.myWords[w];
+	}
+}
+
+bool BitSet::transfer(const BitSet& in, const BitSet& gen,
+	const BitSet& kill){
+	uint64_t * words = myWords.data();
+	const uint64_t * inWords = in.myWords.data();
+	const uint64_t * genWords = gen.myWords.data();
+	const uint64_t * killWords = kill.myWords.data();
+	size_t n = myWords.size();
+	size_t w = 0;
+	uint64_t changed = 0;
+#ifdef LILC_BITSET_VECTOR
+	for (; w + 4 <= n; w += 4){
+		Words4 old, i, g, k;
+		memcpy(&old, words + w, sizeof(old));
+		memcpy(&i, inWords + w, sizeof(i));
+		memcpy(&g, genWords + w, sizeof(g));
+		memcpy(&k, killWords + w, sizeof(k));
+		Words4 now = g | (i & ~k);
+		Words4 diff = now ^ old;
+		changed |= diff[0] | diff[1] | diff[2] | diff[3];
+		memcpy(words + w, &now, sizeof(now));
+	}
+#endif
+	for (; w < n; w++){
+		uint64_t now = genWords[w] | (inWords[w] & ~killWords[w]);
+		changed |= now ^ words[w];
+		words[w] = now;
+	}
+	return changed != 0;
+}
+
+// FlowGraph
+
+const uint32_t FlowGraph::ENTRY;
+const uint32_t FlowGraph::EXIT;
+
+void FlowGraph::build(FnDeclNode * fn){
+	myBlocks.assign(2, FlowBlock());
+	myVars.clear();
+	myIndex.clear();
+	myNumStructs = 0;
+	myNumEvents = 0;
+	myCurrent = ENTRY;
+	myStmt = nullptr;
+	myConditional = 0;
+	if (fn->getFormals() != nullptr){
+		for (FormalDeclNode * formal : fn->getFormals()->getFormals()){
+			declare(formal->getId());
+		}
+	}
+	myNumFormals = myVars.size();
+	declare(fn->getBody()->getDecls());
+	myNumLocals = myVars.size();
+	fn->getBody()->getStmts()->buildFlow(this);
+	edge(myCurrent, EXIT);
+}
+
+void FlowGraph::declare(VarDeclListNode * decls){
+	for (VarDeclNode * decl : decls->getDecls()){
+		declare(decl->getId());
+	}
+}
+
+void FlowGraph::declare(IdNode * id){
+	SemSymbol * sym = id->getSymbol();
+	if (sym == nullptr){
+		return;
+	}
+	if (sym->getStruct() != nullptr){
+		myNumStructs++;
+		return;
+	}
+	if (myIndex.emplace(sym, (uint32_t)myVars.size()).second){
+		myVars.push_back(sym);
+	}
+}
+
+void FlowGraph::record(FlowEvent::Kind kind, IdNode * id, bool store){
+	auto found = myIndex.find(id->getSymbol());
+	if (found == myIndex.end()){
+		return;
+	}
+	FlowEvent event = { kind, myConditional > 0, store, found->second, id,
+		myStmt };
+	myBlocks[myCurrent].events.push_back(event);
+	myNumEvents++;
+}
+
+void FlowGraph::use(IdNode * id){
+	record(FlowEvent::USE, id, false);
+}
+
+void FlowGraph::def(IdNode * id, bool store){
+	record(FlowEvent::DEF, id, store && myConditional == 0);
+}
+
+uint32_t FlowGraph::newBlock(){
+	myBlocks.push_back(FlowBlock());
+	return myBlocks.size() - 1;
+}
+
+void FlowGraph::edge(uint32_t from, uint32_t to){
+	myBlocks[from].succs.push_back(to);
+	myBlocks[to].preds.push_back(from);
+}
+
+// Solver
+
+// Blocks in reverse postorder from the entry, then the unreachable ones
+static std::vector<uint32_t> reversePostorder(FlowGraph& graph){
+	std::vector<FlowBlock>& blocks = graph.blocks();
+	std::vector<uint32_t> post;
+	std::vector<bool> seen(blocks.size(), false);
+	// (block, next successor to look at)
+	std::vector<std::pair<uint32_t, size_t>> stack;
+	stack.push_back({ FlowGraph::ENTRY, 0 });
+	seen[FlowGraph::ENTRY] = true;
+	while (!stack.empty()){
+		uint32_t block = stack.back().first;
+		size_t next = stack.back().second;
+		if (next < blocks[block].succs.size()){
+			stack.back().second++;
+			uint32_t succ = blocks[block].succs[next];
+			if (!seen[succ]){
+				seen[succ] = true;
+				stack.push_back({ succ, 0 });
+			}
+		} else {
+			post.push_back(block);
+			stack.pop_back();
+		}
+	}
+	std::vector<uint32_t> order(post.rbegin(), post.rend());
+	for (uint32_t block = 0; block < blocks.size(); block++){
+		if (!seen[block]){
+			order.push_back(block);
+		}
+	}
+	return order;
+}
+
+size_t solveDataflow(FlowGraph& graph, Direction direction,
+	const std::vector<BitSet>& gen, const std::vector<BitSet>& kill,
+	const BitSet& boundary, std::vector<BitSet>& in, std::vector<BitSet>& out){
+	std::vector<FlowBlock>& blocks = graph.blocks();
+	bool forward = direction == FORWARD;
+	// Named for a forward problem: a backward one flows from the
+	// successors, and its "in" is the fact at the end of the block
+	std::vector<BitSet>& before = forward ? in : out;
+	std::vector<BitSet>& after = forward ? out : in;
+	uint32_t start = forward ? FlowGraph::ENTRY : FlowGraph::EXIT;
+	before.assign(blocks.size(), BitSet(boundary.size()));
+	after.assign(blocks.size(), BitSet(boundary.size()));
+
+	std::vector<uint32_t> order = reversePostorder(graph);
+	if (!forward){
+		std::reverse(order.begin(), order.end());
+	}
+	std::deque<uint32_t> work(order.begin(), order.end());
+	std::vector<bool> queued(blocks.size(), true);
+	size_t visits = 0;
+	while (!work.empty()){
+		uint32_t block = work.front();
+		work.pop_front();
+		queued[block] = false;
+		visits++;
+		BitSet& facts = before[block];
+		if (block == start){
+			facts = boundary;
+		} else {
+			facts.clear();
+		}
+		for (uint32_t from : forward ? blocks[block].preds : blocks[block].succs){
+			facts.unite(after[from]);
+		}
+		if (after[block].transfer(facts, gen[block], kill[block])){
+			for (uint32_t to : forward ? blocks[block].succs : blocks[block].preds){
+				if (!queued[to]){
+					queued[to] = true;
+					work.push_back(to);
+				}
+			}
+		}
+	}
+	return visits;
+}
+
+// Liveness
+
+void Liveness::run(FlowGraph& graph){
+	std::vector<FlowBlock>& blocks = graph.blocks();
+	size_t vars = graph.numVars();
+	std::vector<BitSet> gen(blocks.size(), BitSet(vars));
+	std::vector<BitSet> kill(blocks.size(), BitSet(vars));
+	for (size_t block = 0; block < blocks.size(); block++){
+		for (const FlowEvent& event : blocks[block].events){
+			if (event.kind == FlowEvent::USE){
+				// Read before any write in the block
+				if (!kill[block].test(event.var)){
+					gen[block].set(event.var);
+				}
+			} else if (!event.partial){
+				kill[block].set(event.var);
+			}
+		}
+	}
+	myVisits = solveDataflow(graph, BACKWARD, gen, kill, BitSet(vars),
+		myIn, myOut);
+}
+
+// ReachingDefinitions
+
+void ReachingDefinitions::run(FlowGraph& graph){
+	std::vector<FlowBlock>& blocks = graph.blocks();
+	size_t vars = graph.numVars();
+	myFirstDef.assign(blocks.size(), 0);
+	size_t defs = vars;
+	for (size_t block = 0; block < blocks.size(); block++){
+		myFirstDef[block] = defs;
+		for (const FlowEvent& event : blocks[block].events){
+			defs += event.kind == FlowEvent::DEF;
+		}
+	}
+	myNumDefs = defs;
+
+	myDefsOf.assign(vars, BitSet(defs));
+	for (size_t var = 0; var < vars; var++){
+		myDefsOf[var].set(var);
+	}
+	for (size_t block = 0; block < blocks.size(); block++){
+		uint32_t def = myFirstDef[block];
+		for (const FlowEvent& event : blocks[block].events){
+			if (event.kind == FlowEvent::DEF){
+				myDefsOf[event.var].set(def++);
+			}
+		}
+	}
+
+	std::vector<BitSet> gen(blocks.size(), BitSet(defs));
+	std::vector<BitSet> kill(blocks.size(), BitSet(defs));
+	for (size_t block = 0; block < blocks.size(); block++){
+		uint32_t def = myFirstDef[block];
+		for (const FlowEvent& event : blocks[block].events){
+			if (event.kind == FlowEvent::DEF && !event.partial){
+				kill[block].unite(myDefsOf[event.var]);
+			}
+			step(event, def, gen[block]);
+		}
+	}
+	BitSet entry(defs);
+	for (size_t var = 0; var < vars; var++){
+		entry.set(var);
+	}
+	myVisits = solveDataflow(graph, FORWARD, gen, kill, entry, myIn, myOut);
+}
+
+void ReachingDefinitions::step(const FlowEvent& event, uint32_t& def,
+	BitSet& facts){
+	if (event.kind != FlowEvent::DEF){
+		return;
+	}
+	if (!event.partial){
+		facts.subtract(myDefsOf[event.var]);
+	}
+	facts.set(def++);
+}
+
+// Building the graph from the AST
+
+void StmtListNode::buildFlow(FlowGraph * flow){
+	for (StmtNode * stmt : myList){
+		stmt->buildFlow(flow);
+	}
+}
+
+void AssignStmtNode::buildFlow(FlowGraph * flow){
+	flow->beginStmt(this);
+	// As AssignNode::collectFlow, but a plain x = e is a removable store
+	// unless e has effects, a division that may trap included
+	ExpNode * right = myAssign->getRight();
+	right->collectFlow(flow);
+	IdNode * id = dynamic_cast<IdNode *>(myAssign->getLeft());
+	if (id != nullptr){
+		flow->def(id, !right->hasSideEffects());
+	}
+}
+
+void PostIncStmtNode::buildFlow(FlowGraph * flow){
+	flow->beginStmt(this);
+	IdNode * id = dynamic_cast<IdNode *>(myLoc);
+	if (id != nullptr){
+		flow->use(id);
+		flow->def(id, true);
+	}
+}
+
+void PostDecStmtNode::buildFlow(FlowGraph * flow){
+	flow->beginStmt(this);
+	IdNode * id = dynamic_cast<IdNode *>(myLoc);
+	if (id != nullptr){
+		flow->use(id);
+		flow->def(id, true);
+	}
+}
+
+void ReadStmtNode::buildFlow(FlowGraph * flow){
+	flow->beginStmt(this);
+	IdNode * id = dynamic_cast<IdNode *>(myLoc);
+	if (id != nullptr){
+		// Not a removable store: it consumes input
+		flow->def(id);
+	}
+}
+
+void WriteStmtNode::buildFlow(FlowGraph * flow){
+	flow->beginStmt(this);
+	myLoc->collectFlow(flow);
+}
+
+void CallStmtNode::buildFlow(FlowGraph * flow){
+	flow->beginStmt(this);
+	myCall->collectFlow(flow);
+}
+
+void ReturnStmtNode::buildFlow(FlowGraph * flow){
+	flow->beginStmt(this);
+	if (myLoc != nullptr){
+		myLoc->collectFlow(flow);
+	}
+	flow->edge(flow->current(), FlowGraph::EXIT);
+	// Whatever follows is unreachable
+	flow->setCurrent(flow->newBlock());
+}
+
+void IfStmtNode::buildFlow(FlowGraph * flow){
+	flow->beginStmt(this);
+	myExp->collectFlow(flow);
+	flow->declare(myVarList);
+	uint32_t then = flow->newBlock();
+	uint32_t join = flow->newBlock();
+	flow->edge(flow->current(), then);
+	flow->edge(flow->current(), join);
+	flow->setCurrent(then);
+	myStmtList->buildFlow(flow);
+	flow->edge(flow->current(), join);
+	flow->setCurrent(join);
+}
+
+void IfElseStmtNode::buildFlow(FlowGraph * flow){
+	flow->beginStmt(this);
+	myExp->collectFlow(flow);
+	flow->declare(myVarList);
+	flow->declare(myElseVarList);
+	uint32_t then = flow->newBlock();
+	uint32_t otherwise = flow->newBlock();
+	uint32_t join = flow->newBlock();
+	flow->edge(flow->current(), then);
+	flow->edge(flow->current(), otherwise);
+	flow->setCurrent(then);
+	myStmtList->buildFlow(flow);
+	flow->edge(flow->current(), join);
+	flow->setCurrent(otherwise);
+	myElseStmtList->buildFlow(flow);
+	flow->edge(flow->current(), join);
+	flow->setCurrent(join);
+}
+
+void WhileStmtNode::buildFlow(FlowGraph * flow){
+	uint32_t head = flow->newBlock();
+	uint32_t body = flow->newBlock();
+	uint32_t after = flow->newBlock();
+	flow->edge(flow->current(), head);
+	flow->setCurrent(head);
+	flow->beginStmt(this);
+	myExp->collectFlow(flow);
+	flow->edge(head, body);
+	flow->edge(head, after);
+	flow->declare(myVarList);
+	flow->setCurrent(body);
+	myStmtList->buildFlow(flow);
+	flow->edge(flow->current(), head);
+	flow->setCurrent(after);
+}
+
+void IdNode::collectFlow(FlowGraph * flow){
+	flow->use(this);
+}
+
+void AssignNode::collectFlow(FlowGraph * flow){
+	myRight->collectFlow(flow);
+	IdNode * id = dynamic_cast<IdNode *>(myLeft);
+	if (id != nullptr){
+		flow->def(id);
+	}
+}
+
+void CallExpNode::collectFlow(FlowGraph * flow){
+	if (myList != nullptr){
+		myList->collectFlow(flow);
+	}
+}
+
+void ExpListNode::collectFlow(FlowGraph * flow){
+	for (ExpNode * exp : myList){
+		exp->collectFlow(flow);
+	}
+}
+
+// The right operand only runs on some paths
+void AndNode::collectFlow(FlowGraph * flow){
+	myLeft->collectFlow(flow);
+	flow->beginConditional();
+	myRight->collectFlow(flow);
+	flow->endConditional();
+}
+
+void OrNode::collectFlow(FlowGraph * flow){
+	myLeft->collectFlow(flow);
+	flow->beginConditional();
+	myRight->collectFlow(flow);
+	flow->endConditional();
+}
+
+} //End namespace LIL' C
@@ -0,0 +1,183 @@
+#ifndef LILC_DATAFLOW_HPP
+#define LILC_DATAFLOW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace LILC{
+
+class FnDeclNode;
+class IdNode;
+class SemSymbol;
+class StmtNode;
+class VarDeclListNode;
+
+// Dense bit set over 64-bit words, the fact type of every analysis below.
+// The set operations run a word at a time, four words per step where the
+// compiler has vector extensions, so a block's transfer function costs
+// (variables / 64) word operations however many of them it touches.
+class BitSet{
+public:
+	BitSet(size_t bits = 0) : myWords((bits + 63) / 64, 0){ myBits = bits; }
+
+	size_t size() const { return myBits; }
+	void set(size_t bit){ myWords[bit >> 6] |= uint64_t(1) << (bit & 63); }
+	void reset(size_t bit){ myWords[bit >> 6] &= ~(uint64_t(1) << (bit & 63)); }
+	bool test(size_t bit) const {
+		return (myWords[bit >> 6] >> (bit & 63)) & 1;
+	}
+	void clear();
+	size_t count() const;
+
+	// this |= other; returns whether this changed
+	bool unite(const BitSet& other);
+	// this &= ~other
+	void subtract(const BitSet& other);
+	// this = gen | (in & ~kill), the transfer function of a block;
+	// returns whether this changed
+	bool transfer(const BitSet& in, const BitSet& gen, const BitSet& kill);
+
+	// Calls f(bit) for every set bit, in increasing order
+	template <class F>
+	void forEach(F f) const {
+		for (size_t w = 0; w < myWords.size(); w++){
+			uint64_t word = myWords[w];
+			while (word != 0){
+				f(w * 64 + __builtin_ctzll(word));
+				word &= word - 1;
+			}
+		}
+	}
+private:
+	std::vector<uint64_t> myWords;
+	size_t myBits;
+};
+
+// One read or write of a tracked variable, in evaluation order
+struct FlowEvent {
+	enum Kind { USE, DEF };
+	Kind kind;
+	// A write that happens on only some paths through its statement: in
+	// the right operand of && or ||. It does not kill earlier values.
+	bool partial;
+	// The write a statement exists for (x = e; x++; x--; with e free of
+	// side effects): removing the statement removes only this write and
+	// its reads
+	bool store;
+	uint32_t var;
+	IdNode * id;
+	StmtNode * stmt;
+};
+
+struct FlowBlock {
+	std::vector<FlowEvent> events;
+	std::vector<uint32_t> succs;
+	std::vector<uint32_t> preds;
+};
+
+// Control flow graph of a function body (dataflow.cpp). Blocks hold the
+// reads and writes of the function's formals and scalar locals, numbered
+// densely; globals and struct variables are not tracked. Branches come
+// from if, if-else and while statements, and returns jump to the exit.
+class FlowGraph{
+public:
+	static const uint32_t ENTRY = 0;
+	static const uint32_t EXIT = 1;
+
+	// Builds the graph of fn's type-checked body, replacing any before
+	void build(FnDeclNode * fn);
+
+	std::vector<FlowBlock>& blocks(){ return myBlocks; }
+	size_t numVars(){ return myVars.size(); }
+	SemSymbol * getVar(size_t var){ return myVars[var]; }
+	// Formals come first and start out assigned
+	bool isFormal(size_t var){ return var < myNumFormals; }
+	// Locals of nested blocks come after the body's
+	bool isBlockLocal(size_t var){ return var >= myNumLocals; }
+	// Struct variables declared in the function, which are not tracked
+	size_t numStructs(){ return myNumStructs; }
+	size_t numEvents(){ return myNumEvents; }
+
+	// Called by the statements and expressions while building
+	void declare(VarDeclListNode * decls);
+	void beginStmt(StmtNode * stmt){ myStmt = stmt; }
+	void use(IdNode * id);
+	void def(IdNode * id, bool store = false);
+	void beginConditional(){ myConditional++; }
+	void endConditional(){ myConditional--; }
+	uint32_t newBlock();
+	uint32_t current(){ return myCurrent; }
+	void setCurrent(uint32_t block){ myCurrent = block; }
+	void edge(uint32_t from, uint32_t to);
+private:
+	void declare(IdNode * id);
+	void record(FlowEvent::Kind kind, IdNode * id, bool store);
+
+	std::vector<FlowBlock> myBlocks;
+	std::vector<SemSymbol *> myVars;
+	std::unordered_map<SemSymbol *, uint32_t> myIndex;
+	size_t myNumFormals = 0;
+	size_t myNumLocals = 0;
+	size_t myNumStructs = 0;
+	size_t myNumEvents = 0;
+	uint32_t myCurrent = ENTRY;
+	StmtNode * myStmt = nullptr;
+	int myConditional = 0;
+};
+
+enum Direction { FORWARD, BACKWARD };
+
+// Worklist solver for "may" problems, whose facts meet by union. FORWARD
+// computes out[b] = gen[b] | (in[b] & ~kill[b]) with in[b] the union of
+// its predecessors' out and in[ENTRY] = boundary; BACKWARD is the mirror
+// image, from the successors, with out[EXIT] = boundary. Blocks are
+// visited in reverse postorder (postorder for BACKWARD). Returns the
+// number of blocks visited.
+size_t solveDataflow(FlowGraph& graph, Direction direction,
+	const std::vector<BitSet>& gen, const std::vector<BitSet>& kill,
+	const BitSet& boundary, std::vector<BitSet>& in, std::vector<BitSet>& out);
+
+// Live variables: a variable is live where its value may still be read
+class Liveness{
+public:
+	void run(FlowGraph& graph);
+	const BitSet& liveIn(uint32_t block){ return myIn[block]; }
+	const BitSet& liveOut(uint32_t block){ return myOut[block]; }
+	size_t visits(){ return myVisits; }
+private:
+	std::vector<BitSet> myIn;
+	std::vector<BitSet> myOut;
+	size_t myVisits = 0;
+};
+
+// Reaching definitions. Definition v < numVars() is variable v's value on
+// entry: a formal's argument, or a local not assigned yet. The others are
+// the writes of the graph, numbered in block and event order from
+// firstDef(block).
+class ReachingDefinitions{
+public:
+	void run(FlowGraph& graph);
+	size_t numDefs(){ return myNumDefs; }
+	uint32_t firstDef(uint32_t block){ return myFirstDef[block]; }
+	// Every definition of a variable, its entry one included
+	const BitSet& defsOf(uint32_t var){ return myDefsOf[var]; }
+	const BitSet& reachIn(uint32_t block){ return myIn[block]; }
+	const BitSet& reachOut(uint32_t block){ return myOut[block]; }
+	// Moves facts past one event of a block, keeping count of the block's
+	// definitions in def (from firstDef)
+	void step(const FlowEvent& event, uint32_t& def, BitSet& facts);
+	size_t visits(){ return myVisits; }
+private:
+	size_t myNumDefs = 0;
+	std::vector<uint32_t> myFirstDef;
+	std::vector<BitSet> myDefsOf;
+	std::vector<BitSet> myIn;
+	std::vector<BitSet> myOut;
+	size_t myVisits = 0;
+};
+
+} //End namespace LIL' C
+
+#endif
@@ -0,0 +1,99 @@
+#include <iterator>
+
+#include "ast.hpp"
+#include "callgraph.hpp"
+#include "deadcode.hpp"
+
+namespace LILC{
+
+void DeadCodeEliminator::run(ProgramNode * program){
+	DeclListNode * decls = program->getDeclList();
+	for (DeclNode * decl : decls->getDecls()){
+		FnDeclNode * fn = dynamic_cast<FnDeclNode *>(decl);
+		if (fn != nullptr){
+			fn->getBody()->getStmts()->prune(this);
+		}
+	}
+	// Built from what is left, so calls in dead code do not count
+	CallGraph graph;
+	graph.build(program);
+	if (graph.entry() == nullptr){
+		return;
+	}
+	myReachable = graph.reachableFrom(graph.entry());
+	decls->prune(this);
+}
+
+void DeclListNode::prune(DeadCodeEliminator * dce){
+	auto it = myDecls.begin();
+	while (it != myDecls.end()){
+		FnDeclNode * fn = dynamic_cast<FnDeclNode *>(*it);
+		if (fn != nullptr && !dce->isReachable(fn)){
+			dce->removeFunction(fn->getBody()->getStmts()->nodeCount());
+			it = myDecls.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void StmtListNode::prune(DeadCodeEliminator * dce){
+	auto it = myList.begin();
+	while (it != myList.end()){
+		StmtNode * stmt = *it;
+		if (stmt->isDead()){
+			dce->removeBlock(stmt->nodeCount());
+			it = myList.erase(it);
+			continue;
+		}
+		stmt->prune(dce);
+		++it;
+		if (stmt->alwaysReturns() && it != myList.end()){
+			size_t nodes = 0;
+			for (auto dead = it; dead != myList.end(); ++dead){
+				nodes += (*dead)->nodeCount();
+			}
+			dce->removeStatements(std::distance(it, myList.end()), nodes);
+			myList.erase(it, myList.end());
+			return;
+		}
+	}
+}
+
+// Only the last statement can return on every path once pruned, but a
+// list is checked whole so it can be asked before pruning too.
+bool StmtListNode::alwaysReturns(){
+	for (StmtNode * stmt : myList){
+		if (stmt->alwaysReturns()){
+			return true;
+		}
+	}
+	return false;
+}
+
+bool IfElseStmtNode::alwaysReturns(){
+	return myStmtList->alwaysReturns() && myElseStmtList->alwaysReturns();
+}
+
+bool IfStmtNode::isDead(){
+	return dynamic_cast<FalseNode *>(myExp) != nullptr;
+}
+
+bool WhileStmtNode::isDead(){
+	return dynamic_cast<FalseNode *>(myExp) != nullptr;
+}
+
+void IfStmtNode::prune(DeadCodeEliminator * dce){
+	myStmtList->prune(dce);
+}
+
+void IfElseStmtNode::prune(DeadCodeEliminator * dce){
+	myStmtList->prune(dce);
+	myElseStmtList->prune(dce);
+}
+
+void WhileStmtNode::prune(DeadCodeEliminator * dce){
+	myStmtList->prune(dce);
+}
+
+} //End namespace LIL' C
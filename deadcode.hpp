@@ -0,0 +1,53 @@
+#ifndef LILC_DEADCODE_HPP
+#define LILC_DEADCODE_HPP
+
+#include <cstddef>
+#include <unordered_set>
+
+namespace LILC{
+
+class ProgramNode;
+class FnDeclNode;
+
+// Dead-code elimination on a type-checked AST (deadcode.cpp).
+//
+// Removes statements that follow one that always returns, if and while
+// statements whose condition is the constant false (as left by folding),
+// and then every function the call graph says main cannot reach. A
+// program without main keeps all its functions.
+class DeadCodeEliminator{
+public:
+	void run(ProgramNode * program);
+
+	// Called by the AST nodes as they drop code, with its size in nodes
+	void removeStatements(size_t count, size_t nodes){
+		myStatements += count;
+		myNodes += nodes;
+	}
+	void removeBlock(size_t nodes){
+		myBlocks++;
+		myNodes += nodes;
+	}
+	void removeFunction(size_t nodes){
+		myFunctions++;
+		myNodes += nodes;
+	}
+	bool isReachable(FnDeclNode * fn){
+		return myReachable.count(fn) != 0;
+	}
+
+	size_t statements(){ return myStatements; }
+	size_t blocks(){ return myBlocks; }
+	size_t functions(){ return myFunctions; }
+	size_t nodes(){ return myNodes; }
+private:
+	std::unordered_set<FnDeclNode *> myReachable;
+	size_t myStatements = 0;
+	size_t myBlocks = 0;
+	size_t myFunctions = 0;
+	size_t myNodes = 0;
+};
+
+} //End namespace LIL' C
+
+#endif
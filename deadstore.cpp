@@ -0,0 +1,81 @@
+#include "ast.hpp"
+#include "dataflow.hpp"
+#include "deadstore.hpp"
+
+namespace LILC{
+
+void DeadStoreEliminator::run(ProgramNode * program){
+	for (DeclNode * decl : program->getDeclList()->getDecls()){
+		FnDeclNode * fn = dynamic_cast<FnDeclNode *>(decl);
+		if (fn != nullptr){
+			run(fn);
+		}
+	}
+}
+
+void DeadStoreEliminator::run(FnDeclNode * fn){
+	FlowGraph graph;
+	Liveness liveness;
+	while (true){
+		graph.build(fn);
+		liveness.run(graph);
+		myRounds++;
+		myVisits += liveness.visits();
+		myDead.clear();
+		std::vector<FlowBlock>& blocks = graph.blocks();
+		for (uint32_t block = 0; block < blocks.size(); block++){
+			BitSet live = liveness.liveOut(block);
+			// A statement's events are consecutive, and its write comes
+			// last: once the write is found dead, its reads are skipped
+			// so what they read can turn out dead in the same pass
+			StmtNode * dropping = nullptr;
+			const std::vector<FlowEvent>& events = blocks[block].events;
+			for (auto it = events.rbegin(); it != events.rend(); ++it){
+				const FlowEvent& event = *it;
+				if (event.stmt == dropping){
+					continue;
+				}
+				if (event.kind == FlowEvent::USE){
+					live.set(event.var);
+				} else if (event.store && !live.test(event.var)){
+					dropping = event.stmt;
+					myDead.insert(dropping);
+				} else if (!event.partial){
+					live.reset(event.var);
+				}
+			}
+		}
+		if (myDead.empty()){
+			return;
+		}
+		myStores += myDead.size();
+		fn->getBody()->getStmts()->eraseStores(this);
+	}
+}
+
+void StmtListNode::eraseStores(DeadStoreEliminator * dse){
+	auto it = myList.begin();
+	while (it != myList.end()){
+		if (dse->isDead(*it)){
+			it = myList.erase(it);
+		} else {
+			(*it)->eraseStores(dse);
+			++it;
+		}
+	}
+}
+
+void IfStmtNode::eraseStores(DeadStoreEliminator * dse){
+	myStmtList->eraseStores(dse);
+}
+
+void IfElseStmtNode::eraseStores(DeadStoreEliminator * dse){
+	myStmtList->eraseStores(dse);
+	myElseStmtList->eraseStores(dse);
+}
+
+void WhileStmtNode::eraseStores(DeadStoreEliminator * dse){
+	myStmtList->eraseStores(dse);
+}
+
+} //End namespace LIL' C
@@ -0,0 +1,42 @@
+#ifndef LILC_DEADSTORE_HPP
+#define LILC_DEADSTORE_HPP
+
+#include <cstddef>
+#include <unordered_set>
+
+namespace LILC{
+
+class ProgramNode;
+class FnDeclNode;
+class StmtNode;
+
+// Dead-store elimination on a type-checked AST (deadstore.cpp).
+//
+// Removes x = e;, x++; and x--; statements of a formal or scalar local x
+// whose new value liveness says is never read, as long as e can neither
+// call nor assign anything nor stop the program, as a division by a
+// variable may (IRInstr::removable draws the same line). Each function is
+// analysed again until nothing more goes, since the reads of a removed
+// store may have been all that kept an earlier one alive.
+class DeadStoreEliminator{
+public:
+	void run(ProgramNode * program);
+
+	bool isDead(StmtNode * stmt){ return myDead.count(stmt) != 0; }
+
+	size_t stores(){ return myStores; }
+	size_t rounds(){ return myRounds; }
+	// Blocks the liveness solver visited, over every round
+	size_t visits(){ return myVisits; }
+private:
+	void run(FnDeclNode * fn);
+
+	std::unordered_set<StmtNode *> myDead;
+	size_t myStores = 0;
+	size_t myRounds = 0;
+	size_t myVisits = 0;
+};
+
+} //End namespace LIL' C
+
+#endif
@@ -0,0 +1,407 @@
+#include "ast.hpp"
+#include "fold.hpp"
+#include "lilc_arith.hpp"
+
+namespace LILC{
+
+static bool intValue(ExpNode * exp, int& value){
+	IntLitNode * lit = dynamic_cast<IntLitNode *>(exp);
+	if (lit == nullptr){
+		return false;
+	}
+	value = lit->getValue();
+	return true;
+}
+
+static bool boolValue(ExpNode * exp, bool& value){
+	if (dynamic_cast<TrueNode *>(exp) != nullptr){
+		value = true;
+		return true;
+	}
+	if (dynamic_cast<FalseNode *>(exp) != nullptr){
+		value = false;
+		return true;
+	}
+	return false;
+}
+
+// Replaces `at`, which had `eliminated` more nodes than one literal, by
+// the literal. Leaves it alone if the value cannot be written as one.
+static ExpNode * intResult(Folder * folder, ExpNode * at, int32_t value,
+	size_t eliminated){
+	if (!lilcIsLiteral(value)){
+		return at;
+	}
+	folder->eliminate(eliminated);
+	return new IntLitNode(value, at->getLine(), at->getCol());
+}
+
+static ExpNode * boolResult(Folder * folder, ExpNode * at, bool value,
+	size_t eliminated){
+	folder->eliminate(eliminated);
+	if (value){
+		return new TrueNode(at->getLine(), at->getCol());
+	}
+	return new FalseNode(at->getLine(), at->getCol());
+}
+
+static ExpNode * keep(Folder * folder, ExpNode * kept, size_t eliminated){
+	folder->eliminate(eliminated);
+	return kept;
+}
+
+// `kept op dropped` where the result is `kept` whatever dropped is, e.g.
+// x * 0. Only valid if dropped need not be evaluated.
+static ExpNode * annihilate(Folder * folder, ExpNode * kept,
+	ExpNode * dropped){
+	folder->eliminate(1 + dropped->nodeCount());
+	return kept;
+}
+
+// Operators
+
+ExpNode * UnaryMinusNode::fold(Folder * folder){
+	myNode = myNode->fold(folder);
+	int value;
+	if (intValue(myNode, value)){
+		return intResult(folder, this, lilcNeg(value), 1);
+	}
+	UnaryMinusNode * inner = dynamic_cast<UnaryMinusNode *>(myNode);
+	if (inner != nullptr){
+		return keep(folder, inner->getOperand(), 2);
+	}
+	return this;
+}
+
+ExpNode * NotNode::fold(Folder * folder){
+	myNode = myNode->fold(folder);
+	bool value;
+	if (boolValue(myNode, value)){
+		return boolResult(folder, this, !value, 1);
+	}
+	NotNode * inner = dynamic_cast<NotNode *>(myNode);
+	if (inner != nullptr){
+		return keep(folder, inner->getOperand(), 2);
+	}
+	return this;
+}
+
+ExpNode * PlusNode::fold(Folder * folder){
+	myLeft = myLeft->fold(folder);
+	myRight = myRight->fold(folder);
+	int a = 0, b = 0;
+	bool leftLit = intValue(myLeft, a);
+	bool rightLit = intValue(myRight, b);
+	if (leftLit && rightLit){
+		return intResult(folder, this, lilcAdd(a, b), 2);
+	}
+	if (rightLit && b == 0){
+		return keep(folder, myLeft, 2);
+	}
+	if (leftLit && a == 0){
+		return keep(folder, myRight, 2);
+	}
+	// x + -y => x - y
+	UnaryMinusNode * neg = dynamic_cast<UnaryMinusNode *>(myRight);
+	if (neg != nullptr){
+		folder->eliminate(1);
+		return new MinusNode(myLeft, neg->getOperand());
+	}
+	return this;
+}
+
+ExpNode * MinusNode::fold(Folder * folder){
+	myLeft = myLeft->fold(folder);
+	myRight = myRight->fold(folder);
+	int a = 0, b = 0;
+	bool leftLit = intValue(myLeft, a);
+	bool rightLit = intValue(myRight, b);
+	if (leftLit && rightLit){
+		return intResult(folder, this, lilcSub(a, b), 2);
+	}
+	if (rightLit && b == 0){
+		return keep(folder, myLeft, 2);
+	}
+	// x - -y => x + y
+	UnaryMinusNode * neg = dynamic_cast<UnaryMinusNode *>(myRight);
+	if (neg != nullptr){
+		folder->eliminate(1);
+		return new PlusNode(myLeft, neg->getOperand());
+	}
+	return this;
+}
+
+ExpNode * TimesNode::fold(Folder * folder){
+	myLeft = myLeft->fold(folder);
+	myRight = myRight->fold(folder);
+	int a = 0, b = 0;
+	bool leftLit = intValue(myLeft, a);
+	bool rightLit = intValue(myRight, b);
+	if (leftLit && rightLit){
+		return intResult(folder, this, lilcMul(a, b), 2);
+	}
+	if (rightLit && b == 1){
+		return keep(folder, myLeft, 2);
+	}
+	if (leftLit && a == 1){
+		return keep(folder, myRight, 2);
+	}
+	if (rightLit && b == 0 && !myLeft->hasSideEffects()){
+		return annihilate(folder, myRight, myLeft);
+	}
+	if (leftLit && a == 0 && !myRight->hasSideEffects()){
+		return annihilate(folder, myLeft, myRight);
+	}
+	return this;
+}
+
+ExpNode * DivideNode::fold(Folder * folder){
+	myLeft = myLeft->fold(folder);
+	myRight = myRight->fold(folder);
+	int a = 0, b = 0;
+	bool leftLit = intValue(myLeft, a);
+	bool rightLit = intValue(myRight, b);
+	if (leftLit && rightLit && b != 0){
+		return intResult(folder, this, lilcDiv(a, b), 2);
+	}
+	if (rightLit && b == 1){
+		return keep(folder, myLeft, 2);
+	}
+	return this;
+}
+
+ExpNode * AndNode::fold(Folder * folder){
+	myLeft = myLeft->fold(folder);
+	myRight = myRight->fold(folder);
+	bool a = false, b = false;
+	bool leftLit = boolValue(myLeft, a);
+	bool rightLit = boolValue(myRight, b);
+	if (leftLit && rightLit){
+		return boolResult(folder, this, a && b, 2);
+	}
+	if (leftLit){
+		// true && x => x; false && x => false, x is never evaluated
+		return a ? keep(folder, myRight, 2) : annihilate(folder, myLeft, myRight);
+	}
+	if (rightLit && b){
+		return keep(folder, myLeft, 2);
+	}
+	if (rightLit && !myLeft->hasSideEffects()){
+		return annihilate(folder, myRight, myLeft);
+	}
+	return this;
+}
+
+ExpNode * OrNode::fold(Folder * folder){
+	myLeft = myLeft->fold(folder);
+	myRight = myRight->fold(folder);
+	bool a = false, b = false;
+	bool leftLit = boolValue(myLeft, a);
+	bool rightLit = boolValue(myRight, b);
+	if (leftLit && rightLit){
+		return boolResult(folder, this, a || b, 2);
+	}
+	if (leftLit){
+		// false || x => x; true || x => true, x is never evaluated
+		return a ? annihilate(folder, myLeft, myRight) : keep(folder, myRight, 2);
+	}
+	if (rightLit && !b){
+		return keep(folder, myLeft, 2);
+	}
+	if (rightLit && !myLeft->hasSideEffects()){
+		return annihilate(folder, myRight, myLeft);
+	}
+	return this;
+}
+
+// Comparisons fold when both sides are literals of the same type.
+
+ExpNode * EqualsNode::fold(Folder * folder){
+	myLeft = myLeft->fold(folder);
+	myRight = myRight->fold(folder);
+	int a, b;
+	bool p, q;
+	if (intValue(myLeft, a) && intValue(myRight, b)){
+		return boolResult(folder, this, a == b, 2);
+	}
+	if (boolValue(myLeft, p) && boolValue(myRight, q)){
+		return boolResult(folder, this, p == q, 2);
+	}
+	return this;
+}
+
+ExpNode * NotEqualsNode::fold(Folder * folder){
+	myLeft = myLeft->fold(folder);
+	myRight = myRight->fold(folder);
+	int a, b;
+	bool p, q;
+	if (intValue(myLeft, a) && intValue(myRight, b)){
+		return boolResult(folder, this, a != b, 2);
+	}
+	if (boolValue(myLeft, p) && boolValue(myRight, q)){
+		return boolResult(folder, this, p != q, 2);
+	}
+	return this;
+}
+
+ExpNode * LessNode::fold(Folder * folder){
+	myLeft = myLeft->fold(folder);
+	myRight = myRight->fold(folder);
+	int a, b;
+	if (intValue(myLeft, a) && intValue(myRight, b)){
+		return boolResult(folder, this, a < b, 2);
+	}
+	return this;
+}
+
+ExpNode * GreaterNode::fold(Folder * folder){
+	myLeft = myLeft->fold(folder);
+	myRight = myRight->fold(folder);
+	int a, b;
+	if (intValue(myLeft, a) && intValue(myRight, b)){
+		return boolResult(folder, this, a > b, 2);
+	}
+	return this;
+}
+
+ExpNode * LessEqNode::fold(Folder * folder){
+	myLeft = myLeft->fold(folder);
+	myRight = myRight->fold(folder);
+	int a, b;
+	if (intValue(myLeft, a) && intValue(myRight, b)){
+		return boolResult(folder, this, a <= b, 2);
+	}
+	return this;
+}
+
+ExpNode * GreaterEqNode::fold(Folder * folder){
+	myLeft = myLeft->fold(folder);
+	myRight = myRight->fold(folder);
+	int a, b;
+	if (intValue(myLeft, a) && intValue(myRight, b)){
+		return boolResult(folder, this, a >= b, 2);
+	}
+	return this;
+}
+
+// Other expressions only fold their children
+
+ExpNode * AssignNode::fold(Folder * folder){
+	myRight = myRight->fold(folder);
+	return this;
+}
+
+ExpNode * CallExpNode::fold(Folder * folder){
+	if (myList != nullptr){
+		myList->fold(folder);
+	}
+	return this;
+}
+
+size_t CallExpNode::nodeCount(){
+	return 1 + myLoc->nodeCount()
+		+ (myList == nullptr ? 0 : myList->nodeCount());
+}
+
+ExpNode * ExpListNode::fold(Folder * folder){
+	for (ExpNode *& exp : myList){
+		exp = exp->fold(folder);
+	}
+	return this;
+}
+
+bool DivideNode::hasSideEffects(){
+	IntLitNode * divisor = dynamic_cast<IntLitNode *>(myRight);
+	if (divisor == nullptr || divisor->getValue() == 0){
+		return true;
+	}
+	return BinaryExpNode::hasSideEffects();
+}
+
+bool ExpListNode::hasSideEffects(){
+	for (ExpNode * exp : myList){
+		if (exp->hasSideEffects()){
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t ExpListNode::nodeCount(){
+	size_t count = 1;
+	for (ExpNode * exp : myList){
+		count += exp->nodeCount();
+	}
+	return count;
+}
+
+// Statements and declarations
+
+void ProgramNode::fold(Folder * folder){
+	myDeclList->fold(folder);
+}
+
+void DeclListNode::fold(Folder * folder){
+	for (DeclNode * decl : myDecls){
+		decl->fold(folder);
+	}
+}
+
+void FnDeclNode::fold(Folder * folder){
+	myBody->fold(folder);
+}
+
+void FnBodyNode::fold(Folder * folder){
+	getStmts()->fold(folder);
+}
+
+void StmtListNode::fold(Folder * folder){
+	for (StmtNode * stmt : myList){
+		stmt->fold(folder);
+	}
+}
+
+void AssignStmtNode::fold(Folder * folder){
+	myAssign->fold(folder);
+}
+
+void PostIncStmtNode::fold(Folder * folder){
+}
+
+void PostDecStmtNode::fold(Folder * folder){
+}
+
+void ReadStmtNode::fold(Folder * folder){
+}
+
+void WriteStmtNode::fold(Folder * folder){
+	myLoc = myLoc->fold(folder);
+}
+
+void ReturnStmtNode::fold(Folder * folder){
+	if (myLoc != nullptr){
+		myLoc = myLoc->fold(folder);
+	}
+}
+
+void CallStmtNode::fold(Folder * folder){
+	myCall->fold(folder);
+}
+
+void IfStmtNode::fold(Folder * folder){
+	myExp = myExp->fold(folder);
+	myStmtList->fold(folder);
+}
+
+void IfElseStmtNode::fold(Folder * folder){
+	myExp = myExp->fold(folder);
+	myStmtList->fold(folder);
+	myElseStmtList->fold(folder);
+}
+
+void WhileStmtNode::fold(Folder * folder){
+	myExp = myExp->fold(folder);
+	myStmtList->fold(folder);
+}
+
+} //End namespace LIL' C
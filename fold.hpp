@@ -0,0 +1,26 @@
+#ifndef LILC_FOLD_HPP
+#define LILC_FOLD_HPP
+
+#include <cstddef>
+
+namespace LILC{
+
+// Constant folding and algebraic simplification (fold.cpp).
+//
+// Rewrites a type-checked AST bottom up: int and bool operators over
+// literals are evaluated with Lil' C semantics (lilc_arith.hpp), identities
+// (x + 0, x * 1, x && true, ...) and annihilators (x * 0, x && false, ...)
+// are simplified, and double negations cancel. A subtree is only dropped
+// if evaluating it has no side effects or it would never be evaluated.
+// Division by zero is never folded.
+class Folder{
+public:
+	void eliminate(size_t nodes){ myEliminated += nodes; }
+	size_t eliminated(){ return myEliminated; }
+private:
+	size_t myEliminated = 0;
+};
+
+} //End namespace LIL' C
+
+#endif
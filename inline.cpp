@@ -0,0 +1,504 @@
+#include <algorithm>
+#include <iterator>
+
+#include "ast.hpp"
+#include "callgraph.hpp"
+#include "inline.hpp"
+#include "symbol_table.hpp"
+
+namespace LILC{
+
+// Inliner
+
+void Inliner::run(ProgramNode * program){
+	CallGraph graph;
+	graph.build(program);
+	for (FnDeclNode * fn : graph.functions()){
+		survey(fn);
+		mySummaries[fn].recursive = graph.isRecursive(fn);
+		myNodesBefore += mySummaries[fn].size;
+	}
+	for (FnDeclNode * fn : graph.bottomUp()){
+		FreshNames names(program, fn);
+		myCaller = fn;
+		myNames = &names;
+		fn->getBody()->getStmts()->inlineCalls(this);
+		// Callers see the size after inlining
+		survey(fn);
+		myNodesAfter += mySummaries[fn].size;
+	}
+	myCaller = nullptr;
+	myNames = nullptr;
+}
+
+void Inliner::survey(FnDeclNode * fn){
+	Summary& summary = mySummaries[fn];
+	summary.returns = 0;
+	summary.hasStructs = false;
+	mySurvey = &summary;
+	if (fn->getFormals() != nullptr){
+		for (FormalDeclNode * formal : fn->getFormals()->getFormals()){
+			if (formal->getType()->getStruct() != nullptr){
+				summary.hasStructs = true;
+			}
+		}
+	}
+	FnBodyNode * body = fn->getBody();
+	for (VarDeclNode * decl : body->getDecls()->getDecls()){
+		noteLocal(decl);
+	}
+	StmtListNode * stmts = body->getStmts();
+	stmts->survey(this);
+	summary.size = stmts->nodeCount();
+	summary.endsInReturn = !stmts->getStmts().empty()
+		&& dynamic_cast<ReturnStmtNode *>(stmts->getStmts().back()) != nullptr;
+	mySurvey = nullptr;
+}
+
+void Inliner::noteLocal(VarDeclNode * decl){
+	if (decl->getType()->getStruct() != nullptr){
+		mySurvey->hasStructs = true;
+	}
+}
+
+FnDeclNode * Inliner::inlinable(CallExpNode * call){
+	SemSymbol * sym = call->getId()->getSymbol();
+	FnDeclNode * callee = sym == nullptr ? nullptr
+		: dynamic_cast<FnDeclNode *>(sym->getDecl());
+	auto found = mySummaries.find(callee);
+	if (found == mySummaries.end() || callee == myCaller){
+		return nullptr;
+	}
+	const Summary& summary = found->second;
+	if (summary.recursive || summary.hasStructs
+	    || summary.size > myThreshold){
+		return nullptr;
+	}
+	// Only a return at the very end can become an assignment
+	if (summary.returns > 1 || (summary.returns == 1 && !summary.endsInReturn)){
+		return nullptr;
+	}
+	return callee;
+}
+
+SemSymbol * Inliner::freshLocal(const std::string& name, TypeNode * type,
+	size_t line, size_t col){
+	IdNode * id = new IdNode(myNames->make("_" + myCallee->getId()->getName()
+		+ "_" + name + "_"), line, col);
+	VarDeclNode * decl = new VarDeclNode(type, id, VarDeclNode::NOT_STRUCT);
+	SemSymbol * sym = new SemSymbol(SemSymbol::VAR, id, decl, type);
+	id->setSymbol(sym);
+	myCaller->addLocal(decl);
+	return sym;
+}
+
+SemSymbol * Inliner::rename(SemSymbol * sym){
+	IdNode * id = sym->getId();
+	SemSymbol * fresh = freshLocal(id->getName(), sym->getType(),
+		id->getLine(), id->getCol());
+	myRenamed[sym] = fresh;
+	return fresh;
+}
+
+SemSymbol * Inliner::renamed(SemSymbol * sym){
+	auto found = myRenamed.find(sym);
+	return found == myRenamed.end() ? sym : found->second;
+}
+
+void Inliner::renameLocal(VarDeclNode * decl){
+	myResets.push_back(rename(decl->getId()->getSymbol()));
+}
+
+ExpNode * Inliner::expand(CallExpNode * call, std::list<StmtNode *>& out){
+	myCallee = inlinable(call);
+	myRenamed.clear();
+	myResets.clear();
+	if (call->getArgs() != nullptr){
+		auto actual = call->getArgs()->getExps().begin();
+		for (FormalDeclNode * formal : myCallee->getFormals()->getFormals()){
+			SemSymbol * var = rename(formal->getId()->getSymbol());
+			out.push_back(varAssign(var, *actual++));
+		}
+	}
+	FnBodyNode * body = myCallee->getBody();
+	for (VarDeclNode * decl : body->getDecls()->getDecls()){
+		renameLocal(decl);
+	}
+	// Copying finds the block locals, which are reset ahead of the body
+	std::list<StmtNode *> stmts;
+	ReturnStmtNode * ret = nullptr;
+	const std::list<StmtNode *>& calleeStmts = body->getStmts()->getStmts();
+	for (auto it = calleeStmts.begin(); it != calleeStmts.end(); ++it){
+		if (std::next(it) == calleeStmts.end()){
+			ret = dynamic_cast<ReturnStmtNode *>(*it);
+			if (ret != nullptr){
+				break;
+			}
+		}
+		stmts.push_back((*it)->clone(this));
+	}
+	for (SemSymbol * var : myResets){
+		IdNode * id = var->getId();
+		out.push_back(varAssign(var, zeroValue(var->getType(), id->getLine(),
+			id->getCol())));
+	}
+	out.splice(out.end(), stmts);
+	ExpNode * result = nullptr;
+	TypeNode * type = myCallee->getType();
+	if (!type->isVoid()){
+		SemSymbol * var = freshLocal("result", type, call->getLine(),
+			call->getCol());
+		// Falling off the end returns 0
+		ExpNode * value = ret != nullptr && ret->getExp() != nullptr
+			? ret->getExp()->clone(this)
+			: zeroValue(type, call->getLine(), call->getCol());
+		out.push_back(varAssign(var, value));
+		result = varUse(var, call->getLine(), call->getCol());
+	}
+	myCallee = nullptr;
+	myInlined++;
+	return result;
+}
+
+// Declarations
+
+void FnDeclNode::addLocal(VarDeclNode * decl){
+	myBody->getDecls()->add(decl);
+	TypeNode * type = decl->getType();
+	int offset = alignUp(mySize, type->getAlignment());
+	decl->getId()->getSymbol()->setOffset(offset);
+	mySize = offset + type->getSize();
+}
+
+VarDeclListNode * VarDeclListNode::clone(Inliner * inliner){
+	for (VarDeclNode * decl : myVarDecls){
+		inliner->renameLocal(decl);
+	}
+	std::list<VarDeclNode *> none;
+	return new VarDeclListNode(&none);
+}
+
+// Statements
+
+size_t StmtListNode::nodeCount(){
+	size_t count = 1;
+	for (StmtNode * stmt : myList){
+		count += stmt->nodeCount();
+	}
+	return count;
+}
+
+void StmtListNode::survey(Inliner * inliner){
+	for (StmtNode * stmt : myList){
+		stmt->survey(inliner);
+	}
+}
+
+StmtListNode * StmtListNode::clone(Inliner * inliner){
+	std::list<StmtNode *> copies;
+	for (StmtNode * stmt : myList){
+		copies.push_back(stmt->clone(inliner));
+	}
+	return new StmtListNode(&copies);
+}
+
+void StmtListNode::inlineCalls(Inliner * inliner){
+	auto it = myList.begin();
+	while (it != myList.end()){
+		StmtNode * stmt = *it;
+		ExpNode ** slot = stmt->leadingCall(inliner);
+		CallExpNode * call = nullptr;
+		if (slot != nullptr){
+			call = static_cast<CallExpNode *>(*slot);
+		} else {
+			CallStmtNode * callStmt = dynamic_cast<CallStmtNode *>(stmt);
+			if (callStmt != nullptr && inliner->inlinable(callStmt->getCall())){
+				call = callStmt->getCall();
+			}
+		}
+		if (call == nullptr){
+			stmt->inlineCalls(inliner);
+			++it;
+			continue;
+		}
+		std::list<StmtNode *> expansion;
+		ExpNode * value = inliner->expand(call, expansion);
+		if (slot != nullptr){
+			*slot = value;
+		} else {
+			it = myList.erase(it);
+		}
+		// Revisited, since the actuals can make calls of their own
+		it = myList.insert(it, expansion.begin(), expansion.end());
+	}
+}
+
+size_t AssignStmtNode::nodeCount(){ return 1 + myAssign->nodeCount(); }
+size_t PostIncStmtNode::nodeCount(){ return 1 + myLoc->nodeCount(); }
+size_t PostDecStmtNode::nodeCount(){ return 1 + myLoc->nodeCount(); }
+size_t ReadStmtNode::nodeCount(){ return 1 + myLoc->nodeCount(); }
+size_t WriteStmtNode::nodeCount(){ return 1 + myLoc->nodeCount(); }
+size_t CallStmtNode::nodeCount(){ return 1 + myCall->nodeCount(); }
+
+size_t ReturnStmtNode::nodeCount(){
+	return 1 + (myLoc == nullptr ? 0 : myLoc->nodeCount());
+}
+
+size_t IfStmtNode::nodeCount(){
+	return 1 + myExp->nodeCount() + myVarList->getDecls().size()
+		+ myStmtList->nodeCount();
+}
+
+size_t IfElseStmtNode::nodeCount(){
+	return 1 + myExp->nodeCount() + myVarList->getDecls().size()
+		+ myStmtList->nodeCount() + myElseVarList->getDecls().size()
+		+ myElseStmtList->nodeCount();
+}
+
+size_t WhileStmtNode::nodeCount(){
+	return 1 + myExp->nodeCount() + myVarList->getDecls().size()
+		+ myStmtList->nodeCount();
+}
+
+void AssignStmtNode::survey(Inliner * inliner){}
+void PostIncStmtNode::survey(Inliner * inliner){}
+void PostDecStmtNode::survey(Inliner * inliner){}
+void ReadStmtNode::survey(Inliner * inliner){}
+void WriteStmtNode::survey(Inliner * inliner){}
+void CallStmtNode::survey(Inliner * inliner){}
+void ReturnStmtNode::survey(Inliner * inliner){ inliner->noteReturn(); }
+
+static void surveyBlock(Inliner * inliner, VarDeclListNode * decls,
+	StmtListNode * stmts){
+	for (VarDeclNode * decl : decls->getDecls()){
+		inliner->noteLocal(decl);
+	}
+	stmts->survey(inliner);
+}
+
+void IfStmtNode::survey(Inliner * inliner){
+	surveyBlock(inliner, myVarList, myStmtList);
+}
+
+void IfElseStmtNode::survey(Inliner * inliner){
+	surveyBlock(inliner, myVarList, myStmtList);
+	surveyBlock(inliner, myElseVarList, myElseStmtList);
+}
+
+void WhileStmtNode::survey(Inliner * inliner){
+	surveyBlock(inliner, myVarList, myStmtList);
+}
+
+StmtNode * AssignStmtNode::clone(Inliner * inliner){
+	return new AssignStmtNode(myAssign->clone(inliner));
+}
+
+StmtNode * PostIncStmtNode::clone(Inliner * inliner){
+	return new PostIncStmtNode(myLoc->clone(inliner));
+}
+
+StmtNode * PostDecStmtNode::clone(Inliner * inliner){
+	return new PostDecStmtNode(myLoc->clone(inliner));
+}
+
+StmtNode * ReadStmtNode::clone(Inliner * inliner){
+	return new ReadStmtNode(myLoc->clone(inliner));
+}
+
+StmtNode * WriteStmtNode::clone(Inliner * inliner){
+	return new WriteStmtNode(myLoc->clone(inliner));
+}
+
+StmtNode * ReturnStmtNode::clone(Inliner * inliner){
+	return new ReturnStmtNode(myLoc == nullptr ? nullptr : myLoc->clone(inliner));
+}
+
+StmtNode * CallStmtNode::clone(Inliner * inliner){
+	return new CallStmtNode(myCall->clone(inliner));
+}
+
+StmtNode * IfStmtNode::clone(Inliner * inliner){
+	ExpNode * exp = myExp->clone(inliner);
+	VarDeclListNode * decls = myVarList->clone(inliner);
+	return new IfStmtNode(exp, decls, myStmtList->clone(inliner));
+}
+
+StmtNode * IfElseStmtNode::clone(Inliner * inliner){
+	ExpNode * exp = myExp->clone(inliner);
+	VarDeclListNode * decls = myVarList->clone(inliner);
+	StmtListNode * stmts = myStmtList->clone(inliner);
+	VarDeclListNode * elseDecls = myElseVarList->clone(inliner);
+	return new IfElseStmtNode(exp, decls, stmts, elseDecls,
+		myElseStmtList->clone(inliner));
+}
+
+StmtNode * WhileStmtNode::clone(Inliner * inliner){
+	ExpNode * exp = myExp->clone(inliner);
+	VarDeclListNode * decls = myVarList->clone(inliner);
+	return new WhileStmtNode(exp, decls, myStmtList->clone(inliner));
+}
+
+void IfStmtNode::inlineCalls(Inliner * inliner){
+	myStmtList->inlineCalls(inliner);
+}
+
+void IfElseStmtNode::inlineCalls(Inliner * inliner){
+	myStmtList->inlineCalls(inliner);
+	myElseStmtList->inlineCalls(inliner);
+}
+
+void WhileStmtNode::inlineCalls(Inliner * inliner){
+	myStmtList->inlineCalls(inliner);
+}
+
+ExpNode ** AssignStmtNode::leadingCall(Inliner * inliner){
+	return myAssign->leadingCall(nullptr, inliner);
+}
+
+ExpNode ** WriteStmtNode::leadingCall(Inliner * inliner){
+	return myLoc->leadingCall(&myLoc, inliner);
+}
+
+ExpNode ** ReturnStmtNode::leadingCall(Inliner * inliner){
+	return myLoc == nullptr ? nullptr : myLoc->leadingCall(&myLoc, inliner);
+}
+
+// Only calls among the actuals: the call itself is replaced along with
+// the statement (StmtListNode::inlineCalls)
+ExpNode ** CallStmtNode::leadingCall(Inliner * inliner){
+	return myCall->getArgs() == nullptr ? nullptr
+		: myCall->getArgs()->leadingCall(nullptr, inliner);
+}
+
+ExpNode ** IfStmtNode::leadingCall(Inliner * inliner){
+	return myExp->leadingCall(&myExp, inliner);
+}
+
+ExpNode ** IfElseStmtNode::leadingCall(Inliner * inliner){
+	return myExp->leadingCall(&myExp, inliner);
+}
+
+// Expressions
+
+bool IdNode::isStable(){
+	return mySymbol != nullptr && !mySymbol->isGlobal();
+}
+
+bool DotAccessNode::isStable(){
+	return myBase != nullptr && myBase->isStable();
+}
+
+ExpNode ** BinaryExpNode::leadingCall(ExpNode ** slot, Inliner * inliner){
+	ExpNode ** found = myLeft->leadingCall(&myLeft, inliner);
+	if (found != nullptr || !myLeft->isStable()){
+		return found;
+	}
+	return myRight->leadingCall(&myRight, inliner);
+}
+
+ExpNode ** AndNode::leadingCall(ExpNode ** slot, Inliner * inliner){
+	return myLeft->leadingCall(&myLeft, inliner);
+}
+
+ExpNode ** OrNode::leadingCall(ExpNode ** slot, Inliner * inliner){
+	return myLeft->leadingCall(&myLeft, inliner);
+}
+
+// The right side is evaluated first; the location has no effects
+ExpNode ** AssignNode::leadingCall(ExpNode ** slot, Inliner * inliner){
+	return myRight->leadingCall(&myRight, inliner);
+}
+
+// A call whose actuals are not all stable can still be expanded itself:
+// they are evaluated into the formals in order, as the call would.
+ExpNode ** CallExpNode::leadingCall(ExpNode ** slot, Inliner * inliner){
+	if (myList != nullptr){
+		ExpNode ** found = myList->leadingCall(nullptr, inliner);
+		if (found != nullptr){
+			return found;
+		}
+	}
+	return slot != nullptr && inliner->inlinable(this) != nullptr ? slot : nullptr;
+}
+
+ExpNode ** ExpListNode::leadingCall(ExpNode ** slot, Inliner * inliner){
+	for (ExpNode *& exp : myList){
+		ExpNode ** found = exp->leadingCall(&exp, inliner);
+		if (found != nullptr || !exp->isStable()){
+			return found;
+		}
+	}
+	return nullptr;
+}
+
+IdNode * IdNode::clone(Inliner * inliner){
+	// Named after what it refers to, so the callee's formals and locals
+	// print as the caller's fresh locals
+	SemSymbol * sym = inliner->renamed(mySymbol);
+	IdNode * copy = new IdNode(sym != nullptr ? sym->getName() : myStrVal,
+		myLine, myCol);
+	copy->mySymbol = sym;
+	return copy;
+}
+
+ExpNode * DotAccessNode::clone(Inliner * inliner){
+	DotAccessNode * copy = new DotAccessNode(myLeft->clone(inliner),
+		myRight->clone(inliner));
+	DotAccessNode * leftDot = dynamic_cast<DotAccessNode *>(copy->myLeft);
+	copy->myBase = leftDot != nullptr ? leftDot->myBase
+		: static_cast<IdNode *>(copy->myLeft);
+	copy->myOffset = myOffset;
+	return copy;
+}
+
+AssignNode * AssignNode::clone(Inliner * inliner){
+	return new AssignNode(myLeft->clone(inliner), myRight->clone(inliner));
+}
+
+CallExpNode * CallExpNode::clone(Inliner * inliner){
+	return new CallExpNode(myLoc->clone(inliner),
+		myList == nullptr ? nullptr : myList->clone(inliner));
+}
+
+ExpListNode * ExpListNode::clone(Inliner * inliner){
+	std::list<ExpNode *> copies;
+	for (ExpNode * exp : myList){
+		copies.push_back(exp->clone(inliner));
+	}
+	return new ExpListNode(&copies);
+}
+
+ExpNode * TrueNode::clone(Inliner * inliner){ return new TrueNode(myLine, myCol); }
+ExpNode * FalseNode::clone(Inliner * inliner){ return new FalseNode(myLine, myCol); }
+ExpNode * IntLitNode::clone(Inliner * inliner){ return new IntLitNode(myVal, myLine, myCol); }
+ExpNode * StringLitNode::clone(Inliner * inliner){ return new StringLitNode(*this); }
+
+ExpNode * UnaryMinusNode::clone(Inliner * inliner){
+	return new UnaryMinusNode(myNode->clone(inliner));
+}
+
+ExpNode * NotNode::clone(Inliner * inliner){
+	return new NotNode(myNode->clone(inliner));
+}
+
+#define LILC_CLONE_BINARY(name) \
+	ExpNode * name::clone(Inliner * inliner){ \
+		return new name(myLeft->clone(inliner), myRight->clone(inliner)); \
+	}
+
+LILC_CLONE_BINARY(PlusNode)
+LILC_CLONE_BINARY(MinusNode)
+LILC_CLONE_BINARY(TimesNode)
+LILC_CLONE_BINARY(DivideNode)
+LILC_CLONE_BINARY(AndNode)
+LILC_CLONE_BINARY(OrNode)
+LILC_CLONE_BINARY(EqualsNode)
+LILC_CLONE_BINARY(NotEqualsNode)
+LILC_CLONE_BINARY(LessNode)
+LILC_CLONE_BINARY(GreaterNode)
+LILC_CLONE_BINARY(LessEqNode)
+LILC_CLONE_BINARY(GreaterEqNode)
+
+#undef LILC_CLONE_BINARY
+
+} //End namespace LIL' C
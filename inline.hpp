@@ -0,0 +1,98 @@
+#ifndef LILC_INLINE_HPP
+#define LILC_INLINE_HPP
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace LILC{
+
+class ProgramNode;
+class FnDeclNode;
+class CallExpNode;
+class ExpNode;
+class StmtNode;
+class TypeNode;
+class VarDeclNode;
+class SemSymbol;
+class FreshNames;
+
+// Inlining of small functions at their call sites (inline.cpp).
+//
+// Rewrites a type-checked AST. A call is replaced by a copy of the
+// callee's body if the callee has at most `threshold` nodes, cannot reach
+// itself through calls, only returns at the very end of its body, and has
+// no struct formals or locals. The callee's formals and locals become
+// fresh locals of the caller: the actuals are assigned to the formals in
+// order, the locals are reset to zero as a call would, and the trailing
+// return becomes an assignment to a fresh result variable that takes the
+// call's place. Callees are rewritten before their callers, so what gets
+// copied is already inlined.
+//
+// The copied body runs as statements ahead of the one that made the call.
+// That is only done where nothing the statement evaluates before the call
+// could observe or affect it (see ExpNode::leadingCall), and never for
+// calls in while conditions, which run on every iteration.
+class Inliner{
+public:
+	static const size_t DEFAULT_THRESHOLD = 40;
+
+	Inliner(size_t threshold = DEFAULT_THRESHOLD){ myThreshold = threshold; }
+	void run(ProgramNode * program);
+
+	// The function call would be replaced by, or null
+	FnDeclNode * inlinable(CallExpNode * call);
+	// Appends the statements that replace an inlinable call to out and
+	// returns the variable holding its value (null for a void function).
+	// The call's actuals are moved into the statements.
+	ExpNode * expand(CallExpNode * call, std::list<StmtNode *>& out);
+
+	// Called by the AST nodes while surveying a function
+	void noteReturn(){ mySurvey->returns++; }
+	void noteLocal(VarDeclNode * decl);
+	// Called by the AST nodes while copying a callee: the variable that
+	// stands for sym in the copy, and a fresh one for a block local. An
+	// inliner that is not expanding a call copies statements as they are,
+	// as long as they declare no block locals (loops.cpp).
+	SemSymbol * renamed(SemSymbol * sym);
+	void renameLocal(VarDeclNode * decl);
+
+	size_t inlined(){ return myInlined; }
+	// Nodes in all function bodies before and after inlining
+	size_t nodesBefore(){ return myNodesBefore; }
+	size_t nodesAfter(){ return myNodesAfter; }
+private:
+	struct Summary {
+		size_t size = 0;
+		size_t returns = 0;
+		bool endsInReturn = false;
+		bool hasStructs = false;
+		bool recursive = false;
+	};
+
+	void survey(FnDeclNode * fn);
+	SemSymbol * freshLocal(const std::string& name, TypeNode * type,
+		size_t line, size_t col);
+	SemSymbol * rename(SemSymbol * sym);
+
+	size_t myThreshold;
+	std::unordered_map<FnDeclNode *, Summary> mySummaries;
+	Summary * mySurvey = nullptr;
+	FnDeclNode * myCaller = nullptr;
+	FnDeclNode * myCallee = nullptr;
+	// Names of the caller's fresh locals
+	FreshNames * myNames = nullptr;
+	// While copying a callee: its variables and what replaces them, and
+	// the locals to reset
+	std::unordered_map<SemSymbol *, SemSymbol *> myRenamed;
+	std::vector<SemSymbol *> myResets;
+	size_t myInlined = 0;
+	size_t myNodesBefore = 0;
+	size_t myNodesAfter = 0;
+};
+
+} //End namespace LIL' C
+
+#endif
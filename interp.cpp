@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "ast.hpp"
+#include "interp.hpp"
+#include "lilc_arith.hpp"
+#include "lilc_runtime.hpp"
+#include "symbol_table.hpp"
+
+namespace LILC{
+
+// Room for main and MAX_CALL_DEPTH calls, plus the margin execute() keeps
+static const size_t THREAD_STACK =
+	(MAX_CALL_DEPTH + 1) * Interpreter::NATIVE_PER_CALL + (8 << 20);
+
+Interpreter::Interpreter(RuntimeIO * io, size_t stackBytes)
+: myStack(new char[stackBytes]){
+	myIO = io;
+	myTop = myStack.get();
+	myStackEnd = myTop + stackBytes;
+}
+
+int Interpreter::sizeOf(IdNode * id){
+	return id->getSymbol()->getType()->getSize();
+}
+
+bool Interpreter::run(ProgramNode * program, std::ostream& err){
+	FnDeclNode * main = nullptr;
+	for (DeclNode * decl : program->getDeclList()->getDecls()){
+		FnDeclNode * fn = dynamic_cast<FnDeclNode *>(decl);
+		if (fn != nullptr && fn->getId()->getName() == "main"){
+			main = fn;
+		}
+	}
+	if (main == nullptr){
+		err << "***ERROR*** No main function\n";
+		return false;
+	}
+	myGlobals.assign(program->getGlobalSize(), 0);
+	myError.clear();
+
+	// main runs on a thread of its own, or failing that on what is left of
+	// this thread's stack rlimit
+	pthread_attr_t attr;
+	pthread_t thread;
+	bool threaded = false;
+	myMain = main;
+	if (pthread_attr_init(&attr) == 0){
+		threaded = pthread_attr_setstacksize(&attr, THREAD_STACK) == 0
+			&& pthread_create(&thread, &attr, start, this) == 0;
+		pthread_attr_destroy(&attr);
+	}
+	if (threaded){
+		pthread_join(thread, nullptr);
+	} else {
+		struct rlimit limit;
+		size_t native = 8 << 20;
+		if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY){
+			native = limit.rlim_cur;
+		}
+		execute(main, native);
+	}
+	myIO->flush();
+	err << myError;
+	return myError.empty();
+}
+
+void * Interpreter::start(void * arg){
+	Interpreter * interp = static_cast<Interpreter *>(arg);
+	interp->execute(interp->myMain, THREAD_STACK);
+	return nullptr;
+}
+
+void Interpreter::execute(FnDeclNode * main, size_t native){
+	// Leave a quarter of the native stack (at most 8MB of it) as margin
+	char here;
+	myNativeBase = &here;
+	myNativeLimit = native - std::min(native / 4, (size_t)8 << 20);
+	myDepth = 0;
+	try {
+		call(main, pushFrame(main, main->getId()));
+	} catch (RuntimeError& e){
+		myError = std::to_string(e.getLine()) + ":" + std::to_string(e.getCol())
+			+ " ***RUNTIME ERROR*** " + e.what() + "\n";
+	}
+}
+
+char * Interpreter::pushFrame(FnDeclNode * fn, ExpNode * at){
+	size_t size = alignUp(fn->getFrameSize(), 8);
+	char here;
+	// main is not one of the MAX_CALL_DEPTH calls
+	if (myDepth > MAX_CALL_DEPTH
+	    || size > (size_t)(myStackEnd - myTop)
+	    || (size_t)(myNativeBase - &here) > myNativeLimit){
+		throw RuntimeError(at->getLine(), at->getCol(), "Stack overflow");
+	}
+	char * frame = myTop;
+	memset(frame, 0, size);
+	myTop += size;
+	myDepth++;
+	return frame;
+}
+
+int Interpreter::call(FnDeclNode * fn, char * frame){
+	char * caller = myFrame;
+	myFrame = frame;
+	myCalls++;
+	// Falling off the end returns 0
+	int result = fn->getBody()->exec(this) ? myReturn : 0;
+	myFrame = caller;
+	myTop = frame;
+	myDepth--;
+	return result;
+}
+
+// Statements
+
+bool FnBodyNode::exec(Interpreter * interp){
+	return getStmts()->exec(interp);
+}
+
+bool StmtListNode::exec(Interpreter * interp){
+	for (StmtNode * stmt : myList){
+		if (stmt->exec(interp)){
+			return true;
+		}
+	}
+	return false;
+}
+
+bool AssignStmtNode::exec(Interpreter * interp){
+	myAssign->eval(interp);
+	return false;
+}
+
+bool PostIncStmtNode::exec(Interpreter * interp){
+	char * addr = myLoc->address(interp);
+	int size = Interpreter::sizeOf(myLoc->locId());
+	Interpreter::store(addr, size, lilcAdd(Interpreter::load(addr, size), 1));
+	return false;
+}
+
+bool PostDecStmtNode::exec(Interpreter * interp){
+	char * addr = myLoc->address(interp);
+	int size = Interpreter::sizeOf(myLoc->locId());
+	Interpreter::store(addr, size, lilcSub(Interpreter::load(addr, size), 1));
+	return false;
+}
+
+bool ReadStmtNode::exec(Interpreter * interp){
+	Interpreter::store(myLoc->address(interp),
+		Interpreter::sizeOf(myLoc->locId()), interp->io()->readInt());
+	return false;
+}
+
+bool WriteStmtNode::exec(Interpreter * interp){
+	StringLitNode * str = dynamic_cast<StringLitNode *>(myLoc);
+	if (str != nullptr){
+		interp->io()->writeString(str->getLexeme());
+	} else {
+		interp->io()->writeInt(myLoc->eval(interp));
+	}
+	return false;
+}
+
+bool ReturnStmtNode::exec(Interpreter * interp){
+	if (myLoc != nullptr){
+		interp->setReturn(myLoc->eval(interp));
+	}
+	return true;
+}
+
+bool CallStmtNode::exec(Interpreter * interp){
+	myCall->eval(interp);
+	return false;
+}
+
+bool IfStmtNode::exec(Interpreter * interp){
+	if (myExp->eval(interp)){
+		return myStmtList->exec(interp);
+	}
+	return false;
+}
+
+bool IfElseStmtNode::exec(Interpreter * interp){
+	if (myExp->eval(interp)){
+		return myStmtList->exec(interp);
+	}
+	return myElseStmtList->exec(interp);
+}
+
+bool WhileStmtNode::exec(Interpreter * interp){
+	while (myExp->eval(interp)){
+		if (myStmtList->exec(interp)){
+			return true;
+		}
+	}
+	return false;
+}
+
+// Locations
+
+char * IdNode::address(Interpreter * interp){
+	char * base = mySymbol->isGlobal() ? interp->globals() : interp->frame();
+	return base + mySymbol->getOffset();
+}
+
+char * DotAccessNode::address(Interpreter * interp){
+	return myBase->address(interp) + myOffset;
+}
+
+int IdNode::eval(Interpreter * interp){
+	return Interpreter::load(address(interp), Interpreter::sizeOf(this));
+}
+
+int DotAccessNode::eval(Interpreter * interp){
+	return Interpreter::load(address(interp), Interpreter::sizeOf(myRight));
+}
+
+int AssignNode::eval(Interpreter * interp){
+	int value = myRight->eval(interp);
+	Interpreter::store(myLeft->address(interp),
+		Interpreter::sizeOf(myLeft->locId()), value);
+	return value;
+}
+
+// Values
+
+int IntLitNode::eval(Interpreter * interp){
+	return myVal;
+}
+
+int TrueNode::eval(Interpreter * interp){
+	return 1;
+}
+
+int FalseNode::eval(Interpreter * interp){
+	return 0;
+}
+
+int StringLitNode::eval(Interpreter * interp){
+	throw RuntimeError(myLine, myCol, "Strings can only be written");
+}
+
+int CallExpNode::eval(Interpreter * interp){
+	FnDeclNode * fn = static_cast<FnDeclNode *>(myLoc->getSymbol()->getDecl());
+	char * frame = interp->pushFrame(fn, this);
+	if (myList != nullptr){
+		// Actuals are evaluated in the caller's frame, straight into the
+		// callee's formals
+		auto formal = fn->getFormals()->getFormals().begin();
+		for (ExpNode * actual : myList->getExps()){
+			IdNode * id = (*formal)->getId();
+			Interpreter::store(frame + id->getSymbol()->getOffset(),
+				Interpreter::sizeOf(id), actual->eval(interp));
+			++formal;
+		}
+	}
+	return interp->call(fn, frame);
+}
+
+int ExpListNode::eval(Interpreter * interp){
+	int value = 0;
+	for (ExpNode * exp : myList){
+		value = exp->eval(interp);
+	}
+	return value;
+}
+
+// Operators
+
+int UnaryMinusNode::eval(Interpreter * interp){
+	return lilcNeg(myNode->eval(interp));
+}
+
+int NotNode::eval(Interpreter * interp){
+	return !myNode->eval(interp);
+}
+
+int PlusNode::eval(Interpreter * interp){
+	int a = myLeft->eval(interp);
+	return lilcAdd(a, myRight->eval(interp));
+}
+
+int MinusNode::eval(Interpreter * interp){
+	int a = myLeft->eval(interp);
+	return lilcSub(a, myRight->eval(interp));
+}
+
+int TimesNode::eval(Interpreter * interp){
+	int a = myLeft->eval(interp);
+	return lilcMul(a, myRight->eval(interp));
+}
+
+int DivideNode::eval(Interpreter * interp){
+	int a = myLeft->eval(interp);
+	int b = myRight->eval(interp);
+	if (b == 0){
+		throw RuntimeError(getLine(), getCol(), "Division by zero");
+	}
+	return lilcDiv(a, b);
+}
+
+int AndNode::eval(Interpreter * interp){
+	return myLeft->eval(interp) && myRight->eval(interp);
+}
+
+int OrNode::eval(Interpreter * interp){
+	return myLeft->eval(interp) || myRight->eval(interp);
+}
+
+int EqualsNode::eval(Interpreter * interp){
+	int a = myLeft->eval(interp);
+	return a == myRight->eval(interp);
+}
+
+int NotEqualsNode::eval(Interpreter * interp){
+	int a = myLeft->eval(interp);
+	return a != myRight->eval(interp);
+}
+
+int LessNode::eval(Interpreter * interp){
+	int a = myLeft->eval(interp);
+	return a < myRight->eval(interp);
+}
+
+int GreaterNode::eval(Interpreter * interp){
+	int a = myLeft->eval(interp);
+	return a > myRight->eval(interp);
+}
+
+int LessEqNode::eval(Interpreter * interp){
+	int a = myLeft->eval(interp);
+	return a <= myRight->eval(interp);
+}
+
+int GreaterEqNode::eval(Interpreter * interp){
+	int a = myLeft->eval(interp);
+	return a >= myRight->eval(interp);
+}
+
+} //End namespace LIL' C
@@ -0,0 +1,100 @@
+#ifndef LILC_INTERP_HPP
+#define LILC_INTERP_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace LILC{
+
+class ProgramNode;
+class FnDeclNode;
+class ExpNode;
+class IdNode;
+class RuntimeIO;
+
+// Tree-walking interpreter for a name-analysed and type-checked AST
+// (interp.cpp). Runs main with I/O through a RuntimeIO.
+//
+// Storage is flat bytes laid out by name analysis: one area for the
+// globals, and for each call a frame of the callee's getFrameSize() bytes
+// pushed on a contiguous stack, holding its formals and every local.
+// Variables are read and written at their symbol's offset, ints as 4
+// bytes and bools as 1, so a struct is just its layout in place and a
+// dot-access chain is one addition. Every variable starts out zero or
+// false; block locals keep their value between loop iterations.
+//
+// Calls recurse on the native stack, so main runs on a thread whose stack
+// has NATIVE_PER_CALL bytes for each of MAX_CALL_DEPTH calls
+// (lilc_runtime.hpp).
+class Interpreter{
+public:
+	static const size_t DEFAULT_STACK = 64 << 20;
+	static const size_t NATIVE_PER_CALL = 2 << 10;
+
+	Interpreter(RuntimeIO * io, size_t stackBytes = DEFAULT_STACK);
+
+	// Runs program's main. A runtime error stops the program and is
+	// reported on err; returns false if there was one.
+	bool run(ProgramNode * program, std::ostream& err);
+	size_t getCalls(){ return myCalls; }
+
+	// Used by the AST nodes while running
+	RuntimeIO * io(){ return myIO; }
+	char * globals(){ return myGlobals.data(); }
+	char * frame(){ return myFrame; }
+	// Reserves a zeroed frame for a call to fn at `at` without entering it,
+	// so the caller can evaluate the actuals into it.
+	char * pushFrame(FnDeclNode * fn, ExpNode * at);
+	// Runs fn's body in frame, pops the frame and returns the result
+	int call(FnDeclNode * fn, char * frame);
+	void setReturn(int value){ myReturn = value; }
+
+	// A value of `size` bytes (4 for int, 1 for bool) at addr
+	static int load(const char * addr, int size){
+		if (size == 1){
+			return *addr;
+		}
+		int32_t value;
+		memcpy(&value, addr, sizeof(value));
+		return value;
+	}
+	static void store(char * addr, int size, int value){
+		if (size == 1){
+			*addr = value != 0;
+			return;
+		}
+		int32_t word = value;
+		memcpy(addr, &word, sizeof(word));
+	}
+	// Storage size of the variable or field a location expression names
+	static int sizeOf(IdNode * id);
+private:
+	// Runs main with native bytes of stack below here; a runtime error
+	// ends up in myError
+	void execute(FnDeclNode * main, size_t native);
+	static void * start(void * arg);
+
+	RuntimeIO * myIO;
+	std::vector<char> myGlobals;
+	// Left uninitialized so only the part that is used gets paged in
+	std::unique_ptr<char[]> myStack;
+	char * myStackEnd;
+	char * myTop = nullptr;
+	char * myFrame = nullptr;
+	// Recursion also uses the native stack; stop well before it overflows
+	const char * myNativeBase = nullptr;
+	size_t myNativeLimit = 0;
+	size_t myDepth = 0;
+	FnDeclNode * myMain = nullptr;
+	std::string myError;
+	int myReturn = 0;
+	size_t myCalls = 0;
+};
+
+} //End namespace LIL' C
+
+#endif
@@ -0,0 +1,1005 @@
+#include <algorithm>
+#include <climits>
+#include <functional>
+
+#include "ast.hpp"
+#include "bytecode.hpp"
+#include "ir.hpp"
+#include "lilc_arith.hpp"
+#include "symbol_table.hpp"
+
+// SSA data structures, the textual dump and the lowering of optimized IR
+// to register bytecode (see ir.hpp).
+
+namespace LILC{
+
+struct IROpInfo {
+	const char * name;
+	int flags;
+};
+
+static const IROpInfo OPS[] = {
+#define LILC_IR_INFO(name, text, flags) { text, flags },
+	LILC_IR_OPS(LILC_IR_INFO)
+#undef LILC_IR_INFO
+};
+
+const char * irOpName(IROp op){
+	return OPS[op].name;
+}
+
+int irOpFlags(IROp op){
+	return OPS[op].flags;
+}
+
+bool IRInstr::removable() const {
+	if (op == IR_PARAM || !is(IR_PURE | IR_READS_MEMORY)){
+		return false;
+	}
+	if (is(IR_TRAPS)){
+		// Division only stops the program when the divisor is zero
+		return args[1]->op == IR_CONST && args[1]->value != 0;
+	}
+	return true;
+}
+
+// Blocks
+
+std::vector<IRBlock *> IRBlock::succs(){
+	IRInstr * term = terminator();
+	if (term == nullptr || term->op == IR_RET){
+		return {};
+	}
+	if (term->op == IR_JUMP){
+		return { term->targets[0] };
+	}
+	return { term->targets[0], term->targets[1] };
+}
+
+size_t IRBlock::firstNonPhi(){
+	size_t k = 0;
+	while (k < instrs.size() && instrs[k]->op == IR_PHI){
+		k++;
+	}
+	return k;
+}
+
+size_t IRBlock::predIndex(IRBlock * pred){
+	return std::find(preds.begin(), preds.end(), pred) - preds.begin();
+}
+
+void IRBlock::removePred(IRBlock * pred){
+	size_t index = predIndex(pred);
+	if (index == preds.size()){
+		return;
+	}
+	preds.erase(preds.begin() + index);
+	for (size_t k = 0; k < firstNonPhi(); k++){
+		instrs[k]->args.erase(instrs[k]->args.begin() + index);
+	}
+}
+
+// Functions
+
+IRFunction::IRFunction(FnDeclNode * decl, const std::string& name){
+	myDecl = decl;
+	myName = name;
+	newBlock();
+}
+
+IRBlock * IRFunction::newBlock(){
+	myBlocks.emplace_back(new IRBlock());
+	myBlocks.back()->id = myBlocks.size() - 1;
+	return myBlocks.back().get();
+}
+
+IRInstr * IRFunction::newInstr(IROp op, IRBlock * block){
+	myInstrs.emplace_back(new IRInstr());
+	IRInstr * instr = myInstrs.back().get();
+	instr->op = op;
+	instr->id = myNextId++;
+	if (block != nullptr){
+		instr->block = block;
+		block->instrs.push_back(instr);
+	}
+	return instr;
+}
+
+// Params, then constants, lead the entry block
+static void placeInEntry(IRBlock * entry, IRInstr * instr, bool isParam){
+	size_t k = 0;
+	while (k < entry->instrs.size()
+		&& (entry->instrs[k]->op == IR_PARAM
+		    || (!isParam && entry->instrs[k]->op == IR_CONST))){
+		k++;
+	}
+	entry->instrs.insert(entry->instrs.begin() + k, instr);
+	instr->block = entry;
+}
+
+IRInstr * IRFunction::constant(int32_t value){
+	auto found = myConstants.find(value);
+	if (found != myConstants.end() && found->second->block != nullptr){
+		return found->second;
+	}
+	IRInstr * instr = newInstr(IR_CONST, nullptr);
+	instr->value = value;
+	placeInEntry(entry(), instr, false);
+	myConstants[value] = instr;
+	return instr;
+}
+
+IRInstr * IRFunction::param(int index){
+	while ((int)myParams.size() <= index){
+		IRInstr * instr = newInstr(IR_PARAM, nullptr);
+		instr->value = myParams.size();
+		placeInEntry(entry(), instr, true);
+		myParams.push_back(instr);
+	}
+	return myParams[index];
+}
+
+IRInstr * IRFunction::resolve(IRInstr * v){
+	while (v->forward != nullptr){
+		v = v->forward;
+	}
+	return v;
+}
+
+void IRFunction::resolveAll(){
+	for (auto& block : myBlocks){
+		if (block->removed){
+			continue;
+		}
+		std::vector<IRInstr *> kept;
+		for (IRInstr * instr : block->instrs){
+			if (instr->forward != nullptr){
+				instr->block = nullptr;
+				continue;
+			}
+			for (IRInstr *& arg : instr->args){
+				arg = resolve(arg);
+			}
+			kept.push_back(instr);
+		}
+		block->instrs = std::move(kept);
+	}
+}
+
+std::vector<IRBlock *> IRFunction::reversePostorder(){
+	std::vector<IRBlock *> order;
+	std::vector<bool> visited(myBlocks.size(), false);
+	std::vector<std::pair<IRBlock *, size_t>> stack;
+	stack.emplace_back(entry(), 0);
+	visited[entry()->id] = true;
+	while (!stack.empty()){
+		IRBlock * block = stack.back().first;
+		std::vector<IRBlock *> succs = block->succs();
+		size_t next = stack.back().second++;
+		if (next < succs.size()){
+			// Visited last, so a branch's taken target comes first
+			IRBlock * succ = succs[succs.size() - 1 - next];
+			if (!visited[succ->id]){
+				visited[succ->id] = true;
+				stack.emplace_back(succ, 0);
+			}
+			continue;
+		}
+		order.push_back(block);
+		stack.pop_back();
+	}
+	std::reverse(order.begin(), order.end());
+	return order;
+}
+
+size_t IRFunction::removeUnreachable(){
+	std::vector<bool> reachable(myBlocks.size(), false);
+	for (IRBlock * block : reversePostorder()){
+		reachable[block->id] = true;
+	}
+	size_t removed = 0;
+	for (auto& block : myBlocks){
+		if (block->removed || reachable[block->id]){
+			continue;
+		}
+		for (IRBlock * succ : block->succs()){
+			succ->removePred(block.get());
+		}
+		for (IRInstr * instr : block->instrs){
+			instr->block = nullptr;
+		}
+		block->instrs.clear();
+		block->preds.clear();
+		block->removed = true;
+		removed++;
+	}
+	return removed;
+}
+
+std::unordered_map<IRBlock *, IRBlock *> IRFunction::dominators(
+	const std::vector<IRBlock *>& rpo){
+	// Cooper, Harvey and Kennedy's iterative algorithm
+	std::unordered_map<IRBlock *, size_t> index;
+	for (size_t k = 0; k < rpo.size(); k++){
+		index[rpo[k]] = k;
+	}
+	std::unordered_map<IRBlock *, IRBlock *> idom;
+	idom[rpo[0]] = rpo[0];
+	bool changed = true;
+	while (changed){
+		changed = false;
+		for (size_t k = 1; k < rpo.size(); k++){
+			IRBlock * found = nullptr;
+			for (IRBlock * pred : rpo[k]->preds){
+				if (idom.count(pred) == 0){
+					continue;
+				}
+				if (found == nullptr){
+					found = pred;
+					continue;
+				}
+				IRBlock * a = pred;
+				IRBlock * b = found;
+				while (a != b){
+					while (index[a] > index[b]){ a = idom[a]; }
+					while (index[b] > index[a]){ b = idom[b]; }
+				}
+				found = a;
+			}
+			if (found != nullptr && idom[rpo[k]] != found){
+				idom[rpo[k]] = found;
+				changed = true;
+			}
+		}
+	}
+	return idom;
+}
+
+size_t IRFunction::instructionCount(){
+	size_t count = 0;
+	for (auto& block : myBlocks){
+		count += block->instrs.size();
+	}
+	return count;
+}
+
+// Dump
+
+static void dumpInstr(std::ostream& out, IRInstr * instr){
+	out << "    ";
+	if (!instr->is(IR_VOID)){
+		out << "%" << instr->id << " = ";
+	}
+	out << irOpName(instr->op);
+	switch (instr->op){
+	case IR_CONST:
+	case IR_PARAM:
+		out << " " << instr->value;
+		return;
+	case IR_PHI:
+		for (size_t k = 0; k < instr->args.size(); k++){
+			out << (k == 0 ? " " : ", ") << "[%" << instr->args[k]->id
+				<< ", b" << instr->block->preds[k]->id << "]";
+		}
+		return;
+	case IR_LOADG:
+	case IR_STOREG:
+		out << " @" << instr->global->getName();
+		if (instr->offset != 0){
+			out << "+" << instr->offset;
+		}
+		if (instr->op == IR_STOREG){
+			out << ", %" << instr->args[0]->id;
+		}
+		return;
+	case IR_CALL:
+		out << " " << instr->callee->getId()->getName() << "(";
+		for (size_t k = 0; k < instr->args.size(); k++){
+			out << (k == 0 ? "%" : ", %") << instr->args[k]->id;
+		}
+		out << ")";
+		return;
+	case IR_WRITES:
+		out << " " << instr->text;
+		return;
+	default:
+		break;
+	}
+	for (size_t k = 0; k < instr->args.size(); k++){
+		out << (k == 0 ? " %" : ", %") << instr->args[k]->id;
+	}
+	for (IRBlock * target : instr->targets){
+		if (target != nullptr){
+			out << (instr->args.empty() && target == instr->targets[0] ? " b" : ", b")
+				<< target->id;
+		}
+	}
+}
+
+void IRFunction::dump(std::ostream& out){
+	out << "function " << myName << "\n";
+	for (IRBlock * block : reversePostorder()){
+		out << "b" << block->id << ":";
+		for (size_t k = 0; k < block->preds.size(); k++){
+			out << (k == 0 ? "    ; preds b" : ", b") << block->preds[k]->id;
+		}
+		out << "\n";
+		for (IRInstr * instr : block->instrs){
+			dumpInstr(out, instr);
+			out << "\n";
+		}
+	}
+}
+
+// Programs
+
+IRFunction * IRProgram::add(FnDeclNode * decl, const std::string& name){
+	myFunctions.emplace_back(new IRFunction(decl, name));
+	myByDecl[decl] = myFunctions.back().get();
+	return myFunctions.back().get();
+}
+
+IRFunction * IRProgram::find(FnDeclNode * decl){
+	auto found = myByDecl.find(decl);
+	return found == myByDecl.end() ? nullptr : found->second;
+}
+
+size_t IRProgram::instructionCount(){
+	size_t count = 0;
+	for (auto& fn : myFunctions){
+		count += fn->instructionCount();
+	}
+	return count;
+}
+
+void IRProgram::dump(std::ostream& out){
+	for (size_t k = 0; k < myFunctions.size(); k++){
+		if (k > 0){
+			out << "\n";
+		}
+		myFunctions[k]->dump(out);
+	}
+}
+
+// Lowering to bytecode
+
+namespace {
+
+// Values as dense bit sets, for liveness
+class ValueSet{
+public:
+	ValueSet(size_t size = 0) : myWords((size + 63) / 64, 0){}
+	void add(int v){ myWords[v >> 6] |= uint64_t(1) << (v & 63); }
+	void remove(int v){ myWords[v >> 6] &= ~(uint64_t(1) << (v & 63)); }
+	bool has(int v) const { return (myWords[v >> 6] >> (v & 63)) & 1; }
+	// Returns whether anything was added
+	bool addAll(const ValueSet& other){
+		bool changed = false;
+		for (size_t k = 0; k < myWords.size(); k++){
+			uint64_t merged = myWords[k] | other.myWords[k];
+			changed |= merged != myWords[k];
+			myWords[k] = merged;
+		}
+		return changed;
+	}
+	template <typename F> void forEach(F f) const {
+		for (size_t k = 0; k < myWords.size(); k++){
+			for (uint64_t word = myWords[k]; word != 0; word &= word - 1){
+				f((int)(k * 64 + __builtin_ctzll(word)));
+			}
+		}
+	}
+private:
+	std::vector<uint64_t> myWords;
+};
+
+bool isCompare(IROp op){
+	return op >= IR_EQ && op <= IR_GE;
+}
+
+// Comparisons in the order of their opcodes
+const int NEGATED[] = { 1, 0, 5, 4, 3, 2 };
+const int SWAPPED[] = { 0, 1, 3, 2, 5, 4 };
+
+// One function's worth of lowering state
+class Lowering{
+public:
+	Lowering(IRFunction * fn, BytecodeGen * gen){
+		myFn = fn;
+		myGen = gen;
+	}
+	void run();
+private:
+	// What a branch tests once single-use nots and compares folded into it
+	struct Condition {
+		IRInstr * value = nullptr;
+		bool negate = false;
+		bool fused = false;
+	};
+	// A phi copy on an edge: dst = src, or dst = k if src is null
+	struct Move {
+		int dst;
+		IRInstr * src;
+		int32_t k;
+	};
+
+	void analyze();
+	bool immediate(IRInstr * user, size_t index);
+	template <typename F> void forEachUse(IRInstr * instr, F f);
+	void liveness();
+	void allocate();
+	void emitBlock(IRBlock * block, IRBlock * next);
+	void emitInstr(IRInstr * instr);
+	void emitBranch(IRBlock * block, IRInstr * term, IRBlock * next);
+	void emitMoves(IRBlock * from, IRBlock * to);
+	// Jumps to target if the condition is ifTrue
+	void emitCondJump(const Condition& cond, bool ifTrue, IRBlock * target,
+		size_t stub);
+	void jumpTo(IRBlock * target);
+	int reg(IRInstr * v){ return myBase + myReg[v->id]; }
+	bool hasReg(IRInstr * v){ return myReg[v->id] >= 0; }
+
+	IRFunction * myFn;
+	BytecodeGen * myGen;
+	std::vector<IRBlock *> myOrder;
+	std::vector<int> myUses;
+	std::vector<bool> mySkip;
+	std::unordered_map<IRInstr *, Condition> myConds;
+	std::vector<bool> myNeedsReg;
+	std::vector<ValueSet> myLiveIn;
+	std::vector<ValueSet> myLiveOut;
+	std::vector<int> myReg;
+	int myBase = 0;
+	int myScratch = 0;
+	int myArgs = 0;
+	// Jumps to patch: to a block, or to a stub by index
+	std::vector<std::pair<size_t, IRBlock *>> myBlockJumps;
+	std::vector<std::pair<size_t, size_t>> myStubJumps;
+	std::unordered_map<IRBlock *, size_t> myLabels;
+	std::vector<std::pair<IRBlock *, IRBlock *>> myStubs;
+};
+
+void Lowering::run(){
+	myOrder = myFn->reversePostorder();
+	analyze();
+	liveness();
+	allocate();
+	for (size_t k = 0; k < myOrder.size(); k++){
+		emitBlock(myOrder[k], k + 1 < myOrder.size() ? myOrder[k + 1] : nullptr);
+	}
+	// Critical edges whose copies could not go before the branch
+	std::vector<size_t> stubs;
+	for (auto& stub : myStubs){
+		stubs.push_back(myGen->pc());
+		emitMoves(stub.first, stub.second);
+		jumpTo(stub.second);
+	}
+	for (auto& jump : myBlockJumps){
+		myGen->patch({ jump.first }, myLabels[jump.second]);
+	}
+	for (auto& jump : myStubJumps){
+		myGen->patch({ jump.first }, stubs[jump.second]);
+	}
+}
+
+void Lowering::analyze(){
+	size_t count = 0;
+	for (IRBlock * block : myOrder){
+		for (IRInstr * instr : block->instrs){
+			count = std::max(count, (size_t)instr->id + 1);
+			for (IRInstr * arg : instr->args){
+				count = std::max(count, (size_t)arg->id + 1);
+			}
+		}
+	}
+	myUses.assign(count, 0);
+	mySkip.assign(count, false);
+	myNeedsReg.assign(count, false);
+	for (IRBlock * block : myOrder){
+		for (IRInstr * instr : block->instrs){
+			for (IRInstr * arg : instr->args){
+				myUses[arg->id]++;
+			}
+		}
+	}
+	// Single-use nots and compares in the branch's block become part of it
+	for (IRBlock * block : myOrder){
+		IRInstr * term = block->terminator();
+		if (term == nullptr || term->op != IR_BRANCH){
+			continue;
+		}
+		Condition cond;
+		cond.value = term->args[0];
+		while (cond.value->op == IR_NOT && myUses[cond.value->id] == 1
+			&& cond.value->block == block){
+			mySkip[cond.value->id] = true;
+			cond.negate = !cond.negate;
+			cond.value = cond.value->args[0];
+		}
+		if (isCompare(cond.value->op) && myUses[cond.value->id] == 1
+			&& cond.value->block == block){
+			mySkip[cond.value->id] = true;
+			cond.fused = true;
+		}
+		myConds[term] = cond;
+	}
+	for (IRBlock * block : myOrder){
+		for (IRInstr * instr : block->instrs){
+			if (mySkip[instr->id]){
+				continue;
+			}
+			if (instr->op != IR_CONST){
+				myNeedsReg[instr->id] = !instr->is(IR_VOID);
+			}
+			forEachUse(instr, [&](IRInstr * user, size_t index, IRInstr * arg){
+				if (arg->op == IR_CONST && !immediate(user, index)){
+					myNeedsReg[arg->id] = true;
+				}
+			});
+		}
+	}
+}
+
+// Calls f(user, index, value) for every value instr reads: a branch reads
+// what its condition folded in
+template <typename F> void Lowering::forEachUse(IRInstr * instr, F f){
+	if (instr->op == IR_PHI){
+		return;
+	}
+	if (instr->op == IR_BRANCH){
+		const Condition& cond = myConds[instr];
+		if (cond.fused){
+			f(cond.value, 0, cond.value->args[0]);
+			f(cond.value, 1, cond.value->args[1]);
+		} else {
+			f(instr, 0, cond.value);
+		}
+		return;
+	}
+	for (size_t k = 0; k < instr->args.size(); k++){
+		f(instr, k, instr->args[k]);
+	}
+}
+
+// Whether operand index of user is encoded in the instruction itself
+bool Lowering::immediate(IRInstr * user, size_t index){
+	switch (user->op){
+	case IR_ADD:
+		if (index == 1){
+			return true;
+		}
+		return user->args[1]->op != IR_CONST;
+	case IR_SUB:
+		return index == 1;
+	case IR_EQ: case IR_NE: case IR_LT: case IR_GT: case IR_LE: case IR_GE:
+		// Fused compares take one constant
+		if (!mySkip[user->id]){
+			return false;
+		}
+		return index == 1 || user->args[1]->op != IR_CONST;
+	case IR_CALL:
+	case IR_PHI:
+		return true;
+	case IR_BRANCH:
+		return myConds[user].value->op == IR_CONST;
+	default:
+		return false;
+	}
+}
+
+void Lowering::liveness(){
+	size_t count = myUses.size();
+	size_t blocks = myFn->blocks().size();
+	myLiveIn.assign(blocks, ValueSet(count));
+	myLiveOut.assign(blocks, ValueSet(count));
+	std::vector<ValueSet> uses(blocks, ValueSet(count));
+	std::vector<ValueSet> defs(blocks, ValueSet(count));
+	for (IRBlock * block : myOrder){
+		ValueSet& use = uses[block->id];
+		ValueSet& def = defs[block->id];
+		for (IRInstr * instr : block->instrs){
+			forEachUse(instr, [&](IRInstr *, size_t, IRInstr * arg){
+				if (myNeedsReg[arg->id] && !def.has(arg->id)){
+					use.add(arg->id);
+				}
+			});
+			if (myNeedsReg[instr->id]){
+				def.add(instr->id);
+			}
+		}
+	}
+	bool changed = true;
+	while (changed){
+		changed = false;
+		for (size_t k = myOrder.size(); k-- > 0;){
+			IRBlock * block = myOrder[k];
+			ValueSet out(count);
+			for (IRBlock * succ : block->succs()){
+				out.addAll(myLiveIn[succ->id]);
+				size_t index = succ->predIndex(block);
+				for (size_t p = 0; p < succ->firstNonPhi(); p++){
+					IRInstr * arg = succ->instrs[p]->args[index];
+					if (myNeedsReg[arg->id]){
+						out.add(arg->id);
+					}
+				}
+			}
+			myLiveOut[block->id] = out;
+			ValueSet in = uses[block->id];
+			defs[block->id].forEach([&](int v){ out.remove(v); });
+			in.addAll(out);
+			changed |= myLiveIn[block->id].addAll(in);
+		}
+	}
+}
+
+void Lowering::allocate(){
+	// Live ranges as the hull of every position a value is live at, in
+	// layout order: two positions per instruction, reads at the first and
+	// the write at the second. Phis are written at the end of each
+	// predecessor, where the copies go.
+	size_t count = myUses.size();
+	std::vector<int> start(count, INT_MAX);
+	std::vector<int> end(count, INT_MIN);
+	auto include = [&](IRInstr * v, int pos){
+		if (myNeedsReg[v->id]){
+			start[v->id] = std::min(start[v->id], pos);
+			end[v->id] = std::max(end[v->id], pos);
+		}
+	};
+	int pos = 0;
+	for (IRBlock * block : myOrder){
+		int from = pos;
+		for (IRInstr * instr : block->instrs){
+			pos += 2;
+			forEachUse(instr, [&](IRInstr *, size_t, IRInstr * arg){
+				include(arg, pos);
+			});
+			include(instr, instr->op == IR_PHI ? from : pos + 1);
+			if (instr->op == IR_PARAM){
+				// Arguments arrive in the first registers
+				include(instr, 0);
+			}
+		}
+		int to = pos;
+		for (IRBlock * succ : block->succs()){
+			size_t index = succ->predIndex(block);
+			for (size_t p = 0; p < succ->firstNonPhi(); p++){
+				include(succ->instrs[p], to);
+				include(succ->instrs[p]->args[index], to);
+			}
+		}
+		myLiveIn[block->id].forEach([&](int v){
+			start[v] = std::min(start[v], from);
+			end[v] = std::max(end[v], from);
+		});
+		myLiveOut[block->id].forEach([&](int v){
+			start[v] = std::min(start[v], to);
+			end[v] = std::max(end[v], to + 1);
+		});
+		pos += 2;
+	}
+
+	// Linear scan, parameters first so parameter i gets register i
+	std::vector<int> values;
+	for (size_t v = 0; v < count; v++){
+		if (myNeedsReg[v] && start[v] != INT_MAX){
+			values.push_back(v);
+		}
+	}
+	std::vector<int> order(count, INT_MAX);
+	for (IRInstr * instr : myFn->entry()->instrs){
+		if (instr->op == IR_PARAM){
+			order[instr->id] = instr->value;
+		}
+	}
+	std::sort(values.begin(), values.end(), [&](int a, int b){
+		if (start[a] != start[b]){
+			return start[a] < start[b];
+		}
+		return order[a] < order[b];
+	});
+	myReg.assign(count, -1);
+	std::vector<int> active;
+	std::vector<int> free;
+	int next = 0;
+	for (int v : values){
+		for (size_t k = 0; k < active.size();){
+			if (end[active[k]] < start[v]){
+				free.push_back(myReg[active[k]]);
+				active[k] = active.back();
+				active.pop_back();
+			} else {
+				k++;
+			}
+		}
+		if (free.empty()){
+			myReg[v] = next++;
+		} else {
+			auto lowest = std::min_element(free.begin(), free.end());
+			myReg[v] = *lowest;
+			free.erase(lowest);
+		}
+		active.push_back(v);
+	}
+	int params = 0;
+	if (myFn->getDecl()->getFormals() != nullptr){
+		params = myFn->getDecl()->getFormals()->getFormals().size();
+	}
+	next = std::max(next, params);
+	// One scratch register for copy cycles, then the outgoing arguments
+	size_t maxArgs = 0;
+	for (IRBlock * block : myOrder){
+		for (IRInstr * instr : block->instrs){
+			if (instr->op == IR_CALL){
+				maxArgs = std::max(maxArgs, instr->args.size());
+			}
+		}
+	}
+	myBase = myGen->temps(next + 1 + maxArgs);
+	myScratch = myBase + next;
+	myArgs = myScratch + 1;
+}
+
+void Lowering::emitBlock(IRBlock * block, IRBlock * next){
+	myLabels[block] = myGen->pc();
+	for (IRInstr * instr : block->instrs){
+		if (mySkip[instr->id]){
+			continue;
+		}
+		switch (instr->op){
+		case IR_JUMP:
+			emitMoves(block, instr->targets[0]);
+			if (instr->targets[0] != next){
+				jumpTo(instr->targets[0]);
+			}
+			break;
+		case IR_BRANCH:
+			emitBranch(block, instr, next);
+			break;
+		default:
+			emitInstr(instr);
+		}
+	}
+}
+
+void Lowering::jumpTo(IRBlock * target){
+	myBlockJumps.emplace_back(myGen->emit(OP_JMP, 0, 0, -1), target);
+}
+
+void Lowering::emitInstr(IRInstr * instr){
+	std::vector<IRInstr *>& args = instr->args;
+	switch (instr->op){
+	case IR_CONST:
+		if (hasReg(instr)){
+			myGen->emit(OP_LOADK, reg(instr), instr->value, 0);
+		}
+		return;
+	case IR_PARAM:
+	case IR_PHI:
+		return;
+	case IR_ADD:
+		if (args[1]->op == IR_CONST){
+			myGen->emit(OP_ADDI, reg(instr), reg(args[0]), args[1]->value);
+		} else if (args[0]->op == IR_CONST){
+			myGen->emit(OP_ADDI, reg(instr), reg(args[1]), args[0]->value);
+		} else {
+			myGen->emit(OP_ADD, reg(instr), reg(args[0]), reg(args[1]));
+		}
+		return;
+	case IR_SUB:
+		if (args[1]->op == IR_CONST){
+			myGen->emit(OP_ADDI, reg(instr), reg(args[0]), lilcNeg(args[1]->value));
+		} else {
+			myGen->emit(OP_SUB, reg(instr), reg(args[0]), reg(args[1]));
+		}
+		return;
+	case IR_MUL:
+		myGen->emit(OP_MUL, reg(instr), reg(args[0]), reg(args[1]));
+		return;
+	case IR_DIV:
+		myGen->emit(OP_DIV, reg(instr), reg(args[0]), reg(args[1]), instr->at);
+		return;
+	case IR_NEG:
+		myGen->emit(OP_NEG, reg(instr), reg(args[0]), 0);
+		return;
+	case IR_NOT:
+		myGen->emit(OP_NOT, reg(instr), reg(args[0]), 0);
+		return;
+	case IR_EQ: case IR_NE: case IR_LT: case IR_GT: case IR_LE: case IR_GE:
+		myGen->emit(Opcode(OP_EQ + (instr->op - IR_EQ)), reg(instr),
+			reg(args[0]), reg(args[1]));
+		return;
+	case IR_LOADG:
+		myGen->emit(OP_LOADG, reg(instr),
+			myGen->locate(instr->global, instr->offset).index, 0);
+		return;
+	case IR_STOREG:
+		myGen->emit(OP_STOREG, reg(args[0]),
+			myGen->locate(instr->global, instr->offset).index, 0);
+		return;
+	case IR_CALL:
+		for (size_t k = 0; k < args.size(); k++){
+			if (args[k]->op == IR_CONST){
+				myGen->emit(OP_LOADK, myArgs + k, args[k]->value, 0);
+			} else {
+				myGen->emit(OP_MOV, myArgs + k, reg(args[k]), 0);
+			}
+		}
+		myGen->emit(OP_CALL, reg(instr), myGen->functionIndex(instr->callee),
+			myArgs, instr->at);
+		return;
+	case IR_READ:
+		myGen->emit(OP_READ, reg(instr), 0, 0);
+		return;
+	case IR_READB:
+		myGen->emit(OP_READB, reg(instr), 0, 0);
+		return;
+	case IR_WRITE:
+		myGen->emit(OP_WRITE, reg(args[0]), 0, 0);
+		return;
+	case IR_WRITES:
+		myGen->emit(OP_WRITES, myGen->string(instr->text), 0, 0);
+		return;
+	case IR_RET:
+		if (args.empty()){
+			myGen->emit(OP_RET0, 0, 0, 0);
+		} else {
+			myGen->emit(OP_RET, reg(args[0]), 0, 0);
+		}
+		return;
+	default:
+		return;
+	}
+}
+
+void Lowering::emitMoves(IRBlock * from, IRBlock * to){
+	size_t index = to->predIndex(from);
+	std::vector<Move> moves;
+	std::vector<Move> loads;
+	for (size_t p = 0; p < to->firstNonPhi(); p++){
+		IRInstr * phi = to->instrs[p];
+		IRInstr * src = phi->args[index];
+		if (src->op == IR_CONST && !hasReg(src)){
+			loads.push_back(Move{ reg(phi), nullptr, src->value });
+		} else if (reg(src) != reg(phi)){
+			moves.push_back(Move{ reg(phi), src, 0 });
+		}
+	}
+	// The copies happen at once: write a register only after every read
+	// of it, breaking cycles through the scratch register
+	std::vector<int> srcRegs;
+	for (Move& move : moves){
+		srcRegs.push_back(reg(move.src));
+	}
+	while (!moves.empty()){
+		bool progress = false;
+		for (size_t k = 0; k < moves.size(); k++){
+			bool read = false;
+			for (size_t j = 0; j < moves.size(); j++){
+				read |= j != k && srcRegs[j] == moves[k].dst;
+			}
+			if (read){
+				continue;
+			}
+			myGen->emit(OP_MOV, moves[k].dst, srcRegs[k], 0);
+			moves.erase(moves.begin() + k);
+			srcRegs.erase(srcRegs.begin() + k);
+			progress = true;
+			break;
+		}
+		if (!progress){
+			int dst = moves[0].dst;
+			myGen->emit(OP_MOV, myScratch, dst, 0);
+			for (int& src : srcRegs){
+				if (src == dst){
+					src = myScratch;
+				}
+			}
+		}
+	}
+	for (Move& load : loads){
+		myGen->emit(OP_LOADK, load.dst, load.k, 0);
+	}
+}
+
+static bool hasPhis(IRBlock * block){
+	return block->firstNonPhi() > 0;
+}
+
+void Lowering::emitBranch(IRBlock * block, IRInstr * term, IRBlock * next){
+	const Condition& cond = myConds[term];
+	IRBlock * ifTrue = term->targets[0];
+	IRBlock * ifFalse = term->targets[1];
+	if (cond.value->op == IR_CONST && !cond.fused){
+		IRBlock * target = (cond.value->value != 0) != cond.negate ? ifTrue : ifFalse;
+		emitMoves(block, target);
+		if (target != next){
+			jumpTo(target);
+		}
+		return;
+	}
+	// Copies for one successor can go before the branch when the other
+	// successor never sees the phis' registers and the branch does not
+	// read them; otherwise they go in a stub on the edge
+	size_t stubTrue = SIZE_MAX;
+	size_t stubFalse = SIZE_MAX;
+	bool movesTrue = hasPhis(ifTrue);
+	bool movesFalse = hasPhis(ifFalse);
+	IRBlock * before = nullptr;
+	if (movesTrue != movesFalse){
+		IRBlock * target = movesTrue ? ifTrue : ifFalse;
+		IRBlock * other = movesTrue ? ifFalse : ifTrue;
+		bool safe = true;
+		for (size_t p = 0; p < target->firstNonPhi(); p++){
+			IRInstr * phi = target->instrs[p];
+			safe &= !myLiveIn[other->id].has(phi->id);
+			forEachUse(term, [&](IRInstr *, size_t, IRInstr * arg){
+				safe &= arg != phi;
+			});
+		}
+		if (safe){
+			before = target;
+		}
+	}
+	if (before != nullptr){
+		emitMoves(block, before);
+	} else {
+		if (movesTrue){
+			stubTrue = myStubs.size();
+			myStubs.emplace_back(block, ifTrue);
+		}
+		if (movesFalse){
+			stubFalse = myStubs.size();
+			myStubs.emplace_back(block, ifFalse);
+		}
+	}
+	if (ifTrue == next && stubTrue == SIZE_MAX){
+		emitCondJump(cond, false, ifFalse, stubFalse);
+		return;
+	}
+	emitCondJump(cond, true, ifTrue, stubTrue);
+	if (stubFalse != SIZE_MAX){
+		myStubJumps.emplace_back(myGen->emit(OP_JMP, 0, 0, -1), stubFalse);
+	} else if (ifFalse != next){
+		jumpTo(ifFalse);
+	}
+}
+
+void Lowering::emitCondJump(const Condition& cond, bool ifTrue,
+	IRBlock * target, size_t stub){
+	bool when = ifTrue != cond.negate;
+	size_t jump;
+	if (!cond.fused){
+		jump = myGen->emit(when ? OP_JT : OP_JF, reg(cond.value), 0, -1);
+	} else {
+		IRInstr * left = cond.value->args[0];
+		IRInstr * right = cond.value->args[1];
+		int cmp = cond.value->op - IR_EQ;
+		if (!when){
+			cmp = NEGATED[cmp];
+		}
+		if (right->op == IR_CONST){
+			jump = myGen->emit(Opcode(OP_JEQI + cmp), reg(left), right->value, -1);
+		} else if (left->op == IR_CONST){
+			jump = myGen->emit(Opcode(OP_JEQI + SWAPPED[cmp]), reg(right),
+				left->value, -1);
+		} else {
+			jump = myGen->emit(Opcode(OP_JEQ + cmp), reg(left), reg(right), -1);
+		}
+	}
+	if (stub != SIZE_MAX){
+		myStubJumps.emplace_back(jump, stub);
+	} else {
+		myBlockJumps.emplace_back(jump, target);
+	}
+}
+
+} // end anonymous namespace
+
+void IRFunction::toBytecode(BytecodeGen * gen){
+	Lowering lowering(this, gen);
+	lowering.run();
+}
+
+} //End namespace LIL' C
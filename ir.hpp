@@ -0,0 +1,277 @@
+#ifndef LILC_IR_HPP
+#define LILC_IR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace LILC{
+
+class FnDeclNode;
+class ProgramNode;
+class SemSymbol;
+class ExpNode;
+class BytecodeGen;
+
+// SSA intermediate representation: each function is a control-flow graph
+// of basic blocks whose instructions are SSA values (ir.cpp holds the data
+// structures, the textual dump and the lowering to bytecode; ir_gen.cpp
+// builds it from the AST; ir_opt.cpp optimizes it).
+//
+// Locals, formals and each int or bool leaf of a struct local are SSA
+// variables: they live in values, never in memory, and are renamed during
+// construction. Globals stay in memory behind loadg/storeg. Every variable
+// starts out zero, so a read that reaches the entry block without a
+// definition is the constant 0. Constants are created once per function,
+// at the top of the entry block. A phi has one operand per predecessor of
+// its block, in the order of IRBlock::preds.
+
+#define LILC_IR_OPS(X) \
+	X(CONST,  "const",  IR_PURE) \
+	X(PARAM,  "param",  IR_PURE) \
+	X(PHI,    "phi",    IR_PURE) \
+	X(ADD,    "add",    IR_PURE | IR_COMMUTATIVE) \
+	X(SUB,    "sub",    IR_PURE) \
+	X(MUL,    "mul",    IR_PURE | IR_COMMUTATIVE) \
+	X(DIV,    "div",    IR_PURE | IR_TRAPS) \
+	X(NEG,    "neg",    IR_PURE) \
+	X(NOT,    "not",    IR_PURE) \
+	X(EQ,     "eq",     IR_PURE | IR_COMMUTATIVE) \
+	X(NE,     "ne",     IR_PURE | IR_COMMUTATIVE) \
+	X(LT,     "lt",     IR_PURE) \
+	X(GT,     "gt",     IR_PURE) \
+	X(LE,     "le",     IR_PURE) \
+	X(GE,     "ge",     IR_PURE) \
+	X(LOADG,  "loadg",  IR_READS_MEMORY) \
+	X(STOREG, "storeg", IR_EFFECT | IR_VOID) \
+	X(CALL,   "call",   IR_EFFECT) \
+	X(READ,   "read",   IR_EFFECT) \
+	X(READB,  "readb",  IR_EFFECT) \
+	X(WRITE,  "write",  IR_EFFECT | IR_VOID) \
+	X(WRITES, "writes", IR_EFFECT | IR_VOID) \
+	X(JUMP,   "jump",   IR_TERMINATOR | IR_VOID) \
+	X(BRANCH, "branch", IR_TERMINATOR | IR_VOID) \
+	X(RET,    "ret",    IR_TERMINATOR | IR_VOID)
+
+enum IROpFlags {
+	// No side effects: can be removed if unused, shared and moved
+	IR_PURE = 1,
+	IR_COMMUTATIVE = 2,
+	// Pure except that it can stop the program (division by zero)
+	IR_TRAPS = 4,
+	IR_READS_MEMORY = 8,
+	IR_EFFECT = 16,
+	IR_TERMINATOR = 32,
+	// Has no result
+	IR_VOID = 64
+};
+
+enum IROp : uint8_t {
+#define LILC_IR_ENUM(name, text, flags) IR_##name,
+	LILC_IR_OPS(LILC_IR_ENUM)
+#undef LILC_IR_ENUM
+	NUM_IR_OPS
+};
+
+const char * irOpName(IROp op);
+int irOpFlags(IROp op);
+
+struct IRBlock;
+
+struct IRInstr {
+	IROp op;
+	int id;
+	IRBlock * block = nullptr;
+	std::vector<IRInstr *> args;
+	// CONST value or PARAM index
+	int32_t value = 0;
+	// LOADG and STOREG: the global and the byte offset of the leaf
+	SemSymbol * global = nullptr;
+	int offset = 0;
+	FnDeclNode * callee = nullptr;
+	// WRITES: the literal as written
+	std::string text;
+	// JUMP: targets[0]; BRANCH: taken if args[0] is true, else false
+	IRBlock * targets[2] = { nullptr, nullptr };
+	// Where runtime errors are reported
+	ExpNode * at = nullptr;
+	// The value this one was replaced by, if any
+	IRInstr * forward = nullptr;
+
+	bool is(int flags) const { return (irOpFlags(op) & flags) != 0; }
+	// Whether it can be deleted when nothing uses its value
+	bool removable() const;
+};
+
+struct IRBlock {
+	int id;
+	// Phis first, the terminator last
+	std::vector<IRInstr *> instrs;
+	std::vector<IRBlock *> preds;
+	bool removed = false;
+
+	IRInstr * terminator(){
+		return instrs.empty() || !instrs.back()->is(IR_TERMINATOR)
+			? nullptr : instrs.back();
+	}
+	std::vector<IRBlock *> succs();
+	size_t firstNonPhi();
+	// Index of pred in preds, which is also its phi operand
+	size_t predIndex(IRBlock * pred);
+	// Drops pred and its phi operands
+	void removePred(IRBlock * pred);
+};
+
+class IRFunction{
+public:
+	IRFunction(FnDeclNode * decl, const std::string& name);
+
+	FnDeclNode * getDecl(){ return myDecl; }
+	const std::string& getName(){ return myName; }
+	IRBlock * entry(){ return myBlocks.front().get(); }
+	// Blocks in creation order, including removed ones
+	const std::vector<std::unique_ptr<IRBlock>>& blocks(){ return myBlocks; }
+
+	IRBlock * newBlock();
+	// A new instruction appended to block (or not placed if null)
+	IRInstr * newInstr(IROp op, IRBlock * block);
+	IRInstr * constant(int32_t value);
+	IRInstr * param(int index);
+	// Every instruction id is below this
+	int idLimit(){ return myNextId; }
+
+	// The value v stands for now, following replacements
+	static IRInstr * resolve(IRInstr * v);
+	// Rewrites every operand to its resolved value and drops replaced
+	// instructions from their blocks
+	void resolveAll();
+	// Blocks reachable from the entry, in reverse postorder
+	std::vector<IRBlock *> reversePostorder();
+	// Marks blocks the entry cannot reach as removed and detaches them
+	size_t removeUnreachable();
+	// Immediate dominator of each block in rpo; the entry maps to itself
+	std::unordered_map<IRBlock *, IRBlock *> dominators(const std::vector<IRBlock *>& rpo);
+	size_t instructionCount();
+
+	void dump(std::ostream& out);
+	// Emits the function as bytecode. Phis become copies: each
+	// predecessor writes the incoming value to a register of its own and
+	// the phi's block copies it into place.
+	void toBytecode(BytecodeGen * gen);
+private:
+	FnDeclNode * myDecl;
+	std::string myName;
+	std::vector<std::unique_ptr<IRBlock>> myBlocks;
+	std::vector<std::unique_ptr<IRInstr>> myInstrs;
+	std::unordered_map<int32_t, IRInstr *> myConstants;
+	std::vector<IRInstr *> myParams;
+	int myNextId = 0;
+};
+
+class IRProgram{
+public:
+	IRFunction * add(FnDeclNode * decl, const std::string& name);
+	IRFunction * find(FnDeclNode * decl);
+	const std::vector<std::unique_ptr<IRFunction>>& functions(){ return myFunctions; }
+	size_t instructionCount();
+	void dump(std::ostream& out);
+	// Whether some function could not be lowered
+	bool failed(){ return myFailed; }
+	void setFailed(){ myFailed = true; }
+private:
+	std::vector<std::unique_ptr<IRFunction>> myFunctions;
+	std::unordered_map<FnDeclNode *, IRFunction *> myByDecl;
+	bool myFailed = false;
+};
+
+// Builds SSA form while lowering one function body (ir_gen.cpp), with the
+// on-the-fly algorithm of Braun et al.: a read looks for the innermost
+// definition through the predecessors, placing phis where paths meet, and
+// a block is sealed once all its predecessors are known so that loop
+// headers can get their phis completed late. Phis that turn out to merge
+// a single value are replaced right away.
+class IRBuilder{
+public:
+	IRBuilder(IRFunction * fn);
+
+	IRFunction * function(){ return myFn; }
+	IRBlock * current(){ return myCurrent; }
+	// Continues in block (after the previous one was terminated)
+	void setCurrent(IRBlock * block){ myCurrent = block; }
+	IRInstr * emit(IROp op, std::initializer_list<IRInstr *> args,
+		ExpNode * at = nullptr);
+	void jump(IRBlock * target);
+	void branch(IRInstr * cond, IRBlock * ifTrue, IRBlock * ifFalse);
+	// Ends the current block with ret and continues in an unreachable one
+	void ret(IRInstr * value);
+
+	// A variable: a local or formal, or one leaf of a struct local
+	typedef std::pair<SemSymbol *, int> Var;
+	// A variable of the compiler's own, e.g. the value of a && b
+	Var fresh(){ return Var(nullptr, myFresh++); }
+	void write(Var var, IRInstr * value){ write(var, myCurrent, value); }
+	IRInstr * read(Var var){ return read(var, myCurrent); }
+	void seal(IRBlock * block);
+	// Reports what cannot be lowered; lowering goes on to find more
+	void error(ExpNode * at, const char * msg);
+	bool failed(){ return myFailed; }
+private:
+	struct VarHash {
+		size_t operator()(const Var& var) const {
+			return std::hash<SemSymbol *>()(var.first) * 31 + var.second;
+		}
+	};
+	struct BlockState {
+		std::unordered_map<Var, IRInstr *, VarHash> defs;
+		std::vector<std::pair<Var, IRInstr *>> incomplete;
+		bool sealed = false;
+	};
+
+	void write(Var var, IRBlock * block, IRInstr * value);
+	IRInstr * read(Var var, IRBlock * block);
+	IRInstr * addPhiOperands(Var var, IRInstr * phi);
+	IRInstr * removeTrivialPhi(IRInstr * phi);
+	void link(IRBlock * from, IRBlock * to);
+
+	IRFunction * myFn;
+	IRBlock * myCurrent;
+	std::unordered_map<IRBlock *, BlockState> myStates;
+	int myFresh = 0;
+	bool myFailed = false;
+};
+
+// The optimization pipeline (ir_opt.cpp): copy propagation, sparse
+// conditional constant propagation, global value numbering, loop-invariant
+// code motion and dead-code elimination, with CFG cleanup in between.
+// Instructions with side effects keep their order and are never removed;
+// division is only shared or moved when it cannot trap.
+class IROptimizer{
+public:
+	void run(IRFunction * fn);
+
+	// Number of changes each pass made, for --stats
+	size_t copies = 0;
+	size_t constants = 0;
+	size_t branches = 0;
+	size_t numbered = 0;
+	size_t hoisted = 0;
+	size_t dead = 0;
+	size_t blocks = 0;
+private:
+	size_t propagateCopies(IRFunction * fn);
+	void propagateConstants(IRFunction * fn);
+	size_t numberValues(IRFunction * fn);
+	size_t hoistInvariants(IRFunction * fn);
+	size_t eliminateDeadCode(IRFunction * fn);
+	size_t simplifyCFG(IRFunction * fn);
+};
+
+} //End namespace LIL' C
+
+#endif
@@ -0,0 +1,477 @@
+#include <iostream>
+
+#include "ast.hpp"
+#include "ir.hpp"
+#include "symbol_table.hpp"
+
+// Lowering a type-checked AST to SSA form (see ir.hpp).
+
+namespace LILC{
+
+// IRBuilder
+
+IRBuilder::IRBuilder(IRFunction * fn){
+	myFn = fn;
+	myCurrent = fn->entry();
+	seal(myCurrent);
+}
+
+IRInstr * IRBuilder::emit(IROp op, std::initializer_list<IRInstr *> args,
+	ExpNode * at){
+	IRInstr * instr = myFn->newInstr(op, myCurrent);
+	instr->args = args;
+	instr->at = at;
+	return instr;
+}
+
+void IRBuilder::error(ExpNode * at, const char * msg){
+	std::cerr << at->getLine() << ":" << at->getCol()
+		<< " ***ERROR*** " << msg << "\n";
+	myFailed = true;
+}
+
+void IRBuilder::link(IRBlock * from, IRBlock * to){
+	to->preds.push_back(from);
+}
+
+void IRBuilder::jump(IRBlock * target){
+	IRInstr * instr = emit(IR_JUMP, {});
+	instr->targets[0] = target;
+	link(myCurrent, target);
+}
+
+void IRBuilder::branch(IRInstr * cond, IRBlock * ifTrue, IRBlock * ifFalse){
+	IRInstr * instr = emit(IR_BRANCH, { cond });
+	instr->targets[0] = ifTrue;
+	instr->targets[1] = ifFalse;
+	link(myCurrent, ifTrue);
+	link(myCurrent, ifFalse);
+}
+
+void IRBuilder::ret(IRInstr * value){
+	IRInstr * instr = emit(IR_RET, {});
+	if (value != nullptr){
+		instr->args.push_back(value);
+	}
+	// Whatever follows is unreachable until a label joins it back in
+	myCurrent = myFn->newBlock();
+	seal(myCurrent);
+}
+
+void IRBuilder::write(Var var, IRBlock * block, IRInstr * value){
+	myStates[block].defs[var] = value;
+}
+
+IRInstr * IRBuilder::read(Var var, IRBlock * block){
+	BlockState& state = myStates[block];
+	auto found = state.defs.find(var);
+	if (found != state.defs.end()){
+		return IRFunction::resolve(found->second);
+	}
+	IRInstr * value;
+	if (!state.sealed){
+		// More predecessors are coming: finish the phi when they are known
+		value = myFn->newInstr(IR_PHI, nullptr);
+		value->block = block;
+		block->instrs.insert(block->instrs.begin() + block->firstNonPhi(), value);
+		state.incomplete.emplace_back(var, value);
+	} else if (block->preds.empty()){
+		// Never written: variables start out zero
+		value = myFn->constant(0);
+	} else if (block->preds.size() == 1){
+		value = read(var, block->preds[0]);
+	} else {
+		value = myFn->newInstr(IR_PHI, nullptr);
+		value->block = block;
+		block->instrs.insert(block->instrs.begin() + block->firstNonPhi(), value);
+		// Breaks cycles through loops before looking at the predecessors
+		write(var, block, value);
+		value = addPhiOperands(var, value);
+	}
+	write(var, block, value);
+	return value;
+}
+
+IRInstr * IRBuilder::addPhiOperands(Var var, IRInstr * phi){
+	for (IRBlock * pred : phi->block->preds){
+		phi->args.push_back(read(var, pred));
+	}
+	return removeTrivialPhi(phi);
+}
+
+IRInstr * IRBuilder::removeTrivialPhi(IRInstr * phi){
+	IRInstr * same = nullptr;
+	for (IRInstr * arg : phi->args){
+		arg = IRFunction::resolve(arg);
+		if (arg == same || arg == phi){
+			continue;
+		}
+		if (same != nullptr){
+			return phi;
+		}
+		same = arg;
+	}
+	if (same == nullptr){
+		same = myFn->constant(0);
+	}
+	// Dropped from its block by IRFunction::resolveAll. Phis that used
+	// this one may have become trivial too; copy propagation finds them.
+	phi->forward = same;
+	return same;
+}
+
+void IRBuilder::seal(IRBlock * block){
+	BlockState& state = myStates[block];
+	std::vector<std::pair<Var, IRInstr *>> incomplete;
+	incomplete.swap(state.incomplete);
+	for (auto& entry : incomplete){
+		addPhiOperands(entry.first, entry.second);
+	}
+	myStates[block].sealed = true;
+}
+
+// Declarations
+
+void ProgramNode::lowerIR(IRProgram * program){
+	myDeclList->lowerIR(program);
+}
+
+void DeclListNode::lowerIR(IRProgram * program){
+	for (DeclNode * decl : myDecls){
+		decl->lowerIR(program);
+	}
+}
+
+void FnDeclNode::lowerIR(IRProgram * program){
+	IRFunction * fn = program->add(this, myId->getName());
+	IRBuilder ir(fn);
+	if (myFormals != nullptr){
+		int index = 0;
+		for (FormalDeclNode * formal : myFormals->getFormals()){
+			IRBuilder::Var var(formal->getId()->getSymbol(), 0);
+			ir.write(var, fn->param(index++));
+		}
+	}
+	myBody->lowerIR(&ir);
+	if (ir.current()->terminator() == nullptr){
+		ir.ret(nullptr);
+	}
+	fn->resolveAll();
+	fn->removeUnreachable();
+	if (ir.failed()){
+		program->setFailed();
+	}
+}
+
+void FnBodyNode::lowerIR(IRBuilder * ir){
+	// Locals need no code: a variable read before any write is zero
+	getStmts()->lowerIR(ir);
+}
+
+// Statements
+
+void StmtListNode::lowerIR(IRBuilder * ir){
+	for (StmtNode * stmt : myList){
+		stmt->lowerIR(ir);
+	}
+}
+
+static IRInstr * load(IRBuilder * ir, ExpNode * loc){
+	SemSymbol * sym = loc->locId()->getSymbol();
+	int offset = 0;
+	DotAccessNode * dot = dynamic_cast<DotAccessNode *>(loc);
+	if (dot != nullptr){
+		sym = dot->getBase()->getSymbol();
+		offset = dot->getOffset();
+	}
+	if (!sym->isGlobal()){
+		return ir->read(IRBuilder::Var(sym, offset));
+	}
+	IRInstr * instr = ir->emit(IR_LOADG, {});
+	instr->global = sym;
+	instr->offset = offset;
+	return instr;
+}
+
+static void store(IRBuilder * ir, ExpNode * loc, IRInstr * value){
+	SemSymbol * sym = loc->locId()->getSymbol();
+	int offset = 0;
+	DotAccessNode * dot = dynamic_cast<DotAccessNode *>(loc);
+	if (dot != nullptr){
+		sym = dot->getBase()->getSymbol();
+		offset = dot->getOffset();
+	}
+	if (!sym->isGlobal()){
+		ir->write(IRBuilder::Var(sym, offset), value);
+		return;
+	}
+	IRInstr * instr = ir->emit(IR_STOREG, { value });
+	instr->global = sym;
+	instr->offset = offset;
+}
+
+void AssignStmtNode::lowerIR(IRBuilder * ir){
+	myAssign->lowerIR(ir);
+}
+
+void PostIncStmtNode::lowerIR(IRBuilder * ir){
+	IRInstr * one = ir->function()->constant(1);
+	store(ir, myLoc, ir->emit(IR_ADD, { load(ir, myLoc), one }));
+}
+
+void PostDecStmtNode::lowerIR(IRBuilder * ir){
+	IRInstr * one = ir->function()->constant(1);
+	store(ir, myLoc, ir->emit(IR_SUB, { load(ir, myLoc), one }));
+}
+
+void ReadStmtNode::lowerIR(IRBuilder * ir){
+	bool isBool = myLoc->locId()->getSymbol()->getType()->getSize() == 1;
+	store(ir, myLoc, ir->emit(isBool ? IR_READB : IR_READ, {}));
+}
+
+void WriteStmtNode::lowerIR(IRBuilder * ir){
+	StringLitNode * str = dynamic_cast<StringLitNode *>(myLoc);
+	if (str != nullptr){
+		ir->emit(IR_WRITES, {})->text = str->getLexeme();
+		return;
+	}
+	ir->emit(IR_WRITE, { myLoc->lowerIR(ir) });
+}
+
+void ReturnStmtNode::lowerIR(IRBuilder * ir){
+	ir->ret(myLoc == nullptr ? nullptr : myLoc->lowerIR(ir));
+}
+
+void CallStmtNode::lowerIR(IRBuilder * ir){
+	myCall->lowerIR(ir);
+}
+
+void IfStmtNode::lowerIR(IRBuilder * ir){
+	IRFunction * fn = ir->function();
+	IRBlock * then = fn->newBlock();
+	IRBlock * join = fn->newBlock();
+	myExp->lowerIRBranch(ir, then, join);
+	ir->seal(then);
+	ir->setCurrent(then);
+	myStmtList->lowerIR(ir);
+	ir->jump(join);
+	ir->seal(join);
+	ir->setCurrent(join);
+}
+
+void IfElseStmtNode::lowerIR(IRBuilder * ir){
+	IRFunction * fn = ir->function();
+	IRBlock * then = fn->newBlock();
+	IRBlock * otherwise = fn->newBlock();
+	IRBlock * join = fn->newBlock();
+	myExp->lowerIRBranch(ir, then, otherwise);
+	ir->seal(then);
+	ir->seal(otherwise);
+	ir->setCurrent(then);
+	myStmtList->lowerIR(ir);
+	ir->jump(join);
+	ir->setCurrent(otherwise);
+	myElseStmtList->lowerIR(ir);
+	ir->jump(join);
+	ir->seal(join);
+	ir->setCurrent(join);
+}
+
+void WhileStmtNode::lowerIR(IRBuilder * ir){
+	// Tested once on the way in and then at the bottom, so an iteration
+	// costs one branch. The preheader is where invariants are hoisted to.
+	IRFunction * fn = ir->function();
+	IRBlock * preheader = fn->newBlock();
+	IRBlock * body = fn->newBlock();
+	IRBlock * exit = fn->newBlock();
+	myExp->lowerIRBranch(ir, preheader, exit);
+	ir->seal(preheader);
+	ir->setCurrent(preheader);
+	ir->jump(body);
+	ir->setCurrent(body);
+	myStmtList->lowerIR(ir);
+	myExp->lowerIRBranch(ir, body, exit);
+	ir->seal(body);
+	ir->seal(exit);
+	ir->setCurrent(exit);
+}
+
+// Locations and assignment
+
+IRInstr * IdNode::lowerIR(IRBuilder * ir){
+	return load(ir, this);
+}
+
+IRInstr * DotAccessNode::lowerIR(IRBuilder * ir){
+	return load(ir, this);
+}
+
+IRInstr * AssignNode::lowerIR(IRBuilder * ir){
+	IRInstr * value = myRight->lowerIR(ir);
+	store(ir, myLeft, value);
+	return value;
+}
+
+// Values
+
+IRInstr * IntLitNode::lowerIR(IRBuilder * ir){
+	return ir->function()->constant(myVal);
+}
+
+IRInstr * TrueNode::lowerIR(IRBuilder * ir){
+	return ir->function()->constant(1);
+}
+
+IRInstr * FalseNode::lowerIR(IRBuilder * ir){
+	return ir->function()->constant(0);
+}
+
+IRInstr * StringLitNode::lowerIR(IRBuilder * ir){
+	// Writes lower the literal themselves; anything else, such as a
+	// comparison, has no value to give it
+	ir->error(this, "Strings can only be written");
+	return ir->function()->constant(0);
+}
+
+IRInstr * CallExpNode::lowerIR(IRBuilder * ir){
+	FnDeclNode * fn = static_cast<FnDeclNode *>(myLoc->getSymbol()->getDecl());
+	std::vector<IRInstr *> args;
+	if (myList != nullptr){
+		for (ExpNode * actual : myList->getExps()){
+			args.push_back(actual->lowerIR(ir));
+		}
+	}
+	IRInstr * instr = ir->emit(IR_CALL, {}, this);
+	instr->args = std::move(args);
+	instr->callee = fn;
+	return instr;
+}
+
+IRInstr * ExpListNode::lowerIR(IRBuilder * ir){
+	IRInstr * value = nullptr;
+	for (ExpNode * exp : myList){
+		value = exp->lowerIR(ir);
+	}
+	return value;
+}
+
+// Operators
+
+IRInstr * PlusNode::lowerIR(IRBuilder * ir){
+	IRInstr * left = myLeft->lowerIR(ir);
+	return ir->emit(IR_ADD, { left, myRight->lowerIR(ir) });
+}
+
+IRInstr * MinusNode::lowerIR(IRBuilder * ir){
+	IRInstr * left = myLeft->lowerIR(ir);
+	return ir->emit(IR_SUB, { left, myRight->lowerIR(ir) });
+}
+
+IRInstr * TimesNode::lowerIR(IRBuilder * ir){
+	IRInstr * left = myLeft->lowerIR(ir);
+	return ir->emit(IR_MUL, { left, myRight->lowerIR(ir) });
+}
+
+IRInstr * DivideNode::lowerIR(IRBuilder * ir){
+	IRInstr * left = myLeft->lowerIR(ir);
+	return ir->emit(IR_DIV, { left, myRight->lowerIR(ir) }, this);
+}
+
+IRInstr * UnaryMinusNode::lowerIR(IRBuilder * ir){
+	return ir->emit(IR_NEG, { myNode->lowerIR(ir) });
+}
+
+IRInstr * NotNode::lowerIR(IRBuilder * ir){
+	return ir->emit(IR_NOT, { myNode->lowerIR(ir) });
+}
+
+// Conditions
+
+void ExpNode::lowerIRBranch(IRBuilder * ir, IRBlock * ifTrue,
+	IRBlock * ifFalse){
+	ir->branch(lowerIR(ir), ifTrue, ifFalse);
+}
+
+void NotNode::lowerIRBranch(IRBuilder * ir, IRBlock * ifTrue,
+	IRBlock * ifFalse){
+	myNode->lowerIRBranch(ir, ifFalse, ifTrue);
+}
+
+void AndNode::lowerIRBranch(IRBuilder * ir, IRBlock * ifTrue,
+	IRBlock * ifFalse){
+	IRBlock * right = ir->function()->newBlock();
+	myLeft->lowerIRBranch(ir, right, ifFalse);
+	ir->seal(right);
+	ir->setCurrent(right);
+	myRight->lowerIRBranch(ir, ifTrue, ifFalse);
+}
+
+void OrNode::lowerIRBranch(IRBuilder * ir, IRBlock * ifTrue,
+	IRBlock * ifFalse){
+	IRBlock * right = ir->function()->newBlock();
+	myLeft->lowerIRBranch(ir, ifTrue, right);
+	ir->seal(right);
+	ir->setCurrent(right);
+	myRight->lowerIRBranch(ir, ifTrue, ifFalse);
+}
+
+// The value of a condition: 1 or 0, merged by a phi
+static IRInstr * conditionValue(IRBuilder * ir, ExpNode * cond){
+	IRFunction * fn = ir->function();
+	IRBlock * isTrue = fn->newBlock();
+	IRBlock * isFalse = fn->newBlock();
+	IRBlock * join = fn->newBlock();
+	IRBuilder::Var var = ir->fresh();
+	cond->lowerIRBranch(ir, isTrue, isFalse);
+	ir->seal(isTrue);
+	ir->seal(isFalse);
+	ir->setCurrent(isTrue);
+	ir->write(var, fn->constant(1));
+	ir->jump(join);
+	ir->setCurrent(isFalse);
+	ir->write(var, fn->constant(0));
+	ir->jump(join);
+	ir->seal(join);
+	ir->setCurrent(join);
+	return ir->read(var);
+}
+
+IRInstr * AndNode::lowerIR(IRBuilder * ir){
+	return conditionValue(ir, this);
+}
+
+IRInstr * OrNode::lowerIR(IRBuilder * ir){
+	return conditionValue(ir, this);
+}
+
+IRInstr * EqualsNode::lowerIR(IRBuilder * ir){
+	IRInstr * left = myLeft->lowerIR(ir);
+	return ir->emit(IR_EQ, { left, myRight->lowerIR(ir) });
+}
+
+IRInstr * NotEqualsNode::lowerIR(IRBuilder * ir){
+	IRInstr * left = myLeft->lowerIR(ir);
+	return ir->emit(IR_NE, { left, myRight->lowerIR(ir) });
+}
+
+IRInstr * LessNode::lowerIR(IRBuilder * ir){
+	IRInstr * left = myLeft->lowerIR(ir);
+	return ir->emit(IR_LT, { left, myRight->lowerIR(ir) });
+}
+
+IRInstr * GreaterNode::lowerIR(IRBuilder * ir){
+	IRInstr * left = myLeft->lowerIR(ir);
+	return ir->emit(IR_GT, { left, myRight->lowerIR(ir) });
+}
+
+IRInstr * LessEqNode::lowerIR(IRBuilder * ir){
+	IRInstr * left = myLeft->lowerIR(ir);
+	return ir->emit(IR_LE, { left, myRight->lowerIR(ir) });
+}
+
+IRInstr * GreaterEqNode::lowerIR(IRBuilder * ir){
+	IRInstr * left = myLeft->lowerIR(ir);
+	return ir->emit(IR_GE, { left, myRight->lowerIR(ir) });
+}
+
+} //End namespace LIL' C
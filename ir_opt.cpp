@@ -0,0 +1,635 @@
+#include <algorithm>
+#include <unordered_set>
+
+#include "ir.hpp"
+#include "lilc_arith.hpp"
+
+// The SSA optimization pipeline (see ir.hpp).
+
+namespace LILC{
+
+void IROptimizer::run(IRFunction * fn){
+	blocks += fn->removeUnreachable();
+	copies += propagateCopies(fn);
+	propagateConstants(fn);
+	blocks += simplifyCFG(fn);
+	copies += propagateCopies(fn);
+	numbered += numberValues(fn);
+	// Numbering forwards stored values to loads, which can decide more
+	propagateConstants(fn);
+	blocks += simplifyCFG(fn);
+	hoisted += hoistInvariants(fn);
+	dead += eliminateDeadCode(fn);
+	blocks += simplifyCFG(fn);
+}
+
+// Copy propagation
+
+// What instr is a copy of, if anything: a phi merging one value, or an
+// identity like x + 0
+static IRInstr * copyOf(IRInstr * instr){
+	std::vector<IRInstr *>& args = instr->args;
+	auto isConst = [](IRInstr * v, int32_t k){
+		return v->op == IR_CONST && v->value == k;
+	};
+	switch (instr->op){
+	case IR_PHI: {
+		IRInstr * same = nullptr;
+		for (IRInstr * arg : args){
+			if (arg == same || arg == instr){
+				continue;
+			}
+			if (same != nullptr){
+				return nullptr;
+			}
+			same = arg;
+		}
+		return same;
+	}
+	case IR_ADD:
+		if (isConst(args[1], 0)){ return args[0]; }
+		if (isConst(args[0], 0)){ return args[1]; }
+		return nullptr;
+	case IR_SUB:
+		return isConst(args[1], 0) ? args[0] : nullptr;
+	case IR_MUL:
+		if (isConst(args[1], 1)){ return args[0]; }
+		if (isConst(args[0], 1)){ return args[1]; }
+		return nullptr;
+	case IR_DIV:
+		return isConst(args[1], 1) ? args[0] : nullptr;
+	case IR_NEG:
+	case IR_NOT:
+		// Both are their own inverse on ints and bools
+		return args[0]->op == instr->op ? args[0]->args[0] : nullptr;
+	default:
+		return nullptr;
+	}
+}
+
+size_t IROptimizer::propagateCopies(IRFunction * fn){
+	size_t count = 0;
+	bool changed = true;
+	while (changed){
+		changed = false;
+		for (IRBlock * block : fn->reversePostorder()){
+			for (IRInstr * instr : block->instrs){
+				if (instr->forward != nullptr){
+					continue;
+				}
+				for (IRInstr *& arg : instr->args){
+					arg = IRFunction::resolve(arg);
+				}
+				IRInstr * copy = copyOf(instr);
+				if (copy != nullptr){
+					instr->forward = copy;
+					count++;
+					changed = true;
+				}
+			}
+		}
+	}
+	fn->resolveAll();
+	return count;
+}
+
+// Sparse conditional constant propagation (Wegman and Zadeck): values
+// start out unknown and only ever move down to a constant and then to
+// varying, and only blocks some executable edge reaches are evaluated,
+// so constants flow around loops and through branches they decide.
+
+namespace {
+
+struct Lattice {
+	enum { UNKNOWN, CONSTANT, VARYING } state = UNKNOWN;
+	int32_t value = 0;
+
+	bool operator!=(const Lattice& other) const {
+		return state != other.state
+			|| (state == CONSTANT && value != other.value);
+	}
+};
+
+class ConstantPropagation{
+public:
+	ConstantPropagation(IRFunction * fn);
+	void run();
+	const Lattice& lattice(IRInstr * v){ return myValues[v->id]; }
+	bool executable(IRBlock * block){ return myBlocks[block->id]; }
+private:
+	Lattice evaluate(IRInstr * instr);
+	void visit(IRInstr * instr);
+	void markEdge(IRBlock * from, IRBlock * to);
+
+	IRFunction * myFn;
+	std::vector<Lattice> myValues;
+	std::vector<std::vector<IRInstr *>> myUsers;
+	std::vector<bool> myBlocks;
+	std::unordered_set<uint64_t> myEdges;
+	std::vector<std::pair<IRBlock *, IRBlock *>> myFlowWork;
+	std::vector<IRInstr *> mySSAWork;
+};
+
+ConstantPropagation::ConstantPropagation(IRFunction * fn){
+	myFn = fn;
+	myValues.resize(fn->idLimit());
+	myUsers.resize(fn->idLimit());
+	myBlocks.assign(fn->blocks().size(), false);
+	for (IRBlock * block : fn->reversePostorder()){
+		for (IRInstr * instr : block->instrs){
+			for (IRInstr * arg : instr->args){
+				myUsers[arg->id].push_back(instr);
+			}
+		}
+	}
+}
+
+void ConstantPropagation::markEdge(IRBlock * from, IRBlock * to){
+	uint64_t key = (uint64_t)(from == nullptr ? 0 : from->id + 1) << 32 | to->id;
+	if (myEdges.insert(key).second){
+		myFlowWork.emplace_back(from, to);
+	}
+}
+
+void ConstantPropagation::run(){
+	markEdge(nullptr, myFn->entry());
+	while (!myFlowWork.empty() || !mySSAWork.empty()){
+		while (!myFlowWork.empty()){
+			IRBlock * block = myFlowWork.back().second;
+			myFlowWork.pop_back();
+			bool first = !myBlocks[block->id];
+			myBlocks[block->id] = true;
+			// A new edge into a block already evaluated only changes its phis
+			for (IRInstr * instr : block->instrs){
+				if (first || instr->op == IR_PHI){
+					visit(instr);
+				}
+			}
+		}
+		while (!mySSAWork.empty()){
+			IRInstr * instr = mySSAWork.back();
+			mySSAWork.pop_back();
+			if (myBlocks[instr->block->id]){
+				visit(instr);
+			}
+		}
+	}
+}
+
+void ConstantPropagation::visit(IRInstr * instr){
+	if (instr->op == IR_JUMP){
+		markEdge(instr->block, instr->targets[0]);
+		return;
+	}
+	if (instr->op == IR_BRANCH){
+		const Lattice& cond = myValues[instr->args[0]->id];
+		if (cond.state == Lattice::CONSTANT){
+			markEdge(instr->block, instr->targets[cond.value != 0 ? 0 : 1]);
+		} else if (cond.state == Lattice::VARYING){
+			markEdge(instr->block, instr->targets[0]);
+			markEdge(instr->block, instr->targets[1]);
+		}
+		return;
+	}
+	if (instr->is(IR_VOID)){
+		return;
+	}
+	Lattice value = evaluate(instr);
+	if (value != myValues[instr->id]){
+		myValues[instr->id] = value;
+		for (IRInstr * user : myUsers[instr->id]){
+			mySSAWork.push_back(user);
+		}
+	}
+}
+
+static bool fold(IROp op, int32_t a, int32_t b, int32_t& result){
+	switch (op){
+	case IR_ADD: result = lilcAdd(a, b); return true;
+	case IR_SUB: result = lilcSub(a, b); return true;
+	case IR_MUL: result = lilcMul(a, b); return true;
+	case IR_DIV:
+		// Left for the program to report
+		if (b == 0){ return false; }
+		result = lilcDiv(a, b);
+		return true;
+	case IR_NEG: result = lilcNeg(a); return true;
+	case IR_NOT: result = !a; return true;
+	case IR_EQ: result = a == b; return true;
+	case IR_NE: result = a != b; return true;
+	case IR_LT: result = a < b; return true;
+	case IR_GT: result = a > b; return true;
+	case IR_LE: result = a <= b; return true;
+	case IR_GE: result = a >= b; return true;
+	default: return false;
+	}
+}
+
+Lattice ConstantPropagation::evaluate(IRInstr * instr){
+	Lattice result;
+	switch (instr->op){
+	case IR_CONST:
+		result.state = Lattice::CONSTANT;
+		result.value = instr->value;
+		return result;
+	case IR_PHI:
+		for (size_t k = 0; k < instr->args.size(); k++){
+			IRBlock * pred = instr->block->preds[k];
+			uint64_t key = (uint64_t)(pred->id + 1) << 32 | instr->block->id;
+			if (myEdges.count(key) == 0){
+				continue;
+			}
+			const Lattice& arg = myValues[instr->args[k]->id];
+			if (arg.state == Lattice::UNKNOWN){
+				continue;
+			}
+			if (arg.state == Lattice::VARYING
+				|| (result.state == Lattice::CONSTANT && result.value != arg.value)){
+				result.state = Lattice::VARYING;
+				return result;
+			}
+			result = arg;
+		}
+		return result;
+	default:
+		break;
+	}
+	if (!instr->is(IR_PURE)){
+		result.state = Lattice::VARYING;
+		return result;
+	}
+	int32_t operands[2] = { 0, 0 };
+	for (size_t k = 0; k < instr->args.size(); k++){
+		const Lattice& arg = myValues[instr->args[k]->id];
+		if (arg.state == Lattice::VARYING){
+			result.state = Lattice::VARYING;
+			return result;
+		}
+		if (arg.state == Lattice::UNKNOWN){
+			return result;
+		}
+		operands[k] = arg.value;
+	}
+	if (fold(instr->op, operands[0], operands[1], result.value)){
+		result.state = Lattice::CONSTANT;
+	} else {
+		result.state = Lattice::VARYING;
+	}
+	return result;
+}
+
+} // end anonymous namespace
+
+void IROptimizer::propagateConstants(IRFunction * fn){
+	ConstantPropagation sccp(fn);
+	sccp.run();
+	std::vector<std::pair<IRInstr *, int32_t>> found;
+	std::vector<IRInstr *> decided;
+	for (IRBlock * block : fn->reversePostorder()){
+		if (!sccp.executable(block)){
+			continue;
+		}
+		for (IRInstr * instr : block->instrs){
+			if (instr->op == IR_BRANCH
+				&& sccp.lattice(instr->args[0]).state == Lattice::CONSTANT){
+				decided.push_back(instr);
+			} else if (instr->op != IR_CONST && !instr->is(IR_VOID)
+				&& sccp.lattice(instr).state == Lattice::CONSTANT){
+				found.emplace_back(instr, sccp.lattice(instr).value);
+			}
+		}
+	}
+	for (auto& entry : found){
+		entry.first->forward = fn->constant(entry.second);
+	}
+	constants += found.size();
+	for (IRInstr * branch : decided){
+		bool taken = sccp.lattice(branch->args[0]).value != 0;
+		IRBlock * target = branch->targets[taken ? 0 : 1];
+		// Drops one of two edges if both targets are the same
+		branch->targets[taken ? 1 : 0]->removePred(branch->block);
+		branch->op = IR_JUMP;
+		branch->args.clear();
+		branch->targets[0] = target;
+		branch->targets[1] = nullptr;
+	}
+	branches += decided.size();
+	fn->resolveAll();
+	blocks += fn->removeUnreachable();
+}
+
+// Global value numbering: a pure instruction that computes what one in a
+// dominating block already computed is replaced by it. The dominator tree
+// is walked depth first with a scoped table, so only dominating
+// definitions are ever found. Within a block, a load of a global reuses
+// the last load or store of it unless a call came in between.
+
+namespace {
+
+struct ValueKey {
+	IROp op;
+	int32_t value;
+	int offset;
+	const void * extra;
+	std::vector<int> args;
+
+	bool operator==(const ValueKey& other) const {
+		return op == other.op && value == other.value && offset == other.offset
+			&& extra == other.extra && args == other.args;
+	}
+};
+
+struct ValueKeyHash {
+	size_t operator()(const ValueKey& key) const {
+		size_t hash = std::hash<const void *>()(key.extra) ^ (key.op * 0x9e3779b9u);
+		hash = hash * 31 + key.value;
+		hash = hash * 31 + key.offset;
+		for (int arg : key.args){
+			hash = hash * 31 + arg;
+		}
+		return hash;
+	}
+};
+
+} // end anonymous namespace
+
+size_t IROptimizer::numberValues(IRFunction * fn){
+	std::vector<IRBlock *> rpo = fn->reversePostorder();
+	std::unordered_map<IRBlock *, IRBlock *> idom = fn->dominators(rpo);
+	std::unordered_map<IRBlock *, std::vector<IRBlock *>> children;
+	for (size_t k = 1; k < rpo.size(); k++){
+		children[idom[rpo[k]]].push_back(rpo[k]);
+	}
+	std::unordered_map<ValueKey, IRInstr *, ValueKeyHash> table;
+	size_t count = 0;
+	// Blocks to enter, and the table entries each added to drop on leaving
+	struct Frame {
+		IRBlock * block;
+		std::vector<ValueKey> added;
+		size_t child = 0;
+	};
+	std::vector<Frame> stack;
+	stack.push_back(Frame{ rpo[0], {} });
+	bool entering = true;
+	while (!stack.empty()){
+		if (entering){
+			Frame& frame = stack.back();
+			std::unordered_map<uint64_t, IRInstr *> memory;
+			for (IRInstr * instr : frame.block->instrs){
+				for (IRInstr *& arg : instr->args){
+					arg = IRFunction::resolve(arg);
+				}
+				if (instr->op == IR_LOADG || instr->op == IR_STOREG){
+					uint64_t where = (uint64_t)(uintptr_t)instr->global * 64 + instr->offset;
+					auto known = memory.find(where);
+					if (instr->op == IR_STOREG){
+						memory[where] = instr->args[0];
+					} else if (known != memory.end()){
+						instr->forward = known->second;
+						count++;
+					} else {
+						memory[where] = instr;
+					}
+					continue;
+				}
+				if (instr->op == IR_CALL){
+					memory.clear();
+					continue;
+				}
+				if (!instr->is(IR_PURE) || instr->op == IR_CONST
+					|| instr->op == IR_PARAM){
+					continue;
+				}
+				ValueKey key{ instr->op, 0, 0, nullptr, {} };
+				for (IRInstr * arg : instr->args){
+					key.args.push_back(arg->id);
+				}
+				if (instr->op == IR_PHI){
+					// Only phis of the same block merge the same values
+					key.extra = instr->block;
+				} else if (instr->is(IR_COMMUTATIVE)){
+					std::sort(key.args.begin(), key.args.end());
+				}
+				auto known = table.find(key);
+				if (known != table.end()){
+					instr->forward = known->second;
+					count++;
+				} else {
+					table.emplace(key, instr);
+					frame.added.push_back(std::move(key));
+				}
+			}
+		}
+		Frame& frame = stack.back();
+		std::vector<IRBlock *>& kids = children[frame.block];
+		if (frame.child < kids.size()){
+			IRBlock * next = kids[frame.child++];
+			stack.push_back(Frame{ next, {} });
+			entering = true;
+			continue;
+		}
+		for (ValueKey& key : frame.added){
+			table.erase(key);
+		}
+		stack.pop_back();
+		entering = false;
+	}
+	fn->resolveAll();
+	return count;
+}
+
+// Loop-invariant code motion: pure instructions inside a loop whose
+// operands all come from outside it move to the loop's preheader, inner
+// loops first so invariants can move out several levels. Loads of
+// globals move too when the loop neither stores them nor calls anything.
+
+size_t IROptimizer::hoistInvariants(IRFunction * fn){
+	std::vector<IRBlock *> rpo = fn->reversePostorder();
+	std::unordered_map<IRBlock *, IRBlock *> idom = fn->dominators(rpo);
+	auto dominates = [&](IRBlock * a, IRBlock * b){
+		while (b != a && idom[b] != b){
+			b = idom[b];
+		}
+		return a == b;
+	};
+	// Loop headers, innermost (latest in reverse postorder) first
+	std::vector<IRBlock *> headers;
+	std::unordered_map<IRBlock *, std::vector<IRBlock *>> latches;
+	for (IRBlock * block : rpo){
+		for (IRBlock * succ : block->succs()){
+			if (dominates(succ, block)){
+				if (latches[succ].empty()){
+					headers.push_back(succ);
+				}
+				latches[succ].push_back(block);
+			}
+		}
+	}
+	std::unordered_map<IRBlock *, size_t> index;
+	for (size_t k = 0; k < rpo.size(); k++){
+		index[rpo[k]] = k;
+	}
+	std::sort(headers.begin(), headers.end(), [&](IRBlock * a, IRBlock * b){
+		return index[a] > index[b];
+	});
+
+	size_t count = 0;
+	for (IRBlock * header : headers){
+		std::unordered_set<IRBlock *> body{ header };
+		std::vector<IRBlock *> work = latches[header];
+		while (!work.empty()){
+			IRBlock * block = work.back();
+			work.pop_back();
+			if (body.insert(block).second){
+				work.insert(work.end(), block->preds.begin(), block->preds.end());
+			}
+		}
+		IRBlock * preheader = nullptr;
+		size_t outside = 0;
+		for (IRBlock * pred : header->preds){
+			if (body.count(pred) == 0){
+				preheader = pred;
+				outside++;
+			}
+		}
+		if (outside != 1){
+			continue;
+		}
+		std::unordered_set<uint64_t> stored;
+		bool calls = false;
+		for (IRBlock * block : body){
+			for (IRInstr * instr : block->instrs){
+				if (instr->op == IR_STOREG){
+					stored.insert((uint64_t)(uintptr_t)instr->global * 64 + instr->offset);
+				}
+				calls |= instr->op == IR_CALL;
+			}
+		}
+		std::vector<IRBlock *> ordered(body.begin(), body.end());
+		std::sort(ordered.begin(), ordered.end(), [&](IRBlock * a, IRBlock * b){
+			return index[a] < index[b];
+		});
+		for (IRBlock * block : ordered){
+			std::vector<IRInstr *> kept;
+			for (IRInstr * instr : block->instrs){
+				bool movable;
+				if (instr->op == IR_LOADG){
+					uint64_t where = (uint64_t)(uintptr_t)instr->global * 64 + instr->offset;
+					movable = !calls && stored.count(where) == 0;
+				} else {
+					movable = instr->removable() && instr->op != IR_PHI
+						&& instr->op != IR_CONST;
+				}
+				for (IRInstr * arg : instr->args){
+					movable &= body.count(arg->block) == 0;
+				}
+				if (!movable){
+					kept.push_back(instr);
+					continue;
+				}
+				std::vector<IRInstr *>& target = preheader->instrs;
+				target.insert(target.end() - 1, instr);
+				instr->block = preheader;
+				count++;
+			}
+			block->instrs = std::move(kept);
+		}
+	}
+	return count;
+}
+
+// Dead-code elimination: everything a terminator, an instruction with
+// side effects or a division that may trap depends on is kept, and the
+// rest is deleted.
+
+size_t IROptimizer::eliminateDeadCode(IRFunction * fn){
+	std::vector<bool> live(fn->idLimit(), false);
+	std::vector<IRInstr *> work;
+	std::vector<IRBlock *> rpo = fn->reversePostorder();
+	for (IRBlock * block : rpo){
+		for (IRInstr * instr : block->instrs){
+			if (!instr->removable()){
+				live[instr->id] = true;
+				work.push_back(instr);
+			}
+		}
+	}
+	while (!work.empty()){
+		IRInstr * instr = work.back();
+		work.pop_back();
+		for (IRInstr * arg : instr->args){
+			if (!live[arg->id]){
+				live[arg->id] = true;
+				work.push_back(arg);
+			}
+		}
+	}
+	size_t count = 0;
+	for (IRBlock * block : rpo){
+		std::vector<IRInstr *> kept;
+		for (IRInstr * instr : block->instrs){
+			if (live[instr->id]){
+				kept.push_back(instr);
+			} else {
+				instr->block = nullptr;
+				count++;
+			}
+		}
+		block->instrs = std::move(kept);
+	}
+	return count;
+}
+
+// CFG cleanup: branches with one target become jumps, unreachable blocks
+// go, and a block that is the only way into its successor absorbs it.
+
+size_t IROptimizer::simplifyCFG(IRFunction * fn){
+	size_t count = 0;
+	for (IRBlock * block : fn->reversePostorder()){
+		IRInstr * term = block->terminator();
+		if (term->op == IR_BRANCH && term->targets[0] == term->targets[1]){
+			term->targets[0]->removePred(block);
+			term->op = IR_JUMP;
+			term->args.clear();
+			term->targets[1] = nullptr;
+		}
+	}
+	count += fn->removeUnreachable();
+	for (IRBlock * block : fn->reversePostorder()){
+		if (block->removed){
+			continue;
+		}
+		while (true){
+			IRInstr * term = block->terminator();
+			if (term->op != IR_JUMP){
+				break;
+			}
+			IRBlock * succ = term->targets[0];
+			if (succ == block || succ->preds.size() != 1 || succ == fn->entry()){
+				break;
+			}
+			term->block = nullptr;
+			block->instrs.pop_back();
+			for (IRInstr * instr : succ->instrs){
+				if (instr->op == IR_PHI){
+					instr->forward = instr->args[0];
+					instr->block = nullptr;
+					continue;
+				}
+				instr->block = block;
+				block->instrs.push_back(instr);
+			}
+			for (IRBlock * next : succ->succs()){
+				std::replace(next->preds.begin(), next->preds.end(), succ, block);
+			}
+			succ->instrs.clear();
+			succ->preds.clear();
+			succ->removed = true;
+			count++;
+		}
+	}
+	fn->resolveAll();
+	return count;
+}
+
+} //End namespace LIL' C
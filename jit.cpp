@@ -0,0 +1,575 @@
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include "lilc_runtime.hpp"
+
+#if defined(__linux__) && defined(__x86_64__)
+#define LILC_JIT_X86_64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace LILC{
+
+JIT::JIT(RuntimeIO * io, size_t registers)
+: myRegs(new int32_t[registers]){
+	myIO = io;
+	myNumRegs = registers;
+}
+
+#ifndef LILC_JIT_X86_64
+
+bool JIT::supported(){
+	return false;
+}
+
+bool JIT::run(const BytecodeProgram& program, std::ostream& err){
+	err << "***ERROR*** The JIT needs Linux on x86-64\n";
+	return false;
+}
+
+#else
+
+bool JIT::supported(){
+	return true;
+}
+
+// Everything the generated code needs, reached through r14. The entry
+// stub loads the pinned registers from it and error exits write to it.
+struct JitContext {
+	void * savedRsp;
+	char * stackTop;
+	int32_t * regs;
+	int32_t * regsEnd;
+	int32_t * globals;
+	uint64_t depth;
+	uint64_t calls;
+	int32_t errorSite;
+	RuntimeIO * io;
+	const BytecodeProgram * program;
+};
+
+// Runtime helpers, called with the SysV ABI. They must not throw: there is
+// no unwind information for the generated frames.
+static int32_t jitRead(JitContext * ctx){
+	return ctx->io->readInt();
+}
+
+static int32_t jitReadBool(JitContext * ctx){
+	return ctx->io->readInt() != 0;
+}
+
+static void jitWrite(JitContext * ctx, int32_t value){
+	ctx->io->writeInt(value);
+}
+
+static void jitWriteString(JitContext * ctx, int32_t index){
+	ctx->io->writeString(ctx->program->strings[index]);
+}
+
+// x86-64 condition codes, as in jcc (0f 80+cc) and setcc (0f 90+cc)
+enum Cond : uint8_t { CC_E = 0x4, CC_NE = 0x5, CC_A = 0x7, CC_L = 0xc,
+	CC_GE = 0xd, CC_LE = 0xe, CC_G = 0xf };
+
+// 32-bit general registers by encoding
+enum Reg32 : uint8_t { EAX = 0, ECX = 1, EDX = 2, ESI = 6 };
+
+static Cond condOf(int op){
+	switch (op){
+	case OP_EQ: case OP_JEQ: case OP_JEQI: return CC_E;
+	case OP_NE: case OP_JNE: case OP_JNEI: return CC_NE;
+	case OP_LT: case OP_JLT: case OP_JLTI: return CC_L;
+	case OP_GT: case OP_JGT: case OP_JGTI: return CC_G;
+	case OP_LE: case OP_JLE: case OP_JLEI: return CC_LE;
+	default: return CC_GE;
+	}
+}
+
+// Machine code for a whole program. Register conventions, all callee-saved
+// so they survive the helpers: rbx the current frame, r12 the globals,
+// r13 the end of the register stack, r14 the JitContext and r15 the
+// number of calls that may still be made. eax, ecx, edx, esi, edi are
+// scratch and nothing lives in them between bytecode instructions.
+class Assembler{
+public:
+	Assembler(const BytecodeProgram& program) : myProgram(program){ }
+
+	void assemble();
+	const std::vector<uint8_t>& code(){ return myCode; }
+	// Where each error exit came from, indexed by JitContext::errorSite
+	struct Site {
+		int fn;
+		size_t pc;
+		const char * msg;
+	};
+	const std::vector<Site>& sites(){ return mySites; }
+private:
+	void byte(uint8_t b){ myCode.push_back(b); }
+	void bytes(std::initializer_list<uint8_t> bs){
+		myCode.insert(myCode.end(), bs);
+	}
+	void u32(uint32_t v){
+		for (int i = 0; i < 4; i++){
+			byte(v >> (8 * i));
+		}
+	}
+	void u64(uint64_t v){
+		u32((uint32_t)v);
+		u32((uint32_t)(v >> 32));
+	}
+	void patch32(size_t at, int32_t v){
+		memcpy(&myCode[at], &v, sizeof(v));
+	}
+	// rel32 from the end of the 4 bytes at `at` to target
+	void patchRel(size_t at, size_t target){
+		patch32(at, (int32_t)(target - (at + 4)));
+	}
+
+	// op reg, [rbx + 4 * r]: the register operand of a bytecode instruction
+	void frame(std::initializer_list<uint8_t> op, int reg, int r){
+		bytes(op);
+		byte(0x80 | (reg << 3) | 3);
+		u32(4 * r);
+	}
+	// op reg, [r12 + 4 * g]
+	void global(uint8_t op, int reg, int g){
+		bytes({0x41, op, (uint8_t)(0x84 | (reg << 3)), 0x24});
+		u32(4 * g);
+	}
+	void load(Reg32 reg, int r){ frame({0x8b}, reg, r); }
+	void store(Reg32 reg, int r){ frame({0x89}, reg, r); }
+	// dst = reg as 0 or 1 after cmp
+	void setcc(Cond cc, int dst){
+		bytes({0x0f, (uint8_t)(0x90 | cc), 0xc0}); // setcc al
+		bytes({0x0f, 0xb6, 0xc0});                 // movzx eax, al
+		store(EAX, dst);
+	}
+	// jcc rel32 to a bytecode pc, patched once every start is known
+	void jcc(Cond cc, int target){
+		bytes({0x0f, (uint8_t)(0x80 | cc)});
+		jumpTo(target);
+	}
+	void jumpTo(int target){
+		myJumps.push_back(std::make_pair(myCode.size(), (size_t)target));
+		u32(0);
+	}
+	// jcc rel32 to an error exit for the current instruction
+	void fail(Cond cc, const char * msg);
+	void callHelper(const void * fn){
+		bytes({0x48, 0xb8}); // mov rax, imm64
+		u64((uint64_t)fn);
+		bytes({0xff, 0xd0}); // call rax
+	}
+	void movRdiContext(){ bytes({0x4c, 0x89, 0xf7}); }
+
+	void entry();
+	void function(int index);
+	void insn(const Insn& in);
+	void call(const Insn& in);
+	void tailCall(const Insn& in);
+	void clear(int first, int count);
+	void divide(const Insn& in);
+
+	const BytecodeProgram& myProgram;
+	std::vector<uint8_t> myCode;
+	std::vector<size_t> myFunctions;
+	// Displacements to patch: (at, function index)
+	std::vector<std::pair<size_t, size_t>> myCalls;
+	// Within the current function: (at, bytecode pc) and (at, site)
+	std::vector<std::pair<size_t, size_t>> myJumps;
+	std::vector<std::pair<size_t, size_t>> myFails;
+	std::vector<Site> mySites;
+	size_t myErrorExit = 0;
+	int myFn = 0;
+	size_t myPc = 0;
+};
+
+void Assembler::assemble(){
+	entry();
+	myFunctions.resize(myProgram.functions.size());
+	for (size_t i = 0; i < myProgram.functions.size(); i++){
+		function(i);
+	}
+	for (auto& c : myCalls){
+		patchRel(c.first, myFunctions[c.second]);
+	}
+}
+
+// int entry(JitContext * ctx), at offset 0: saves the C++ side, switches
+// to the JIT's native stack and calls main. Returns 0, or 1 through the
+// error exit with ctx->errorSite set.
+void Assembler::entry(){
+	const int SAVED_RSP = offsetof(JitContext, savedRsp);
+	bytes({0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57});
+	bytes({0x49, 0x89, 0xfe});       // mov r14, rdi
+	bytes({0x49, 0x89, 0xa6});       // mov [r14 + savedRsp], rsp
+	u32(SAVED_RSP);
+	bytes({0x49, 0x8b, 0xa6});       // mov rsp, [r14 + stackTop]
+	u32(offsetof(JitContext, stackTop));
+	bytes({0x49, 0x8b, 0x9e});       // mov rbx, [r14 + regs]
+	u32(offsetof(JitContext, regs));
+	bytes({0x4d, 0x8b, 0xa6});       // mov r12, [r14 + globals]
+	u32(offsetof(JitContext, globals));
+	bytes({0x4d, 0x8b, 0xae});       // mov r13, [r14 + regsEnd]
+	u32(offsetof(JitContext, regsEnd));
+	bytes({0x4d, 0x8b, 0xbe});       // mov r15, [r14 + depth]
+	u32(offsetof(JitContext, depth));
+	byte(0xe8);                      // call main
+	myCalls.push_back(std::make_pair(myCode.size(), (size_t)myProgram.main));
+	u32(0);
+	bytes({0x31, 0xc0});             // xor eax, eax
+	size_t leave = myCode.size();
+	bytes({0x49, 0x8b, 0xa6});       // mov rsp, [r14 + savedRsp]
+	u32(SAVED_RSP);
+	bytes({0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5d, 0x5b, 0xc3});
+
+	// Error exit, with the site in esi
+	myErrorExit = myCode.size();
+	bytes({0x41, 0x89, 0xb6});       // mov [r14 + errorSite], esi
+	u32(offsetof(JitContext, errorSite));
+	byte(0xb8);                      // mov eax, 1
+	u32(1);
+	byte(0xe9);                      // jmp leave
+	u32(0);
+	patchRel(myCode.size() - 4, leave);
+}
+
+void Assembler::fail(Cond cc, const char * msg){
+	bytes({0x0f, (uint8_t)(0x80 | cc)});
+	myFails.push_back(std::make_pair(myCode.size(), mySites.size()));
+	mySites.push_back(Site{myFn, myPc, msg});
+	u32(0);
+}
+
+// Entered with rsp 8 below a 16-byte boundary, like any SysV function;
+// the extra 8 bytes keep helper calls aligned.
+void Assembler::function(int index){
+	const BytecodeFunction& fn = myProgram.functions[index];
+	myFn = index;
+	myFunctions[index] = myCode.size();
+	myJumps.clear();
+	myFails.clear();
+	bytes({0x48, 0x83, 0xec, 0x08}); // sub rsp, 8
+	std::vector<size_t> starts(fn.code.size() + 1);
+	for (myPc = 0; myPc < fn.code.size(); myPc++){
+		starts[myPc] = myCode.size();
+		insn(fn.code[myPc]);
+	}
+	starts[fn.code.size()] = myCode.size();
+	for (auto& j : myJumps){
+		patchRel(j.first, starts[j.second]);
+	}
+	// One stub per error site: mov esi, site; jmp error exit
+	for (auto& f : myFails){
+		patchRel(f.first, myCode.size());
+		byte(0xbe);
+		u32(f.second);
+		byte(0xe9);
+		u32(0);
+		patchRel(myCode.size() - 4, myErrorExit);
+	}
+}
+
+void Assembler::insn(const Insn& in){
+	switch (in.op){
+	case OP_MOV:
+		if (in.a != in.b){
+			load(EAX, in.b);
+			store(EAX, in.a);
+		}
+		break;
+	case OP_LOADK:
+		frame({0xc7}, 0, in.a);          // mov dword [a], k
+		u32(in.b);
+		break;
+	case OP_LOADG:
+		global(0x8b, EAX, in.b);
+		store(EAX, in.a);
+		break;
+	case OP_STOREG:
+		load(EAX, in.a);
+		global(0x89, EAX, in.b);
+		break;
+	case OP_ADD:
+	case OP_SUB:
+	case OP_MUL:
+		// Wrapping 32-bit arithmetic, as lilc_arith.hpp defines it
+		load(EAX, in.b);
+		if (in.op == OP_ADD){
+			frame({0x03}, EAX, in.c);
+		} else if (in.op == OP_SUB){
+			frame({0x2b}, EAX, in.c);
+		} else {
+			frame({0x0f, 0xaf}, EAX, in.c);
+		}
+		store(EAX, in.a);
+		break;
+	case OP_DIV:
+		divide(in);
+		break;
+	case OP_ADDI:
+		load(EAX, in.b);
+		byte(0x05);                      // add eax, k
+		u32(in.c);
+		store(EAX, in.a);
+		break;
+	case OP_NEG:
+		load(EAX, in.b);
+		bytes({0xf7, 0xd8});             // neg eax
+		store(EAX, in.a);
+		break;
+	case OP_NOT:
+		frame({0x83}, 7, in.b);          // cmp dword [b], 0
+		byte(0);
+		setcc(CC_E, in.a);
+		break;
+	case OP_EQ: case OP_NE: case OP_LT:
+	case OP_GT: case OP_LE: case OP_GE:
+		load(EAX, in.b);
+		frame({0x3b}, EAX, in.c);
+		setcc(condOf(in.op), in.a);
+		break;
+	case OP_JMP:
+		byte(0xe9);
+		jumpTo(in.c);
+		break;
+	case OP_JT:
+	case OP_JF:
+		frame({0x83}, 7, in.a);
+		byte(0);
+		jcc(in.op == OP_JT ? CC_NE : CC_E, in.c);
+		break;
+	case OP_JEQ: case OP_JNE: case OP_JLT:
+	case OP_JGT: case OP_JLE: case OP_JGE:
+		load(EAX, in.a);
+		frame({0x3b}, EAX, in.b);
+		jcc(condOf(in.op), in.c);
+		break;
+	case OP_JEQI: case OP_JNEI: case OP_JLTI:
+	case OP_JGTI: case OP_JLEI: case OP_JGEI:
+		frame({0x81}, 7, in.a);          // cmp dword [a], k
+		u32(in.b);
+		jcc(condOf(in.op), in.c);
+		break;
+	case OP_CALL:
+		call(in);
+		break;
+	case OP_TCALL:
+		tailCall(in);
+		break;
+	case OP_RET:
+	case OP_RET0:
+		if (in.op == OP_RET){
+			load(EAX, in.a);
+		} else {
+			bytes({0x31, 0xc0});
+		}
+		bytes({0x48, 0x83, 0xc4, 0x08, 0xc3}); // add rsp, 8; ret
+		break;
+	case OP_READ:
+	case OP_READB:
+		movRdiContext();
+		callHelper((const void *)(in.op == OP_READ ? jitRead : jitReadBool));
+		store(EAX, in.a);
+		break;
+	case OP_WRITE:
+		movRdiContext();
+		load(ESI, in.a);
+		callHelper((const void *)jitWrite);
+		break;
+	case OP_WRITES:
+		movRdiContext();
+		byte(0xbe);                      // mov esi, index
+		u32(in.a);
+		callHelper((const void *)jitWriteString);
+		break;
+	}
+}
+
+// Truncating division; x / -1 is a wrapping negation since idiv traps on
+// INT_MIN / -1
+void Assembler::divide(const Insn& in){
+	load(ECX, in.c);
+	bytes({0x85, 0xc9});                     // test ecx, ecx
+	fail(CC_E, "Division by zero");
+	load(EAX, in.b);
+	bytes({0x83, 0xf9, 0xff});               // cmp ecx, -1
+	bytes({0x75, 0x04});                     // jne idiv
+	bytes({0xf7, 0xd8});                     // neg eax
+	bytes({0xeb, 0x03});                     // jmp done
+	bytes({0x99, 0xf7, 0xf9});               // idiv: cdq; idiv ecx
+	store(EAX, in.a);                        // done:
+}
+
+// The callee's frame starts right after the caller's. Checks there is room
+// for it and that the call depth allows another call, copies the arguments
+// from c.. and zeroes the rest of the frame.
+void Assembler::call(const Insn& in){
+	const BytecodeFunction& caller = myProgram.functions[myFn];
+	const BytecodeFunction& callee = myProgram.functions[in.b];
+	int base = caller.numRegs;
+	bytes({0x48, 0x8d, 0x83});               // lea rax, [rbx + end of callee]
+	u32(4 * (base + callee.numRegs));
+	bytes({0x4c, 0x39, 0xe8});               // cmp rax, r13
+	fail(CC_A, "Stack overflow");
+	bytes({0x49, 0xff, 0xcf});               // dec r15
+	fail(CC_E, "Stack overflow");
+	for (int i = 0; i < callee.numParams; i++){
+		load(EAX, in.c + i);
+		store(EAX, base + i);
+	}
+	clear(base + callee.numParams, callee.numRegs - callee.numParams);
+	bytes({0x48, 0x81, 0xc3});               // add rbx, 4 * base
+	u32(4 * base);
+	byte(0xe8);                              // call callee
+	myCalls.push_back(std::make_pair(myCode.size(), (size_t)in.b));
+	u32(0);
+	bytes({0x48, 0x81, 0xeb});               // sub rbx, 4 * base
+	u32(4 * base);
+	bytes({0x49, 0xff, 0xc7});               // inc r15
+	bytes({0x49, 0xff, 0x86});               // inc qword [r14 + calls]
+	u32(offsetof(JitContext, calls));
+	store(EAX, in.a);
+}
+
+// The callee takes over the frame: the arguments move down to its start
+// and the callee is jumped to with this function's return address on
+// the stack. Registers c.. lie above 0.., so copying upwards is safe.
+void Assembler::tailCall(const Insn& in){
+	const BytecodeFunction& callee = myProgram.functions[in.b];
+	bytes({0x48, 0x8d, 0x83});               // lea rax, [rbx + end of callee]
+	u32(4 * callee.numRegs);
+	bytes({0x4c, 0x39, 0xe8});               // cmp rax, r13
+	fail(CC_A, "Stack overflow");
+	for (int i = 0; i < callee.numParams; i++){
+		load(EAX, in.c + i);
+		store(EAX, i);
+	}
+	clear(callee.numParams, callee.numRegs - callee.numParams);
+	bytes({0x49, 0xff, 0x86});               // inc qword [r14 + calls]
+	u32(offsetof(JitContext, calls));
+	bytes({0x48, 0x83, 0xc4, 0x08});         // add rsp, 8
+	byte(0xe9);                              // jmp callee
+	myCalls.push_back(std::make_pair(myCode.size(), (size_t)in.b));
+	u32(0);
+}
+
+// Zeroes count registers from first
+void Assembler::clear(int first, int count){
+	if (count <= 8){
+		for (int i = 0; i < count; i++){
+			frame({0xc7}, 0, first + i);
+			u32(0);
+		}
+	} else {
+		bytes({0x48, 0x8d, 0xbb});           // lea rdi, [rbx + first]
+		u32(4 * first);
+		byte(0xb9);                          // mov ecx, count
+		u32(count);
+		bytes({0x31, 0xc0, 0xf3, 0xab});     // xor eax, eax; rep stosd
+	}
+}
+
+// Anonymous memory, unmapped on scope exit
+class Mapping{
+public:
+	Mapping(size_t size){
+		mySize = size;
+		myBase = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	}
+	~Mapping(){
+		if (ok()){
+			munmap(myBase, mySize);
+		}
+	}
+	bool ok(){ return myBase != MAP_FAILED; }
+	char * base(){ return (char *)myBase; }
+	size_t size(){ return mySize; }
+private:
+	void * myBase;
+	size_t mySize;
+};
+
+static size_t pageAlign(size_t bytes){
+	size_t page = sysconf(_SC_PAGESIZE);
+	return (bytes + page - 1) / page * page;
+}
+
+bool JIT::run(const BytecodeProgram& program, std::ostream& err){
+	if (program.main < 0){
+		err << "***ERROR*** No main function\n";
+		return false;
+	}
+	Assembler as(program);
+	as.assemble();
+	myCodeBytes = as.code().size();
+
+	// Written while only writable, then switched to only executable
+	Mapping code(pageAlign(myCodeBytes));
+	if (!code.ok()){
+		err << "***ERROR*** Cannot map memory for the JIT\n";
+		return false;
+	}
+	memcpy(code.base(), as.code().data(), myCodeBytes);
+	if (mprotect(code.base(), code.size(), PROT_READ | PROT_EXEC) != 0){
+		err << "***ERROR*** Cannot make JIT code executable\n";
+		return false;
+	}
+
+	// 16 bytes of native stack per frame plus room for the helpers, with
+	// a guard page below
+	Mapping stack(pageAlign(MAX_CALL_DEPTH * 16 + (1 << 20)));
+	if (!stack.ok()){
+		err << "***ERROR*** Cannot map memory for the JIT\n";
+		return false;
+	}
+	mprotect(stack.base(), pageAlign(1), PROT_NONE);
+
+	std::vector<int32_t> globals(program.numGlobals, 0);
+	const BytecodeFunction& main = program.functions[program.main];
+	JitContext ctx;
+	ctx.savedRsp = nullptr;
+	ctx.stackTop = stack.base() + stack.size();
+	ctx.regs = myRegs.get();
+	ctx.regsEnd = myRegs.get() + myNumRegs;
+	ctx.globals = globals.data();
+	// Counts down on each call; main is already running
+	ctx.depth = MAX_CALL_DEPTH + 1;
+	ctx.calls = 1;
+	ctx.errorSite = -1;
+	ctx.io = myIO;
+	ctx.program = &program;
+
+	int failed = 1;
+	if ((size_t)main.numRegs <= myNumRegs){
+		memset(myRegs.get(), 0, main.numRegs * sizeof(int32_t));
+		int (*entry)(JitContext *) = (int (*)(JitContext *))code.base();
+		failed = entry(&ctx);
+	}
+	myCalls = ctx.calls;
+	myIO->flush();
+	if (failed){
+		size_t line = 0;
+		size_t col = 0;
+		const char * msg = "Stack overflow";
+		if (ctx.errorSite >= 0){
+			const Assembler::Site& site = as.sites()[ctx.errorSite];
+			const std::pair<size_t, size_t>& pos =
+				program.functions[site.fn].positions[site.pc];
+			line = pos.first;
+			col = pos.second;
+			msg = site.msg;
+		}
+		err << line << ":" << col << " ***RUNTIME ERROR*** " << msg << "\n";
+		return false;
+	}
+	return true;
+}
+
+#endif
+
+} //End namespace LIL' C
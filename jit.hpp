@@ -0,0 +1,57 @@
+#ifndef LILC_JIT_HPP
+#define LILC_JIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace LILC{
+
+struct BytecodeProgram;
+class RuntimeIO;
+
+// Compiles register bytecode (bytecode.hpp) to x86-64 machine code and
+// runs it from main (jit.cpp). Linux x86-64 only; elsewhere run() reports
+// that the JIT is unavailable.
+//
+// Every bytecode function becomes one native function. Its registers are
+// 32-bit slots in a frame on the same register stack the VM uses, held in
+// rbx, so operands are [rbx + 4 * r] and globals [r12 + 4 * g]. Conditions
+// compile to cmp and jcc, && and || are already branches in the bytecode,
+// calls are direct `call rel32` with the callee's frame starting right
+// after the caller's, and reads and writes call back into a RuntimeIO.
+// Code is written to a private buffer and only then mapped executable,
+// never writable and executable at once.
+//
+// The code runs on its own native stack. Division by zero and running out
+// of frames jump back to the entry stub, which restores the native stack,
+// so runtime errors are reported like the interpreter reports them.
+class JIT{
+public:
+	static const size_t DEFAULT_REGISTERS = 16 << 20;
+
+	JIT(RuntimeIO * io, size_t registers = DEFAULT_REGISTERS);
+
+	// Whether this build can generate and run native code
+	static bool supported();
+
+	// Compiles and runs program. A runtime error stops the program and is
+	// reported on err; returns false if there was one or if the JIT is
+	// not supported.
+	bool run(const BytecodeProgram& program, std::ostream& err);
+	size_t getCalls(){ return myCalls; }
+	size_t getCodeBytes(){ return myCodeBytes; }
+private:
+	RuntimeIO * myIO;
+	// Left uninitialized so only the part that is used gets paged in
+	std::unique_ptr<int32_t[]> myRegs;
+	size_t myNumRegs;
+	size_t myCalls = 0;
+	size_t myCodeBytes = 0;
+};
+
+} //End namespace LIL' C
+
+#endif
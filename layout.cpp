@@ -0,0 +1,43 @@
+#include "ast.hpp"
+#include "symbol_table.hpp"
+
+// Storage layout of values and structs (see StructDef).
+
+namespace LILC{
+
+int IntNode::getSize(){ return 4; }
+int IntNode::getAlignment(){ return 4; }
+
+int BoolNode::getSize(){ return 1; }
+int BoolNode::getAlignment(){ return 1; }
+
+int VoidNode::getSize(){ return 0; }
+int VoidNode::getAlignment(){ return 1; }
+
+int StructNode::getSize(){
+	StructDef * def = getStruct();
+	return def == nullptr ? 0 : def->getSize();
+}
+
+int StructNode::getAlignment(){
+	StructDef * def = getStruct();
+	return def == nullptr ? 1 : def->getAlignment();
+}
+
+void StructDef::computeLayout(){
+	int offset = 0;
+	myAlignment = 1;
+	for (SemSymbol * field : myFieldOrder){
+		TypeNode * type = field->getType();
+		int alignment = type->getAlignment();
+		offset = alignUp(offset, alignment);
+		field->setOffset(offset);
+		offset += type->getSize();
+		if (alignment > myAlignment){
+			myAlignment = alignment;
+		}
+	}
+	mySize = alignUp(offset, myAlignment);
+}
+
+} //End namespace LIL' C
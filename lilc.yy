@@ -37,9 +37,54 @@
 
    /* include for interoperation between scanner/parser */
    #include "lilc_compiler.hpp"
+   #include "lilc_ruleprof.hpp"
 
+/* Tokens are pulled through the compiler so --stats can count them, and
+ * in rule profiles their spans are noted as they arrive */
 #undef yylex
-#define yylex scanner.yylex
+#ifdef LILC_RULE_PROFILE
+static int profiledLex( LILC::LilC_Compiler& compiler,
+   LILC::LilC_Scanner& scanner, LILC::LilC_Parser::semantic_type * lval ){
+   int tag = compiler.lex(lval);
+   PARSE_TOKEN(scanner.tokenStart(), scanner.offset());
+   return tag;
+}
+#define yylex(lval) profiledLex(compiler, scanner, lval)
+#else
+#define yylex compiler.lex
+#endif
+
+/* Opens every semantic action. In rule profiles (lilc_ruleprof.hpp) it
+ * times the action and charges it to the production being reduced,
+ * named once from the symbols on the stack. The name is never freed:
+ * the report printing it at exit outlives function-local statics. */
+#ifdef LILC_RULE_PROFILE
+#define RULE_SCOPE \
+   static const std::string& ruleText = *new std::string([&]{ \
+      std::string text = symbol_name(symbol_kind_type(yyr1_[yyn])); \
+      text += ":"; \
+      for (int i = yylen; i > 0; i--){ \
+         text += " "; \
+         text += symbol_name(yystack_[i - 1].kind()); \
+      } \
+      return yylen == 0 ? text + " %empty" : text; \
+   }()); \
+   LILC::ReductionScope ruleScope(yyn, ruleText.c_str(), yystack_.size(), yylen)
+#else
+#define RULE_SCOPE static_cast<void>(0)
+#endif
+
+/* Charges the enclosing semantic action to the AST build phase. Nodes
+ * are tagged by class in allocation profiles; what else an action
+ * allocates is list headers and list nodes. */
+#define AST_BUILD_SCOPE \
+   RULE_SCOPE; \
+   LILC::PhaseScope astScope(compiler.getStats(), LILC::CompilerStats::AST, true); \
+   ALLOC_SCOPE("std::list")
+}
+
+%initial-action {
+   PARSE_BEGIN;
 }
 %expect 4
 
@@ -86,8 +131,8 @@
 %token               BOOL
 %token               INT
 %token               VOID
-%token               TRUE
-%token               FALSE
+%token <symbolValue> TRUE
+%token <symbolValue> FALSE
 %token               STRUCT
 %token               INPUT
 %token               OUTPUT
@@ -156,6 +201,7 @@
 %%
 
 program : declList {
+           AST_BUILD_SCOPE;
            //$$ = new ProgramNode(new DeclListNode($1));
            $$ = new ProgramNode(new DeclListNode($1));
            compiler.setASTRoot($$);
@@ -163,211 +209,269 @@ program : declList {
     ;
 
 declList : declList decl {
+             AST_BUILD_SCOPE;
              $1->push_back($2);
              $$ = $1;
              }
     | /* epsilon */ {
+            AST_BUILD_SCOPE;
             $$ = new std::list<DeclNode *>();
             }
     ;
 // Bison adds '$$ = $1' for empty bracket definitions by default
-decl : varDecl {} | structDecl {} | fnDecl {}
+decl : varDecl { RULE_SCOPE; } | structDecl { RULE_SCOPE; } | fnDecl { RULE_SCOPE; }
 
 varDecl : type id SEMICOLON {
+  AST_BUILD_SCOPE;
   $$ = new VarDeclNode($1, $2, VarDeclNode::NOT_STRUCT);
 }
+        | STRUCT id id SEMICOLON {
+  AST_BUILD_SCOPE;
+  $$ = new VarDeclNode(new StructNode($2), $3, 0);
+}
 
 structDecl : STRUCT id LCURLY structBody RCURLY SEMICOLON {
+  AST_BUILD_SCOPE;
   $$ = new StructDeclNode($2, $4, 0);
 }
 
 structBody : structBody varDecl {
+  AST_BUILD_SCOPE;
   $1->add($2);
   $$ = $1;
              }
         |    varDecl {
+            AST_BUILD_SCOPE;
             $$ = new VarDeclListNode(new std::list<VarDeclNode *>());
             $$->add($1);
              }
 
 fnDecl : type id formals fnBody {
+    AST_BUILD_SCOPE;
     $$ = new FnDeclNode($1, $2, $3, $4, 0);
 }
 
 formals : LPAREN RPAREN {
+            RULE_SCOPE;
             $$ = nullptr;
         }
     | LPAREN formalsList RPAREN {
+            RULE_SCOPE;
             $$ = $2;
         }
 
 formalsList : formalDecl {
+            AST_BUILD_SCOPE;
             $$ = new FormalsListNode(new std::list<FormalDeclNode *>());
             $$->add($1);
         }
     | formalsList COMMA formalDecl {
+            AST_BUILD_SCOPE;
             $1->add($3);
             $$ = $1;
         }
 
 formalDecl : type id {
+            AST_BUILD_SCOPE;
             $$ = new FormalDeclNode($1, $2, 0);
 }
 
 fnBody : LCURLY varDeclList stmtList RCURLY {
+    AST_BUILD_SCOPE;
     $$ = new FnBodyNode($2, $3);
 }
 
 varDeclList : varDeclList varDecl {
+          AST_BUILD_SCOPE;
           $1->add($2);
           $$ = $1;
             }
         | /* epsilon */ {
+          AST_BUILD_SCOPE;
           $$ = new VarDeclListNode(new std::list<VarDeclNode *>());
         }
 
 stmtList : stmtList stmt {
+            AST_BUILD_SCOPE;
             $1->add($2);
             $$ = $1;
         }
     | /* epsilon */ {
+            AST_BUILD_SCOPE;
             $$ = new StmtListNode(new std::list<StmtNode *>());
         }
 
 stmt : assignExp SEMICOLON {
+            AST_BUILD_SCOPE;
             $$ = new AssignStmtNode($1);
         }
          | loc PLUSPLUS SEMICOLON {
+            AST_BUILD_SCOPE;
             $$ = new PostIncStmtNode($1);
            }
          | loc MINUSMINUS SEMICOLON {
+            AST_BUILD_SCOPE;
             $$ = new PostDecStmtNode($1);
            }
          | INPUT READ loc SEMICOLON {
+            AST_BUILD_SCOPE;
             $$ = new ReadStmtNode($3);
            }
          | OUTPUT WRITE exp SEMICOLON {
+            AST_BUILD_SCOPE;
             $$ = new WriteStmtNode($3);
            }
          | IF LPAREN exp RPAREN LCURLY varDeclList stmtList RCURLY ELSE LCURLY varDeclList stmtList RCURLY {
+            AST_BUILD_SCOPE;
             $$ = new IfElseStmtNode($3, $6, $7, $11, $12);
            }
          | IF LPAREN exp RPAREN LCURLY varDeclList stmtList RCURLY {
+            AST_BUILD_SCOPE;
             $$ = new IfStmtNode($3, $6, $7);
            }
          |  WHILE LPAREN exp RPAREN LCURLY varDeclList stmtList RCURLY {
+            AST_BUILD_SCOPE;
             $$ = new WhileStmtNode($3, $6, $7);
            }
          | RETURN exp SEMICOLON {
+            AST_BUILD_SCOPE;
             $$ = new ReturnStmtNode($2);
            }
          | RETURN SEMICOLON {
+            AST_BUILD_SCOPE;
             $$ = new ReturnStmtNode(nullptr);
            }
          | fncall SEMICOLON {
+            AST_BUILD_SCOPE;
             $$ = new CallStmtNode($1);
            }
 
 assignExp : loc ASSIGN exp {
+    AST_BUILD_SCOPE;
     $$ = new AssignNode($1, $3);
 }
 
-loc : id {} | loc DOT id {
+loc : id { RULE_SCOPE; } | loc DOT id {
+        AST_BUILD_SCOPE;
         $$ = new DotAccessNode($1, $3);
     }
 
-exp : assignExp {}
+exp : assignExp { RULE_SCOPE; }
      | exp PLUS expt {
+        AST_BUILD_SCOPE;
         $$ = new PlusNode($1, $3);
      }
      | exp MINUS expt {
+        AST_BUILD_SCOPE;
         $$ = new MinusNode($1, $3);
      }
-     | expt {}
+     | expt { RULE_SCOPE; }
      | NOT exp {
+        AST_BUILD_SCOPE;
         $$ = new NotNode($2);
        }
      | term AND term {
+        AST_BUILD_SCOPE;
         $$ = new AndNode($1, $3);
        }
      | term OR term {
+        AST_BUILD_SCOPE;
         $$ = new OrNode($1, $3);
        }
      | term EQUALS term {
+        AST_BUILD_SCOPE;
         $$ = new EqualsNode($1, $3);
        }
      | term NOTEQUALS term {
+        AST_BUILD_SCOPE;
         $$ = new NotEqualsNode($1, $3);
        }
      | term LESS term {
+        AST_BUILD_SCOPE;
         $$ = new LessNode($1, $3);
        }
      | term GREATER term {
+        AST_BUILD_SCOPE;
         $$ = new GreaterNode($1, $3);
        }
      | term LESSEQ term {
+        AST_BUILD_SCOPE;
         $$ = new LessEqNode($1, $3);
        }
      | term GREATEREQ term {
+        AST_BUILD_SCOPE;
         $$ = new GreaterEqNode($1, $3);
        }
 
 expt : expt TIMES expf {
+            AST_BUILD_SCOPE;
             $$ = new TimesNode($1, $3);
         }
     | expt DIVIDE expf {
+            AST_BUILD_SCOPE;
             $$ =  new DivideNode($1, $3);
         }
-    | expf {}
+    | expf { RULE_SCOPE; }
 
-expf : term {}
+expf : term { RULE_SCOPE; }
     | MINUS term {
+        AST_BUILD_SCOPE;
         $$ = new UnaryMinusNode($2);
     }
 
 term : loc {
+        RULE_SCOPE;
        }
      | INTLITERAL {
+        AST_BUILD_SCOPE;
         $$ = new IntLitNode($1);
        }
      | STRINGLITERAL {
+        AST_BUILD_SCOPE;
         $$ = new StringLitNode($1);
        }
      | TRUE {
-        $$ = new TrueNode();
+        AST_BUILD_SCOPE;
+        $$ = new TrueNode($1);
        }
      | FALSE {
-        $$ = new FalseNode();
+        AST_BUILD_SCOPE;
+        $$ = new FalseNode($1);
        }
      | LPAREN exp RPAREN {
+        RULE_SCOPE;
         $$ = $2;
        }
-     | fncall {}
+     | fncall { RULE_SCOPE; }
 
 fncall : id LPAREN RPAREN {
+            AST_BUILD_SCOPE;
             $$ = new CallExpNode($1, nullptr);
         }
     | id LPAREN actualList RPAREN {
+            AST_BUILD_SCOPE;
             $$ = new CallExpNode($1, $3);
         }
 
 actualList : exp {
+            AST_BUILD_SCOPE;
             $$ = new ExpListNode(new std::list<ExpNode *>());
             $$->add($1);
         }
     | actualList COMMA exp {
+        AST_BUILD_SCOPE;
         $1->add($3);
         $$ = $1;
     }
 
-type : INT { $$ = new IntNode(); }
-     | BOOL { $$ = new BoolNode(); }
-     | VOID { $$ = new VoidNode(); }
+type : INT { AST_BUILD_SCOPE; $$ = new IntNode(); }
+     | BOOL { AST_BUILD_SCOPE; $$ = new BoolNode(); }
+     | VOID { AST_BUILD_SCOPE; $$ = new VoidNode(); }
 
-id : ID { $$ = new IdNode($1); }
+id : ID { AST_BUILD_SCOPE; $$ = new IdNode($1); }
 %%
 void
 LILC::LilC_Parser::error(const std::string &err_message )
 {
-   std::cerr << "Error: " << err_message << "\n";
+   scanner.error( LILC::Diagnostics::SYNTAX_ERROR, err_message );
 }
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "lilc_alloc.hpp"
+
+// Running byte total for --stats. Counting only starts once someone asks
+// for it, so a plain run pays a single relaxed load per allocation.
+static std::atomic<bool> trackAllocs(false);
+static std::atomic<size_t> allocBytes(0);
+
+namespace LILC{
+
+void trackAllocations(){
+	trackAllocs.store(true, std::memory_order_relaxed);
+}
+
+size_t allocatedBytes(){
+	return allocBytes.load(std::memory_order_relaxed);
+}
+
+} // End namespace LIL' C
+
+#if defined(LILC_LIBRARY)
+
+// liblilc.a leaves the embedding program's operator new alone, so
+// allocatedBytes() stays 0 there and --stats-style reports show no bytes
+
+#elif !defined(LILC_ALLOC_PROFILE)
+
+void * operator new(size_t size){
+	if (trackAllocs.load(std::memory_order_relaxed)){
+		allocBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+	void * ptr = malloc(size == 0 ? 1 : size);
+	if (ptr == nullptr){
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void * ptr) noexcept { free(ptr); }
+
+#else
+
+namespace {
+
+const int MAX_TAGS = 256;
+
+struct TagRecord {
+	const char * name;
+	std::atomic<size_t> count;
+	std::atomic<size_t> bytes;
+	std::atomic<size_t> live;
+	std::atomic<size_t> peak;
+};
+
+// Every block carries its size and tag so delete can credit the right
+// type's live bytes. 16 bytes keeps the payload max-aligned.
+struct alignas(16) BlockHeader {
+	size_t size;
+	int tag;
+};
+
+TagRecord tags[MAX_TAGS];
+std::atomic<int> numTags(1);
+std::mutex tagLock;
+thread_local int currentTag = 0;
+
+void * allocate(size_t size, int tag){
+	BlockHeader * block = (BlockHeader *)malloc(sizeof(BlockHeader) + size);
+	if (block == nullptr){
+		throw std::bad_alloc();
+	}
+	block->size = size;
+	block->tag = tag;
+
+	TagRecord & rec = tags[tag];
+	rec.count.fetch_add(1, std::memory_order_relaxed);
+	rec.bytes.fetch_add(size, std::memory_order_relaxed);
+	size_t live = rec.live.fetch_add(size, std::memory_order_relaxed) + size;
+	size_t peak = rec.peak.load(std::memory_order_relaxed);
+	while (live > peak && !rec.peak.compare_exchange_weak(peak, live,
+		std::memory_order_relaxed)){
+	}
+	if (trackAllocs.load(std::memory_order_relaxed)){
+		allocBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+	return block + 1;
+}
+
+class AllocReport{
+public:
+	~AllocReport(){
+		std::vector<int> order;
+		int n = numTags.load();
+		for (int i = 0; i < n; i++){
+			if (tags[i].count.load() != 0){
+				order.push_back(i);
+			}
+		}
+		std::sort(order.begin(), order.end(), [](int a, int b){
+			return tags[a].bytes.load() > tags[b].bytes.load();
+		});
+		size_t totalCount = 0, totalBytes = 0;
+		fprintf(stderr, "%-24s %12s %14s %10s %14s %14s\n", "type", "count",
+			"bytes", "avg", "peak live", "live at exit");
+		for (int i : order){
+			TagRecord & rec = tags[i];
+			size_t count = rec.count.load();
+			size_t bytes = rec.bytes.load();
+			totalCount += count;
+			totalBytes += bytes;
+			fprintf(stderr, "%-24s %12zu %14zu %10.1f %14zu %14zu\n",
+				i == 0 ? "(untagged)" : rec.name, count, bytes,
+				(double)bytes / count, rec.peak.load(), rec.live.load());
+		}
+		fprintf(stderr, "%-24s %12zu %14zu\n", "total", totalCount, totalBytes);
+	}
+};
+
+AllocReport report;
+
+} // End anonymous namespace
+
+namespace LILC{
+
+int registerAllocTag(const char * name){
+	std::lock_guard<std::mutex> guard(tagLock);
+	int n = numTags.load();
+	for (int i = 1; i < n; i++){
+		if (strcmp(tags[i].name, name) == 0){
+			return i;
+		}
+	}
+	if (n == MAX_TAGS){
+		return 0;
+	}
+	tags[n].name = name;
+	numTags.store(n + 1);
+	return n;
+}
+
+void * taggedNew(size_t size, int tag){
+	return allocate(size, tag);
+}
+
+AllocScope::AllocScope(int tag){
+	myPrev = currentTag;
+	currentTag = tag;
+}
+
+AllocScope::~AllocScope(){
+	currentTag = myPrev;
+}
+
+} // End namespace LIL' C
+
+void * operator new(size_t size){
+	return allocate(size, currentTag);
+}
+
+void operator delete(void * ptr) noexcept {
+	if (ptr == nullptr){
+		return;
+	}
+	BlockHeader * block = (BlockHeader *)ptr - 1;
+	tags[block->tag].live.fetch_sub(block->size, std::memory_order_relaxed);
+	free(block);
+}
+
+#endif
+
+#if !defined(LILC_LIBRARY)
+
+// The array and sized forms go through the replacements above
+void * operator new[](size_t size){
+	return operator new(size);
+}
+
+void operator delete[](void * ptr) noexcept { operator delete(ptr); }
+void operator delete(void * ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void * ptr, size_t) noexcept { operator delete(ptr); }
+
+#endif
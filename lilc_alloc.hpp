@@ -0,0 +1,62 @@
+#ifndef __LILC_ALLOC_HPP__
+#define __LILC_ALLOC_HPP__ 1
+
+#include <cstddef>
+
+// Global allocation accounting.
+//
+// P3 replaces the global operator new/delete (lilc_alloc.cpp). In a normal
+// build they only keep the running byte total that --stats reports per
+// phase. Building with -DLILC_ALLOC_PROFILE (make P3-allocprof) also
+// attributes every allocation to a type and prints a per-type report at
+// exit:
+//
+//   ALLOC_TAGGED(Class)   inside a class body, tags `new Class` with
+//                         the class name
+//   ALLOC_SCOPE("name")   tags untagged allocations made by the rest of
+//                         the enclosing block, e.g. std::list nodes or
+//                         std::string buffers
+//
+// Both macros expand to nothing in a normal build.
+
+namespace LILC{
+
+// Starts counting bytes for allocatedBytes(); off until the first call.
+void trackAllocations();
+size_t allocatedBytes();
+
+#ifdef LILC_ALLOC_PROFILE
+
+int registerAllocTag(const char * name);
+void * taggedNew(size_t size, int tag);
+
+class AllocScope{
+public:
+	AllocScope(int tag);
+	~AllocScope();
+private:
+	int myPrev;
+};
+
+#define ALLOC_TAGGED(name) \
+	static void * operator new(size_t size){ \
+		static int tag = LILC::registerAllocTag(#name); \
+		return LILC::taggedNew(size, tag); \
+	} \
+	static void operator delete(void * ptr){ ::operator delete(ptr); }
+
+#define ALLOC_SCOPE(name) \
+	LILC::AllocScope allocScope([]{ \
+		static int tag = LILC::registerAllocTag(name); \
+		return tag; \
+	}())
+
+#else
+
+#define ALLOC_TAGGED(name)
+#define ALLOC_SCOPE(name) static_cast<void>(0)
+
+#endif
+
+} /* end namespace */
+#endif /* END __LILC_ALLOC_HPP__ */
@@ -0,0 +1,73 @@
+#include <sstream>
+
+#include "lilc_api.hpp"
+
+namespace LILC{
+
+const char * statusName(Status status){
+	switch (status){
+		case OK:
+			return "ok";
+		case SYNTAX_ERROR:
+			return "syntax error";
+		case SEMANTIC_ERROR:
+			return "semantic error";
+		default:
+			return "unknown";
+	}
+}
+
+// Points compiler's error stream at a local buffer for one call and hands
+// what was written to the caller's string at the end
+class ErrorCapture{
+public:
+	ErrorCapture(LilC_Compiler& compiler, std::string& errors)
+	: myCompiler(compiler), myErrors(errors){
+		myPrevious = &compiler.getErrorStream();
+		compiler.setErrorStream(myBuffer);
+	}
+	~ErrorCapture(){
+		myCompiler.setErrorStream(*myPrevious);
+		myErrors = myBuffer.str();
+	}
+private:
+	LilC_Compiler& myCompiler;
+	std::string& myErrors;
+	std::ostream * myPrevious;
+	std::ostringstream myBuffer;
+};
+
+Status tokenize(SourceText source, std::vector<Token>& tokens,
+	std::string& errors){
+	LilC_Compiler compiler;
+	ErrorCapture capture(compiler, errors);
+	bool ok = compiler.scanText(source.data(), source.size(), tokens);
+	return ok ? OK : SYNTAX_ERROR;
+}
+
+Status parse(SourceText source, LilC_Compiler& compiler, std::string& errors,
+	bool check){
+	ErrorCapture capture(compiler, errors);
+	if (!compiler.parseText(source.data(), source.size())){
+		return SYNTAX_ERROR;
+	}
+	if (check && !(compiler.nameAnalysis() && compiler.typeCheck(1))){
+		return SEMANTIC_ERROR;
+	}
+	return OK;
+}
+
+Status unparse(SourceText source, std::string& text, std::string& errors,
+	bool check){
+	LilC_Compiler compiler;
+	Status status = parse(source, compiler, errors, check);
+	text.clear();
+	if (status != SYNTAX_ERROR){
+		std::ostringstream out;
+		compiler.unparse(out);
+		text.append(out.str());
+	}
+	return status;
+}
+
+} /* end namespace */
@@ -0,0 +1,72 @@
+#ifndef __LILC_API_HPP__
+#define __LILC_API_HPP__ 1
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#include "lilc_compiler.hpp"
+
+namespace LILC{
+
+// The compiler as a library (liblilc.a), for programs that generate Lil' C
+// in memory. Every call works on source text and its own compiler, writes
+// only to the buffers it is given and reports problems by status, so
+// calls may run on any number of threads at once. Output buffers are
+// cleared first and keep their capacity, so a caller can reuse them.
+// Errors are written to `errors` in the text P3 prints to cerr.
+
+// Source text, not copied; a std::string_view converts under C++17
+class SourceText{
+public:
+	SourceText(const char * data, size_t size){
+		myData = data;
+		mySize = size;
+	}
+	SourceText(const char * text) : SourceText(text, strlen(text)){ }
+	SourceText(const std::string& text)
+	: SourceText(text.data(), text.size()){ }
+#if __cplusplus >= 201703L
+	SourceText(std::string_view text) : SourceText(text.data(), text.size()){ }
+#endif
+
+	const char * data() const { return myData; }
+	size_t size() const { return mySize; }
+private:
+	const char * myData;
+	size_t mySize;
+};
+
+enum Status {
+	OK,
+	// The scanner or parser reported an error
+	SYNTAX_ERROR,
+	// Name analysis or type checking failed
+	SEMANTIC_ERROR
+};
+
+const char * statusName(Status status);
+
+// The tokens of source, up to and including END. Scanner errors still
+// produce every token, with SYNTAX_ERROR.
+Status tokenize(SourceText source, std::vector<Token>& tokens,
+	std::string& errors);
+
+// Builds the AST of source in compiler, replacing the one it had, and with
+// check name-analyses and type checks it. The AST is then compiler's
+// getASTRoot(), ready for its other passes. compiler belongs to the
+// caller; it must not be used by another thread during the call.
+Status parse(SourceText source, LilC_Compiler& compiler, std::string& errors,
+	bool check = false);
+
+// The unparsed program, what `P3 in out` writes to out, into text. On
+// SYNTAX_ERROR text is left empty.
+Status unparse(SourceText source, std::string& text, std::string& errors,
+	bool check = false);
+
+} /* end namespace */
+#endif /* END __LILC_API_HPP__ */
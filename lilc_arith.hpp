@@ -0,0 +1,42 @@
+#ifndef __LILC_ARITH_HPP__
+#define __LILC_ARITH_HPP__ 1
+
+#include <climits>
+#include <cstdint>
+
+// Lil' C int arithmetic. Ints are 32-bit two's complement and wrap on
+// overflow; division truncates toward zero and INT_MIN / -1 wraps to
+// INT_MIN. Every stage that evaluates ints goes through these so compile
+// time and run time always agree. Division by zero is the caller's
+// problem: folding leaves it alone and execution reports it.
+
+namespace LILC{
+
+inline int32_t lilcAdd(int32_t a, int32_t b){
+	return (int32_t)((uint32_t)a + (uint32_t)b);
+}
+
+inline int32_t lilcSub(int32_t a, int32_t b){
+	return (int32_t)((uint32_t)a - (uint32_t)b);
+}
+
+inline int32_t lilcMul(int32_t a, int32_t b){
+	return (int32_t)((uint32_t)a * (uint32_t)b);
+}
+
+inline int32_t lilcNeg(int32_t a){
+	return (int32_t)(0u - (uint32_t)a);
+}
+
+inline int32_t lilcDiv(int32_t a, int32_t b){
+	return b == -1 ? lilcNeg(a) : a / b;
+}
+
+// Whether value can be written as Lil' C source: a literal, possibly
+// negated. lilc.l clamps literals above INT_MAX, so INT_MIN cannot be.
+inline bool lilcIsLiteral(int32_t value){
+	return value != INT_MIN;
+}
+
+} /* end namespace */
+#endif /* END __LILC_ARITH_HPP__ */
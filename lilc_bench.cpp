@@ -0,0 +1,145 @@
+// Benchmark harness for the P3 front end.
+//
+// Usage: P3bench [--reps N] [--parser=bison|descent] [--lazy] file.lilc...
+//
+// For each input, times LilC_Compiler::scan, LilC_Compiler::parse and
+// unparsing separately (best of N runs) and reports throughput in MB/s of
+// source text and in AST nodes per second. --parser picks the engine
+// parse uses (bison by default); with --lazy, parse only brace-matches
+// function bodies and unparse pays for building them. Inputs normally come from lilcgen; see
+// the bench and compare-parsers targets in the Makefile.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <streambuf>
+
+#include "lilc_compiler.hpp"
+
+namespace LILC{
+
+// Discards output but still pays for all the formatting.
+class NullBuffer : public std::streambuf {
+public:
+	size_t bytes = 0;
+protected:
+	int overflow(int c) override {
+		bytes++;
+		return c;
+	}
+	std::streamsize xsputn(const char *, std::streamsize n) override {
+		bytes += n;
+		return n;
+	}
+};
+
+static double now(){
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t fileSize(const char * filename){
+	std::ifstream in(filename, std::ios::binary | std::ios::ate);
+	return in.good() ? (size_t)in.tellg() : 0;
+}
+
+} // End namespace LIL' C
+
+int
+main( const int argc, const char **argv )
+{
+	using namespace LILC;
+	int reps = 3;
+	LilC_Compiler::ParserEngine engine = LilC_Compiler::BISON;
+	bool lazy = false;
+	int first = 1;
+	while (first < argc){
+		if (first + 1 < argc && strcmp(argv[first], "--reps") == 0){
+			reps = std::max(1, atoi(argv[first + 1]));
+			first += 2;
+		} else if (strcmp(argv[first], "--parser=bison") == 0){
+			engine = LilC_Compiler::BISON;
+			first++;
+		} else if (strcmp(argv[first], "--parser=descent") == 0){
+			engine = LilC_Compiler::DESCENT;
+			first++;
+		} else if (strcmp(argv[first], "--lazy") == 0){
+			lazy = true;
+			first++;
+		} else {
+			break;
+		}
+	}
+	if (first >= argc){
+		std::cerr << "Usage: P3bench [--reps N] [--parser=bison|descent] [--lazy] file.lilc..." << std::endl;
+		return 1;
+	}
+
+	std::cout << std::left << std::setw(28) << "input" << std::right
+	          << std::setw(12) << "bytes" << std::setw(10) << "nodes"
+	          << std::setw(12) << "scan MB/s"
+	          << std::setw(12) << "parse MB/s"
+	          << std::setw(14) << "parse node/s"
+	          << std::setw(14) << "unparse MB/s"
+	          << std::setw(16) << "unparse node/s" << "\n";
+	std::cout << std::fixed;
+
+	for (int i = first; i < argc; i++){
+		const char * filename = argv[i];
+		size_t bytes = fileSize(filename);
+		double scan = 1e30, parse = 1e30, unparse = 1e30;
+		size_t nodes = 0;
+		size_t outBytes = 0;
+
+		for (int r = 0; r < reps; r++){
+			LilC_Compiler compiler;
+			double start = now();
+			compiler.scan(filename, "/dev/null");
+			scan = std::min(scan, now() - start);
+		}
+		for (int r = 0; r < reps; r++){
+			LilC_Compiler compiler;
+			compiler.setParserEngine(engine);
+			compiler.setLazyBodies(lazy);
+			double start = now();
+			if (!compiler.parse(filename)){
+				std::cerr << filename << ": parse failed" << std::endl;
+				return 1;
+			}
+			parse = std::min(parse, now() - start);
+
+			NullBuffer sink;
+			std::ostream out(&sink);
+			start = now();
+			if (!compiler.unparse(out)){
+				std::cerr << filename << ": parse failed" << std::endl;
+				return 1;
+			}
+			unparse = std::min(unparse, now() - start);
+			outBytes = sink.bytes;
+
+			if (r == 0){
+				CompilerStats stats;
+				compiler.getASTRoot()->collectStats(stats);
+				nodes = stats.nodeCount();
+			}
+		}
+
+		double mb = bytes / 1e6;
+		std::cout << std::left << std::setw(28) << filename << std::right
+		          << std::setw(12) << bytes << std::setw(10) << nodes
+		          << std::setprecision(2)
+		          << std::setw(12) << mb / scan
+		          << std::setw(12) << mb / parse
+		          << std::setprecision(0)
+		          << std::setw(14) << nodes / parse
+		          << std::setprecision(2)
+		          << std::setw(14) << outBytes / 1e6 / unparse
+		          << std::setprecision(0)
+		          << std::setw(16) << nodes / unparse << "\n";
+	}
+	return 0;
+}
@@ -1,8 +1,27 @@
 #include <cctype>
+#include <chrono>
 #include <fstream>
+#include <sstream>
 #include <cassert>
 
 #include "lilc_compiler.hpp"
+#include "lilc_rdparser.hpp"
+#include "symbol_table.hpp"
+#include "type_check.hpp"
+#include "fold.hpp"
+#include "deadcode.hpp"
+#include "loops.hpp"
+#include "tailcall.hpp"
+#include "deadstore.hpp"
+#include "uninit.hpp"
+#include "inline.hpp"
+#include "interp.hpp"
+#include "ir.hpp"
+#include "bytecode.hpp"
+#include "vm.hpp"
+#include "jit.hpp"
+#include "asm.hpp"
+#include "lilc_runtime.hpp"
 
 using TokenTag = LILC::LilC_Parser::token;
 using Lexeme = LILC::LilC_Parser::semantic_type;
@@ -13,196 +32,641 @@ LILC::LilC_Compiler::~LilC_Compiler()
    scanner = nullptr;
    delete(parser);
    parser = nullptr;
+   delete(stats);
+   stats = nullptr;
+   delete(ir);
+   ir = nullptr;
+   delete(bytecode);
+   bytecode = nullptr;
 }
 
-void LILC::LilC_Compiler::scan( const char * const filename,
-const char * outfile )
+void LILC::LilC_Compiler::enableStats()
 {
+   if (stats == nullptr){
+      stats = new CompilerStats();
+   }
+}
 
-   std::ifstream inStream( filename );
+bool LILC::LilC_Compiler::readFile( const char * const filename,
+std::string& contents )
+{
+   PhaseScope scope(stats, CompilerStats::READ);
+   std::ifstream inStream( filename, std::ios::in | std::ios::binary );
    if( ! inStream.good() ) {
-       exit( EXIT_FAILURE );
+       *errors << filename << ": cannot read file\n";
+       return false;
+   }
+   std::ostringstream buffer;
+   buffer << inStream.rdbuf();
+   contents = buffer.str();
+   if (stats != nullptr){
+      stats->countBytes(contents.size());
    }
+   return true;
+}
 
-   delete(scanner);
-   scanner = new LILC::LilC_Scanner( &inStream );
+// How the token dump spells a token
+static std::string tokenText( int tag, Lexeme& lexeme )
+{
+   switch (tag){
+	case TokenTag::END:
+		return "EOF";
+	case TokenTag::BOOL:
+		return "bool";
+	case TokenTag::INT:
+		return "int";
+	case TokenTag::VOID:
+		return "void";
+	case TokenTag::TRUE:
+		return "true";
+	case TokenTag::FALSE:
+		return "false";
+	case TokenTag::STRUCT:
+		return "struct";
+	case TokenTag::INPUT:
+		return "input";
+	case TokenTag::OUTPUT:
+		return "output";
+	case TokenTag::IF:
+		return "if";
+	case TokenTag::ELSE:
+		return "else";
+	case TokenTag::WHILE:
+		return "while";
+	case TokenTag::RETURN:
+		return "return";
+	case TokenTag::ID:
+		{
+		LILC::IDToken * tok = (LILC::IDToken *)lexeme.symbolValue;
+		return "ID:" + tok->value();
+		}
+	case TokenTag::INTLITERAL:
+		{
+		LILC::IntLitToken * tok = (LILC::IntLitToken *)lexeme.symbolValue;
+		return "INTLIT:" + std::to_string(tok->value());
+		}
+	case TokenTag::STRINGLITERAL:
+		{
+		LILC::StringLitToken * tok = (LILC::StringLitToken *)lexeme.symbolValue;
+		return "STRINGLIT:" + tok->value();
+		}
+	case TokenTag::LCURLY:
+		return "{";
+	case TokenTag::RCURLY:
+		return "}";
+	case TokenTag::LPAREN:
+		return "(";
+	case TokenTag::RPAREN:
+		return ")";
+	case TokenTag::SEMICOLON:
+		return ";";
+	case TokenTag::COMMA:
+		return ",";
+	case TokenTag::DOT:
+		return ".";
+	case TokenTag::WRITE:
+		return "<<";
+	case TokenTag::READ:
+		return ">>";
+	case TokenTag::PLUSPLUS:
+		return "++";
+	case TokenTag::MINUSMINUS:
+		return "--";
+	case TokenTag::PLUS:
+		return "+";
+	case TokenTag::MINUS:
+		return "-";
+	case TokenTag::TIMES:
+		return "*";
+	case TokenTag::DIVIDE:
+		return "/";
+	case TokenTag::NOT:
+		return "!";
+	case TokenTag::AND:
+		return "&&";
+	case TokenTag::OR:
+		return "||";
+	case TokenTag::EQUALS:
+		return "==";
+	case TokenTag::NOTEQUALS:
+		return "!=";
+	case TokenTag::LESS:
+		return "<";
+	case TokenTag::GREATER:
+		return ">";
+	case TokenTag::LESSEQ:
+		return ">=";
+	case TokenTag::GREATEREQ:
+		return ">=";
+	case TokenTag::ASSIGN:
+		return "=";
+	default:
+		return "UNKNOWN TOKEN";
+}
+}
 
+// scanText hands out copies, so the scanner's token objects go as soon
+// as they are read
+static void deleteToken( int tag, Lexeme& lexeme )
+{
+   switch (tag){
+	case TokenTag::ID:
+		delete (LILC::IDToken *)lexeme.symbolValue;
+		break;
+	case TokenTag::INTLITERAL:
+		delete (LILC::IntLitToken *)lexeme.symbolValue;
+		break;
+	case TokenTag::STRINGLITERAL:
+		delete (LILC::StringLitToken *)lexeme.symbolValue;
+		break;
+	default:
+		delete (LILC::NullaryToken *)lexeme.symbolValue;
+		break;
+   }
+}
+
+bool LILC::LilC_Compiler::scan( const char * const filename,
+const char * outfile )
+{
+   std::string contents;
+   if (!readFile( filename, contents )){
+      return false;
+   }
+   std::vector<Token> tokens;
+   bool ok = scanText( contents.data(), contents.size(), tokens );
    std::ofstream out(outfile);
+   for (const Token& token : tokens){
+      out << token.text << "\n";
+   }
+   return ok;
+}
+
+bool LILC::LilC_Compiler::scanText( const char * text, size_t size,
+std::vector<Token>& tokens )
+{
+   std::istringstream inStream( std::string(text, size) );
+
+   delete(scanner);
+   scanner = new LILC::LilC_Scanner( &inStream, &diagnostics );
+
+   PhaseScope scope(stats, CompilerStats::SCAN);
+   size_t errorsBefore = diagnostics.errors();
+   tokens.clear();
    Lexeme lexeme;
    int tokenTag;
-   while(true){
-   	tokenTag = scanner->yylex(&lexeme);
-	switch (tokenTag){
-		case TokenTag::END:
-			out << "EOF" << std::endl;
-			return;
-		case TokenTag::BOOL:
-			out << "bool" << std::endl;
-			break;
-		case TokenTag::INT:
-			out << "int" << std::endl;
-			break;
-		case TokenTag::VOID:
-			out << "void" << std::endl;
-			break;
-		case TokenTag::TRUE:
-			out << "true" << std::endl;
-			break;
-		case TokenTag::FALSE:
-			out << "false" << std::endl;
-			break;
-		case TokenTag::STRUCT:
-			out << "struct" << std::endl;
-			break;
-		case TokenTag::INPUT:
-			out << "input" << std::endl;
-			break;
-		case TokenTag::OUTPUT:
-			out << "output" << std::endl;
-			break;
-		case TokenTag::IF:
-			out << "if" << std::endl;
-			break;
-		case TokenTag::ELSE:
-			out << "else" << std::endl;
-			break;
-		case TokenTag::WHILE:
-			out << "while" << std::endl;
-			break;
-		case TokenTag::RETURN:
-			out << "return" << std::endl;
-			break;
-		case TokenTag::ID:
-			{
-			IDToken * tok = (IDToken *)lexeme.symbolValue;
-			out << "ID:" << tok->value() << std::endl;
-			break;
-			}
-		case TokenTag::INTLITERAL:
-			{
-			IntLitToken * tok = (IntLitToken *)lexeme.symbolValue;
-			out << "INTLIT:" << tok->value() << std::endl;	
-			break;
-			}
-		case TokenTag::STRINGLITERAL:
-			{
-			StringLitToken * tok = (StringLitToken *)lexeme.symbolValue;
-			out << "STRINGLIT:" << tok->value() << std::endl;	
-			break;
-			}
-		case TokenTag::LCURLY:
-			out << "{" << std::endl;
-			break;
-		case TokenTag::RCURLY:
-			out << "}" << std::endl;
-			break;
-		case TokenTag::LPAREN:
-			out << "(" << std::endl;
-			break;
-		case TokenTag::RPAREN:
-			out << ")" << std::endl;
-			break;
-		case TokenTag::SEMICOLON:
-			out << ";" << std::endl;
-			break;
-		case TokenTag::COMMA:
-			out << "," << std::endl;
-			break;
-		case TokenTag::DOT:
-			out << "." << std::endl;
-			break;
-		case TokenTag::WRITE:
-			out << "<<" << std::endl;
-			break;
-		case TokenTag::READ:
-			out << ">>" << std::endl;
-			break;
-		case TokenTag::PLUSPLUS:
-			out << "++" << std::endl;
-			break;
-		case TokenTag::MINUSMINUS:
-			out << "--" << std::endl;
-			break;
-		case TokenTag::PLUS:
-			out << "+" << std::endl;
-			break;
-		case TokenTag::MINUS:
-			out << "-" << std::endl;
-			break;
-		case TokenTag::TIMES:
-			out << "*" << std::endl;
-			break;
-		case TokenTag::DIVIDE:
-			out << "/" << std::endl;
-			break;
-		case TokenTag::NOT:
-			out << "!" << std::endl;
-			break;
-		case TokenTag::AND:
-			out << "&&" << std::endl;
-			break;
-		case TokenTag::OR:
-			out << "||" << std::endl;
-			break;
-		case TokenTag::EQUALS:
-			out << "==" << std::endl;
-			break;
-		case TokenTag::NOTEQUALS:
-			out << "!=" << std::endl;
-			break;
-		case TokenTag::LESS:
-			out << "<" << std::endl;
-			break;
-		case TokenTag::GREATER:
-			out << ">" << std::endl;
-			break;
-		case TokenTag::LESSEQ:
-			out << ">=" << std::endl;
-			break;
-		case TokenTag::GREATEREQ:
-			out << ">=" << std::endl;
-			break;
-		case TokenTag::ASSIGN:
-			out << "=" << std::endl;
-			break;
-		default:
-			out << "UNKNOWN TOKEN" << std::endl;
-			break;
+   do {
+	lexeme.symbolValue = nullptr;
+	tokenTag = scanner->yylex(&lexeme);
+	if (stats != nullptr){
+		stats->countToken(tokenTag);
 	}
-   }
+	Token token;
+	token.tag = tokenTag;
+	token.line = lexeme.symbolValue == nullptr ? 0 : lexeme.symbolValue->line;
+	token.column = lexeme.symbolValue == nullptr ? 0 : lexeme.symbolValue->column;
+	token.text = tokenText( tokenTag, lexeme );
+	tokens.push_back( std::move(token) );
+	deleteToken( tokenTag, lexeme );
+   } while (tokenTag != TokenTag::END);
+   delete(scanner);
+   scanner = nullptr;
+   flushDiagnostics();
+   return diagnostics.errors() == errorsBefore;
 }
 
-void 
+bool
 LILC::LilC_Compiler::parse( const char * const filename, const char * const outfile )
+{
+   bool ok = parse( filename );
+   std::ofstream out(outfile);
+   ok = unparse( out ) && ok;
+   out.flush();
+   return ok;
+}
+
+bool
+LILC::LilC_Compiler::parse( const char * const filename )
 {
    assert( filename != nullptr );
-   std::ifstream in_stream( filename );
-   if( ! in_stream.good() )
-   {
-       exit( EXIT_FAILURE );
+   std::string contents;
+   if (!readFile( filename, contents )){
+      return false;
    }
-   std::ofstream out(outfile);
+   return parseContents( contents );
+}
+
+bool
+LILC::LilC_Compiler::parseText( const char * text, size_t size )
+{
+   std::string contents( text, size );
+   return parseContents( contents );
+}
+
+bool
+LILC::LilC_Compiler::parseContents( std::string& contents )
+{
+   std::istringstream in_stream( contents );
    
    delete(scanner);
-   scanner = new LILC::LilC_Scanner( &in_stream );
+   scanner = new LILC::LilC_Scanner( &in_stream, &diagnostics );
    delete(parser); 
+   parser = nullptr;
    delete(astRoot);
-   try
+   astRoot = nullptr;
+   lazySource = nullptr;
+   const int accept( 0 );
+   int result;
+   if( engine == DESCENT || lazy )
    {
-      parser = new LILC::LilC_Parser( (*scanner) /* scanner */, 
-                                  (*this) /* compiler */ );
+      LILC::LilC_RDParser descent( (*scanner) /* scanner */,
+                                   this /* compiler */ );
+      if( lazy )
+      {
+         lazySource = std::make_shared<LazySource>();
+         lazySource->text = std::move( contents );
+         lazySource->diagnostics = &diagnostics;
+         descent.setLazy( lazySource );
+      }
+      PhaseScope scope(stats, CompilerStats::PARSE);
+      result = descent.parse();
    }
-   catch( std::bad_alloc &ba )
+   else
    {
-      std::cerr << "Failed to allocate parser: (" << 
-         ba.what() << "), exiting!!\n";
-      exit( EXIT_FAILURE );
+      try
+      {
+         parser = new LILC::LilC_Parser( (*scanner) /* scanner */, 
+                                     (*this) /* compiler */ );
+      }
+      catch( std::bad_alloc &ba )
+      {
+         *errors << "Failed to allocate parser: (" <<
+            ba.what() << ")\n";
+         return false;
+      }
+      PhaseScope scope(stats, CompilerStats::PARSE);
+      result = parser->parse();
    }
-   const int accept( 0 );
-   if( parser->parse() != accept )
+   flushDiagnostics();
+   if( result != accept )
    {
-      std::cerr << "Parse failed!!\n";
+      *errors << "Parse failed!!\n";
+   }
+   if (stats != nullptr && astRoot != nullptr){
+      astRoot->collectStats(*stats);
+   }
+   return result == accept;
+}
+
+bool
+LILC::LilC_Compiler::unparse( std::ostream& out )
+{
+   if (astRoot == nullptr){
+      return false;
+   }
+   PhaseScope scope(stats, CompilerStats::UNPARSE);
+   if (lazySource == nullptr){
+      astRoot->unparse(out, 0);
+      return true;
+   }
+   // Bodies still unbuilt are parsed on the way, so nothing is written
+   // until they are known to be good
+   size_t errorsBefore = lazyBodyErrors();
+   std::ostringstream text;
+   astRoot->unparse(text, 0);
+   flushDiagnostics();
+   if (lazyBodyErrors() != errorsBefore){
+      *errors << "Parse failed!!\n";
+      return false;
+   }
+   out << text.str();
+   return true;
+}
+
+void
+LILC::LilC_Compiler::addImport( ProgramNode * iface )
+{
+   astRoot->getDeclList()->addImported( iface->getDeclList()->getDecls() );
+}
+
+void
+LILC::LilC_Compiler::dropImports()
+{
+   astRoot->getDeclList()->dropImported();
+}
+
+void
+LILC::LilC_Compiler::writeInterface( std::ostream& out )
+{
+   PhaseScope scope(stats, CompilerStats::UNPARSE);
+   for (DeclNode * decl : astRoot->getDeclList()->getDecls()){
+      decl->unparseInterface(out);
+   }
+}
+
+bool
+LILC::LilC_Compiler::nameAnalysis()
+{
+   if (astRoot == nullptr){
+      return false;
+   }
+   PhaseScope scope(stats, CompilerStats::NAMES);
+   SymbolTable symTab;
+   symTab.setErrorStream(*errors);
+   bool ok = astRoot->nameAnalysis(&symTab);
+   flushDiagnostics();
+   return ok && lazyBodyErrors() == 0;
+}
+
+void
+LILC::LilC_Compiler::flushDiagnostics()
+{
+   if (diagnostics.getFormat() == Diagnostics::TEXT && diagnostics.pending()){
+      diagnostics.emit(*errors);
+   }
+}
+
+size_t
+LILC::LilC_Compiler::lazyBodyErrors()
+{
+   return lazySource == nullptr ? 0 : lazySource->errors.load();
+}
+
+bool
+LILC::LilC_Compiler::typeCheck( size_t jobs )
+{
+   if (astRoot == nullptr){
+      return false;
+   }
+   PhaseScope scope(stats, CompilerStats::TYPES);
+   TypeChecker checker(jobs);
+   return checker.check(astRoot, *errors);
+}
+
+size_t
+LILC::LilC_Compiler::inlineCalls( size_t threshold )
+{
+   if (astRoot == nullptr){
+      return 0;
+   }
+   PhaseScope scope(stats, CompilerStats::INLINE);
+   Inliner inliner(threshold);
+   inliner.run(astRoot);
+   if (stats != nullptr){
+      stats->countPass("inline: calls inlined", inliner.inlined());
+      stats->countPass("inline: nodes before", inliner.nodesBefore());
+      stats->countPass("inline: nodes after", inliner.nodesAfter());
+   }
+   return inliner.inlined();
+}
+
+size_t
+LILC::LilC_Compiler::fold()
+{
+   if (astRoot == nullptr){
+      return 0;
+   }
+   PhaseScope scope(stats, CompilerStats::FOLD);
+   Folder folder;
+   astRoot->fold(&folder);
+   if (stats != nullptr){
+      stats->countPass("fold: nodes eliminated", folder.eliminated());
+   }
+   return folder.eliminated();
+}
+
+size_t
+LILC::LilC_Compiler::optimizeLoops( size_t factor )
+{
+   if (astRoot == nullptr){
+      return 0;
+   }
+   PhaseScope scope(stats, CompilerStats::LOOPS);
+   LoopOptimizer loops( factor );
+   loops.run(astRoot);
+   if (stats != nullptr){
+      stats->countPass("loops: counter loops", loops.counterLoops());
+      stats->countPass("loops: fully unrolled", loops.fullyUnrolled());
+      stats->countPass("loops: unrolled", loops.unrolled());
+      stats->countPass("loops: products reduced", loops.reduced());
+   }
+   return loops.fullyUnrolled() + loops.unrolled();
+}
+
+size_t
+LILC::LilC_Compiler::eliminateTailCalls()
+{
+   if (astRoot == nullptr){
+      return 0;
+   }
+   PhaseScope scope(stats, CompilerStats::TAILS);
+   TailCallEliminator tails;
+   tails.run(astRoot);
+   if (stats != nullptr){
+      stats->countPass("tce: self tail calls", tails.selfCalls());
+      stats->countPass("tce: other tail calls", tails.otherCalls());
+      stats->countPass("tce: calls made jumps", tails.jumps());
+      stats->countPass("tce: functions looped", tails.looped());
+   }
+   return tails.jumps();
+}
+
+size_t
+LILC::LilC_Compiler::eliminateDeadCode()
+{
+   if (astRoot == nullptr){
+      return 0;
+   }
+   PhaseScope scope(stats, CompilerStats::DCE);
+   DeadCodeEliminator dce;
+   dce.run(astRoot);
+   if (stats != nullptr){
+      stats->countPass("dce: dead statements", dce.statements());
+      stats->countPass("dce: dead blocks", dce.blocks());
+      stats->countPass("dce: dead functions", dce.functions());
+      stats->countPass("dce: nodes removed", dce.nodes());
+   }
+   return dce.nodes();
+}
+
+size_t
+LILC::LilC_Compiler::eliminateDeadStores()
+{
+   if (astRoot == nullptr){
+      return 0;
+   }
+   PhaseScope scope(stats, CompilerStats::DATAFLOW);
+   DeadStoreEliminator dse;
+   dse.run(astRoot);
+   if (stats != nullptr){
+      stats->countPass("dse: stores removed", dse.stores());
+      stats->countPass("dse: rounds", dse.rounds());
+      stats->countPass("dse: block visits", dse.visits());
+   }
+   return dse.stores();
+}
+
+size_t
+LILC::LilC_Compiler::warnUninitialized()
+{
+   if (astRoot == nullptr){
+      return 0;
+   }
+   PhaseScope scope(stats, CompilerStats::DATAFLOW);
+   UninitChecker checker(&diagnostics);
+   checker.run(astRoot);
+   flushDiagnostics();
+   if (stats != nullptr){
+      stats->countPass("uninit: warnings", checker.warnings());
+      stats->countPass("uninit: block visits", checker.visits());
+   }
+   return checker.warnings();
+}
+
+bool
+LILC::LilC_Compiler::run()
+{
+   if (astRoot == nullptr){
+      return false;
+   }
+   PhaseScope scope(stats, CompilerStats::RUN);
+   RuntimeIO io(stdin, stdout);
+   Interpreter interp(&io);
+   bool ok = interp.run(astRoot, *errors);
+   if (stats != nullptr){
+      stats->countPass("run: calls", interp.getCalls());
+   }
+   return ok;
+}
+
+bool
+LILC::LilC_Compiler::lowerIR()
+{
+   if (astRoot == nullptr){
+      return false;
+   }
+   PhaseScope scope(stats, CompilerStats::IR);
+   delete(ir);
+   ir = new IRProgram();
+   astRoot->lowerIR(ir);
+   if (ir->failed()){
+      delete(ir);
+      ir = nullptr;
+      return false;
+   }
+   if (stats != nullptr){
+      stats->countPass("ir: instructions", ir->instructionCount());
+   }
+   return true;
+}
+
+void
+LILC::LilC_Compiler::optimizeIR()
+{
+   if (ir == nullptr){
+      return;
+   }
+   PhaseScope scope(stats, CompilerStats::IR);
+   IROptimizer optimizer;
+   for (auto& fn : ir->functions()){
+      optimizer.run(fn.get());
+   }
+   if (stats != nullptr){
+      stats->countPass("ir: copies propagated", optimizer.copies);
+      stats->countPass("ir: constants propagated", optimizer.constants);
+      stats->countPass("ir: branches decided", optimizer.branches);
+      stats->countPass("ir: values numbered", optimizer.numbered);
+      stats->countPass("ir: invariants hoisted", optimizer.hoisted);
+      stats->countPass("ir: dead instructions", optimizer.dead);
+      stats->countPass("ir: blocks removed", optimizer.blocks);
+      stats->countPass("ir: instructions after", ir->instructionCount());
+   }
+}
+
+void
+LILC::LilC_Compiler::dumpIR( std::ostream& out )
+{
+   if (ir != nullptr){
+      ir->dump(out);
+   }
+}
+
+bool
+LILC::LilC_Compiler::lowerBytecode()
+{
+   if (astRoot == nullptr){
+      return false;
+   }
+   PhaseScope scope(stats, CompilerStats::BYTECODE);
+   delete(bytecode);
+   bytecode = new BytecodeProgram();
+   BytecodeGen gen(bytecode);
+   gen.useIR(ir);
+   astRoot->compile(&gen);
+   if (stats != nullptr){
+      stats->countPass("bytecode: instructions", bytecode->codeSize());
+   }
+   return !gen.failed();
+}
+
+void
+LILC::LilC_Compiler::disassemble( std::ostream& out )
+{
+   if (bytecode != nullptr){
+      bytecode->disassemble(out);
+   }
+}
+
+bool
+LILC::LilC_Compiler::runBytecode()
+{
+   if (bytecode == nullptr){
+      return false;
+   }
+   PhaseScope scope(stats, CompilerStats::RUN);
+   RuntimeIO io(stdin, stdout);
+   VM vm(&io);
+   auto start = std::chrono::steady_clock::now();
+   bool ok = vm.run(*bytecode, *errors);
+   std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+   if (stats != nullptr){
+      stats->countPass("vm: calls", vm.getCalls());
+      stats->countPass("vm: instructions", vm.getInstructions());
+      if (elapsed.count() > 0){
+         stats->countPass("vm: instructions/s",
+            vm.getInstructions() / elapsed.count());
+      }
+   }
+   return ok;
+}
+
+bool
+LILC::LilC_Compiler::runJit()
+{
+   if (bytecode == nullptr){
+      return false;
+   }
+   PhaseScope scope(stats, CompilerStats::RUN);
+   RuntimeIO io(stdin, stdout);
+   JIT jit(&io);
+   bool ok = jit.run(*bytecode, *errors);
+   if (stats != nullptr){
+      stats->countPass("jit: calls", jit.getCalls());
+      stats->countPass("jit: code bytes", jit.getCodeBytes());
+   }
+   return ok;
+}
+
+bool
+LILC::LilC_Compiler::emitAsm( std::ostream& out )
+{
+   if (astRoot == nullptr){
+      return false;
+   }
+   PhaseScope scope(stats, CompilerStats::CODEGEN);
+   AsmGen gen(out);
+   astRoot->genAsm(&gen);
+   if (stats != nullptr){
+      stats->countPass("codegen: instructions", gen.getInstructions());
    }
-   this->astRoot->unparse(out, 0);
-   return;
+   return !gen.failed();
 }
@@ -4,16 +4,39 @@
 #include <string>
 #include <cstddef>
 #include <istream>
+#include <memory>
+#include <iostream>
+#include <vector>
 
 #include "lilc_scanner.hpp"
 #include "symbols.hpp"
 #include "ast.hpp"
 #include "grammar.hh"
+#include "lilc_stats.hpp"
+#include "lilc_diagnostics.hpp"
 
 namespace LILC{
 
+struct BytecodeProgram;
+class IRProgram;
+struct LazySource;
+
+// One token of LilC_Compiler::scanText: its tag (LilC_Parser::token),
+// where it starts, and how the scanner's token dump spells it, e.g.
+// "ID:count", "INTLIT:3" or "<<"
+struct Token {
+   int tag;
+   size_t line;
+   size_t column;
+   std::string text;
+};
+
 class LilC_Compiler{
 public:
+   // Which parser parse() builds the AST with: the bison LALR parser from
+   // lilc.yy or the hand-written one in lilc_rdparser.hpp
+   enum ParserEngine { BISON, DESCENT };
+
    LilC_Compiler() = default;
 
    virtual ~LilC_Compiler();
@@ -21,12 +44,134 @@ public:
    void setASTRoot(ProgramNode * root){ this->astRoot = root; }
    ProgramNode * getASTRoot(){ return this->astRoot; }
 
-   void scan( const char * const filename, const char * outfile);
-   void parse( const char * const filename, const char * outfile );
+   void setParserEngine( ParserEngine engine ){ this->engine = engine; }
+   // Makes parse() only brace-match function bodies and build them the
+   // first time something asks for them (see lilc_rdparser.hpp). Uses the
+   // DESCENT engine, whichever is set.
+   void setLazyBodies( bool lazy ){ this->lazy = lazy; }
+   // Syntax errors found so far in lazily parsed bodies
+   size_t lazyBodyErrors();
+
+   // The file entry points return false, with a message on the error
+   // stream, when filename cannot be read or has errors
+   bool scan( const char * const filename, const char * outfile);
+   bool parse( const char * const filename, const char * outfile );
+   // Builds the AST for filename without unparsing it
+   bool parse( const char * const filename );
+   // In-memory counterparts for embedding (lilc_api.hpp): the tokens of
+   // text, up to and including END, into tokens (cleared first), and the
+   // AST of text. Both return false if text has errors.
+   bool scanText( const char * text, size_t size, std::vector<Token>& tokens );
+   bool parseText( const char * text, size_t size );
+   // Returns false, writing nothing, if a lazily parsed body it builds
+   // has syntax errors; they are reported as parse() reports its own
+   bool unparse( std::ostream& out );
+   // Module imports (lilc_modules.hpp): puts the declarations of another
+   // module's parsed interface in scope ahead of this file's own, for
+   // name analysis and type checking, then takes them out again
+   void addImport( ProgramNode * iface );
+   void dropImports();
+   // Writes what importing modules see of this one: its structs, globals
+   // and function signatures with empty bodies
+   void writeInterface( std::ostream& out );
+   // Links every name in the AST to its declaration. Errors go to cerr;
+   // returns false if there were any, including syntax errors in lazily
+   // parsed bodies, which this is the first to touch.
+   bool nameAnalysis();
+   // Type checks a name-analysed AST, checking function bodies on up to
+   // `jobs` threads. Errors go to cerr in source order.
+   bool typeCheck( size_t jobs );
+   // Replaces calls to small non-recursive functions of a type-checked
+   // AST by their bodies (inline.hpp). Returns the number of calls.
+   size_t inlineCalls( size_t threshold );
+   // Constant folding and algebraic simplification of a type-checked
+   // AST (fold.hpp). Returns the number of nodes eliminated.
+   size_t fold();
+   // Strength reduction and unrolling of counter loops in a type-checked
+   // AST, repeating bodies `factor` times (loops.hpp). Returns the number
+   // of loops unrolled.
+   size_t optimizeLoops( size_t factor );
+   // Marks the tail calls of a type-checked AST and turns the self tail
+   // calls of each function into a loop (tailcall.hpp). Returns the
+   // number of calls that became jumps.
+   size_t eliminateTailCalls();
+   // Removes unreachable statements, blocks that can never run and
+   // functions main cannot call from a type-checked AST (deadcode.hpp).
+   // Returns the number of nodes removed.
+   size_t eliminateDeadCode();
+   // Removes assignments, ++ and -- of locals whose value is never read
+   // again from a type-checked AST (deadstore.hpp). Returns the number of
+   // statements removed.
+   size_t eliminateDeadStores();
+   // Warns about locals of a type-checked AST that may be read before
+   // they are assigned (uninit.hpp). Returns the number of warnings.
+   size_t warnUninitialized();
+   // Runs a type-checked program from main, reading stdin and writing
+   // stdout (interp.hpp). Returns false if it stopped on a runtime error.
+   bool run();
+   // Lowers every function of a type-checked AST to SSA form (ir.hpp).
+   // Returns false, keeping no SSA form, if part of the program cannot
+   // be lowered.
+   bool lowerIR();
+   // Runs the SSA optimization pipeline over the lowered functions
+   void optimizeIR();
+   void dumpIR( std::ostream& out );
+   // Lowers a type-checked AST to register bytecode (bytecode.hpp), from
+   // the SSA form if it was built. Returns false if part of the program
+   // cannot be lowered.
+   bool lowerBytecode();
+   void disassemble( std::ostream& out );
+   // Runs the lowered program on the bytecode VM (vm.hpp), like run()
+   bool runBytecode();
+   // Compiles the lowered program to x86-64 and runs it (jit.hpp), like
+   // run(). Fails on platforms the JIT does not support.
+   bool runJit();
+   // Writes x86-64 assembly for the type-checked AST (asm.hpp). Returns
+   // false if part of the program cannot be compiled.
+   bool emitAsm( std::ostream& out );
+
+   // Warnings and errors from the scanner and parsers (see
+   // lilc_diagnostics.hpp). In TEXT format they are written to cerr in a
+   // batch at the end of scan(), parse() and nameAnalysis(); in JSON
+   // format they are kept until emitDiagnostics().
+   Diagnostics * getDiagnostics(){ return &diagnostics; }
+   // Where scan/parse/name/type/runtime errors are written; cerr unless
+   // set. Each compiler has its own, so compilers on different threads
+   // can report into different buffers.
+   void setErrorStream( std::ostream& out ){ this->errors = &out; }
+   std::ostream& getErrorStream(){ return *this->errors; }
+   void emitDiagnostics( std::ostream& out ){ diagnostics.emit(out); }
+
+   // Starts collecting per-phase timings and counters (see lilc_stats.hpp)
+   void enableStats();
+   CompilerStats * getStats(){ return this->stats; }
+
+   // Token source for the parser. Counts tokens and charges the time to
+   // the scan phase when stats are enabled.
+   int lex( LILC::LilC_Parser::semantic_type * const lval ){
+      if (stats == nullptr){ return scanner->yylex(lval); }
+      PhaseScope scope(stats, CompilerStats::SCAN, true);
+      int tag = scanner->yylex(lval);
+      stats->countToken(tag);
+      return tag;
+   }
 private:
+   bool readFile( const char * const filename, std::string& contents );
+   // Lazy parsing keeps contents, so it may be moved from
+   bool parseContents( std::string& contents );
+   void flushDiagnostics();
+
    LILC::LilC_Parser  *parser  = nullptr;
    LILC::LilC_Scanner *scanner = nullptr;
    ProgramNode * astRoot = nullptr;
+   IRProgram * ir = nullptr;
+   BytecodeProgram * bytecode = nullptr;
+   CompilerStats * stats = nullptr;
+   ParserEngine engine = BISON;
+   bool lazy = false;
+   std::shared_ptr<LazySource> lazySource;
+   Diagnostics diagnostics;
+   std::ostream * errors = &std::cerr;
 };
 
 } /* end namespace */
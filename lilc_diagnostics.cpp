@@ -0,0 +1,127 @@
+#include <sstream>
+
+#include "lilc_diagnostics.hpp"
+
+namespace LILC{
+
+void Diagnostics::report(Severity severity, Code code, size_t line,
+	size_t column, size_t offset, const std::string& arg){
+	std::lock_guard<std::mutex> guard(myLock);
+	if (severity == ERROR){
+		myErrors++;
+	} else {
+		myWarnings++;
+	}
+	if (!myRecords.empty()){
+		Record& last = myRecords.back();
+		if (last.severity == severity && last.code == code && last.arg == arg){
+			last.count++;
+			return;
+		}
+	}
+	if (myLimit != 0 && myRecords.size() >= myLimit){
+		mySuppressed++;
+		return;
+	}
+	myRecords.push_back({ severity, code, line, column, offset, arg, 1 });
+}
+
+std::string Diagnostics::message(Code code, const std::string& arg){
+	switch (code){
+		case ILLEGAL_CHARACTER:
+			return "Illegal character " + arg;
+		case UNTERMINATED_STRING:
+			return "unterminated string literal ignored";
+		case BAD_ESCAPE:
+			return "string literal with bad escaped character ignored";
+		case UNTERMINATED_BAD_ESCAPE:
+			return "unterminated string literal with bad"
+				"escaped character ignored";
+		case INT_TOO_LARGE:
+			return "Integer literal too large; using max value";
+		case SYNTAX_ERROR:
+			return arg;
+		case UNINITIALIZED_USE:
+			return "Variable " + arg + " may be used before it is assigned";
+		default:
+			return "";
+	}
+}
+
+const char * Diagnostics::codeName(Code code){
+	static const char * names[] = {
+		"illegal-character",
+		"unterminated-string",
+		"bad-escape",
+		"unterminated-bad-escape",
+		"int-too-large",
+		"syntax-error",
+		"uninitialized-use",
+	};
+	return code < NUM_CODES ? names[code] : "unknown";
+}
+
+static void jsonString(std::ostream& out, const std::string& text){
+	out << '"';
+	for (char c : text){
+		unsigned char u = (unsigned char)c;
+		if (c == '"' || c == '\\'){
+			out << '\\' << c;
+		} else if (u < 0x20 || u >= 0x7f){
+			// Offending bytes of a binary input are not valid UTF-8
+			static const char hex[] = "0123456789abcdef";
+			out << "\\u00" << hex[u >> 4] << hex[u & 0xf];
+		} else {
+			out << c;
+		}
+	}
+	out << '"';
+}
+
+void Diagnostics::emit(std::ostream& out){
+	std::lock_guard<std::mutex> guard(myLock);
+	// Formatted whole first: unbuffered streams such as cerr would
+	// otherwise write every piece on its own
+	std::ostringstream text;
+	if (myFormat == JSON){
+		text << "{\n  \"diagnostics\": [";
+		for (size_t i = 0; i < myRecords.size(); i++){
+			Record& rec = myRecords[i];
+			text << (i == 0 ? "\n" : ",\n") << "    {\"severity\": \""
+			     << (rec.severity == ERROR ? "error" : "warning")
+			     << "\", \"code\": \"" << codeName(rec.code)
+			     << "\", \"line\": " << rec.line
+			     << ", \"column\": " << rec.column
+			     << ", \"offset\": " << rec.offset
+			     << ", \"args\": [";
+			if (!rec.arg.empty()){
+				jsonString(text, rec.arg);
+			}
+			text << "], \"count\": " << rec.count << ", \"message\": ";
+			jsonString(text, message(rec.code, rec.arg));
+			text << "}";
+		}
+		text << "\n  ],\n  \"suppressed\": " << mySuppressed << "\n}\n";
+	} else {
+		for (Record& rec : myRecords){
+			text << rec.line << ":" << rec.column
+			     << (rec.severity == ERROR ? " ***ERROR*** " : " ***WARNING*** ")
+			     << message(rec.code, rec.arg);
+			if (rec.count > 1){
+				text << " (" << rec.count << " times)";
+			}
+			text << "\n";
+		}
+		if (mySuppressed != 0){
+			text << mySuppressed << " more diagnostics not shown (limit "
+			     << myLimit << ")\n";
+		}
+	}
+	const std::string& batch = text.str();
+	out.write(batch.data(), batch.size());
+	out.flush();
+	myRecords.clear();
+	mySuppressed = 0;
+}
+
+} /* end namespace */
@@ -0,0 +1,81 @@
+#ifndef __LILC_DIAGNOSTICS_HPP__
+#define __LILC_DIAGNOSTICS_HPP__ 1
+
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace LILC{
+
+// Buffer for the scanner's and parsers' warnings and errors, and for the
+// uninitialized-use warnings (uninit.hpp). Reports are stored as records
+// rather than written as they happen, so a broken input costs one write
+// per batch instead of a flush per message:
+//  - a report identical to the one before it (same severity, code and
+//    argument) only bumps that record's count;
+//  - past `limit` records, further reports are counted but not kept;
+//  - emit() writes the pending records as text or JSON in one go.
+class Diagnostics{
+public:
+	enum Severity { WARNING, ERROR };
+	enum Code {
+		ILLEGAL_CHARACTER,
+		UNTERMINATED_STRING,
+		BAD_ESCAPE,
+		UNTERMINATED_BAD_ESCAPE,
+		INT_TOO_LARGE,
+		SYNTAX_ERROR,
+		UNINITIALIZED_USE,
+		NUM_CODES
+	};
+	enum Format { TEXT, JSON };
+
+	static const size_t DEFAULT_LIMIT = 100;
+
+	struct Record {
+		Severity severity;
+		Code code;
+		// Of the first occurrence; line and column count from 1
+		size_t line;
+		size_t column;
+		size_t offset;
+		std::string arg;
+		size_t count;
+	};
+
+	// A limit of 0 keeps every record
+	Diagnostics(size_t limit = DEFAULT_LIMIT){ myLimit = limit; }
+
+	void setLimit(size_t limit){ myLimit = limit; }
+	void setFormat(Format format){ myFormat = format; }
+	Format getFormat(){ return myFormat; }
+
+	void report(Severity severity, Code code, size_t line, size_t column,
+		size_t offset, const std::string& arg = "");
+
+	// Reports so far, kept or not, emitted or not
+	size_t errors(){ return myErrors; }
+	size_t warnings(){ return myWarnings; }
+	bool pending(){ return !myRecords.empty() || mySuppressed != 0; }
+
+	// Writes the records since the last emit in the set format, then
+	// forgets them
+	void emit(std::ostream& out);
+
+	// The text a record stands for, e.g. "Illegal character @"
+	static std::string message(Code code, const std::string& arg);
+	static const char * codeName(Code code);
+private:
+	std::mutex myLock;
+	std::vector<Record> myRecords;
+	size_t myLimit;
+	size_t mySuppressed = 0;
+	size_t myErrors = 0;
+	size_t myWarnings = 0;
+	Format myFormat = TEXT;
+};
+
+} /* end namespace */
+#endif /* END __LILC_DIAGNOSTICS_HPP__ */
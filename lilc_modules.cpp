@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <sys/stat.h>
+
+#include "lilc_modules.hpp"
+#include "lilc_compiler.hpp"
+#include "lilc_parallel.hpp"
+
+namespace LILC{
+
+// FNV-1a: stable across runs and builds, unlike std::hash
+static uint64_t hashText(const std::string& text){
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (char c : text){
+		hash ^= (unsigned char)c;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static std::string hex(uint64_t value, int digits = 16){
+	std::ostringstream out;
+	out.width(digits);
+	out.fill('0');
+	out << std::hex << value;
+	std::string text = out.str();
+	return text.substr(text.size() - digits);
+}
+
+static bool readText(const std::string& path, std::string& text){
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	if (!in.good()){
+		return false;
+	}
+	std::ostringstream buffer;
+	buffer << in.rdbuf();
+	text = buffer.str();
+	return true;
+}
+
+static std::string dirName(const std::string& path){
+	size_t slash = path.find_last_of('/');
+	if (slash == std::string::npos){
+		return ".";
+	}
+	return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+static bool canonical(const std::string& path, std::string& result){
+	char buffer[PATH_MAX];
+	if (realpath(path.c_str(), buffer) == nullptr){
+		return false;
+	}
+	result = buffer;
+	return true;
+}
+
+// The paths of the #import lines of a file, in order
+static std::vector<std::string> importsOf(const std::string& text){
+	std::vector<std::string> paths;
+	size_t pos = 0;
+	while (pos < text.size()){
+		size_t end = text.find('\n', pos);
+		if (end == std::string::npos){
+			end = text.size();
+		}
+		size_t at = text.find_first_not_of(" \t", pos);
+		if (at < end && text.compare(at, 7, "#import") == 0){
+			size_t open = text.find_first_not_of(" \t", at + 7);
+			if (open < end && text[open] == '"'){
+				size_t close = text.find('"', open + 1);
+				if (close < end){
+					paths.push_back(text.substr(open + 1, close - open - 1));
+				}
+			}
+		}
+		pos = end + 1;
+	}
+	return paths;
+}
+
+// ModuleGraph
+
+bool ModuleGraph::load(const std::string& root, std::ostream& err){
+	std::string path;
+	if (!canonical(root, path)){
+		err << root << ": cannot read file\n";
+		return false;
+	}
+	myRootDir = dirName(path);
+	bool ok = true;
+	add(path, err, ok);
+	size_t depth = 0;
+	for (size_t level : myLevel){
+		depth = std::max(depth, level + 1);
+	}
+	myLevels.assign(depth, std::vector<size_t>());
+	for (size_t m = 0; m < myModules.size(); m++){
+		myLevels[myLevel[m]].push_back(m);
+	}
+	return ok;
+}
+
+size_t ModuleGraph::add(const std::string& path, std::ostream& err, bool& ok){
+	auto found = myIndex.find(path);
+	if (found != myIndex.end()){
+		return found->second;
+	}
+	std::string text;
+	if (!readText(path, text)){
+		err << path << ": cannot read file\n";
+		ok = false;
+		return SIZE_MAX;
+	}
+	size_t m = myModules.size();
+	myIndex[path] = m;
+	myModules.push_back(Module());
+	myState.push_back(1);
+	myLevel.push_back(0);
+	Module& module = myModules.back();
+	module.path = path;
+	if (path.compare(0, myRootDir.size() + 1, myRootDir + "/") == 0){
+		module.display = path.substr(myRootDir.size() + 1);
+	} else {
+		module.display = path;
+	}
+	std::string stem = path.substr(path.find_last_of('/') + 1);
+	stem = stem.substr(0, stem.find_last_of('.'));
+	module.cacheName = stem + "-" + hex(hashText(path), 8);
+	module.sourceHash = hashText(text);
+
+	for (const std::string& name : importsOf(text)){
+		std::string target;
+		std::string given = name[0] == '/' ? name : dirName(path) + "/" + name;
+		if (!canonical(given, target)){
+			err << myModules[m].display << ": cannot find import \""
+			    << name << "\"\n";
+			ok = false;
+			continue;
+		}
+		size_t i = add(target, err, ok);
+		if (i == SIZE_MAX){
+			continue;
+		}
+		if (myState[i] == 1){
+			err << myModules[m].display << ": import cycle through "
+			    << myModules[i].display << "\n";
+			ok = false;
+			continue;
+		}
+		std::vector<size_t>& imports = myModules[m].imports;
+		if (std::find(imports.begin(), imports.end(), i) == imports.end()){
+			imports.push_back(i);
+			myModules[i].importers.push_back(m);
+			myLevel[m] = std::max(myLevel[m], myLevel[i] + 1);
+		}
+	}
+	myState[m] = 2;
+	return m;
+}
+
+void ModuleGraph::visitImports(size_t m, std::vector<bool>& seen,
+	std::vector<size_t>& order){
+	for (size_t i : myModules[m].imports){
+		if (!seen[i]){
+			seen[i] = true;
+			visitImports(i, seen, order);
+			order.push_back(i);
+		}
+	}
+}
+
+std::vector<size_t> ModuleGraph::importClosure(size_t m){
+	std::vector<bool> seen(myModules.size(), false);
+	std::vector<size_t> order;
+	seen[m] = true;
+	visitImports(m, seen, order);
+	return order;
+}
+
+std::vector<size_t> ModuleGraph::affectedBy(size_t m){
+	std::vector<bool> seen(myModules.size(), false);
+	std::vector<size_t> affected = { m };
+	seen[m] = true;
+	for (size_t next = 0; next < affected.size(); next++){
+		for (size_t importer : myModules[affected[next]].importers){
+			if (!seen[importer]){
+				seen[importer] = true;
+				affected.push_back(importer);
+			}
+		}
+	}
+	return affected;
+}
+
+// ModuleBuilder
+
+std::string ModuleBuilder::cachePath(const ModuleGraph::Module& module,
+	const char * ext){
+	return myCacheDir + "/" + module.cacheName + "." + ext;
+}
+
+// What a module's last build must have been built on to still be good
+std::string ModuleBuilder::stampFor(ModuleGraph& graph, size_t m){
+	const ModuleGraph::Module& module = graph.modules()[m];
+	std::string stamp = "source " + hex(module.sourceHash) + "\n";
+	for (size_t i : graph.importClosure(m)){
+		stamp += "import " + graph.modules()[i].cacheName + " "
+			+ hex(myInterfaceHashes[i]) + "\n";
+	}
+	return stamp;
+}
+
+bool ModuleBuilder::compile(ModuleGraph& graph, size_t m,
+	std::ostream& errors){
+	const ModuleGraph::Module& module = graph.modules()[m];
+	LilC_Compiler compiler;
+	compiler.setErrorStream(errors);
+	if (!compiler.parse(module.path.c_str())){
+		return false;
+	}
+	// Each import's interface is parsed afresh: name analysis writes
+	// into the AST, so builds running side by side cannot share one
+	std::vector<std::unique_ptr<LilC_Compiler>> interfaces;
+	for (size_t i : graph.importClosure(m)){
+		std::unique_ptr<LilC_Compiler> iface(new LilC_Compiler());
+		iface->setErrorStream(errors);
+		std::string path = cachePath(graph.modules()[i], "lilci");
+		if (!iface->parse(path.c_str())){
+			return false;
+		}
+		compiler.addImport(iface->getASTRoot());
+		interfaces.push_back(std::move(iface));
+	}
+	if (!compiler.nameAnalysis() || !compiler.typeCheck(1)){
+		return false;
+	}
+	compiler.dropImports();
+	std::ofstream out(cachePath(module, "out"));
+	compiler.unparse(out);
+	std::ofstream iface(cachePath(module, "lilci"));
+	compiler.writeInterface(iface);
+	return out.good() && iface.good();
+}
+
+bool ModuleBuilder::build(ModuleGraph& graph, std::ostream& log){
+	if (mkdir(myCacheDir.c_str(), 0777) != 0 && errno != EEXIST){
+		log << myCacheDir << ": cannot create cache directory\n";
+		return false;
+	}
+	size_t count = graph.modules().size();
+	myResults.assign(count, SKIPPED);
+	myInterfaceHashes.assign(count, 0);
+	myErrors.assign(count, std::string());
+	for (const std::vector<size_t>& level : graph.levels()){
+		parallelFor(level.size(), myJobs, [&](size_t k){
+			size_t m = level[k];
+			const ModuleGraph::Module& module = graph.modules()[m];
+			for (size_t i : module.imports){
+				if (myResults[i] == FAILED || myResults[i] == SKIPPED){
+					return;
+				}
+			}
+			std::string stamp = stampFor(graph, m);
+			std::string stampPath = cachePath(module, "stamp");
+			std::string old;
+			std::string iface;
+			std::ifstream out(cachePath(module, "out"));
+			if (readText(stampPath, old) && old == stamp && out.good()
+				&& readText(cachePath(module, "lilci"), iface)){
+				myResults[m] = UP_TO_DATE;
+				myInterfaceHashes[m] = hashText(iface);
+				return;
+			}
+			// No stamp while the outputs are being rewritten, so a build
+			// that fails or is cut short is redone next time
+			std::remove(stampPath.c_str());
+			std::ostringstream errors;
+			bool ok = compile(graph, m, errors);
+			myErrors[m] = errors.str();
+			if (!ok || !readText(cachePath(module, "lilci"), iface)){
+				myResults[m] = FAILED;
+				return;
+			}
+			myInterfaceHashes[m] = hashText(iface);
+			std::ofstream(stampPath) << stamp;
+			myResults[m] = COMPILED;
+		});
+	}
+	for (const std::vector<size_t>& level : graph.levels()){
+		for (size_t m : level){
+			const std::string& name = graph.modules()[m].display;
+			switch (myResults[m]){
+				case COMPILED:
+					myCompiled++;
+					log << "compiled   " << name << "\n";
+					break;
+				case UP_TO_DATE:
+					myUpToDate++;
+					log << "up to date " << name << "\n";
+					break;
+				case FAILED: {
+					myFailed++;
+					// Errors carry the file name, as they come from
+					// several files
+					std::istringstream lines(myErrors[m]);
+					std::string line;
+					while (std::getline(lines, line)){
+						std::cerr << name << ":" << line << "\n";
+					}
+					log << "failed     " << name << "\n";
+					break;
+				}
+				case SKIPPED:
+					myFailed++;
+					log << "skipped    " << name << " (an import failed)\n";
+					break;
+			}
+		}
+	}
+	log << myCompiled << " compiled, " << myUpToDate << " up to date, "
+	    << myFailed << " failed\n";
+	return myFailed == 0;
+}
+
+} /* end namespace */
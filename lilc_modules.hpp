@@ -0,0 +1,110 @@
+#ifndef __LILC_MODULES_HPP__
+#define __LILC_MODULES_HPP__ 1
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace LILC{
+
+// Multi-file programs. A file imports another with a line
+//
+//     #import "path/to/other.lilc"
+//
+// (a comment to the scanner, so every file still parses on its own), the
+// path relative to the importing file. It then sees the struct, global
+// and function declarations of the imported file and, transitively, of
+// everything that file imports.
+
+// The files of a program and who imports whom, read from the root file.
+class ModuleGraph{
+public:
+	struct Module {
+		// Canonical path, and as given relative to the root's directory
+		std::string path;
+		std::string display;
+		// File name in the cache: the stem plus a hash of the path
+		std::string cacheName;
+		uint64_t sourceHash;
+		std::vector<size_t> imports;
+		std::vector<size_t> importers;
+	};
+
+	// Reads root and everything it imports. Unreadable files and import
+	// cycles are reported on err and make it return false.
+	bool load(const std::string& root, std::ostream& err);
+
+	const std::vector<Module>& modules(){ return myModules; }
+	// Modules grouped so that each one's imports are all in earlier
+	// groups; the modules of one group are independent of each other
+	const std::vector<std::vector<size_t>>& levels(){ return myLevels; }
+	// Everything m imports directly or not, imports before importers
+	std::vector<size_t> importClosure(size_t m);
+	// m and every module that imports it directly or not: what has to be
+	// looked at again when m's file changes
+	std::vector<size_t> affectedBy(size_t m);
+private:
+	size_t add(const std::string& path, std::ostream& err, bool& ok);
+	void visitImports(size_t m, std::vector<bool>& seen,
+		std::vector<size_t>& order);
+
+	std::string myRootDir;
+	std::vector<Module> myModules;
+	std::unordered_map<std::string, size_t> myIndex;
+	std::vector<std::vector<size_t>> myLevels;
+	// While loading: 0 unvisited, 1 on the import path, 2 done
+	std::vector<int> myState;
+	std::vector<size_t> myLevel;
+};
+
+// Compiles each module of a graph on its own against the interfaces of
+// its imports and keeps the results in a cache directory:
+//   <name>.lilci  the interface, the module's declarations with empty
+//                 function bodies, which importers parse
+//   <name>.out    the unparsed module
+//   <name>.stamp  the source hash and the interface hashes it was built on
+// A module is rebuilt when its stamp no longer matches, that is when its
+// file or the interface of anything it imports changed. A rebuild that
+// leaves a module's interface as it was does not touch its importers.
+// The modules of a level are compiled in parallel.
+class ModuleBuilder{
+public:
+	ModuleBuilder(const std::string& cacheDir, size_t jobs){
+		myCacheDir = cacheDir;
+		myJobs = jobs;
+	}
+
+	// Brings every module up to date, logging one line per module.
+	// Compile errors go to cerr, each line led by the module's file name.
+	// Returns false if any module failed.
+	bool build(ModuleGraph& graph, std::ostream& log);
+
+	size_t compiled(){ return myCompiled; }
+	size_t upToDate(){ return myUpToDate; }
+	size_t failed(){ return myFailed; }
+private:
+	enum Result { COMPILED, UP_TO_DATE, FAILED, SKIPPED };
+
+	std::string cachePath(const ModuleGraph::Module& module,
+		const char * ext);
+	std::string stampFor(ModuleGraph& graph, size_t m);
+	// Compile errors of m go to errors
+	bool compile(ModuleGraph& graph, size_t m, std::ostream& errors);
+
+	std::string myCacheDir;
+	size_t myJobs;
+	std::vector<Result> myResults;
+	// Hash of each built module's interface, for its importers' stamps
+	std::vector<uint64_t> myInterfaceHashes;
+	// Compile errors of each module, reported once all levels are built
+	std::vector<std::string> myErrors;
+	size_t myCompiled = 0;
+	size_t myUpToDate = 0;
+	size_t myFailed = 0;
+};
+
+} /* end namespace */
+#endif /* END __LILC_MODULES_HPP__ */
@@ -0,0 +1,48 @@
+#ifndef __LILC_PARALLEL_HPP__
+#define __LILC_PARALLEL_HPP__ 1
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace LILC{
+
+// Number of workers to use when the user did not ask for a count.
+inline size_t defaultJobs(){
+	size_t cores = std::thread::hardware_concurrency();
+	return cores == 0 ? 1 : cores;
+}
+
+// Runs body(i) for every i in [0, count) on up to `jobs` threads. Workers
+// pull the next index from a shared counter, so uneven items balance
+// themselves. The calling thread is one of the workers; with one job or
+// one item no thread is started at all.
+template <typename Body>
+void parallelFor(size_t count, size_t jobs, Body body){
+	jobs = std::max<size_t>(1, std::min(jobs, count));
+	if (jobs == 1){
+		for (size_t i = 0; i < count; i++){
+			body(i);
+		}
+		return;
+	}
+	std::atomic<size_t> next(0);
+	auto worker = [&]{
+		for (size_t i = next++; i < count; i = next++){
+			body(i);
+		}
+	};
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < jobs; t++){
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& thread : threads){
+		thread.join();
+	}
+}
+
+} /* end namespace */
+#endif /* END __LILC_PARALLEL_HPP__ */
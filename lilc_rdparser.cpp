@@ -0,0 +1,588 @@
+#include <sstream>
+
+#include "lilc_rdparser.hpp"
+#include "lilc_compiler.hpp"
+
+using TokenTag = LILC::LilC_Parser::token;
+
+/* Same charging as the semantic actions in lilc.yy, so --stats and the
+ * allocation profile read the same for both parsers */
+#define AST_BUILD_SCOPE \
+   LILC::PhaseScope astScope(myStats, LILC::CompilerStats::AST, true); \
+   ALLOC_SCOPE("std::list")
+
+namespace LILC{
+
+// Binding power of the infix arithmetic operators; 0 for anything else
+static int precedence(int tag){
+	switch (tag){
+		case TokenTag::PLUS:
+		case TokenTag::MINUS:
+			return 1;
+		case TokenTag::TIMES:
+		case TokenTag::DIVIDE:
+			return 2;
+		default:
+			return 0;
+	}
+}
+
+// Precedence levels of what an expression can stand for: an expf (or
+// term) is usable as an expt, an expt as an exp, but not the other way
+static const int LEVEL_EXP = 1;
+static const int LEVEL_EXPT = 2;
+
+static bool isComparison(int tag){
+	switch (tag){
+		case TokenTag::AND:
+		case TokenTag::OR:
+		case TokenTag::EQUALS:
+		case TokenTag::NOTEQUALS:
+		case TokenTag::LESS:
+		case TokenTag::GREATER:
+		case TokenTag::LESSEQ:
+		case TokenTag::GREATEREQ:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static ExpNode * binary(int tag, ExpNode * left, ExpNode * right){
+	switch (tag){
+		case TokenTag::PLUS: return new PlusNode(left, right);
+		case TokenTag::MINUS: return new MinusNode(left, right);
+		case TokenTag::TIMES: return new TimesNode(left, right);
+		case TokenTag::DIVIDE: return new DivideNode(left, right);
+		case TokenTag::AND: return new AndNode(left, right);
+		case TokenTag::OR: return new OrNode(left, right);
+		case TokenTag::EQUALS: return new EqualsNode(left, right);
+		case TokenTag::NOTEQUALS: return new NotEqualsNode(left, right);
+		case TokenTag::LESS: return new LessNode(left, right);
+		case TokenTag::GREATER: return new GreaterNode(left, right);
+		case TokenTag::LESSEQ: return new LessEqNode(left, right);
+		default: return new GreaterEqNode(left, right);
+	}
+}
+
+LilC_RDParser::LilC_RDParser(LilC_Scanner& scanner, LilC_Compiler * compiler)
+: myScanner(scanner){
+	myCompiler = compiler;
+	myStats = compiler == nullptr ? nullptr : compiler->getStats();
+	myDiagnostics = scanner.getDiagnostics();
+	myTag = TokenTag::END;
+}
+
+int LilC_RDParser::parse(){
+	try {
+		advance();
+		ProgramNode * root = program();
+		myCompiler->setASTRoot(root);
+	} catch (SyntaxError&){
+		error("syntax error");
+		return 1;
+	}
+	return 0;
+}
+
+bool LilC_RDParser::parseBody(VarDeclListNode *& decls, StmtListNode *& stmts){
+	try {
+		advance();
+		decls = varDeclList();
+		stmts = stmtList();
+		expect(TokenTag::END);
+	} catch (SyntaxError&){
+		error("syntax error");
+		return false;
+	}
+	return true;
+}
+
+void LilC_RDParser::error(const std::string& message){
+	myScanner.reportTo(myDiagnostics, Diagnostics::ERROR,
+		Diagnostics::SYNTAX_ERROR, message);
+}
+
+void LilC_RDParser::advance(){
+	if (myCompiler != nullptr){
+		myTag = myCompiler->lex(&myLexeme);
+	} else {
+		myTag = myScanner.yylex(&myLexeme);
+	}
+}
+
+SynSymbol * LilC_RDParser::take(){
+	SynSymbol * value = myLexeme.symbolValue;
+	advance();
+	return value;
+}
+
+SynSymbol * LilC_RDParser::expect(int tag){
+	if (myTag != tag){
+		throw SyntaxError();
+	}
+	return take();
+}
+
+bool LilC_RDParser::isTypeStart(){
+	return myTag == TokenTag::INT || myTag == TokenTag::BOOL
+		|| myTag == TokenTag::VOID || myTag == TokenTag::STRUCT;
+}
+
+// Declarations
+
+ProgramNode * LilC_RDParser::program(){
+	std::list<DeclNode *> * decls;
+	{
+		AST_BUILD_SCOPE;
+		decls = new std::list<DeclNode *>();
+	}
+	while (myTag != TokenTag::END){
+		DeclNode * next = decl();
+		AST_BUILD_SCOPE;
+		decls->push_back(next);
+	}
+	AST_BUILD_SCOPE;
+	return new ProgramNode(new DeclListNode(decls));
+}
+
+DeclNode * LilC_RDParser::decl(){
+	if (myTag == TokenTag::STRUCT){
+		advance();
+		IdNode * name = id();
+		if (myTag != TokenTag::LCURLY){
+			IdNode * var = id();
+			expect(TokenTag::SEMICOLON);
+			AST_BUILD_SCOPE;
+			return new VarDeclNode(new StructNode(name), var, 0);
+		}
+		advance();
+		VarDeclListNode * fields = structBody();
+		expect(TokenTag::RCURLY);
+		expect(TokenTag::SEMICOLON);
+		AST_BUILD_SCOPE;
+		return new StructDeclNode(name, fields, 0);
+	}
+	TypeNode * declType = type();
+	IdNode * name = id();
+	if (myTag == TokenTag::LPAREN){
+		return fnDecl(declType, name);
+	}
+	expect(TokenTag::SEMICOLON);
+	AST_BUILD_SCOPE;
+	return new VarDeclNode(declType, name, VarDeclNode::NOT_STRUCT);
+}
+
+VarDeclNode * LilC_RDParser::varDecl(){
+	if (myTag == TokenTag::STRUCT){
+		advance();
+		IdNode * name = id();
+		IdNode * var = id();
+		expect(TokenTag::SEMICOLON);
+		AST_BUILD_SCOPE;
+		return new VarDeclNode(new StructNode(name), var, 0);
+	}
+	TypeNode * declType = type();
+	IdNode * name = id();
+	expect(TokenTag::SEMICOLON);
+	AST_BUILD_SCOPE;
+	return new VarDeclNode(declType, name, VarDeclNode::NOT_STRUCT);
+}
+
+VarDeclListNode * LilC_RDParser::varDeclList(){
+	VarDeclListNode * decls;
+	{
+		AST_BUILD_SCOPE;
+		decls = new VarDeclListNode(new std::list<VarDeclNode *>());
+	}
+	while (isTypeStart()){
+		VarDeclNode * next = varDecl();
+		AST_BUILD_SCOPE;
+		decls->add(next);
+	}
+	return decls;
+}
+
+// Like varDeclList, but a struct needs at least one field
+VarDeclListNode * LilC_RDParser::structBody(){
+	if (!isTypeStart()){
+		throw SyntaxError();
+	}
+	return varDeclList();
+}
+
+FnDeclNode * LilC_RDParser::fnDecl(TypeNode * retType, IdNode * name){
+	FormalsListNode * params = formals();
+	FnBodyNode * body = fnBody();
+	AST_BUILD_SCOPE;
+	return new FnDeclNode(retType, name, params, body, 0);
+}
+
+FormalsListNode * LilC_RDParser::formals(){
+	expect(TokenTag::LPAREN);
+	if (myTag == TokenTag::RPAREN){
+		advance();
+		return nullptr;
+	}
+	FormalsListNode * params;
+	{
+		AST_BUILD_SCOPE;
+		params = new FormalsListNode(new std::list<FormalDeclNode *>());
+	}
+	while (true){
+		TypeNode * paramType = type();
+		IdNode * name = id();
+		{
+			AST_BUILD_SCOPE;
+			params->add(new FormalDeclNode(paramType, name, 0));
+		}
+		if (myTag != TokenTag::COMMA){
+			break;
+		}
+		advance();
+	}
+	expect(TokenTag::RPAREN);
+	return params;
+}
+
+FnBodyNode * LilC_RDParser::fnBody(){
+	if (mySource != nullptr){
+		return skipBody();
+	}
+	expect(TokenTag::LCURLY);
+	VarDeclListNode * decls = varDeclList();
+	StmtListNode * stmts = stmtList();
+	expect(TokenTag::RCURLY);
+	AST_BUILD_SCOPE;
+	return new FnBodyNode(decls, stmts);
+}
+
+// Matches the body's braces without building anything
+FnBodyNode * LilC_RDParser::skipBody(){
+	if (myTag != TokenTag::LCURLY){
+		throw SyntaxError();
+	}
+	SynSymbol * open = myLexeme.symbolValue;
+	LazyBody * lazy = new LazyBody();
+	lazy->source = mySource;
+	lazy->begin = myScanner.offset();
+	lazy->line = open->line;
+	lazy->col = open->column + 1;
+	size_t depth = 1;
+	while (depth > 0){
+		advance();
+		if (myTag == TokenTag::END){
+			throw SyntaxError();
+		} else if (myTag == TokenTag::LCURLY){
+			depth++;
+		} else if (myTag == TokenTag::RCURLY){
+			depth--;
+		}
+	}
+	// Up to the closing brace, which the scanner has just read
+	lazy->end = myScanner.offset() - 1;
+	advance();
+	AST_BUILD_SCOPE;
+	return new FnBodyNode(lazy);
+}
+
+TypeNode * LilC_RDParser::type(){
+	int tag = myTag;
+	switch (tag){
+		case TokenTag::INT:
+		case TokenTag::BOOL:
+		case TokenTag::VOID:
+			advance();
+			break;
+		default:
+			throw SyntaxError();
+	}
+	AST_BUILD_SCOPE;
+	if (tag == TokenTag::INT){
+		return new IntNode();
+	} else if (tag == TokenTag::BOOL){
+		return new BoolNode();
+	}
+	return new VoidNode();
+}
+
+IdNode * LilC_RDParser::id(){
+	IDToken * token = static_cast<IDToken *>(expect(TokenTag::ID));
+	AST_BUILD_SCOPE;
+	return new IdNode(token);
+}
+
+// Statements
+
+StmtListNode * LilC_RDParser::stmtList(){
+	StmtListNode * stmts;
+	{
+		AST_BUILD_SCOPE;
+		stmts = new StmtListNode(new std::list<StmtNode *>());
+	}
+	while (myTag != TokenTag::RCURLY && myTag != TokenTag::END){
+		StmtNode * next = stmt();
+		AST_BUILD_SCOPE;
+		stmts->add(next);
+	}
+	return stmts;
+}
+
+StmtNode * LilC_RDParser::stmt(){
+	switch (myTag){
+	case TokenTag::INPUT: {
+		advance();
+		expect(TokenTag::READ);
+		ExpNode * target = loc(id());
+		expect(TokenTag::SEMICOLON);
+		AST_BUILD_SCOPE;
+		return new ReadStmtNode(target);
+	}
+	case TokenTag::OUTPUT: {
+		advance();
+		expect(TokenTag::WRITE);
+		ExpNode * value = exp();
+		expect(TokenTag::SEMICOLON);
+		AST_BUILD_SCOPE;
+		return new WriteStmtNode(value);
+	}
+	case TokenTag::IF: {
+		advance();
+		expect(TokenTag::LPAREN);
+		ExpNode * cond = exp();
+		expect(TokenTag::RPAREN);
+		expect(TokenTag::LCURLY);
+		VarDeclListNode * decls = varDeclList();
+		StmtListNode * stmts = stmtList();
+		expect(TokenTag::RCURLY);
+		if (myTag != TokenTag::ELSE){
+			AST_BUILD_SCOPE;
+			return new IfStmtNode(cond, decls, stmts);
+		}
+		advance();
+		expect(TokenTag::LCURLY);
+		VarDeclListNode * elseDecls = varDeclList();
+		StmtListNode * elseStmts = stmtList();
+		expect(TokenTag::RCURLY);
+		AST_BUILD_SCOPE;
+		return new IfElseStmtNode(cond, decls, stmts, elseDecls, elseStmts);
+	}
+	case TokenTag::WHILE: {
+		advance();
+		expect(TokenTag::LPAREN);
+		ExpNode * cond = exp();
+		expect(TokenTag::RPAREN);
+		expect(TokenTag::LCURLY);
+		VarDeclListNode * decls = varDeclList();
+		StmtListNode * stmts = stmtList();
+		expect(TokenTag::RCURLY);
+		AST_BUILD_SCOPE;
+		return new WhileStmtNode(cond, decls, stmts);
+	}
+	case TokenTag::RETURN: {
+		advance();
+		ExpNode * value = nullptr;
+		if (myTag != TokenTag::SEMICOLON){
+			value = exp();
+		}
+		expect(TokenTag::SEMICOLON);
+		AST_BUILD_SCOPE;
+		return new ReturnStmtNode(value);
+	}
+	case TokenTag::ID: {
+		IdNode * name = id();
+		if (myTag == TokenTag::LPAREN){
+			CallExpNode * call = fncall(name);
+			expect(TokenTag::SEMICOLON);
+			AST_BUILD_SCOPE;
+			return new CallStmtNode(call);
+		}
+		ExpNode * target = loc(name);
+		int tag = myTag;
+		if (tag == TokenTag::PLUSPLUS || tag == TokenTag::MINUSMINUS){
+			advance();
+			expect(TokenTag::SEMICOLON);
+			AST_BUILD_SCOPE;
+			if (tag == TokenTag::PLUSPLUS){
+				return new PostIncStmtNode(target);
+			}
+			return new PostDecStmtNode(target);
+		}
+		expect(TokenTag::ASSIGN);
+		ExpNode * value = exp();
+		expect(TokenTag::SEMICOLON);
+		AST_BUILD_SCOPE;
+		return new AssignStmtNode(new AssignNode(target, value));
+	}
+	default:
+		throw SyntaxError();
+	}
+}
+
+// Expressions
+
+ExpNode * LilC_RDParser::exp(){
+	if (myTag == TokenTag::NOT){
+		advance();
+		ExpNode * operand = exp();
+		AST_BUILD_SCOPE;
+		return new NotNode(operand);
+	}
+	if (myTag == TokenTag::MINUS){
+		return climb(expf(), LEVEL_EXPT, LEVEL_EXP);
+	}
+	bool isLoc = false;
+	ExpNode * left = term(&isLoc);
+	if (isLoc && myTag == TokenTag::ASSIGN){
+		advance();
+		ExpNode * value = exp();
+		AST_BUILD_SCOPE;
+		return new AssignNode(left, value);
+	}
+	if (isComparison(myTag)){
+		int tag = myTag;
+		advance();
+		ExpNode * right = term(nullptr);
+		ExpNode * result;
+		{
+			AST_BUILD_SCOPE;
+			result = binary(tag, left, right);
+		}
+		return climb(result, LEVEL_EXP, LEVEL_EXP);
+	}
+	return climb(left, LEVEL_EXPT, LEVEL_EXP);
+}
+
+// Folds the operators of precedence at least minPrec that follow lhs into
+// it. lhs stands at `level`, so an operator binding tighter than that
+// cannot take it as its left operand and ends the expression instead.
+ExpNode * LilC_RDParser::climb(ExpNode * lhs, int level, int minPrec){
+	int prec = precedence(myTag);
+	while (prec >= minPrec && prec <= level){
+		int tag = myTag;
+		advance();
+		ExpNode * rhs = expf();
+		while (precedence(myTag) > prec){
+			rhs = climb(rhs, LEVEL_EXPT, prec + 1);
+		}
+		{
+			AST_BUILD_SCOPE;
+			lhs = binary(tag, lhs, rhs);
+		}
+		level = prec;
+		prec = precedence(myTag);
+	}
+	return lhs;
+}
+
+ExpNode * LilC_RDParser::expf(){
+	if (myTag != TokenTag::MINUS){
+		return term(nullptr);
+	}
+	advance();
+	ExpNode * operand = term(nullptr);
+	AST_BUILD_SCOPE;
+	return new UnaryMinusNode(operand);
+}
+
+// Sets *isLoc if the term is a bare loc, which may be assigned to
+ExpNode * LilC_RDParser::term(bool * isLoc){
+	switch (myTag){
+	case TokenTag::ID: {
+		IdNode * name = id();
+		if (myTag == TokenTag::LPAREN){
+			return fncall(name);
+		}
+		if (isLoc != nullptr){
+			*isLoc = true;
+		}
+		return loc(name);
+	}
+	case TokenTag::INTLITERAL: {
+		IntLitToken * token = static_cast<IntLitToken *>(take());
+		AST_BUILD_SCOPE;
+		return new IntLitNode(token);
+	}
+	case TokenTag::STRINGLITERAL: {
+		StringLitToken * token = static_cast<StringLitToken *>(take());
+		AST_BUILD_SCOPE;
+		return new StringLitNode(token);
+	}
+	case TokenTag::TRUE: {
+		SynSymbol * token = take();
+		AST_BUILD_SCOPE;
+		return new TrueNode(token);
+	}
+	case TokenTag::FALSE: {
+		SynSymbol * token = take();
+		AST_BUILD_SCOPE;
+		return new FalseNode(token);
+	}
+	case TokenTag::LPAREN: {
+		advance();
+		ExpNode * inner = exp();
+		expect(TokenTag::RPAREN);
+		return inner;
+	}
+	default:
+		throw SyntaxError();
+	}
+}
+
+// The rest of a loc that starts with id
+ExpNode * LilC_RDParser::loc(IdNode * name){
+	ExpNode * result = name;
+	while (myTag == TokenTag::DOT){
+		advance();
+		IdNode * field = id();
+		AST_BUILD_SCOPE;
+		result = new DotAccessNode(result, field);
+	}
+	return result;
+}
+
+// The rest of a call to id, from its opening parenthesis
+CallExpNode * LilC_RDParser::fncall(IdNode * name){
+	expect(TokenTag::LPAREN);
+	ExpListNode * actuals = nullptr;
+	if (myTag != TokenTag::RPAREN){
+		{
+			AST_BUILD_SCOPE;
+			actuals = new ExpListNode(new std::list<ExpNode *>());
+		}
+		while (true){
+			ExpNode * actual = exp();
+			{
+				AST_BUILD_SCOPE;
+				actuals->add(actual);
+			}
+			if (myTag != TokenTag::COMMA){
+				break;
+			}
+			advance();
+		}
+	}
+	expect(TokenTag::RPAREN);
+	AST_BUILD_SCOPE;
+	return new CallExpNode(name, actuals);
+}
+
+void FnBodyNode::parseLazy(){
+	LazyBody * lazy = myLazy;
+	myLazy = nullptr;
+	std::istringstream in(lazy->source->text.substr(lazy->begin,
+		lazy->end - lazy->begin));
+	// The scanner reported its own diagnostics when the body was skipped
+	LilC_Scanner scanner(&in);
+	scanner.resume(lazy->line, lazy->col, lazy->begin);
+	LilC_RDParser parser(scanner, nullptr);
+	parser.setDiagnostics(lazy->source->diagnostics);
+	if (!parser.parseBody(myDecls, myStmts)){
+		lazy->source->errors++;
+		myDecls = new VarDeclListNode(new std::list<VarDeclNode *>());
+		myStmts = new StmtListNode(new std::list<StmtNode *>());
+	}
+	delete lazy;
+}
+
+} /* end namespace */
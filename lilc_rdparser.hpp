@@ -0,0 +1,116 @@
+#ifndef __LILC_RDPARSER_HPP__
+#define __LILC_RDPARSER_HPP__ 1
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "ast.hpp"
+#include "grammar.hh"
+#include "lilc_diagnostics.hpp"
+
+namespace LILC{
+
+class LilC_Compiler;
+class LilC_Scanner;
+
+// The text lazily parsed function bodies are read back from, shared by
+// every body of one file
+struct LazySource {
+	std::string text;
+	// Syntax errors found in bodies so far, and where they are reported
+	std::atomic<size_t> errors{0};
+	Diagnostics * diagnostics = nullptr;
+};
+
+// Where a lazily parsed function body is: the bytes between its braces,
+// starting at line:col
+struct LazyBody {
+	std::shared_ptr<LazySource> source;
+	size_t begin;
+	size_t end;
+	size_t line;
+	size_t col;
+};
+
+// Hand-written alternative to the bison parser in lilc.yy. It accepts the
+// same language, builds the same AST and fails on the same inputs, so the
+// two are interchangeable behind LilC_Compiler::parse.
+//
+// Declarations and statements are recursive descent with one token of
+// lookahead; a statement starting with an id reads the id before choosing
+// between a call, an assignment and ++/--. Expressions are precedence
+// climbing over + - (exp) and * / (expt), with the parts of lilc.yy that
+// are not arithmetic kept as they are there:
+//  - comparisons, && and || join exactly two terms and are not chained;
+//  - `!` and `loc =` take a whole exp, so `!a + b` is `!(a + b)` and
+//    `a = b + c` is `a = (b + c)` (bison's shift/reduce choices);
+//  - unary minus applies to a term only.
+//
+// In lazy mode a function body is only brace-matched: the tokens between
+// its braces are read and dropped, and the FnBodyNode keeps their span of
+// the source. Its declarations and statements are parsed the first time
+// they are asked for (FnBodyNode::getDecls/getStmts), so syntax errors
+// inside bodies are reported then and leave the body empty.
+class LilC_RDParser{
+public:
+	// Reads tokens from scanner; through the compiler, when there is one,
+	// so they are counted and timed as LilC_Parser's are. Syntax errors
+	// are reported where the scanner reports its own.
+	LilC_RDParser(LilC_Scanner& scanner, LilC_Compiler * compiler);
+
+	void setDiagnostics(Diagnostics * diagnostics){ myDiagnostics = diagnostics; }
+
+	// Parses function bodies lazily from source, which must hold the text
+	// the scanner reads
+	void setLazy(std::shared_ptr<LazySource> source){ mySource = source; }
+
+	// Like LilC_Parser::parse: hands the AST root to the compiler and
+	// returns 0, or reports a syntax error and returns 1
+	int parse();
+	// Parses what a lazy body's span holds, a varDeclList and a stmtList,
+	// up to the end of input. Returns false on a syntax error.
+	bool parseBody(VarDeclListNode *& decls, StmtListNode *& stmts);
+private:
+	struct SyntaxError {};
+
+	void advance();
+	// The current token's value, then moves past it
+	SynSymbol * take();
+	SynSymbol * expect(int tag);
+	bool isTypeStart();
+
+	ProgramNode * program();
+	DeclNode * decl();
+	VarDeclNode * varDecl();
+	VarDeclListNode * varDeclList();
+	VarDeclListNode * structBody();
+	FnDeclNode * fnDecl(TypeNode * type, IdNode * id);
+	FormalsListNode * formals();
+	FnBodyNode * fnBody();
+	FnBodyNode * skipBody();
+	StmtListNode * stmtList();
+	StmtNode * stmt();
+	TypeNode * type();
+	IdNode * id();
+
+	ExpNode * exp();
+	ExpNode * climb(ExpNode * lhs, int level, int minPrec);
+	ExpNode * expf();
+	ExpNode * term(bool * isLoc);
+	ExpNode * loc(IdNode * id);
+	CallExpNode * fncall(IdNode * id);
+
+	void error(const std::string& message);
+
+	LilC_Scanner& myScanner;
+	LilC_Compiler * myCompiler;
+	CompilerStats * myStats;
+	Diagnostics * myDiagnostics;
+	std::shared_ptr<LazySource> mySource;
+	LilC_Parser::semantic_type myLexeme;
+	int myTag;
+};
+
+} /* end namespace */
+#endif /* END __LILC_RDPARSER_HPP__ */
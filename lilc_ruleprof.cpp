@@ -0,0 +1,180 @@
+#include "lilc_ruleprof.hpp"
+
+#ifdef LILC_RULE_PROFILE
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int MAX_LEX_RULES = 128;
+const int MAX_PARSE_RULES = 256;
+
+struct RuleRecord {
+	std::atomic<const char *> name;
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> bytes;
+	std::atomic<uint64_t> nanos;
+};
+
+RuleRecord lexRules[MAX_LEX_RULES];
+RuleRecord parseRules[MAX_PARSE_RULES];
+
+void charge(RuleRecord& rec, const char * name, uint64_t bytes){
+	if (rec.name.load(std::memory_order_relaxed) == nullptr){
+		rec.name.store(name, std::memory_order_relaxed);
+	}
+	rec.hits.fetch_add(1, std::memory_order_relaxed);
+	rec.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+uint64_t nanosSince(Clock::time_point start, Clock::time_point now){
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		now - start).count();
+}
+
+// Where each symbol on the bison parser's stack starts and ends in the
+// source. Tokens are read ahead of being shifted, so they wait in
+// pending until a reduction finds them on the stack.
+struct ParseSpans {
+	std::deque<std::pair<size_t, size_t>> pending;
+	std::vector<size_t> starts;
+	std::vector<size_t> ends;
+	// Stack slots whose spans are known; slot 0 holds no symbol
+	size_t known = 1;
+	size_t lastEnd = 0;
+};
+
+thread_local Clock::time_point lexMark;
+thread_local ParseSpans spans;
+
+void printTable(const char * title, RuleRecord * rules, int count){
+	std::vector<int> order;
+	uint64_t totalNanos = 0;
+	for (int i = 0; i < count; i++){
+		if (rules[i].hits.load() != 0){
+			order.push_back(i);
+			totalNanos += rules[i].nanos.load();
+		}
+	}
+	if (order.empty()){
+		return;
+	}
+	std::sort(order.begin(), order.end(), [&](int a, int b){
+		uint64_t na = rules[a].nanos.load();
+		uint64_t nb = rules[b].nanos.load();
+		return na != nb ? na > nb : rules[a].hits.load() > rules[b].hits.load();
+	});
+	fprintf(stderr, "%12s %14s %8s %10s %8s %6s  %s\n", "hits", "bytes",
+		"avg", "ms", "ns/hit", "time%", title);
+	uint64_t totalHits = 0, totalBytes = 0;
+	for (int i : order){
+		RuleRecord& rec = rules[i];
+		uint64_t hits = rec.hits.load();
+		uint64_t bytes = rec.bytes.load();
+		uint64_t nanos = rec.nanos.load();
+		totalHits += hits;
+		totalBytes += bytes;
+		fprintf(stderr, "%12llu %14llu %8.1f %10.3f %8.1f %6.1f  %s\n",
+			(unsigned long long)hits, (unsigned long long)bytes,
+			(double)bytes / hits, nanos / 1e6, (double)nanos / hits,
+			totalNanos == 0 ? 0.0 : 100.0 * nanos / totalNanos,
+			rec.name.load());
+	}
+	fprintf(stderr, "%12llu %14llu %8s %10.3f %8s %6s  total\n\n",
+		(unsigned long long)totalHits, (unsigned long long)totalBytes, "",
+		totalNanos / 1e6, "", "");
+}
+
+class RuleReport{
+public:
+	~RuleReport(){
+		printTable("lexer rule", lexRules, MAX_LEX_RULES);
+		printTable("parser production", parseRules, MAX_PARSE_RULES);
+	}
+};
+
+RuleReport report;
+
+} // End anonymous namespace
+
+namespace LILC{
+
+void beginLex(){
+	lexMark = Clock::now();
+}
+
+void noteLexRule(int rule, const char * name, size_t length){
+	Clock::time_point now = Clock::now();
+	if (rule >= 0 && rule < MAX_LEX_RULES){
+		RuleRecord& rec = lexRules[rule];
+		charge(rec, name, length);
+		rec.nanos.fetch_add(nanosSince(lexMark, now), std::memory_order_relaxed);
+	}
+	lexMark = now;
+}
+
+void beginParse(){
+	spans.pending.clear();
+	spans.known = 1;
+	spans.lastEnd = 0;
+}
+
+void noteParseToken(size_t start, size_t end){
+	spans.pending.emplace_back(start, end);
+}
+
+ReductionScope::ReductionScope(int rule, const char * name, size_t depth,
+	int length){
+	myRule = rule;
+	ParseSpans& s = spans;
+	if (s.starts.size() < depth){
+		s.starts.resize(depth);
+		s.ends.resize(depth);
+	}
+	// Tokens shifted since the last reduction
+	for (size_t slot = s.known; slot < depth; slot++){
+		if (!s.pending.empty()){
+			s.lastEnd = s.pending.front().second;
+			s.starts[slot] = s.pending.front().first;
+			s.pending.pop_front();
+		} else {
+			s.starts[slot] = s.lastEnd;
+		}
+		s.ends[slot] = s.lastEnd;
+	}
+	// The left-hand side replaces the right-hand side on the stack; an
+	// empty one sits where the next token starts
+	size_t first = depth - length;
+	size_t start = s.pending.empty() ? s.lastEnd : s.pending.front().first;
+	size_t end = start;
+	if (length > 0){
+		start = s.starts[first];
+		end = s.ends[depth - 1];
+	}
+	s.starts[first] = start;
+	s.ends[first] = end;
+	s.known = first + 1;
+	if (rule >= 0 && rule < MAX_PARSE_RULES){
+		charge(parseRules[rule], name, end - start);
+	}
+	myStart = Clock::now();
+}
+
+ReductionScope::~ReductionScope(){
+	if (myRule >= 0 && myRule < MAX_PARSE_RULES){
+		parseRules[myRule].nanos.fetch_add(nanosSince(myStart, Clock::now()),
+			std::memory_order_relaxed);
+	}
+}
+
+} // End namespace LIL' C
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef __LILC_RULEPROF_HPP__
+#define __LILC_RULEPROF_HPP__ 1
+
+#include <chrono>
+#include <cstddef>
+
+// Front-end rule profiling.
+//
+// Building with -DLILC_RULE_PROFILE (make P3-ruleprof) counts every match
+// of a lilc.l rule and every reduction of a lilc.yy production, with the
+// bytes of source each covered and the time each took, and prints both
+// tables at exit, costliest first:
+//
+//   LEX_BEGIN                  where yylex is entered
+//   LEX_RULE(rule, name, len)  in YY_USER_ACTION, for flex rule number
+//                              `rule` matching len bytes. It is charged
+//                              the time since the previous match, or
+//                              since yylex was entered: matching its text
+//                              plus the action of a rule that returned
+//                              no token, such as whitespace.
+//   PARSE_BEGIN                where the bison parser starts
+//   PARSE_TOKEN(start, end)    for each token the bison parser reads, by
+//                              byte offset
+//   ReductionScope             opened by RULE_SCOPE (lilc.yy) in every
+//                              semantic action. A production is charged
+//                              the time its action takes and the bytes
+//                              from its first token to its last.
+//
+// All expand to nothing in a normal build. The recursive-descent parser
+// makes no reductions, so only its scanner rules are profiled.
+
+namespace LILC{
+
+#ifdef LILC_RULE_PROFILE
+
+void beginLex();
+void noteLexRule(int rule, const char * name, size_t length);
+void beginParse();
+void noteParseToken(size_t start, size_t end);
+
+class ReductionScope{
+public:
+	// For production `rule`, whose right-hand side is the top length of
+	// the depth symbols on the parser's stack
+	ReductionScope(int rule, const char * name, size_t depth, int length);
+	~ReductionScope();
+private:
+	int myRule;
+	std::chrono::steady_clock::time_point myStart;
+};
+
+#define LEX_BEGIN LILC::beginLex()
+#define LEX_RULE(rule, name, length) LILC::noteLexRule(rule, name, length)
+#define PARSE_BEGIN LILC::beginParse()
+#define PARSE_TOKEN(start, end) LILC::noteParseToken(start, end)
+
+#else
+
+#define LEX_BEGIN static_cast<void>(0)
+#define LEX_RULE(rule, name, length) static_cast<void>(0)
+#define PARSE_BEGIN static_cast<void>(0)
+#define PARSE_TOKEN(start, end) static_cast<void>(0)
+
+#endif
+
+} /* end namespace */
+#endif /* END __LILC_RULEPROF_HPP__ */
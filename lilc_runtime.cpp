@@ -0,0 +1,83 @@
+#include <cctype>
+
+#include "lilc_runtime.hpp"
+#include "lilc_arith.hpp"
+
+namespace LILC{
+
+RuntimeIO::RuntimeIO(FILE * in, FILE * out){
+	myInFile = in;
+	myOutFile = out;
+}
+
+bool RuntimeIO::fill(){
+	myInPos = 0;
+	myInEnd = fread(myIn, 1, BUFFER_SIZE, myInFile);
+	return myInEnd > 0;
+}
+
+int32_t RuntimeIO::readInt(){
+	flush();
+	int c = peekChar();
+	while (c != EOF && isspace(c)){
+		myInPos++;
+		c = peekChar();
+	}
+	bool negative = false;
+	if (c == '-' || c == '+'){
+		negative = c == '-';
+		myInPos++;
+		c = peekChar();
+	}
+	int32_t value = 0;
+	while (c != EOF && isdigit(c)){
+		value = lilcAdd(lilcMul(value, 10), c - '0');
+		myInPos++;
+		c = peekChar();
+	}
+	return negative ? lilcNeg(value) : value;
+}
+
+void RuntimeIO::writeInt(int32_t value){
+	char digits[12];
+	int n = 0;
+	// Negated as unsigned so INT_MIN works
+	uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+	do {
+		digits[n++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude != 0);
+	if (value < 0){
+		put('-');
+	}
+	while (n > 0){
+		put(digits[--n]);
+	}
+}
+
+void RuntimeIO::writeString(const std::string& lexeme){
+	// Skip the quotes; the scanner only accepts valid escapes
+	for (size_t i = 1; i + 1 < lexeme.size(); i++){
+		char c = lexeme[i];
+		if (c == '\\'){
+			c = lexeme[++i];
+			if (c == 'n'){
+				c = '\n';
+			} else if (c == 't'){
+				c = '\t';
+			}
+		}
+		put(c);
+	}
+}
+
+void RuntimeIO::flush(){
+	if (myOutPos == 0){
+		return;
+	}
+	fwrite(myOut, 1, myOutPos, myOutFile);
+	myOutPos = 0;
+	fflush(myOutFile);
+}
+
+} /* end namespace */
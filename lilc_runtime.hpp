@@ -0,0 +1,79 @@
+#ifndef __LILC_RUNTIME_HPP__
+#define __LILC_RUNTIME_HPP__ 1
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+// Run-time support shared by everything that executes Lil' C programs.
+//
+// Input and output are buffered in large blocks instead of going through
+// iostreams per value. `input >> x` reads a decimal int (optionally
+// signed, wrapping like Lil' C arithmetic); a bool location stores
+// whether it is non-zero. At end of input, or on anything that is not a
+// number, it reads 0. `output << e` writes ints in decimal, bools as 1 or
+// 0 and string literals with their escapes decoded. Output is flushed
+// before every read, so prompts appear, and when the RuntimeIO goes away.
+
+namespace LILC{
+
+class RuntimeIO{
+public:
+	RuntimeIO(FILE * in, FILE * out);
+	~RuntimeIO(){ flush(); }
+
+	int32_t readInt();
+	void writeInt(int32_t value);
+	// lexeme is a string literal as written, quotes included
+	void writeString(const std::string& lexeme);
+	void flush();
+private:
+	static const size_t BUFFER_SIZE = 1 << 16;
+
+	int peekChar(){
+		if (myInPos == myInEnd && !fill()){
+			return EOF;
+		}
+		return (unsigned char)myIn[myInPos];
+	}
+	bool fill();
+	void put(char c){
+		if (myOutPos == BUFFER_SIZE){
+			flush();
+		}
+		myOut[myOutPos++] = c;
+	}
+
+	FILE * myInFile;
+	FILE * myOutFile;
+	char myIn[BUFFER_SIZE];
+	size_t myInPos = 0;
+	size_t myInEnd = 0;
+	char myOut[BUFFER_SIZE];
+	size_t myOutPos = 0;
+};
+
+// How many calls may be in progress inside main, in every back end. One
+// call more stops the program with a "Stack overflow" runtime error.
+const size_t MAX_CALL_DEPTH = 1 << 16;
+
+// An error that stops a running program, e.g. division by zero, reported
+// at the position of the expression that caused it.
+class RuntimeError : public std::runtime_error{
+public:
+	RuntimeError(size_t line, size_t col, const std::string& msg)
+	: std::runtime_error(msg){
+		myLine = line;
+		myCol = col;
+	}
+	size_t getLine() const { return myLine; }
+	size_t getCol() const { return myCol; }
+private:
+	size_t myLine;
+	size_t myCol;
+};
+
+} /* end namespace */
+#endif /* END __LILC_RUNTIME_HPP__ */
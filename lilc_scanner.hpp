@@ -6,14 +6,18 @@
 #endif
 
 #include "grammar.hh"
+#include "lilc_diagnostics.hpp"
 
 namespace LILC{
 
 class LilC_Scanner : public yyFlexLexer{
 public:
    
-   LilC_Scanner(std::istream *in) : yyFlexLexer(in)
+   // Reports go to diagnostics; with none, they are dropped
+   LilC_Scanner(std::istream *in, Diagnostics * diagnostics = nullptr)
+   : yyFlexLexer(in)
    {
+	this->diagnostics = diagnostics;
    };
    virtual ~LilC_Scanner() {
    };
@@ -25,12 +29,37 @@ public:
    virtual
    int yylex( LILC::LilC_Parser::semantic_type * const lval);
 
-   void warn(int lineNum, int charNum, std::string msg){
-	std::cerr << lineNum << ":" << charNum << " ***WARNING*** " << msg << std::endl;
+   // Record a diagnostic at the start of the last text matched, which is
+   // the offending token for the scanner's own reports and the lookahead
+   // for the parsers'
+   void warn(Diagnostics::Code code, const std::string& arg = ""){
+	reportTo(diagnostics, Diagnostics::WARNING, code, arg);
    }
 
-   void error(int lineNum, int charNum, std::string msg){
-	std::cerr << lineNum << ":" << charNum << " ***ERROR*** " << msg << std::endl;
+   void error(Diagnostics::Code code, const std::string& arg = ""){
+	reportTo(diagnostics, Diagnostics::ERROR, code, arg);
+   }
+
+   void reportTo(Diagnostics * to, Diagnostics::Severity severity,
+	Diagnostics::Code code, const std::string& arg){
+	if (to != nullptr){
+		to->report(severity, code, tokenLine, tokenCol, tokenOffset, arg);
+	}
+   }
+
+   Diagnostics * getDiagnostics(){ return diagnostics; }
+
+   // Bytes of input matched so far: the offset just past the last token
+   size_t offset(){ return byteOffset; }
+   // Where the last text matched starts
+   size_t tokenStart(){ return tokenOffset; }
+
+   // For input that starts part way into a file, e.g. a lazily parsed
+   // function body: positions and offsets continue from line:col, offset
+   void resume(size_t line, size_t col, size_t offset){
+	lineNum = line;
+	charNum = col;
+	byteOffset = offset;
    }
 
    int produceNullaryToken(int tag){
@@ -43,8 +72,14 @@ public:
 private:
    /* yyval ptr */
    LILC::LilC_Parser::semantic_type *yylval = nullptr;
-   size_t lineNum;
-   size_t charNum;
+   size_t lineNum = 1;
+   size_t charNum = 1;
+   size_t byteOffset = 0;
+   // Where the last text matched starts (set by YY_USER_ACTION)
+   size_t tokenLine = 1;
+   size_t tokenCol = 1;
+   size_t tokenOffset = 0;
+   Diagnostics * diagnostics;
 };
 
 } /* end namespace */
@@ -0,0 +1,446 @@
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <typeinfo>
+#include <algorithm>
+#include <iomanip>
+#include <cxxabi.h>
+#include <sys/resource.h>
+
+#include "lilc_stats.hpp"
+#include "lilc_alloc.hpp"
+#include "grammar.hh"
+
+using TokenTag = LILC::LilC_Parser::token;
+
+namespace LILC{
+
+static double wallSeconds(){
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static double cpuSeconds(){
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::string className(const ASTNode * node){
+	int status = 0;
+	char * demangled = abi::__cxa_demangle(typeid(*node).name(),
+		nullptr, nullptr, &status);
+	std::string name = (status == 0) ? demangled : typeid(*node).name();
+	free(demangled);
+	size_t colons = name.rfind("::");
+	if (colons != std::string::npos){
+		name = name.substr(colons + 2);
+	}
+	return name;
+}
+
+CompilerStats::CompilerStats(){
+	trackAllocations();
+	myCurrent = NONE;
+	for (int p = 0; p < NUM_PHASES; p++){
+		myIntervalWall[p] = 0;
+	}
+	myLastWall = wallSeconds();
+	myLastCpu = cpuSeconds();
+	myLastBytes = allocatedBytes();
+	myInputBytes = 0;
+}
+
+CompilerStats::Phase CompilerStats::switchPhase(Phase phase, bool fine){
+	double wall = wallSeconds();
+	size_t bytes = allocatedBytes();
+	PhaseRecord & rec = myPhases[myCurrent];
+	rec.wall += wall - myLastWall;
+	rec.bytes += bytes - myLastBytes;
+	myIntervalWall[myCurrent] += wall - myLastWall;
+	myLastWall = wall;
+	myLastBytes = bytes;
+
+	if (!fine){
+		double cpu = cpuSeconds();
+		double intervalWall = 0;
+		for (int p = 0; p < NUM_PHASES; p++){
+			intervalWall += myIntervalWall[p];
+		}
+		for (int p = 0; p < NUM_PHASES; p++){
+			if (intervalWall > 0){
+				myPhases[p].cpu += (cpu - myLastCpu)
+					* myIntervalWall[p] / intervalWall;
+			}
+			myIntervalWall[p] = 0;
+		}
+		myLastCpu = cpu;
+	}
+
+	Phase prev = myCurrent;
+	myCurrent = phase;
+	myPhases[phase].entries++;
+	return prev;
+}
+
+void CompilerStats::countNode(const ASTNode * node){
+	myNodeCounts[className(node)]++;
+}
+
+size_t CompilerStats::nodeCount(){
+	size_t total = 0;
+	for (auto& count : myNodeCounts){
+		total += count.second;
+	}
+	return total;
+}
+
+const char * CompilerStats::phaseName(Phase phase){
+	switch (phase){
+		case NONE: return "other";
+		case READ: return "read";
+		case SCAN: return "scan";
+		case PARSE: return "parse";
+		case AST: return "ast";
+		case NAMES: return "names";
+		case TYPES: return "types";
+		case INLINE: return "inline";
+		case TAILS: return "tailcalls";
+		case FOLD: return "fold";
+		case LOOPS: return "loops";
+		case DCE: return "dce";
+		case DATAFLOW: return "dataflow";
+		case IR: return "ir";
+		case BYTECODE: return "bytecode";
+		case CODEGEN: return "codegen";
+		case RUN: return "run";
+		case UNPARSE: return "unparse";
+		default: return "?";
+	}
+}
+
+const char * CompilerStats::tokenName(int tag){
+	switch (tag){
+		case TokenTag::END: return "EOF";
+		case TokenTag::BOOL: return "BOOL";
+		case TokenTag::INT: return "INT";
+		case TokenTag::VOID: return "VOID";
+		case TokenTag::TRUE: return "TRUE";
+		case TokenTag::FALSE: return "FALSE";
+		case TokenTag::STRUCT: return "STRUCT";
+		case TokenTag::INPUT: return "INPUT";
+		case TokenTag::OUTPUT: return "OUTPUT";
+		case TokenTag::IF: return "IF";
+		case TokenTag::ELSE: return "ELSE";
+		case TokenTag::WHILE: return "WHILE";
+		case TokenTag::RETURN: return "RETURN";
+		case TokenTag::ID: return "ID";
+		case TokenTag::INTLITERAL: return "INTLITERAL";
+		case TokenTag::STRINGLITERAL: return "STRINGLITERAL";
+		case TokenTag::LCURLY: return "LCURLY";
+		case TokenTag::RCURLY: return "RCURLY";
+		case TokenTag::LPAREN: return "LPAREN";
+		case TokenTag::RPAREN: return "RPAREN";
+		case TokenTag::SEMICOLON: return "SEMICOLON";
+		case TokenTag::COMMA: return "COMMA";
+		case TokenTag::DOT: return "DOT";
+		case TokenTag::WRITE: return "WRITE";
+		case TokenTag::READ: return "READ";
+		case TokenTag::PLUSPLUS: return "PLUSPLUS";
+		case TokenTag::MINUSMINUS: return "MINUSMINUS";
+		case TokenTag::PLUS: return "PLUS";
+		case TokenTag::MINUS: return "MINUS";
+		case TokenTag::TIMES: return "TIMES";
+		case TokenTag::DIVIDE: return "DIVIDE";
+		case TokenTag::NOT: return "NOT";
+		case TokenTag::AND: return "AND";
+		case TokenTag::OR: return "OR";
+		case TokenTag::EQUALS: return "EQUALS";
+		case TokenTag::NOTEQUALS: return "NOTEQUALS";
+		case TokenTag::LESS: return "LESS";
+		case TokenTag::GREATER: return "GREATER";
+		case TokenTag::LESSEQ: return "LESSEQ";
+		case TokenTag::GREATEREQ: return "GREATEREQ";
+		case TokenTag::ASSIGN: return "ASSIGN";
+		default: return "UNKNOWN";
+	}
+}
+
+static long peakRssKB(){
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+template <typename Count>
+static std::vector<std::pair<std::string, size_t>> sortedCounts(Count begin,
+	Count end){
+	std::vector<std::pair<std::string, size_t>> sorted(begin, end);
+	std::stable_sort(sorted.begin(), sorted.end(),
+		[](const std::pair<std::string, size_t>& a,
+		   const std::pair<std::string, size_t>& b){
+			return a.second > b.second;
+		});
+	return sorted;
+}
+
+void CompilerStats::report(std::ostream& out, bool json){
+	// Close out whatever phase is still open.
+	switchPhase(myCurrent);
+
+	std::map<std::string, size_t> tokens;
+	size_t totalTokens = 0;
+	for (size_t tag = 0; tag < myTokenCounts.size(); tag++){
+		if (myTokenCounts[tag] != 0){
+			tokens[tokenName(tag)] += myTokenCounts[tag];
+			totalTokens += myTokenCounts[tag];
+		}
+	}
+	size_t totalNodes = nodeCount();
+	auto tokenList = sortedCounts(tokens.begin(), tokens.end());
+	auto nodeList = sortedCounts(myNodeCounts.begin(), myNodeCounts.end());
+
+	if (json){
+		out << "{\n  \"input_bytes\": " << myInputBytes << ",\n";
+		out << "  \"peak_rss_kb\": " << peakRssKB() << ",\n";
+		out << "  \"phases\": {";
+		for (int p = READ; p < NUM_PHASES; p++){
+			PhaseRecord & rec = myPhases[p];
+			out << (p == READ ? "\n" : ",\n");
+			out << "    \"" << phaseName((Phase)p) << "\": {"
+			    << "\"wall_ms\": " << rec.wall * 1e3
+			    << ", \"cpu_ms\": " << rec.cpu * 1e3
+			    << ", \"alloc_bytes\": " << rec.bytes << "}";
+		}
+		out << "\n  },\n  \"tokens\": {";
+		for (size_t i = 0; i < tokenList.size(); i++){
+			out << (i == 0 ? "\n" : ",\n") << "    \""
+			    << tokenList[i].first << "\": " << tokenList[i].second;
+		}
+		out << "\n  },\n  \"nodes\": {";
+		for (size_t i = 0; i < nodeList.size(); i++){
+			out << (i == 0 ? "\n" : ",\n") << "    \""
+			    << nodeList[i].first << "\": " << nodeList[i].second;
+		}
+		out << "\n  },\n  \"passes\": {";
+		for (size_t i = 0; i < myPassCounts.size(); i++){
+			out << (i == 0 ? "\n" : ",\n") << "    \""
+			    << myPassCounts[i].first << "\": " << myPassCounts[i].second;
+		}
+		out << "\n  }\n}\n";
+		return;
+	}
+
+	out << "input: " << myInputBytes << " bytes, peak RSS: "
+	    << peakRssKB() << " KB\n";
+	out << std::left << std::setw(10) << "phase"
+	    << std::right << std::setw(12) << "wall(ms)"
+	    << std::setw(12) << "cpu(ms)"
+	    << std::setw(16) << "alloc(bytes)" << "\n";
+	out << std::fixed << std::setprecision(3);
+	for (int p = READ; p < NUM_PHASES; p++){
+		PhaseRecord & rec = myPhases[p];
+		out << std::left << std::setw(10) << phaseName((Phase)p)
+		    << std::right << std::setw(12) << rec.wall * 1e3
+		    << std::setw(12) << rec.cpu * 1e3
+		    << std::setw(16) << rec.bytes << "\n";
+	}
+	out << "tokens: " << totalTokens << "\n";
+	for (auto& count : tokenList){
+		out << "  " << std::left << std::setw(24) << count.first
+		    << std::right << std::setw(10) << count.second << "\n";
+	}
+	out << "nodes: " << totalNodes << "\n";
+	for (auto& count : nodeList){
+		out << "  " << std::left << std::setw(24) << count.first
+		    << std::right << std::setw(10) << count.second << "\n";
+	}
+	if (!myPassCounts.empty()){
+		out << "passes:\n";
+	}
+	for (auto& count : myPassCounts){
+		out << "  " << std::left << std::setw(24) << count.first
+		    << std::right << std::setw(10) << count.second << "\n";
+	}
+}
+
+// AST walk for node counts. Only run when --stats is on.
+
+void ASTNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+}
+
+void ProgramNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myDeclList->collectStats(stats);
+}
+
+void DeclListNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	for (DeclNode * decl : myDecls){
+		decl->collectStats(stats);
+	}
+}
+
+void FormalsListNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	for (FormalDeclNode * formal : myFormals){
+		formal->collectStats(stats);
+	}
+}
+
+void VarDeclNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myType->collectStats(stats);
+	myId->collectStats(stats);
+}
+
+void StructNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myId->collectStats(stats);
+}
+
+void FormalDeclNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myType->collectStats(stats);
+	myId->collectStats(stats);
+}
+
+void StmtListNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	for (StmtNode * stmt : myList){
+		stmt->collectStats(stats);
+	}
+}
+
+void FnBodyNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	// Counts what has been built, so a lazy body is left unparsed
+	if (isParsed()){
+		myDecls->collectStats(stats);
+		myStmts->collectStats(stats);
+	}
+}
+
+void FnDeclNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myType->collectStats(stats);
+	myId->collectStats(stats);
+	if (myFormals != nullptr){
+		myFormals->collectStats(stats);
+	}
+	myBody->collectStats(stats);
+}
+
+void VarDeclListNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	for (VarDeclNode * decl : myVarDecls){
+		decl->collectStats(stats);
+	}
+}
+
+void StructDeclNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myId->collectStats(stats);
+	myDecls->collectStats(stats);
+}
+
+void AssignStmtNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myAssign->collectStats(stats);
+}
+
+void PostIncStmtNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myLoc->collectStats(stats);
+}
+
+void PostDecStmtNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myLoc->collectStats(stats);
+}
+
+void ReadStmtNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myLoc->collectStats(stats);
+}
+
+void WriteStmtNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myLoc->collectStats(stats);
+}
+
+void ReturnStmtNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	if (myLoc != nullptr){
+		myLoc->collectStats(stats);
+	}
+}
+
+void CallStmtNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myCall->collectStats(stats);
+}
+
+void IfStmtNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myExp->collectStats(stats);
+	myVarList->collectStats(stats);
+	myStmtList->collectStats(stats);
+}
+
+void IfElseStmtNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myExp->collectStats(stats);
+	myVarList->collectStats(stats);
+	myStmtList->collectStats(stats);
+	myElseVarList->collectStats(stats);
+	myElseStmtList->collectStats(stats);
+}
+
+void WhileStmtNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myExp->collectStats(stats);
+	myVarList->collectStats(stats);
+	myStmtList->collectStats(stats);
+}
+
+void AssignNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myLeft->collectStats(stats);
+	myRight->collectStats(stats);
+}
+
+void DotAccessNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myLeft->collectStats(stats);
+	myRight->collectStats(stats);
+}
+
+void CallExpNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myLoc->collectStats(stats);
+	if (myList != nullptr){
+		myList->collectStats(stats);
+	}
+}
+
+void ExpListNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	for (ExpNode * exp : myList){
+		exp->collectStats(stats);
+	}
+}
+
+void UnaryExpNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myNode->collectStats(stats);
+}
+
+void BinaryExpNode::collectStats(CompilerStats& stats){
+	stats.countNode(this);
+	myLeft->collectStats(stats);
+	myRight->collectStats(stats);
+}
+
+} // End namespace LIL' C
@@ -0,0 +1,93 @@
+#ifndef __LILC_STATS_HPP__
+#define __LILC_STATS_HPP__ 1
+
+#include <cstddef>
+#include <ostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace LILC{
+
+class ASTNode;
+
+// Per-phase timers and counters behind P3's --stats flag. The compiler
+// only holds a CompilerStats when stats were requested, so every hook is
+// a null pointer check when they are off.
+class CompilerStats{
+public:
+	enum Phase { NONE, READ, SCAN, PARSE, AST, NAMES, TYPES, INLINE, TAILS, FOLD, LOOPS, DCE, DATAFLOW, IR, BYTECODE, CODEGEN, RUN, UNPARSE, NUM_PHASES };
+
+	CompilerStats();
+
+	// Charges everything since the last switch to the current phase and
+	// makes `phase` current. Returns the phase that was current before.
+	// Fine-grained switches (once per token or reduction) skip the CPU
+	// clock, which is a system call; the CPU time of the enclosing coarse
+	// interval is split between its phases by wall time instead.
+	Phase switchPhase(Phase phase, bool fine = false);
+
+	void countToken(int tag){
+		if (tag >= (int)myTokenCounts.size()){
+			myTokenCounts.resize(tag + 1, 0);
+		}
+		myTokenCounts[tag]++;
+	}
+	void countNode(const ASTNode * node);
+	size_t nodeCount();
+	void countBytes(size_t bytes){ myInputBytes += bytes; }
+	// Records a result of an optimization pass, e.g. nodes folded away.
+	// Reported in the order recorded.
+	void countPass(const std::string& name, size_t value){
+		myPassCounts.emplace_back(name, value);
+	}
+
+	void report(std::ostream& out, bool json);
+
+	static const char * phaseName(Phase phase);
+	static const char * tokenName(int tag);
+private:
+	struct PhaseRecord {
+		double wall = 0;
+		double cpu = 0;
+		size_t bytes = 0;
+		size_t entries = 0;
+	};
+	PhaseRecord myPhases[NUM_PHASES];
+	double myIntervalWall[NUM_PHASES];
+	Phase myCurrent;
+	double myLastWall;
+	double myLastCpu;
+	size_t myLastBytes;
+	size_t myInputBytes;
+	std::vector<size_t> myTokenCounts;
+	std::map<std::string, size_t> myNodeCounts;
+	std::vector<std::pair<std::string, size_t>> myPassCounts;
+};
+
+// Makes `phase` current for the lifetime of the scope and restores the
+// enclosing phase afterwards, so nested phases (e.g. scanning inside
+// parsing) are charged exclusively.
+class PhaseScope{
+public:
+	PhaseScope(CompilerStats * stats, CompilerStats::Phase phase,
+		bool fine = false){
+		myStats = stats;
+		myFine = fine;
+		if (myStats != nullptr){
+			myPrev = myStats->switchPhase(phase, myFine);
+		}
+	}
+	~PhaseScope(){
+		if (myStats != nullptr){
+			myStats->switchPhase(myPrev, myFine);
+		}
+	}
+private:
+	CompilerStats * myStats;
+	CompilerStats::Phase myPrev;
+	bool myFine;
+};
+
+} /* end namespace */
+#endif /* END __LILC_STATS_HPP__ */
@@ -0,0 +1,185 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+#include "lilc_watch.hpp"
+
+#ifdef __linux__
+#define LILC_WATCH_INOTIFY 1
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace LILC{
+
+static bool isSource(const std::string& name){
+	return name.size() > 5 && name.compare(name.size() - 5, 5, ".lilc") == 0
+		&& name[0] != '.';
+}
+
+// Where a rebuild of the source name writes its unparsed program
+static std::string outPath(const std::string& outDir, const std::string& name){
+	return outDir + "/" + name.substr(0, name.size() - 5) + ".out";
+}
+
+void Watcher::rebuild(const std::string& name, std::ostream& log){
+	using namespace std::chrono;
+	steady_clock::time_point start = steady_clock::now();
+	std::unique_ptr<LilC_Compiler>& compiler = myCompilers[name];
+	if (compiler == nullptr){
+		compiler.reset(new LilC_Compiler());
+		compiler->setParserEngine(myEngine);
+	}
+	std::ostringstream errors;
+	compiler->setErrorStream(errors);
+	std::string path = myDir + "/" + name;
+	bool ok = compiler->parse(path.c_str());
+	if (ok && myNames){
+		ok = compiler->nameAnalysis();
+	}
+	if (ok && myTypes){
+		ok = compiler->typeCheck(1);
+	}
+	if (ok && !myOutDir.empty()){
+		std::ofstream out(outPath(myOutDir, name));
+		ok = compiler->unparse(out) && out.good();
+	}
+	compiler->setErrorStream(std::cerr);
+	double ms = duration<double, std::milli>(steady_clock::now() - start).count();
+	myRebuilds++;
+
+	// Errors carry the file name, as they come from several files
+	std::istringstream lines(errors.str());
+	std::string line;
+	while (std::getline(lines, line)){
+		log << name << ":" << line << "\n";
+	}
+	log << (ok ? "ok     " : "failed ") << name << " (" << std::fixed
+	    << std::setprecision(3) << ms << " ms)" << std::endl;
+}
+
+void Watcher::forget(const std::string& name, std::ostream& log){
+	// The output of a file that is gone would only be stale
+	if (!myOutDir.empty()){
+		std::remove(outPath(myOutDir, name).c_str());
+	}
+	if (myCompilers.erase(name) != 0){
+		log << "gone   " << name << std::endl;
+	}
+}
+
+#ifndef LILC_WATCH_INOTIFY
+
+bool Watcher::supported(){
+	return false;
+}
+
+bool Watcher::run(std::ostream& log){
+	log << "***ERROR*** --watch needs Linux (inotify)" << std::endl;
+	return false;
+}
+
+#else
+
+bool Watcher::supported(){
+	return true;
+}
+
+bool Watcher::run(std::ostream& log){
+	int fd = inotify_init1(IN_CLOEXEC);
+	if (fd < 0){
+		log << "***ERROR*** inotify is not available" << std::endl;
+		return false;
+	}
+	// Editors save in place (close-write) or by renaming a temporary over
+	// the file (moved-to); touch only changes the attributes
+	const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB
+		| IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF;
+	if (inotify_add_watch(fd, myDir.c_str(), mask) < 0){
+		log << "***ERROR*** cannot watch " << myDir << std::endl;
+		close(fd);
+		return false;
+	}
+
+	// Watching starts before the first build so no save is missed
+	std::set<std::string> names;
+	if (DIR * dir = opendir(myDir.c_str())){
+		while (dirent * entry = readdir(dir)){
+			if (isSource(entry->d_name)){
+				names.insert(entry->d_name);
+			}
+		}
+		closedir(dir);
+	}
+	for (const std::string& name : names){
+		rebuild(name, log);
+	}
+	log << "watching " << myDir << " (" << names.size() << " files)"
+	    << std::endl;
+
+	alignas(inotify_event) char buffer[64 * 1024];
+	bool done = false;
+	while (!done){
+		// One save raises several events, e.g. touch's attribute change
+		// and close-write; those arriving within SETTLE_MS of each other
+		// make one batch, in which each file is rebuilt once
+		std::set<std::string> changed;
+		std::set<std::string> removed;
+		ssize_t length = read(fd, buffer, sizeof(buffer));
+		if (length <= 0){
+			break;
+		}
+		pollfd more = { fd, POLLIN, 0 };
+		while (length > 0){
+			collect(buffer, length, changed, removed, done);
+			length = 0;
+			if (poll(&more, 1, SETTLE_MS) > 0){
+				length = read(fd, buffer, sizeof(buffer));
+			}
+		}
+		for (const std::string& name : removed){
+			forget(name, log);
+		}
+		for (const std::string& name : changed){
+			rebuild(name, log);
+		}
+	}
+	if (done){
+		log << "stopped: " << myDir << " is gone" << std::endl;
+	}
+	close(fd);
+	return true;
+}
+
+void Watcher::collect(char * buffer, size_t length,
+	std::set<std::string>& changed, std::set<std::string>& removed,
+	bool& done){
+	for (char * at = buffer; at < buffer + length; ){
+		inotify_event * event = (inotify_event *)at;
+		at += sizeof(inotify_event) + event->len;
+		if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)){
+			done = true;
+			continue;
+		}
+		if (event->len == 0 || !isSource(event->name)
+			|| (event->mask & IN_ISDIR)){
+			continue;
+		}
+		if (event->mask & (IN_DELETE | IN_MOVED_FROM)){
+			changed.erase(event->name);
+			removed.insert(event->name);
+		} else {
+			removed.erase(event->name);
+			changed.insert(event->name);
+		}
+	}
+}
+
+#endif
+
+} /* end namespace */
@@ -0,0 +1,68 @@
+#ifndef __LILC_WATCH_HPP__
+#define __LILC_WATCH_HPP__ 1
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <string>
+
+#include "lilc_compiler.hpp"
+
+namespace LILC{
+
+// P3 --watch: stays resident over a directory, compiles each of its .lilc
+// files once and then again whenever inotify reports the file written,
+// moved in or touched, printing how long each rebuild took. Every file
+// keeps its compiler, and with it its last AST, between rebuilds. Only
+// the directory itself is watched, not subdirectories.
+class Watcher{
+public:
+	// With an outDir, each file's unparsed program is written there as
+	// <name>.out after every successful rebuild, and removed with the file
+	Watcher(const std::string& dir, const std::string& outDir){
+		myDir = dir;
+		myOutDir = outDir;
+	}
+
+	// Whether this platform has inotify
+	static bool supported();
+
+	// What each rebuild runs after parsing, as for P3 without --watch
+	void setChecks(bool names, bool types){
+		myNames = names;
+		myTypes = types;
+	}
+	void setParserEngine(LilC_Compiler::ParserEngine engine){
+		myEngine = engine;
+	}
+
+	// Builds everything, then watches until the directory goes away or
+	// the process is stopped. Returns false if it could not be watched.
+	bool run(std::ostream& log);
+
+	size_t rebuilds(){ return myRebuilds; }
+private:
+	// Compiles dir/name and logs the outcome and latency
+	void rebuild(const std::string& name, std::ostream& log);
+	void forget(const std::string& name, std::ostream& log);
+	// Sorts a read's inotify events into files to rebuild and to forget;
+	// sets done when the directory itself went away
+	void collect(char * buffer, size_t length,
+		std::set<std::string>& changed, std::set<std::string>& removed,
+		bool& done);
+
+	static const int SETTLE_MS = 10;
+
+	std::string myDir;
+	std::string myOutDir;
+	bool myNames = false;
+	bool myTypes = false;
+	LilC_Compiler::ParserEngine myEngine = LilC_Compiler::BISON;
+	// By file name
+	std::map<std::string, std::unique_ptr<LilC_Compiler>> myCompilers;
+	size_t myRebuilds = 0;
+};
+
+} /* end namespace */
+#endif /* END __LILC_WATCH_HPP__ */
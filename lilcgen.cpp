@@ -0,0 +1,420 @@
+// Deterministic generator of synthetic Lil' C programs for benchmarking.
+//
+// Usage: lilcgen [options] > out.lilc
+//   --seed N          PRNG seed (default 1)
+//   --functions N     number of functions besides main (default 10)
+//   --structs N       number of struct declarations (default 2)
+//   --stmts N         statements per function body (default 20)
+//   --depth N         expression nesting depth (default 2)
+//   --width N         operands per arithmetic chain (default 3)
+//   --dot N           DotAccessNode chain length, 0 disables (default 2);
+//                     capped at the number of structs
+//   --vocab N         identifier vocabulary size (default 16)
+//   --comments P      probability of a comment per statement (default 0.1)
+//   --whitespace P    probability of extra blanks/blank lines (default 0.1)
+//
+// The same options and seed always produce the same bytes. Every program
+// parses with lilc.yy, loops are bounded counter loops and functions only
+// call functions declared before them, so the output also terminates when
+// executed. Every name is declared before use, so programs also pass name
+// analysis: each struct nests the previous one in its mnest field and
+// functions access fields through a local of the outermost struct.
+// Identifiers contain letters only, as the scanner does not accept digits
+// in identifiers.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace LILC{
+
+struct GenOptions {
+	uint64_t seed = 1;
+	int functions = 10;
+	int structs = 2;
+	int stmts = 20;
+	int depth = 2;
+	int width = 3;
+	int dot = 2;
+	int vocab = 16;
+	double comments = 0.1;
+	double whitespace = 0.1;
+};
+
+class LilCGenerator{
+public:
+	LilCGenerator(const GenOptions& opts, std::ostream& out)
+	: myOpts(opts), myOut(out){
+		myState = opts.seed * 0x9E3779B97F4A7C15ULL + 1;
+		for (int i = 0; (int)myVocab.size() < opts.vocab; i++){
+			std::string word = "v" + letters(i);
+			if (!isKeyword(word)){
+				myVocab.push_back(word);
+			}
+		}
+	}
+
+	void program(){
+		for (int s = 0; s < myOpts.structs; s++){
+			structDecl(s);
+		}
+		myOut << "int gcount;\n\n";
+		for (int f = 0; f < myOpts.functions; f++){
+			function(f);
+		}
+		mainFunction();
+	}
+
+private:
+	struct Local {
+		std::string name;
+		bool isInt;
+	};
+
+	// splitmix64: stable across platforms, unlike <random> distributions
+	uint64_t next(){
+		uint64_t z = (myState += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+	int below(int n){ return n <= 0 ? 0 : (int)(next() % (uint64_t)n); }
+	bool chance(double p){ return (next() >> 11) * (1.0 / 9007199254740992.0) < p; }
+
+	static std::string letters(int n){
+		std::string s;
+		do {
+			s += (char)('a' + n % 26);
+			n /= 26;
+		} while (n > 0);
+		return s;
+	}
+
+	static bool isKeyword(const std::string& word){
+		static const char * keywords[] = { "bool", "int", "void", "true",
+			"false", "struct", "input", "output", "if", "else", "while",
+			"return" };
+		for (const char * kw : keywords){
+			if (word == kw){ return true; }
+		}
+		return false;
+	}
+
+	std::string fnName(int f){ return "fn" + letters(f); }
+	std::string structName(int s){ return "S" + letters(s); }
+	std::string fieldName(int f){ return "m" + letters(f); }
+
+	// A separator between tokens, occasionally padded.
+	const char * sep(){
+		if (!chance(myOpts.whitespace)){ return " "; }
+		return chance(0.5) ? "  " : " \t";
+	}
+
+	void indent(int level){
+		for (int i = 0; i < level; i++){ myOut << "\t"; }
+	}
+
+	void filler(int level){
+		if (chance(myOpts.whitespace)){
+			myOut << "\n";
+		}
+		if (chance(myOpts.comments)){
+			indent(level);
+			myOut << (chance(0.5) ? "// " : "# ") << "note "
+			      << letters(below(10000)) << " about the next line\n";
+		}
+	}
+
+	void structDecl(int s){
+		myOut << "struct" << sep() << structName(s) << " {\n";
+		int fields = 2 + below(3);
+		for (int f = 0; f < fields; f++){
+			myOut << "\t" << (f % 2 == 0 ? "int" : "bool") << sep()
+			      << fieldName(f) << ";\n";
+		}
+		if (s > 0){
+			myOut << "\tstruct" << sep() << structName(s - 1) << sep()
+			      << "mnest;\n";
+		}
+		myOut << "};\n\n";
+	}
+
+	void declareLocals(int level){
+		myLocals.clear();
+		int count = std::min(myOpts.vocab, 6);
+		std::vector<int> picked;
+		while ((int)picked.size() < count){
+			int idx = below(myOpts.vocab);
+			bool seen = false;
+			for (int p : picked){ seen = seen || p == idx; }
+			if (!seen){ picked.push_back(idx); }
+		}
+		for (size_t i = 0; i < picked.size(); i++){
+			Local local = { myVocab[picked[i]], i % 3 != 2 };
+			if (i == 0){ local.isInt = true; }
+			myLocals.push_back(local);
+			filler(level);
+			indent(level);
+			myOut << (local.isInt ? "int" : "bool") << sep()
+			      << local.name << ";\n";
+		}
+		for (int d = 0; d < 3; d++){
+			indent(level);
+			myOut << "int" << sep() << counterName(d) << ";\n";
+		}
+		if (dotLength() > 0){
+			indent(level);
+			myOut << "struct" << sep() << structName(myOpts.structs - 1)
+			      << sep() << "rec;\n";
+		}
+	}
+
+	int dotLength(){ return std::min(myOpts.dot, myOpts.structs); }
+
+	std::string counterName(int depth){ return "loop" + letters(depth); }
+
+	const Local& pick(bool isInt){
+		size_t start = below(myLocals.size());
+		for (size_t i = 0; i < myLocals.size(); i++){
+			const Local& local = myLocals[(start + i) % myLocals.size()];
+			if (local.isInt == isInt){ return local; }
+		}
+		return myLocals[start];
+	}
+
+	void loc(bool isInt){
+		if (isInt && dotLength() > 0 && chance(0.1)){
+			myOut << "rec";
+			for (int d = 1; d < dotLength(); d++){
+				myOut << ".mnest";
+			}
+			// Field 0 is an int in every struct
+			myOut << "." << fieldName(0);
+			return;
+		}
+		myOut << pick(isInt).name;
+	}
+
+	void intLeaf(int depth){
+		int kind = below(10);
+		if (kind < 5){
+			loc(true);
+		} else if (kind < 8){
+			myOut << below(100);
+		} else if (kind < 9 && myCallable > 0){
+			call(depth);
+		} else {
+			myOut << "gcount";
+		}
+	}
+
+	void call(int depth){
+		int f = below(myCallable);
+		myOut << fnName(f) << "(";
+		intExp(depth > 0 ? depth - 1 : 0);
+		myOut << "," << sep();
+		intExp(depth > 0 ? depth - 1 : 0);
+		myOut << ")";
+	}
+
+	// An int-valued term as used by the comparison productions.
+	void intTerm(int depth){
+		if (depth > 0 && chance(0.5)){
+			myOut << "(";
+			intExp(depth - 1);
+			myOut << ")";
+		} else {
+			intLeaf(depth);
+		}
+	}
+
+	void intExp(int depth){
+		int width = 1 + below(myOpts.width);
+		for (int i = 0; i < width; i++){
+			if (i > 0){
+				static const char * ops[] = { "+", "-", "*", "/" };
+				const char * op = ops[below(4)];
+				myOut << sep() << op << sep();
+				if (op[0] == '/'){
+					// Never divide by something that could be zero.
+					myOut << 1 + below(9);
+					continue;
+				}
+			}
+			if (chance(0.1)){
+				myOut << "-";
+			}
+			intTerm(depth);
+		}
+	}
+
+	void boolExp(int depth){
+		int kind = below(8);
+		if (kind == 0 && depth > 0){
+			myOut << "!(";
+			boolExp(depth - 1);
+			myOut << ")";
+		} else if (kind <= 2 && depth > 0){
+			myOut << "(";
+			boolExp(depth - 1);
+			myOut << ")" << sep() << (kind == 1 ? "&&" : "||") << sep() << "(";
+			boolExp(depth - 1);
+			myOut << ")";
+		} else if (kind == 3){
+			static const char * lits[] = { "true", "false" };
+			myOut << (chance(0.5) ? pick(false).name : lits[below(2)]);
+		} else {
+			static const char * rel[] = { "<", ">", "<=", ">=", "==", "!=" };
+			intTerm(depth);
+			myOut << sep() << rel[below(6)] << sep();
+			intTerm(depth);
+		}
+	}
+
+	void block(int level, int nest, int length){
+		for (int i = 0; i < length; i++){
+			filler(level);
+			stmt(level, nest);
+		}
+	}
+
+	void stmt(int level, int nest){
+		int kind = below(20);
+		if (nest >= 2 && kind >= 14){
+			kind = below(14);
+		}
+		int inner = std::max(1, myOpts.stmts / 4);
+		indent(level);
+		if (kind < 6){
+			loc(true);
+			myOut << sep() << "=" << sep();
+			intExp(myOpts.depth);
+			myOut << ";\n";
+		} else if (kind < 8){
+			myOut << pick(false).name << sep() << "=" << sep();
+			boolExp(myOpts.depth);
+			myOut << ";\n";
+		} else if (kind < 10){
+			loc(true);
+			myOut << (kind == 8 ? "++;\n" : "--;\n");
+		} else if (kind < 11){
+			myOut << "output" << sep() << "<<" << sep();
+			if (chance(0.3)){
+				myOut << "\"value\\n\"";
+			} else {
+				intExp(myOpts.depth);
+			}
+			myOut << ";\n";
+		} else if (kind < 12 && myCallable > 0){
+			call(myOpts.depth);
+			myOut << ";\n";
+		} else if (kind < 14){
+			myOut << "gcount++;\n";
+		} else if (kind < 17){
+			myOut << "if" << sep() << "(";
+			boolExp(myOpts.depth);
+			myOut << ") {\n";
+			block(level + 1, nest + 1, inner);
+			indent(level);
+			if (kind == 16){
+				myOut << "} else {\n";
+				block(level + 1, nest + 1, inner);
+				indent(level);
+			}
+			myOut << "}\n";
+		} else {
+			std::string counter = counterName(nest);
+			myOut << counter << sep() << "=" << sep() << "0;\n";
+			indent(level);
+			myOut << "while" << sep() << "(" << counter << sep() << "<"
+			      << sep() << 1 + below(8) << ") {\n";
+			block(level + 1, nest + 1, inner);
+			indent(level + 1);
+			myOut << counter << "++;\n";
+			indent(level);
+			myOut << "}\n";
+		}
+	}
+
+	void function(int f){
+		myOut << "int" << sep() << fnName(f) << "(int pa," << sep()
+		      << "int pb) {\n";
+		declareLocals(1);
+		myLocals.push_back({ "pa", true });
+		myLocals.push_back({ "pb", true });
+		for (const Local& local : myLocals){
+			if (local.isInt && local.name[0] == 'v'){
+				indent(1);
+				myOut << local.name << " = pa;\n";
+			}
+		}
+		block(1, 0, myOpts.stmts);
+		indent(1);
+		myOut << "return" << sep();
+		intExp(myOpts.depth);
+		myOut << ";\n}\n\n";
+		myCallable = f + 1;
+	}
+
+	void mainFunction(){
+		myOut << "void main() {\n";
+		declareLocals(1);
+		for (const Local& local : myLocals){
+			if (local.isInt && local.name[0] == 'v'){
+				indent(1);
+				myOut << local.name << " = " << below(10) << ";\n";
+			}
+		}
+		block(1, 0, myOpts.stmts);
+		for (int f = 0; f < myOpts.functions; f++){
+			indent(1);
+			myOut << "output << " << fnName(f) << "(" << f << ", "
+			      << below(100) << ");\n";
+		}
+		myOut << "}\n";
+	}
+
+	GenOptions myOpts;
+	std::ostream& myOut;
+	uint64_t myState;
+	std::vector<std::string> myVocab;
+	std::vector<Local> myLocals;
+	int myCallable = 0;
+};
+
+} // End namespace LIL' C
+
+int
+main( const int argc, const char **argv )
+{
+	LILC::GenOptions opts;
+	for (int i = 1; i < argc; i++){
+		const char * arg = argv[i];
+		if (i + 1 >= argc){
+			std::cerr << "lilcgen: missing value for " << arg << std::endl;
+			return 1;
+		}
+		const char * val = argv[++i];
+		if (strcmp(arg, "--seed") == 0){ opts.seed = strtoull(val, nullptr, 10); }
+		else if (strcmp(arg, "--functions") == 0){ opts.functions = atoi(val); }
+		else if (strcmp(arg, "--structs") == 0){ opts.structs = atoi(val); }
+		else if (strcmp(arg, "--stmts") == 0){ opts.stmts = atoi(val); }
+		else if (strcmp(arg, "--depth") == 0){ opts.depth = atoi(val); }
+		else if (strcmp(arg, "--width") == 0){ opts.width = std::max(1, atoi(val)); }
+		else if (strcmp(arg, "--dot") == 0){ opts.dot = atoi(val); }
+		else if (strcmp(arg, "--vocab") == 0){ opts.vocab = std::max(1, atoi(val)); }
+		else if (strcmp(arg, "--comments") == 0){ opts.comments = atof(val); }
+		else if (strcmp(arg, "--whitespace") == 0){ opts.whitespace = atof(val); }
+		else {
+			std::cerr << "lilcgen: unknown option " << arg << std::endl;
+			return 1;
+		}
+	}
+	LILC::LilCGenerator gen(opts, std::cout);
+	gen.program();
+	return 0;
+}
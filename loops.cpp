@@ -0,0 +1,396 @@
+#include <climits>
+#include <iterator>
+
+#include "ast.hpp"
+#include "inline.hpp"
+#include "loops.hpp"
+#include "symbol_table.hpp"
+
+namespace LILC{
+
+void LoopOptimizer::run(ProgramNode * program){
+	for (DeclNode * decl : program->getDeclList()->getDecls()){
+		myFn = dynamic_cast<FnDeclNode *>(decl);
+		if (myFn != nullptr){
+			FreshNames names(program, myFn);
+			myNames = &names;
+			myFn->getBody()->getStmts()->optimizeLoops(this);
+		}
+	}
+	myFn = nullptr;
+	myNames = nullptr;
+}
+
+std::list<StmtNode *>::iterator LoopOptimizer::optimize(
+	std::list<StmtNode *>& stmts, std::list<StmtNode *>::iterator it){
+	WhileStmtNode * loop = static_cast<WhileStmtNode *>(*it);
+	auto next = std::next(it);
+	const std::list<StmtNode *>& body = loop->getBody()->getStmts();
+	if (body.empty()){
+		return next;
+	}
+	// The counter is what the last statement steps
+	ExpNode * loc = nullptr;
+	int step = 0;
+	if (PostIncStmtNode * inc = dynamic_cast<PostIncStmtNode *>(body.back())){
+		loc = inc->getLoc();
+		step = 1;
+	} else if (PostDecStmtNode * dec = dynamic_cast<PostDecStmtNode *>(body.back())){
+		loc = dec->getLoc();
+		step = -1;
+	}
+	IdNode * id = dynamic_cast<IdNode *>(loc);
+	SemSymbol * var = id == nullptr ? nullptr : id->getSymbol();
+	if (var == nullptr || var->isGlobal()
+	    || dynamic_cast<IntNode *>(var->getType()) == nullptr){
+		return next;
+	}
+	myCounter = var;
+	myStep = step;
+	myWrites = 0;
+	myLocals = false;
+	loop->surveyLoop(this);
+	if (myWrites != 1){
+		myCounter = nullptr;
+		return next;
+	}
+	myCounterLoops++;
+
+	// Decided before the products' initial values go in front of the loop
+	int64_t start = 0;
+	int64_t trips = -1;
+	bool known = it != stmts.begin()
+		&& tripCount(*std::prev(it), loop->getCondition(), start, trips);
+
+	// Copies of a fully unrolled body each see the counter as it is
+	bool unrolled = known && !myLocals;
+	bool full = unrolled
+		&& (uint64_t)trips * loop->getBody()->nodeCount() <= FULL_UNROLL_NODES;
+	myProducts.clear();
+	if (!full){
+		loop->reduceStrength(this);
+	}
+	for (auto& product : myProducts){
+		SemSymbol * tracker = product.second;
+		size_t line = tracker->getId()->getLine();
+		size_t col = tracker->getId()->getCol();
+		stmts.insert(it, varAssign(tracker, new TimesNode(
+			varUse(var, line, col), new IntLitNode(product.first, line, col))));
+		ExpNode * now = varUse(tracker, line, col);
+		ExpNode * by = new IntLitNode(product.first, line, col);
+		ExpNode * stepped = step > 0 ? (ExpNode *)new PlusNode(now, by)
+			: (ExpNode *)new MinusNode(now, by);
+		loop->getBody()->add(varAssign(tracker, stepped));
+	}
+	if (unrolled){
+		unroll(stmts, it, start, trips);
+	}
+	myCounter = nullptr;
+	return next;
+}
+
+bool LoopOptimizer::tripCount(StmtNode * init, ExpNode * test,
+	int64_t& start, int64_t& trips){
+	AssignStmtNode * assignment = dynamic_cast<AssignStmtNode *>(init);
+	if (assignment == nullptr){
+		return false;
+	}
+	IdNode * var = dynamic_cast<IdNode *>(assignment->getAssign()->getLeft());
+	IntLitNode * first = dynamic_cast<IntLitNode *>(
+		assignment->getAssign()->getRight());
+	BinaryExpNode * compare = dynamic_cast<BinaryExpNode *>(test);
+	if (var == nullptr || var->getSymbol() != myCounter || first == nullptr
+	    || compare == nullptr){
+		return false;
+	}
+	IdNode * counter = dynamic_cast<IdNode *>(compare->getLeft());
+	IntLitNode * last = dynamic_cast<IntLitNode *>(compare->getRight());
+	if (counter == nullptr || counter->getSymbol() != myCounter
+	    || last == nullptr){
+		return false;
+	}
+	start = first->getValue();
+	int64_t bound = last->getValue();
+	// An inclusive bound at the end of the int range would wrap forever
+	if (myStep > 0 && dynamic_cast<LessNode *>(test) != nullptr){
+		trips = bound - start;
+	} else if (myStep > 0 && dynamic_cast<LessEqNode *>(test) != nullptr
+	    && bound < INT_MAX){
+		trips = bound - start + 1;
+	} else if (myStep < 0 && dynamic_cast<GreaterNode *>(test) != nullptr){
+		trips = start - bound;
+	} else if (myStep < 0 && dynamic_cast<GreaterEqNode *>(test) != nullptr
+	    && bound > INT_MIN){
+		trips = start - bound + 1;
+	} else {
+		return false;
+	}
+	trips = std::max<int64_t>(trips, 0);
+	return true;
+}
+
+void LoopOptimizer::unroll(std::list<StmtNode *>& stmts,
+	std::list<StmtNode *>::iterator it, int64_t start, int64_t trips){
+	WhileStmtNode * loop = static_cast<WhileStmtNode *>(*it);
+	StmtListNode * body = loop->getBody();
+	size_t nodes = body->nodeCount();
+	// Not expanding a call, it copies the body as it is
+	Inliner copier;
+	auto copyBody = [&](std::list<StmtNode *>& out, int64_t times){
+		for (int64_t k = 0; k < times; k++){
+			for (StmtNode * stmt : body->getStmts()){
+				out.push_back(stmt->clone(&copier));
+			}
+		}
+	};
+
+	if ((uint64_t)trips * nodes <= FULL_UNROLL_NODES){
+		// The condition has no side effects to keep
+		std::list<StmtNode *> copies;
+		copyBody(copies, trips);
+		stmts.splice(it, copies);
+		stmts.erase(it);
+		myFullyUnrolled++;
+		return;
+	}
+	if (myFactor < 2 || (uint64_t)trips < myFactor
+	    || nodes * myFactor > MAX_UNROLL_NODES){
+		return;
+	}
+	int64_t rest = trips % myFactor;
+	std::list<StmtNode *> copies;
+	copyBody(copies, myFactor);
+	// The counter is i0 + k * step at the top of each iteration
+	int64_t bound = start + myStep * (trips - rest);
+	ExpNode * test = loop->getCondition();
+	ExpNode * counter = varUse(myCounter, test->getLine(), test->getCol());
+	ExpNode * limit = new IntLitNode((int)bound, test->getLine(),
+		test->getCol());
+	ExpNode * condition = myStep > 0
+		? (ExpNode *)new LessNode(counter, limit)
+		: (ExpNode *)new GreaterNode(counter, limit);
+	*it = new WhileStmtNode(condition, loop->getDecls(),
+		new StmtListNode(&copies));
+	std::list<StmtNode *> leftover;
+	copyBody(leftover, rest);
+	stmts.splice(std::next(it), leftover);
+	myUnrolled++;
+}
+
+void LoopOptimizer::noteWrite(ExpNode * loc){
+	IdNode * id = dynamic_cast<IdNode *>(loc);
+	if (id != nullptr && id->getSymbol() == myCounter){
+		myWrites++;
+	}
+}
+
+void LoopOptimizer::noteLocals(VarDeclListNode * decls){
+	if (!decls->getDecls().empty()){
+		myLocals = true;
+	}
+}
+
+ExpNode * LoopOptimizer::reduce(ExpNode * left, ExpNode * right){
+	IdNode * id = dynamic_cast<IdNode *>(left);
+	IntLitNode * lit = dynamic_cast<IntLitNode *>(right);
+	if (id == nullptr){
+		id = dynamic_cast<IdNode *>(right);
+		lit = dynamic_cast<IntLitNode *>(left);
+	}
+	if (id == nullptr || lit == nullptr || id->getSymbol() != myCounter){
+		return nullptr;
+	}
+	SemSymbol *& tracker = myProducts[lit->getValue()];
+	if (tracker == nullptr){
+		tracker = freshLocal(id->getName() + "_times_", myCounter);
+	}
+	myReduced++;
+	return varUse(tracker, id->getLine(), id->getCol());
+}
+
+SemSymbol * LoopOptimizer::freshLocal(const std::string& name,
+	SemSymbol * like){
+	IdNode * at = like->getId();
+	IdNode * id = new IdNode(myNames->make("_" + name), at->getLine(),
+		at->getCol());
+	VarDeclNode * decl = new VarDeclNode(like->getType(), id,
+		VarDeclNode::NOT_STRUCT);
+	SemSymbol * sym = new SemSymbol(SemSymbol::VAR, id, decl, like->getType());
+	id->setSymbol(sym);
+	myFn->addLocal(decl);
+	return sym;
+}
+
+// Statements
+
+void StmtListNode::optimizeLoops(LoopOptimizer * loops){
+	auto it = myList.begin();
+	while (it != myList.end()){
+		(*it)->optimizeLoops(loops);
+		if (dynamic_cast<WhileStmtNode *>(*it) != nullptr){
+			it = loops->optimize(myList, it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void StmtListNode::surveyLoop(LoopOptimizer * loops){
+	for (StmtNode * stmt : myList){
+		stmt->surveyLoop(loops);
+	}
+}
+
+void StmtListNode::reduceStrength(LoopOptimizer * loops){
+	for (StmtNode * stmt : myList){
+		stmt->reduceStrength(loops);
+	}
+}
+
+void AssignStmtNode::surveyLoop(LoopOptimizer * loops){
+	myAssign->surveyLoop(loops);
+}
+
+void AssignStmtNode::reduceStrength(LoopOptimizer * loops){
+	myAssign->reduceStrength(loops);
+}
+
+void PostIncStmtNode::surveyLoop(LoopOptimizer * loops){
+	loops->noteWrite(myLoc);
+}
+
+void PostIncStmtNode::reduceStrength(LoopOptimizer * loops){}
+
+void PostDecStmtNode::surveyLoop(LoopOptimizer * loops){
+	loops->noteWrite(myLoc);
+}
+
+void PostDecStmtNode::reduceStrength(LoopOptimizer * loops){}
+
+void ReadStmtNode::surveyLoop(LoopOptimizer * loops){
+	loops->noteWrite(myLoc);
+}
+
+void ReadStmtNode::reduceStrength(LoopOptimizer * loops){}
+
+void WriteStmtNode::surveyLoop(LoopOptimizer * loops){
+	myLoc->surveyLoop(loops);
+}
+
+void WriteStmtNode::reduceStrength(LoopOptimizer * loops){
+	myLoc = myLoc->reduceStrength(loops);
+}
+
+void ReturnStmtNode::surveyLoop(LoopOptimizer * loops){
+	if (myLoc != nullptr){
+		myLoc->surveyLoop(loops);
+	}
+}
+
+void ReturnStmtNode::reduceStrength(LoopOptimizer * loops){
+	if (myLoc != nullptr){
+		myLoc = myLoc->reduceStrength(loops);
+	}
+}
+
+void CallStmtNode::surveyLoop(LoopOptimizer * loops){
+	myCall->surveyLoop(loops);
+}
+
+void CallStmtNode::reduceStrength(LoopOptimizer * loops){
+	myCall->reduceStrength(loops);
+}
+
+void IfStmtNode::optimizeLoops(LoopOptimizer * loops){
+	myStmtList->optimizeLoops(loops);
+}
+
+void IfStmtNode::surveyLoop(LoopOptimizer * loops){
+	loops->noteLocals(myVarList);
+	myExp->surveyLoop(loops);
+	myStmtList->surveyLoop(loops);
+}
+
+void IfStmtNode::reduceStrength(LoopOptimizer * loops){
+	myExp = myExp->reduceStrength(loops);
+	myStmtList->reduceStrength(loops);
+}
+
+void IfElseStmtNode::optimizeLoops(LoopOptimizer * loops){
+	myStmtList->optimizeLoops(loops);
+	myElseStmtList->optimizeLoops(loops);
+}
+
+void IfElseStmtNode::surveyLoop(LoopOptimizer * loops){
+	loops->noteLocals(myVarList);
+	loops->noteLocals(myElseVarList);
+	myExp->surveyLoop(loops);
+	myStmtList->surveyLoop(loops);
+	myElseStmtList->surveyLoop(loops);
+}
+
+void IfElseStmtNode::reduceStrength(LoopOptimizer * loops){
+	myExp = myExp->reduceStrength(loops);
+	myStmtList->reduceStrength(loops);
+	myElseStmtList->reduceStrength(loops);
+}
+
+void WhileStmtNode::optimizeLoops(LoopOptimizer * loops){
+	myStmtList->optimizeLoops(loops);
+}
+
+void WhileStmtNode::surveyLoop(LoopOptimizer * loops){
+	loops->noteLocals(myVarList);
+	myExp->surveyLoop(loops);
+	myStmtList->surveyLoop(loops);
+}
+
+void WhileStmtNode::reduceStrength(LoopOptimizer * loops){
+	myExp = myExp->reduceStrength(loops);
+	myStmtList->reduceStrength(loops);
+}
+
+// Expressions
+
+void AssignNode::surveyLoop(LoopOptimizer * loops){
+	loops->noteWrite(myLeft);
+	myRight->surveyLoop(loops);
+}
+
+ExpNode * AssignNode::reduceStrength(LoopOptimizer * loops){
+	myRight = myRight->reduceStrength(loops);
+	return this;
+}
+
+void CallExpNode::surveyLoop(LoopOptimizer * loops){
+	if (myList != nullptr){
+		myList->surveyLoop(loops);
+	}
+}
+
+ExpNode * CallExpNode::reduceStrength(LoopOptimizer * loops){
+	if (myList != nullptr){
+		myList->reduceStrength(loops);
+	}
+	return this;
+}
+
+void ExpListNode::surveyLoop(LoopOptimizer * loops){
+	for (ExpNode * exp : myList){
+		exp->surveyLoop(loops);
+	}
+}
+
+ExpNode * ExpListNode::reduceStrength(LoopOptimizer * loops){
+	for (ExpNode *& exp : myList){
+		exp = exp->reduceStrength(loops);
+	}
+	return this;
+}
+
+ExpNode * TimesNode::reduceStrength(LoopOptimizer * loops){
+	ExpNode * tracker = loops->reduce(myLeft, myRight);
+	return tracker != nullptr ? tracker : BinaryExpNode::reduceStrength(loops);
+}
+
+} //End namespace LIL' C
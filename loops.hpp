@@ -0,0 +1,95 @@
+#ifndef LILC_LOOPS_HPP
+#define LILC_LOOPS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+
+namespace LILC{
+
+class ProgramNode;
+class FnDeclNode;
+class StmtNode;
+class ExpNode;
+class VarDeclListNode;
+class SemSymbol;
+class FreshNames;
+
+// Strength reduction and unrolling of counter loops in a type-checked AST
+// (loops.cpp).
+//
+// A counter loop is a while loop whose body ends in i++; or i--; where i
+// is an int local or formal that nothing else in the loop assigns. In
+// one, each product i * c or c * i of the counter and a literal becomes a
+// fresh local, set to i * c ahead of the loop and stepped by c (-c when
+// counting down) after the counter, so the loop adds instead of
+// multiplying.
+//
+// A counter loop runs a known number of times when the statement before
+// it is i = c0; and its condition is i < n or i <= n (i > n or i >= n
+// when counting down), with c0 and n literals. Such a loop is replaced by
+// that many copies of its body when they come to at most
+// FULL_UNROLL_NODES nodes. Otherwise the body is repeated `factor` times
+// in a loop that runs trips / factor times, and the trips % factor left
+// over run as copies after it. Loops declaring block locals anywhere in
+// their body are not unrolled.
+class LoopOptimizer{
+public:
+	static const size_t DEFAULT_FACTOR = 4;
+	static const size_t FULL_UNROLL_NODES = 256;
+	// Largest body, repeated `factor` times, that is unrolled
+	static const size_t MAX_UNROLL_NODES = 400;
+
+	// A factor below 2 only unrolls fully
+	LoopOptimizer(size_t factor = DEFAULT_FACTOR){ myFactor = factor; }
+	void run(ProgramNode * program);
+
+	// Called by StmtListNode for each of its while loops: optimizes the
+	// loop at it, which may be replaced by other statements, and returns
+	// the position of the statement that followed it
+	std::list<StmtNode *>::iterator optimize(std::list<StmtNode *>& stmts,
+		std::list<StmtNode *>::iterator it);
+
+	// Called by the AST nodes while surveying a loop
+	void noteWrite(ExpNode * loc);
+	void noteLocals(VarDeclListNode * decls);
+	// Called by TimesNode while reducing a loop: the variable tracking
+	// left * right, or null if it is not a product of the counter and a
+	// literal
+	ExpNode * reduce(ExpNode * left, ExpNode * right);
+
+	size_t counterLoops(){ return myCounterLoops; }
+	size_t fullyUnrolled(){ return myFullyUnrolled; }
+	size_t unrolled(){ return myUnrolled; }
+	size_t reduced(){ return myReduced; }
+private:
+	// Whether init and test, the statement before a counter loop and its
+	// condition, fix how many times it runs; sets start and trips if so
+	bool tripCount(StmtNode * init, ExpNode * test, int64_t& start,
+		int64_t& trips);
+	void unroll(std::list<StmtNode *>& stmts,
+		std::list<StmtNode *>::iterator it, int64_t start, int64_t trips);
+	SemSymbol * freshLocal(const std::string& name, SemSymbol * like);
+
+	size_t myFactor;
+	FnDeclNode * myFn = nullptr;
+	FreshNames * myNames = nullptr;
+	// While surveying and reducing a loop: its counter, which way it
+	// steps, how often it is assigned, whether the loop declares block
+	// locals, and the variables tracking its products, by literal
+	SemSymbol * myCounter = nullptr;
+	int myStep = 0;
+	size_t myWrites = 0;
+	bool myLocals = false;
+	std::map<int, SemSymbol *> myProducts;
+	size_t myCounterLoops = 0;
+	size_t myFullyUnrolled = 0;
+	size_t myUnrolled = 0;
+	size_t myReduced = 0;
+};
+
+} //End namespace LIL' C
+
+#endif
@@ -0,0 +1,324 @@
+#include <iostream>
+
+#include "ast.hpp"
+#include "symbol_table.hpp"
+
+// Name analysis: links every IdNode to the SemSymbol of its declaration.
+//
+// Scopes: the program is one scope, each function's formals and locals
+// share another, and every if/else/while block opens its own. Struct
+// names live with the variables; struct fields live in their struct's
+// own table (StructDef), which dot accesses are resolved against.
+// Struct layouts are computed as each struct is declared, so dot-access
+// chains resolve straight to a base variable plus a constant offset.
+//
+// Storage is assigned as variables are declared: globals get offsets in
+// one global area and each function's formals and locals, including
+// those of nested blocks, get distinct offsets in one flat frame whose
+// size is recorded on the FnDeclNode.
+
+namespace LILC{
+
+static void nameError(SymbolTable * symTab, IdNode * id, const char * msg){
+	symTab->errors() << id->getLine() << ":" << id->getCol()
+		<< " ***ERROR*** " << msg << "\n";
+}
+
+bool ASTNode::nameAnalysis(SymbolTable * symTab){
+	return true;
+}
+
+bool ProgramNode::nameAnalysis(SymbolTable * symTab){
+	symTab->enterScope();
+	bool ok = myDeclList->nameAnalysis(symTab);
+	symTab->exitScope();
+	myGlobalSize = symTab->getGlobalSize();
+	return ok;
+}
+
+bool DeclListNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = true;
+	for (DeclNode * decl : myDecls){
+		ok = decl->nameAnalysis(symTab) && ok;
+	}
+	return ok;
+}
+
+bool VarDeclListNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = true;
+	for (VarDeclNode * decl : myVarDecls){
+		ok = decl->nameAnalysis(symTab) && ok;
+	}
+	return ok;
+}
+
+bool FormalsListNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = true;
+	for (FormalDeclNode * formal : myFormals){
+		ok = formal->nameAnalysis(symTab) && ok;
+	}
+	return ok;
+}
+
+bool StmtListNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = true;
+	for (StmtNode * stmt : myList){
+		ok = stmt->nameAnalysis(symTab) && ok;
+	}
+	return ok;
+}
+
+bool ExpListNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = true;
+	for (ExpNode * exp : myList){
+		ok = exp->nameAnalysis(symTab) && ok;
+	}
+	return ok;
+}
+
+// Declarations
+
+SemSymbol * VarDeclNode::makeSymbol(SymbolTable * symTab){
+	if (myType->isVoid()){
+		nameError(symTab, myId, "Non-function declared void");
+		return nullptr;
+	}
+	if (!myType->nameAnalysis(symTab)){
+		return nullptr;
+	}
+	SemSymbol * sym = new SemSymbol(SemSymbol::VAR, myId, this, myType);
+	sym->setStruct(myType->getStruct());
+	if (sym->getStruct() != nullptr){
+		mySize = sym->getStruct()->getSize();
+	}
+	myId->setSymbol(sym);
+	return sym;
+}
+
+bool VarDeclNode::nameAnalysis(SymbolTable * symTab){
+	SemSymbol * sym = makeSymbol(symTab);
+	if (sym == nullptr){
+		return false;
+	}
+	sym->setGlobal(symTab->depth() == 1);
+	if (!symTab->declare(myId->getName(), sym)){
+		nameError(symTab, myId, "Multiply declared identifier");
+		return false;
+	}
+	sym->setOffset(symTab->allocate(myType->getSize(), myType->getAlignment()));
+	return true;
+}
+
+bool FormalDeclNode::nameAnalysis(SymbolTable * symTab){
+	if (myType->isVoid()){
+		nameError(symTab, myId, "Non-function declared void");
+		return false;
+	}
+	SemSymbol * sym = new SemSymbol(SemSymbol::VAR, myId, this, myType);
+	myId->setSymbol(sym);
+	if (!symTab->declare(myId->getName(), sym)){
+		nameError(symTab, myId, "Multiply declared identifier");
+		return false;
+	}
+	sym->setOffset(symTab->allocate(myType->getSize(), myType->getAlignment()));
+	return true;
+}
+
+bool FnDeclNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = true;
+	// Declared before the body so the function can call itself
+	SemSymbol * sym = new SemSymbol(SemSymbol::FN, myId, this, myType);
+	sym->setGlobal(true);
+	myId->setSymbol(sym);
+	if (!symTab->declare(myId->getName(), sym)){
+		nameError(symTab, myId, "Multiply declared identifier");
+		ok = false;
+	}
+	symTab->enterScope();
+	symTab->beginFrame();
+	if (myFormals != nullptr){
+		ok = myFormals->nameAnalysis(symTab) && ok;
+	}
+	ok = myBody->nameAnalysis(symTab) && ok;
+	mySize = symTab->getFrameSize();
+	symTab->exitScope();
+	return ok;
+}
+
+bool FnBodyNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = getDecls()->nameAnalysis(symTab);
+	return getStmts()->nameAnalysis(symTab) && ok;
+}
+
+bool StructDeclNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = true;
+	StructDef * def = new StructDef(myId);
+	for (VarDeclNode * field : myDecls->getDecls()){
+		// Field types are resolved in the enclosing scope
+		SemSymbol * fieldSym = field->makeSymbol(symTab);
+		if (fieldSym == nullptr){
+			ok = false;
+		} else if (!def->addField(fieldSym)){
+			nameError(symTab, field->getId(), "Multiply declared identifier");
+			ok = false;
+		}
+	}
+	// Every field type is complete by now, so the layout is final
+	def->computeLayout();
+	mySize = def->getSize();
+	// Declared after its fields, so a struct cannot contain itself
+	SemSymbol * sym = new SemSymbol(SemSymbol::STRUCT, myId, this, nullptr);
+	sym->setStruct(def);
+	sym->setGlobal(symTab->depth() == 1);
+	myId->setSymbol(sym);
+	if (!symTab->declare(myId->getName(), sym)){
+		nameError(symTab, myId, "Multiply declared identifier");
+		ok = false;
+	}
+	return ok;
+}
+
+bool StructNode::nameAnalysis(SymbolTable * symTab){
+	SemSymbol * sym = symTab->lookup(myId->getName());
+	if (sym == nullptr || sym->getKind() != SemSymbol::STRUCT){
+		nameError(symTab, myId, "Invalid name of struct type");
+		return false;
+	}
+	myId->setSymbol(sym);
+	return true;
+}
+
+StructDef * StructNode::getStruct(){
+	SemSymbol * sym = myId->getSymbol();
+	return sym == nullptr ? nullptr : sym->getStruct();
+}
+
+// Statements
+
+bool AssignStmtNode::nameAnalysis(SymbolTable * symTab){
+	return myAssign->nameAnalysis(symTab);
+}
+
+bool PostIncStmtNode::nameAnalysis(SymbolTable * symTab){
+	return myLoc->nameAnalysis(symTab);
+}
+
+bool PostDecStmtNode::nameAnalysis(SymbolTable * symTab){
+	return myLoc->nameAnalysis(symTab);
+}
+
+bool ReadStmtNode::nameAnalysis(SymbolTable * symTab){
+	return myLoc->nameAnalysis(symTab);
+}
+
+bool WriteStmtNode::nameAnalysis(SymbolTable * symTab){
+	return myLoc->nameAnalysis(symTab);
+}
+
+bool ReturnStmtNode::nameAnalysis(SymbolTable * symTab){
+	if (myLoc == nullptr){
+		return true;
+	}
+	return myLoc->nameAnalysis(symTab);
+}
+
+bool CallStmtNode::nameAnalysis(SymbolTable * symTab){
+	return myCall->nameAnalysis(symTab);
+}
+
+bool IfStmtNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = myExp->nameAnalysis(symTab);
+	symTab->enterScope();
+	ok = myVarList->nameAnalysis(symTab) && ok;
+	ok = myStmtList->nameAnalysis(symTab) && ok;
+	symTab->exitScope();
+	return ok;
+}
+
+bool IfElseStmtNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = myExp->nameAnalysis(symTab);
+	symTab->enterScope();
+	ok = myVarList->nameAnalysis(symTab) && ok;
+	ok = myStmtList->nameAnalysis(symTab) && ok;
+	symTab->exitScope();
+	symTab->enterScope();
+	ok = myElseVarList->nameAnalysis(symTab) && ok;
+	ok = myElseStmtList->nameAnalysis(symTab) && ok;
+	symTab->exitScope();
+	return ok;
+}
+
+bool WhileStmtNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = myExp->nameAnalysis(symTab);
+	symTab->enterScope();
+	ok = myVarList->nameAnalysis(symTab) && ok;
+	ok = myStmtList->nameAnalysis(symTab) && ok;
+	symTab->exitScope();
+	return ok;
+}
+
+// Expressions
+
+bool IdNode::nameAnalysis(SymbolTable * symTab){
+	mySymbol = symTab->lookup(myStrVal);
+	if (mySymbol == nullptr){
+		nameError(symTab, this, "Undeclared identifier");
+		return false;
+	}
+	return true;
+}
+
+bool DotAccessNode::nameAnalysis(SymbolTable * symTab){
+	// An unresolved left side has already been reported
+	if (!myLeft->nameAnalysis(symTab)){
+		return false;
+	}
+	IdNode * leftId = myLeft->locId();
+	SemSymbol * leftSym = leftId->getSymbol();
+	StructDef * def = leftSym->getStruct();
+	if (leftSym->getKind() != SemSymbol::VAR || def == nullptr){
+		nameError(symTab, leftId, "Dot-access of non-struct type");
+		return false;
+	}
+	SemSymbol * field = def->lookupField(myRight->getName());
+	if (field == nullptr){
+		nameError(symTab, myRight, "Invalid struct field name");
+		return false;
+	}
+	myRight->setSymbol(field);
+	// Collapse the chain: the left side already knows its own base and
+	// offset, so this costs one addition however deep the chain is.
+	DotAccessNode * leftDot = dynamic_cast<DotAccessNode *>(myLeft);
+	if (leftDot != nullptr){
+		myBase = leftDot->getBase();
+		myOffset = leftDot->getOffset() + field->getOffset();
+	} else {
+		myBase = leftId;
+		myOffset = field->getOffset();
+	}
+	return true;
+}
+
+bool AssignNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = myLeft->nameAnalysis(symTab);
+	return myRight->nameAnalysis(symTab) && ok;
+}
+
+bool CallExpNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = myLoc->nameAnalysis(symTab);
+	if (myList != nullptr){
+		ok = myList->nameAnalysis(symTab) && ok;
+	}
+	return ok;
+}
+
+bool UnaryExpNode::nameAnalysis(SymbolTable * symTab){
+	return myNode->nameAnalysis(symTab);
+}
+
+bool BinaryExpNode::nameAnalysis(SymbolTable * symTab){
+	bool ok = myLeft->nameAnalysis(symTab);
+	return myRight->nameAnalysis(symTab) && ok;
+}
+
+} //End namespace LIL' C
@@ -0,0 +1,200 @@
+#include "symbol_table.hpp"
+#include "ast.hpp"
+
+namespace LILC{
+
+const std::string& SemSymbol::getName(){
+	return myId->getName();
+}
+
+std::string letterTag(size_t n){
+	std::string tag;
+	do {
+		tag.insert(tag.begin(), char('a' + n % 26));
+		n /= 26;
+	} while (n != 0);
+	return tag;
+}
+
+FreshNames::FreshNames(ProgramNode * program, FnDeclNode * fn){
+	for (DeclNode * decl : program->getDeclList()->getDecls()){
+		if (VarDeclNode * var = dynamic_cast<VarDeclNode *>(decl)){
+			myTaken.insert(var->getId()->getName());
+		} else if (FnDeclNode * other = dynamic_cast<FnDeclNode *>(decl)){
+			myTaken.insert(other->getId()->getName());
+		} else if (StructDeclNode * def = dynamic_cast<StructDeclNode *>(decl)){
+			myTaken.insert(def->getId()->getName());
+		}
+	}
+	if (fn->getFormals() != nullptr){
+		for (FormalDeclNode * formal : fn->getFormals()->getFormals()){
+			myTaken.insert(formal->getId()->getName());
+		}
+	}
+	declared(fn->getBody()->getDecls());
+	declared(fn->getBody()->getStmts());
+}
+
+void FreshNames::declared(VarDeclListNode * decls){
+	for (VarDeclNode * decl : decls->getDecls()){
+		myTaken.insert(decl->getId()->getName());
+	}
+}
+
+void FreshNames::declared(StmtListNode * stmts){
+	for (StmtNode * stmt : stmts->getStmts()){
+		if (IfStmtNode * branch = dynamic_cast<IfStmtNode *>(stmt)){
+			declared(branch->getDecls());
+			declared(branch->getBody());
+		} else if (IfElseStmtNode * split = dynamic_cast<IfElseStmtNode *>(stmt)){
+			declared(split->getDecls());
+			declared(split->getBody());
+			declared(split->getElseDecls());
+			declared(split->getElseBody());
+		} else if (WhileStmtNode * loop = dynamic_cast<WhileStmtNode *>(stmt)){
+			declared(loop->getDecls());
+			declared(loop->getBody());
+		}
+	}
+}
+
+std::string FreshNames::make(const std::string& prefix){
+	for (size_t n = 0; ; n++){
+		std::string name = prefix + letterTag(n);
+		if (myTaken.insert(name).second){
+			return name;
+		}
+	}
+}
+
+ExpNode * varUse(SemSymbol * var, size_t line, size_t col){
+	IdNode * id = new IdNode(var->getName(), line, col);
+	id->setSymbol(var);
+	return id;
+}
+
+StmtNode * varAssign(SemSymbol * var, ExpNode * value){
+	IdNode * id = var->getId();
+	return new AssignStmtNode(new AssignNode(
+		varUse(var, id->getLine(), id->getCol()), value));
+}
+
+ExpNode * zeroValue(TypeNode * type, size_t line, size_t col){
+	if (dynamic_cast<BoolNode *>(type) != nullptr){
+		return new FalseNode(line, col);
+	}
+	return new IntLitNode(0, line, col);
+}
+
+const std::string& StructDef::getName(){
+	return myId->getName();
+}
+
+SymbolTable::SymbolTable(size_t expectedNames){
+	size_t size = 16;
+	while (size < expectedNames * 2){
+		size *= 2;
+	}
+	mySlots.assign(size, Slot{nullptr, 0, -1});
+	myUsed = 0;
+}
+
+// FNV-1a
+uint32_t SymbolTable::hashName(const std::string& name){
+	uint32_t hash = 2166136261u;
+	for (char c : name){
+		hash = (hash ^ (unsigned char)c) * 16777619u;
+	}
+	return hash;
+}
+
+size_t SymbolTable::findSlot(const std::string& name, uint32_t hash) const{
+	size_t mask = mySlots.size() - 1;
+	size_t idx = hash & mask;
+	for (;;){
+		const Slot & slot = mySlots[idx];
+		if (slot.key == nullptr
+		    || (slot.hash == hash && *slot.key == name)){
+			return idx;
+		}
+		idx = (idx + 1) & mask;
+	}
+}
+
+void SymbolTable::grow(){
+	std::vector<Slot> old;
+	old.swap(mySlots);
+	mySlots.assign(old.size() * 2, Slot{nullptr, 0, -1});
+	for (const Slot & slot : old){
+		if (slot.key == nullptr){
+			continue;
+		}
+		size_t idx = findSlot(*slot.key, slot.hash);
+		mySlots[idx] = slot;
+		for (int32_t b = slot.binding; b >= 0; b = myBindings[b].shadowed){
+			myBindings[b].slot = idx;
+		}
+	}
+}
+
+void SymbolTable::enterScope(){
+	myScopes.push_back(myBindings.size());
+}
+
+void SymbolTable::exitScope(){
+	size_t marker = myScopes.back();
+	while (myBindings.size() > marker){
+		const Binding & binding = myBindings.back();
+		mySlots[binding.slot].binding = binding.shadowed;
+		myBindings.pop_back();
+	}
+	myScopes.pop_back();
+}
+
+bool SymbolTable::declare(const std::string& name, SemSymbol * sym){
+	if ((myUsed + 1) * 2 > mySlots.size()){
+		grow();
+	}
+	uint32_t hash = hashName(name);
+	size_t idx = findSlot(name, hash);
+	Slot & slot = mySlots[idx];
+	if (slot.key == nullptr){
+		slot.key = &name;
+		slot.hash = hash;
+		slot.binding = -1;
+		myUsed++;
+	} else if (slot.binding >= 0
+	           && myBindings[slot.binding].depth == depth()){
+		return false;
+	}
+	Binding binding = { sym, (uint32_t)idx, slot.binding, (uint32_t)depth() };
+	slot.binding = myBindings.size();
+	myBindings.push_back(binding);
+	return true;
+}
+
+SemSymbol * SymbolTable::lookup(const std::string& name) const{
+	const Slot & slot = mySlots[findSlot(name, hashName(name))];
+	if (slot.key == nullptr || slot.binding < 0){
+		return nullptr;
+	}
+	return myBindings[slot.binding].sym;
+}
+
+SemSymbol * SymbolTable::lookupLocal(const std::string& name) const{
+	const Slot & slot = mySlots[findSlot(name, hashName(name))];
+	if (slot.key == nullptr || slot.binding < 0
+	    || myBindings[slot.binding].depth != myScopes.size()){
+		return nullptr;
+	}
+	return myBindings[slot.binding].sym;
+}
+
+int SymbolTable::allocate(int size, int alignment){
+	int & top = depth() == 1 ? myGlobalSize : myFrameSize;
+	int offset = alignUp(top, alignment);
+	top = offset + size;
+	return offset;
+}
+
+} //End namespace LIL' C
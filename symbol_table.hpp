@@ -0,0 +1,206 @@
+#ifndef LILC_SYMBOL_TABLE_HPP
+#define LILC_SYMBOL_TABLE_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "lilc_alloc.hpp"
+
+namespace LILC{
+
+class IdNode;
+class DeclNode;
+class TypeNode;
+class ExpNode;
+class StmtNode;
+class ProgramNode;
+class FnDeclNode;
+class VarDeclListNode;
+class StmtListNode;
+class StructDef;
+class FnSignature;
+
+// What a declared name stands for. Every IdNode that name analysis
+// resolves points at one of these.
+class SemSymbol{
+public:
+	ALLOC_TAGGED(SemSymbol)
+	enum Kind { VAR, FN, STRUCT };
+
+	SemSymbol(Kind kind, IdNode * id, DeclNode * decl, TypeNode * type){
+		myKind = kind;
+		myId = id;
+		myDecl = decl;
+		myType = type;
+	}
+	Kind getKind(){ return myKind; }
+	const std::string& getName();
+	IdNode * getId(){ return myId; }
+	DeclNode * getDecl(){ return myDecl; }
+	// Declared type: the variable type, or the return type of a function.
+	// Null for struct names.
+	TypeNode * getType(){ return myType; }
+	// The struct a STRUCT symbol defines, or the struct type of a
+	// struct-typed variable or field. Null otherwise.
+	StructDef * getStruct(){ return myStruct; }
+	void setStruct(StructDef * def){ myStruct = def; }
+	// Formal and return types of a FN symbol, filled in by the first
+	// phase of type checking.
+	FnSignature * getSignature(){ return mySignature; }
+	void setSignature(FnSignature * sig){ mySignature = sig; }
+	bool isGlobal(){ return myGlobal; }
+	void setGlobal(bool global){ myGlobal = global; }
+	// Byte offset of a struct field within its struct, of a global within
+	// the global area, or of a local or formal within its function's frame
+	int getOffset(){ return myOffset; }
+	void setOffset(int offset){ myOffset = offset; }
+private:
+	Kind myKind;
+	IdNode * myId;
+	DeclNode * myDecl;
+	TypeNode * myType;
+	StructDef * myStruct = nullptr;
+	FnSignature * mySignature = nullptr;
+	bool myGlobal = false;
+	int myOffset = 0;
+};
+
+// Spells n in lowercase letters, a, b, ..., z, ba, bb, ..., to number
+// the locals a pass makes up: identifiers cannot hold digits (lilc.l)
+std::string letterTag(size_t n);
+
+// Names for the locals a pass makes up in one function, so the unparsed
+// program still means the same: none is declared where the function can
+// see it, as a global, struct or function, or as one of its formals or
+// locals in any block, and none is handed out twice
+class FreshNames{
+public:
+	FreshNames(ProgramNode * program, FnDeclNode * fn);
+	// prefix and the first letterTag that makes a name still free
+	std::string make(const std::string& prefix);
+private:
+	void declared(VarDeclListNode * decls);
+	void declared(StmtListNode * stmts);
+
+	std::unordered_set<std::string> myTaken;
+};
+
+// AST pieces for the passes that rewrite a type-checked AST: a read of
+// var at line:col, already linked to it; the statement var = value;, at
+// var's declaration; and the zero of an int or bool type, which is what
+// variables start out as
+ExpNode * varUse(SemSymbol * var, size_t line, size_t col);
+StmtNode * varAssign(SemSymbol * var, ExpNode * value);
+ExpNode * zeroValue(TypeNode * type, size_t line, size_t col);
+
+// Scoped name -> SemSymbol map.
+//
+// Names live in one open-addressing table (linear probing) whose slots
+// point at the innermost binding of that name. Each binding remembers the
+// binding it shadows and every scope remembers how many bindings existed
+// when it was entered, so leaving a scope just pops its bindings and
+// restores the shadowed ones: O(#decls in that scope). Lookups hash the
+// name in place and never allocate. Keys point at the declaring IdNode's
+// string, which outlives the table.
+class SymbolTable{
+public:
+	SymbolTable(size_t expectedNames = 16);
+
+	void enterScope();
+	void exitScope();
+	size_t depth(){ return myScopes.size(); }
+
+	// Binds name in the innermost scope. Returns false, leaving the table
+	// unchanged, if the innermost scope already binds it.
+	bool declare(const std::string& name, SemSymbol * sym);
+	SemSymbol * lookup(const std::string& name) const;
+	// Only looks in the innermost scope.
+	SemSymbol * lookupLocal(const std::string& name) const;
+
+	// Storage for a variable declared in the current scope: the global
+	// area for the outermost scope, otherwise the frame of the function
+	// being analysed. Returns the variable's byte offset.
+	int allocate(int size, int alignment);
+	// Starts a new, empty frame for the next function's formals and locals
+	void beginFrame(){ myFrameSize = 0; }
+	int getFrameSize(){ return myFrameSize; }
+	int getGlobalSize(){ return myGlobalSize; }
+
+	// Where name analysis reports errors; cerr unless set
+	void setErrorStream(std::ostream& out){ myErrors = &out; }
+	std::ostream& errors(){ return *myErrors; }
+private:
+	struct Slot {
+		const std::string * key;
+		uint32_t hash;
+		int32_t binding;
+	};
+	struct Binding {
+		SemSymbol * sym;
+		uint32_t slot;
+		int32_t shadowed;
+		uint32_t depth;
+	};
+
+	static uint32_t hashName(const std::string& name);
+	size_t findSlot(const std::string& name, uint32_t hash) const;
+	void grow();
+
+	std::vector<Slot> mySlots;
+	size_t myUsed;
+	std::vector<Binding> myBindings;
+	std::vector<size_t> myScopes;
+	int myGlobalSize = 0;
+	int myFrameSize = 0;
+	std::ostream * myErrors = &std::cerr;
+};
+
+inline int alignUp(int offset, int alignment){
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+// A struct type: its fields in declaration order plus a single-scope
+// table for resolving DotAccessNode fields.
+//
+// Layout is C-like: ints take 4 bytes aligned to 4, bools 1 byte, and a
+// nested struct its own size and alignment. Fields are placed in
+// declaration order at the next suitably aligned offset and the size is
+// rounded up to the alignment.
+class StructDef{
+public:
+	ALLOC_TAGGED(StructDef)
+	StructDef(IdNode * id) : myFields(8){
+		myId = id;
+		myFields.enterScope();
+	}
+	IdNode * getId(){ return myId; }
+	const std::string& getName();
+	SymbolTable * getFieldTable(){ return &myFields; }
+	bool addField(SemSymbol * field){
+		if (!myFields.declare(field->getName(), field)){
+			return false;
+		}
+		myFieldOrder.push_back(field);
+		return true;
+	}
+	SemSymbol * lookupField(const std::string& name){
+		return myFields.lookupLocal(name);
+	}
+	const std::vector<SemSymbol *>& getFields(){ return myFieldOrder; }
+	// Assigns field offsets once all fields are added (layout.cpp)
+	void computeLayout();
+	int getSize(){ return mySize; }
+	int getAlignment(){ return myAlignment; }
+private:
+	IdNode * myId;
+	int mySize = 0;
+	int myAlignment = 1;
+	SymbolTable myFields;
+	std::vector<SemSymbol *> myFieldOrder;
+};
+
+} //End namespace LIL' C
+
+#endif
@@ -2,13 +2,19 @@
 #define LILC_SEMANTIC_SYMBOL_H
 
 #include <iostream>
+#include "lilc_alloc.hpp"
 
 namespace LILC{
 
 class SynSymbol {
 	public:
+		ALLOC_TAGGED(SynSymbol)
 		std::string name;
-		SynSymbol(size_t line, size_t column, int tag){ this->_tag = tag; }
+		SynSymbol(size_t line, size_t column, int tag){
+			this->line = line;
+			this->column = column;
+			this->_tag = tag;
+		}
 		int tag() { return _tag; }
 		size_t line;
 		size_t column;
@@ -19,6 +25,7 @@ class SynSymbol {
 
 class NullaryToken : public SynSymbol {
 	public:
+		ALLOC_TAGGED(NullaryToken)
 		NullaryToken(size_t line, size_t col, int tag) : SynSymbol(line,col,tag) { };
 		int token() { return _tag; } 
 		
@@ -26,6 +33,7 @@ class NullaryToken : public SynSymbol {
 
 class IntLitToken : public SynSymbol {
 	public:
+		ALLOC_TAGGED(IntLitToken)
 		IntLitToken(size_t line, size_t col, int value); //Defined in lilc_lexer.l
 		int value() { return _value; }
 	private:
@@ -34,6 +42,7 @@ class IntLitToken : public SynSymbol {
 
 class IDToken : public SynSymbol {
 	public:
+		ALLOC_TAGGED(IDToken)
 		IDToken(size_t line, size_t col, std::string id); //Defined in lilc_lexer.l
 		std::string value() { return _value; }
 	private:
@@ -42,6 +51,7 @@ class IDToken : public SynSymbol {
 
 class StringLitToken : public SynSymbol {
 	public:
+		ALLOC_TAGGED(StringLitToken)
 		StringLitToken(size_t line, size_t col, std::string value); //Defined in lilc_lexer.l
 		std::string value() { return _value; }
 	private:
@@ -0,0 +1,263 @@
+#include <iterator>
+
+#include "ast.hpp"
+#include "dataflow.hpp"
+#include "symbol_table.hpp"
+#include "tailcall.hpp"
+
+namespace LILC{
+
+// Whether control leaves the function after the statement before next,
+// in a statement list in tail position
+static bool endsList(const std::list<StmtNode *>& stmts,
+	std::list<StmtNode *>::const_iterator next){
+	if (next == stmts.end()){
+		return true;
+	}
+	ReturnStmtNode * ret = dynamic_cast<ReturnStmtNode *>(*next);
+	return ret != nullptr && ret->getExp() == nullptr;
+}
+
+void TailCallEliminator::run(ProgramNode * program){
+	for (DeclNode * decl : program->getDeclList()->getDecls()){
+		FnDeclNode * fn = dynamic_cast<FnDeclNode *>(decl);
+		if (fn != nullptr){
+			FreshNames names(program, fn);
+			myNames = &names;
+			run(fn);
+		}
+	}
+	myFn = nullptr;
+	myNames = nullptr;
+}
+
+void TailCallEliminator::run(FnDeclNode * fn){
+	myFn = fn;
+	mySites.clear();
+	myBranches.clear();
+	myResets.clear();
+	myNext.clear();
+	StmtListNode * body = fn->getBody()->getStmts();
+	if (!body->markTailCalls(this, true) || !loopable()){
+		return;
+	}
+	body->loopTailCalls(this);
+	IdNode * id = fn->getId();
+	body->loopWhile(new TrueNode(id->getLine(), id->getCol()));
+	myLooped++;
+}
+
+bool TailCallEliminator::noteTailCall(StmtNode * stmt, CallExpNode * call,
+	bool tail){
+	call->setTail();
+	if (call->getId()->getSymbol() != myFn->getId()->getSymbol()){
+		myOtherCalls++;
+		return false;
+	}
+	mySelfCalls++;
+	if (tail){
+		mySites[stmt] = call;
+	}
+	return tail;
+}
+
+bool TailCallEliminator::returnsVoid(){
+	return myFn->getType()->isVoid();
+}
+
+bool TailCallEliminator::loopable(){
+	FlowGraph graph;
+	graph.build(myFn);
+	if (graph.numStructs() != 0){
+		return false;
+	}
+	ReachingDefinitions reaching;
+	reaching.run(graph);
+
+	// A local needs zeroing at each jump if its entry value may be read
+	std::vector<bool> read(graph.numVars(), false);
+	std::vector<FlowBlock>& blocks = graph.blocks();
+	for (uint32_t block = 0; block < blocks.size(); block++){
+		BitSet facts = reaching.reachIn(block);
+		uint32_t def = reaching.firstDef(block);
+		for (const FlowEvent& event : blocks[block].events){
+			if (event.kind == FlowEvent::USE && facts.test(event.var)){
+				read[event.var] = true;
+			}
+			reaching.step(event, def, facts);
+		}
+	}
+	for (size_t var = 0; var < read.size(); var++){
+		if (!read[var] || graph.isFormal(var)){
+			continue;
+		}
+		// Out of scope at the jumps
+		if (graph.isBlockLocal(var)){
+			return false;
+		}
+		myResets.push_back(graph.getVar(var));
+	}
+	return true;
+}
+
+CallExpNode * TailCallEliminator::siteCall(StmtNode * stmt){
+	auto found = mySites.find(stmt);
+	return found == mySites.end() ? nullptr : found->second;
+}
+
+void TailCallEliminator::jump(CallExpNode * call, std::list<StmtNode *>& out){
+	std::vector<SemSymbol *> changed;
+	std::vector<ExpNode *> values;
+	if (call->getArgs() != nullptr){
+		auto actual = call->getArgs()->getExps().begin();
+		for (FormalDeclNode * formal : myFn->getFormals()->getFormals()){
+			SemSymbol * var = formal->getId()->getSymbol();
+			IdNode * id = dynamic_cast<IdNode *>(*actual);
+			if (id == nullptr || id->getSymbol() != var){
+				changed.push_back(var);
+				values.push_back(*actual);
+			}
+			++actual;
+		}
+	}
+	// The last actual is evaluated after the others and can go straight
+	// to its formal; the rest wait in their next-value locals
+	for (size_t k = 0; k + 1 < changed.size(); k++){
+		out.push_back(varAssign(nextValue(changed[k]), values[k]));
+	}
+	if (!changed.empty()){
+		out.push_back(varAssign(changed.back(), values.back()));
+	}
+	for (size_t k = 0; k + 1 < changed.size(); k++){
+		IdNode * id = changed[k]->getId();
+		out.push_back(varAssign(changed[k],
+			varUse(nextValue(changed[k]), id->getLine(), id->getCol())));
+	}
+	for (SemSymbol * var : myResets){
+		IdNode * id = var->getId();
+		out.push_back(varAssign(var, zeroValue(var->getType(), id->getLine(),
+			id->getCol())));
+	}
+	myJumps++;
+}
+
+SemSymbol * TailCallEliminator::nextValue(SemSymbol * formal){
+	SemSymbol *& sym = myNext[formal];
+	if (sym == nullptr){
+		IdNode * at = formal->getId();
+		IdNode * id = new IdNode(myNames->make("_" + formal->getName()
+			+ "_next_"), at->getLine(), at->getCol());
+		VarDeclNode * decl = new VarDeclNode(formal->getType(), id,
+			VarDeclNode::NOT_STRUCT);
+		sym = new SemSymbol(SemSymbol::VAR, id, decl, formal->getType());
+		id->setSymbol(sym);
+		myFn->addLocal(decl);
+	}
+	return sym;
+}
+
+StmtNode * TailCallEliminator::fallOff(){
+	TypeNode * type = myFn->getType();
+	if (type->isVoid()){
+		return new ReturnStmtNode(nullptr);
+	}
+	// Falling off the end returns 0
+	IdNode * id = myFn->getId();
+	return new ReturnStmtNode(zeroValue(type, id->getLine(), id->getCol()));
+}
+
+// Statements
+
+bool StmtListNode::markTailCalls(TailCallEliminator * tce, bool tail){
+	bool found = false;
+	for (auto it = myList.begin(); it != myList.end(); ++it){
+		// Past an if whose branch always returns, the rest of the list
+		// is as good as its else branch
+		IfStmtNode * branch = dynamic_cast<IfStmtNode *>(*it);
+		bool last = endsList(myList, std::next(it))
+			|| (branch != nullptr && branch->getBody()->alwaysReturns());
+		if ((*it)->markTailCalls(tce, tail && last)){
+			found = true;
+		}
+	}
+	return found;
+}
+
+void StmtListNode::loopTailCalls(TailCallEliminator * tce){
+	for (auto it = myList.begin(); it != myList.end(); ++it){
+		auto next = std::next(it);
+		CallExpNode * call = tce->siteCall(*it);
+		if (call != nullptr){
+			// What follows the call never runs
+			std::list<StmtNode *> jump;
+			tce->jump(call, jump);
+			myList.erase(it, myList.end());
+			myList.splice(myList.end(), jump);
+			return;
+		}
+		IfStmtNode * branch = dynamic_cast<IfStmtNode *>(*it);
+		if (branch != nullptr && tce->isBranch(branch)){
+			std::list<StmtNode *> rest(next, myList.end());
+			std::list<VarDeclNode *> none;
+			myList.erase(next, myList.end());
+			*it = new IfElseStmtNode(branch->getCondition(),
+				branch->getDecls(), branch->getBody(),
+				new VarDeclListNode(&none), new StmtListNode(&rest));
+			next = myList.end();
+		}
+		IfElseStmtNode * split = dynamic_cast<IfElseStmtNode *>(*it);
+		if (split != nullptr && endsList(myList, next)){
+			split->loopTailCalls(tce);
+			myList.erase(next, myList.end());
+			return;
+		}
+	}
+	if (myList.empty() || dynamic_cast<ReturnStmtNode *>(myList.back()) == nullptr){
+		myList.push_back(tce->fallOff());
+	}
+}
+
+void StmtListNode::loopWhile(ExpNode * condition){
+	std::list<VarDeclNode *> none;
+	StmtNode * loop = new WhileStmtNode(condition, new VarDeclListNode(&none),
+		new StmtListNode(&myList));
+	myList.clear();
+	myList.push_back(loop);
+}
+
+bool ReturnStmtNode::markTailCalls(TailCallEliminator * tce, bool tail){
+	CallExpNode * call = dynamic_cast<CallExpNode *>(myLoc);
+	// A return always leaves the function
+	return call != nullptr && tce->noteTailCall(this, call, tail);
+}
+
+bool CallStmtNode::markTailCalls(TailCallEliminator * tce, bool tail){
+	// A void function returns nothing after the call
+	return tail && tce->returnsVoid() && tce->noteTailCall(this, myCall, true);
+}
+
+bool IfStmtNode::markTailCalls(TailCallEliminator * tce, bool tail){
+	if (!myStmtList->markTailCalls(tce, tail)){
+		return false;
+	}
+	tce->noteBranch(this);
+	return true;
+}
+
+bool IfElseStmtNode::markTailCalls(TailCallEliminator * tce, bool tail){
+	bool found = myStmtList->markTailCalls(tce, tail);
+	return myElseStmtList->markTailCalls(tce, tail) || found;
+}
+
+void IfElseStmtNode::loopTailCalls(TailCallEliminator * tce){
+	myStmtList->loopTailCalls(tce);
+	myElseStmtList->loopTailCalls(tce);
+}
+
+bool WhileStmtNode::markTailCalls(TailCallEliminator * tce, bool tail){
+	// A call in the loop returns to it
+	myStmtList->markTailCalls(tce, false);
+	return false;
+}
+
+} //End namespace LIL' C
@@ -0,0 +1,86 @@
+#ifndef LILC_TAILCALL_HPP
+#define LILC_TAILCALL_HPP
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace LILC{
+
+class ProgramNode;
+class FnDeclNode;
+class StmtNode;
+class IfStmtNode;
+class CallExpNode;
+class SemSymbol;
+class FreshNames;
+
+// Tail calls in a type-checked AST (tailcall.cpp).
+//
+// A call is a tail call when its function returns the result unchanged,
+// return f(...);, or, in a void function, when the call statement is the
+// last thing the function does. Every tail call is marked so that the
+// bytecode generator can give the callee the caller's frame (OP_TCALL).
+//
+// A tail call of a function to itself is a jump back to its top when it
+// sits in tail position: in the body's statement list, or in a branch of
+// an if or if-else in tail position. Such functions get the body wrapped
+// in while (true). Each of those calls assigns its actuals to the formals,
+// through fresh locals so every actual sees the old values, and zeroes
+// the locals whose entry value may be read, as a new call would. The
+// body's other ways out return explicitly, and an if whose branch holds
+// such a call takes the statements after it as its else branch. A
+// function with struct locals, or with a block local whose entry value
+// may be read, only has its calls marked.
+class TailCallEliminator{
+public:
+	void run(ProgramNode * program);
+
+	// Called by the statements while marking: call is a tail call of the
+	// current function, in a statement in tail position if tail. Returns
+	// whether it is a self call to replace by a jump.
+	bool noteTailCall(StmtNode * stmt, CallExpNode * call, bool tail);
+	// Whether the current function is void, so a call statement ending
+	// it is a tail call
+	bool returnsVoid();
+	// An if in tail position holding a call to replace in its branch
+	void noteBranch(IfStmtNode * branch){ myBranches.insert(branch); }
+
+	// Called by the statement lists while rewriting
+	bool isBranch(IfStmtNode * branch){ return myBranches.count(branch) != 0; }
+	// The self call that stmt makes in tail position, or null
+	CallExpNode * siteCall(StmtNode * stmt);
+	// Appends the statements that replace a self tail call
+	void jump(CallExpNode * call, std::list<StmtNode *>& out);
+	// The return ending a branch that used to fall off the body
+	StmtNode * fallOff();
+
+	size_t selfCalls(){ return mySelfCalls; }
+	size_t otherCalls(){ return myOtherCalls; }
+	size_t jumps(){ return myJumps; }
+	size_t looped(){ return myLooped; }
+private:
+	void run(FnDeclNode * fn);
+	// Whether fn's self tail calls can become jumps; fills myResets
+	bool loopable();
+	SemSymbol * nextValue(SemSymbol * formal);
+
+	FnDeclNode * myFn = nullptr;
+	FreshNames * myNames = nullptr;
+	std::map<StmtNode *, CallExpNode *> mySites;
+	std::set<IfStmtNode *> myBranches;
+	// Locals zeroed at each jump, and the locals holding each formal's
+	// next value
+	std::vector<SemSymbol *> myResets;
+	std::map<SemSymbol *, SemSymbol *> myNext;
+	size_t mySelfCalls = 0;
+	size_t myOtherCalls = 0;
+	size_t myJumps = 0;
+	size_t myLooped = 0;
+};
+
+} //End namespace LIL' C
+
+#endif
@@ -0,0 +1,417 @@
+#include "ast.hpp"
+#include "symbol_table.hpp"
+#include "type_check.hpp"
+#include "lilc_parallel.hpp"
+
+namespace LILC{
+
+void BodyChecker::error(ExpNode * exp, const char * msg){
+	error(exp->getLine(), exp->getCol(), msg);
+}
+
+bool TypeChecker::check(ProgramNode * root, std::ostream& errors){
+	myFunctions.clear();
+	root->collectSignatures(this);
+
+	std::vector<std::vector<TypeError>> results(myFunctions.size());
+	parallelFor(myFunctions.size(), myJobs, [&](size_t i){
+		FnDeclNode * fn = myFunctions[i];
+		BodyChecker checker(fn->getId()->getSymbol()->getSignature());
+		fn->typeCheckBody(&checker);
+		results[i].swap(checker.getErrors());
+	});
+
+	bool ok = true;
+	for (const std::vector<TypeError>& fnErrors : results){
+		for (const TypeError& err : fnErrors){
+			errors << err.line << ":" << err.col << " ***ERROR*** "
+				<< err.msg << "\n";
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+static DataType symbolType(SemSymbol * sym){
+	if (sym == nullptr){
+		return DataType::ERROR;
+	}
+	switch (sym->getKind()){
+		case SemSymbol::VAR:
+			return sym->getType()->getDataType();
+		case SemSymbol::FN:
+			return DataType::fnType(sym->getSignature());
+		case SemSymbol::STRUCT:
+			return DataType::structType(DataType::STRUCT_NAME,
+				sym->getStruct());
+	}
+	return DataType::ERROR;
+}
+
+// Types
+
+DataType IntNode::getDataType(){ return DataType::INT; }
+DataType BoolNode::getDataType(){ return DataType::BOOL; }
+DataType VoidNode::getDataType(){ return DataType::VOID; }
+
+DataType StructNode::getDataType(){
+	StructDef * def = getStruct();
+	if (def == nullptr){
+		return DataType::ERROR;
+	}
+	return DataType::structType(DataType::STRUCT, def);
+}
+
+// Phase one: signatures
+
+void ProgramNode::collectSignatures(TypeChecker * checker){
+	myDeclList->collectSignatures(checker);
+}
+
+void DeclListNode::collectSignatures(TypeChecker * checker){
+	for (DeclNode * decl : myDecls){
+		decl->collectSignatures(checker);
+	}
+}
+
+void FnDeclNode::collectSignatures(TypeChecker * checker){
+	FnSignature * sig = new FnSignature(myType->getDataType());
+	if (myFormals != nullptr){
+		for (FormalDeclNode * formal : myFormals->getFormals()){
+			sig->addFormal(formal->getType()->getDataType());
+		}
+	}
+	myId->getSymbol()->setSignature(sig);
+	checker->addFunction(this);
+}
+
+// Phase two: bodies
+
+void FnDeclNode::typeCheckBody(BodyChecker * checker){
+	myBody->typeCheck(checker);
+}
+
+void FnBodyNode::typeCheck(BodyChecker * checker){
+	getStmts()->typeCheck(checker);
+}
+
+void StmtListNode::typeCheck(BodyChecker * checker){
+	for (StmtNode * stmt : myList){
+		stmt->typeCheck(checker);
+	}
+}
+
+static void checkCondition(BodyChecker * checker, ExpNode * exp,
+	const char * msg){
+	DataType type = exp->typeCheck(checker);
+	if (!type.isError() && !type.is(DataType::BOOL)){
+		checker->error(exp, msg);
+	}
+}
+
+// Checks one operand of an operator that needs `want` and reports msg if
+// it has some other type. Returns false if the operand is unusable.
+static bool checkOperand(BodyChecker * checker, ExpNode * exp,
+	DataType::Kind want, const char * msg){
+	DataType type = exp->typeCheck(checker);
+	if (type.isError()){
+		return false;
+	}
+	if (!type.is(want)){
+		checker->error(exp, msg);
+		return false;
+	}
+	return true;
+}
+
+static DataType checkBinary(BodyChecker * checker, ExpNode * left,
+	ExpNode * right, DataType::Kind operand, DataType::Kind result,
+	const char * msg){
+	bool ok = checkOperand(checker, left, operand, msg);
+	ok = checkOperand(checker, right, operand, msg) && ok;
+	return ok ? DataType(result) : DataType(DataType::ERROR);
+}
+
+static const char * ARITH_ERROR =
+	"Arithmetic operator applied to non-numeric operand";
+static const char * LOGIC_ERROR =
+	"Logical operator applied to non-bool operand";
+static const char * REL_ERROR =
+	"Relational operator applied to non-numeric operand";
+
+void AssignStmtNode::typeCheck(BodyChecker * checker){
+	myAssign->typeCheck(checker);
+}
+
+void PostIncStmtNode::typeCheck(BodyChecker * checker){
+	checkOperand(checker, myLoc, DataType::INT, ARITH_ERROR);
+}
+
+void PostDecStmtNode::typeCheck(BodyChecker * checker){
+	checkOperand(checker, myLoc, DataType::INT, ARITH_ERROR);
+}
+
+void ReadStmtNode::typeCheck(BodyChecker * checker){
+	DataType type = myLoc->typeCheck(checker);
+	if (type.is(DataType::FN)){
+		checker->error(myLoc, "Attempt to read a function");
+	} else if (type.is(DataType::STRUCT_NAME)){
+		checker->error(myLoc, "Attempt to read a struct name");
+	} else if (type.is(DataType::STRUCT)){
+		checker->error(myLoc, "Attempt to read a struct variable");
+	}
+}
+
+void WriteStmtNode::typeCheck(BodyChecker * checker){
+	DataType type = myLoc->typeCheck(checker);
+	if (type.is(DataType::FN)){
+		checker->error(myLoc, "Attempt to write a function");
+	} else if (type.is(DataType::STRUCT_NAME)){
+		checker->error(myLoc, "Attempt to write a struct name");
+	} else if (type.is(DataType::STRUCT)){
+		checker->error(myLoc, "Attempt to write a struct variable");
+	} else if (type.is(DataType::VOID)){
+		checker->error(myLoc, "Attempt to write void");
+	}
+}
+
+void ReturnStmtNode::typeCheck(BodyChecker * checker){
+	DataType expected = checker->getSignature()->getReturnType();
+	if (myLoc == nullptr){
+		if (!expected.is(DataType::VOID)){
+			checker->error(0, 0, "Missing return value");
+		}
+		return;
+	}
+	DataType type = myLoc->typeCheck(checker);
+	if (expected.is(DataType::VOID)){
+		checker->error(myLoc, "Return with a value in a void function");
+	} else if (!type.isError() && type != expected){
+		checker->error(myLoc, "Bad return value");
+	}
+}
+
+void CallStmtNode::typeCheck(BodyChecker * checker){
+	myCall->typeCheck(checker);
+}
+
+void IfStmtNode::typeCheck(BodyChecker * checker){
+	checkCondition(checker, myExp,
+		"Non-bool expression used as an if condition");
+	myStmtList->typeCheck(checker);
+}
+
+void IfElseStmtNode::typeCheck(BodyChecker * checker){
+	checkCondition(checker, myExp,
+		"Non-bool expression used as an if condition");
+	myStmtList->typeCheck(checker);
+	myElseStmtList->typeCheck(checker);
+}
+
+void WhileStmtNode::typeCheck(BodyChecker * checker){
+	checkCondition(checker, myExp,
+		"Non-bool expression used as a while condition");
+	myStmtList->typeCheck(checker);
+}
+
+// Expressions
+
+size_t CallExpNode::getLine(){ return myLoc->getLine(); }
+size_t CallExpNode::getCol(){ return myLoc->getCol(); }
+
+DataType IntLitNode::typeCheck(BodyChecker * checker){
+	return DataType::INT;
+}
+
+DataType StringLitNode::typeCheck(BodyChecker * checker){
+	return DataType::STRING;
+}
+
+DataType TrueNode::typeCheck(BodyChecker * checker){
+	return DataType::BOOL;
+}
+
+DataType FalseNode::typeCheck(BodyChecker * checker){
+	return DataType::BOOL;
+}
+
+DataType IdNode::typeCheck(BodyChecker * checker){
+	return symbolType(mySymbol);
+}
+
+DataType DotAccessNode::typeCheck(BodyChecker * checker){
+	return symbolType(myRight->getSymbol());
+}
+
+DataType AssignNode::typeCheck(BodyChecker * checker){
+	DataType left = myLeft->typeCheck(checker);
+	DataType right = myRight->typeCheck(checker);
+	if (left.isError() || right.isError()){
+		return DataType::ERROR;
+	}
+	if (left != right){
+		checker->error(this, "Type mismatch");
+		return DataType::ERROR;
+	}
+	if (left.is(DataType::FN)){
+		checker->error(this, "Function assignment");
+		return DataType::ERROR;
+	}
+	if (left.is(DataType::STRUCT_NAME)){
+		checker->error(this, "Struct name assignment");
+		return DataType::ERROR;
+	}
+	if (left.is(DataType::STRUCT)){
+		checker->error(this, "Struct variable assignment");
+		return DataType::ERROR;
+	}
+	return left;
+}
+
+DataType CallExpNode::typeCheck(BodyChecker * checker){
+	DataType callee = myLoc->typeCheck(checker);
+	size_t numActuals = myList == nullptr ? 0 : myList->getExps().size();
+	if (!callee.is(DataType::FN)){
+		if (!callee.isError()){
+			checker->error(myLoc, "Attempt to call a non-function");
+		}
+		if (myList != nullptr){
+			myList->typeCheck(checker);
+		}
+		return DataType::ERROR;
+	}
+	FnSignature * sig = callee.getSignature();
+	const std::vector<DataType>& formals = sig->getFormals();
+	if (numActuals != formals.size()){
+		checker->error(myLoc, "Function call with wrong number of args");
+		if (myList != nullptr){
+			myList->typeCheck(checker);
+		}
+		return sig->getReturnType();
+	}
+	if (myList != nullptr){
+		size_t i = 0;
+		for (ExpNode * actual : myList->getExps()){
+			DataType type = actual->typeCheck(checker);
+			if (!type.isError() && type != formals[i]){
+				checker->error(actual,
+					"Type of actual does not match type of formal");
+			}
+			i++;
+		}
+	}
+	return sig->getReturnType();
+}
+
+DataType ExpListNode::typeCheck(BodyChecker * checker){
+	for (ExpNode * exp : myList){
+		exp->typeCheck(checker);
+	}
+	return DataType::VOID;
+}
+
+DataType UnaryMinusNode::typeCheck(BodyChecker * checker){
+	if (!checkOperand(checker, myNode, DataType::INT, ARITH_ERROR)){
+		return DataType::ERROR;
+	}
+	return DataType::INT;
+}
+
+DataType NotNode::typeCheck(BodyChecker * checker){
+	if (!checkOperand(checker, myNode, DataType::BOOL, LOGIC_ERROR)){
+		return DataType::ERROR;
+	}
+	return DataType::BOOL;
+}
+
+DataType PlusNode::typeCheck(BodyChecker * checker){
+	return checkBinary(checker, myLeft, myRight, DataType::INT,
+		DataType::INT, ARITH_ERROR);
+}
+
+DataType MinusNode::typeCheck(BodyChecker * checker){
+	return checkBinary(checker, myLeft, myRight, DataType::INT,
+		DataType::INT, ARITH_ERROR);
+}
+
+DataType TimesNode::typeCheck(BodyChecker * checker){
+	return checkBinary(checker, myLeft, myRight, DataType::INT,
+		DataType::INT, ARITH_ERROR);
+}
+
+DataType DivideNode::typeCheck(BodyChecker * checker){
+	return checkBinary(checker, myLeft, myRight, DataType::INT,
+		DataType::INT, ARITH_ERROR);
+}
+
+DataType AndNode::typeCheck(BodyChecker * checker){
+	return checkBinary(checker, myLeft, myRight, DataType::BOOL,
+		DataType::BOOL, LOGIC_ERROR);
+}
+
+DataType OrNode::typeCheck(BodyChecker * checker){
+	return checkBinary(checker, myLeft, myRight, DataType::BOOL,
+		DataType::BOOL, LOGIC_ERROR);
+}
+
+DataType LessNode::typeCheck(BodyChecker * checker){
+	return checkBinary(checker, myLeft, myRight, DataType::INT,
+		DataType::BOOL, REL_ERROR);
+}
+
+DataType GreaterNode::typeCheck(BodyChecker * checker){
+	return checkBinary(checker, myLeft, myRight, DataType::INT,
+		DataType::BOOL, REL_ERROR);
+}
+
+DataType LessEqNode::typeCheck(BodyChecker * checker){
+	return checkBinary(checker, myLeft, myRight, DataType::INT,
+		DataType::BOOL, REL_ERROR);
+}
+
+DataType GreaterEqNode::typeCheck(BodyChecker * checker){
+	return checkBinary(checker, myLeft, myRight, DataType::INT,
+		DataType::BOOL, REL_ERROR);
+}
+
+static DataType checkEquality(BodyChecker * checker, ExpNode * exp,
+	ExpNode * left, ExpNode * right){
+	DataType leftType = left->typeCheck(checker);
+	DataType rightType = right->typeCheck(checker);
+	if (leftType.isError() || rightType.isError()){
+		return DataType::ERROR;
+	}
+	if (leftType != rightType){
+		checker->error(exp, "Type mismatch");
+		return DataType::ERROR;
+	}
+	const char * msg = nullptr;
+	switch (leftType.getKind()){
+		case DataType::VOID:
+			msg = "Equality operator applied to void functions";
+			break;
+		case DataType::FN:
+			msg = "Equality operator applied to functions";
+			break;
+		case DataType::STRUCT_NAME:
+			msg = "Equality operator applied to struct names";
+			break;
+		case DataType::STRUCT:
+			msg = "Equality operator applied to struct variables";
+			break;
+		default:
+			return DataType::BOOL;
+	}
+	checker->error(exp, msg);
+	return DataType::ERROR;
+}
+
+DataType EqualsNode::typeCheck(BodyChecker * checker){
+	return checkEquality(checker, this, myLeft, myRight);
+}
+
+DataType NotEqualsNode::typeCheck(BodyChecker * checker){
+	return checkEquality(checker, this, myLeft, myRight);
+}
+
+} //End namespace LIL' C
@@ -0,0 +1,105 @@
+#ifndef LILC_TYPE_CHECK_HPP
+#define LILC_TYPE_CHECK_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+#include "lilc_alloc.hpp"
+
+namespace LILC{
+
+class StructDef;
+class FnSignature;
+class FnDeclNode;
+class ProgramNode;
+class ExpNode;
+
+// The type of an expression. STRUCT is a struct-typed value, STRUCT_NAME
+// the name of a struct type itself; both carry the StructDef. FN carries
+// the function's signature. ERROR marks an expression whose error has
+// already been reported, so it is not reported again further up.
+class DataType{
+public:
+	enum Kind { ERROR, VOID, INT, BOOL, STRING, STRUCT, STRUCT_NAME, FN };
+
+	DataType(Kind kind = ERROR) : myKind(kind) {}
+	static DataType structType(Kind kind, StructDef * def){
+		DataType type(kind);
+		type.myStruct = def;
+		return type;
+	}
+	static DataType fnType(FnSignature * sig){
+		DataType type(FN);
+		type.mySig = sig;
+		return type;
+	}
+	Kind getKind() const { return myKind; }
+	bool is(Kind kind) const { return myKind == kind; }
+	bool isError() const { return myKind == ERROR; }
+	StructDef * getStruct() const { return myStruct; }
+	FnSignature * getSignature() const { return mySig; }
+	bool operator==(const DataType& other) const {
+		// All functions share one type; the signature is only carried
+		// along for calls.
+		return myKind == other.myKind && myStruct == other.myStruct;
+	}
+	bool operator!=(const DataType& other) const { return !(*this == other); }
+private:
+	Kind myKind;
+	StructDef * myStruct = nullptr;
+	FnSignature * mySig = nullptr;
+};
+
+class FnSignature{
+public:
+	ALLOC_TAGGED(FnSignature)
+	FnSignature(DataType returnType) : myReturn(returnType) {}
+	DataType getReturnType(){ return myReturn; }
+	const std::vector<DataType>& getFormals(){ return myFormals; }
+	void addFormal(DataType type){ myFormals.push_back(type); }
+private:
+	DataType myReturn;
+	std::vector<DataType> myFormals;
+};
+
+struct TypeError {
+	size_t line;
+	size_t col;
+	const char * msg;
+};
+
+// State for checking one function body. Only reads global information,
+// so bodies can be checked on different threads.
+class BodyChecker{
+public:
+	BodyChecker(FnSignature * sig) : mySig(sig) {}
+	FnSignature * getSignature(){ return mySig; }
+	void error(size_t line, size_t col, const char * msg){
+		myErrors.push_back({line, col, msg});
+	}
+	void error(ExpNode * exp, const char * msg);
+	std::vector<TypeError>& getErrors(){ return myErrors; }
+private:
+	FnSignature * mySig;
+	std::vector<TypeError> myErrors;
+};
+
+// Two-phase type checker. Phase one walks the global declarations once,
+// giving every function a FnSignature. Phase two checks the function
+// bodies on up to `jobs` threads; each body collects its own errors,
+// which are printed in declaration order afterwards so the output does
+// not depend on scheduling.
+class TypeChecker{
+public:
+	TypeChecker(size_t jobs) : myJobs(jobs) {}
+	void addFunction(FnDeclNode * fn){ myFunctions.push_back(fn); }
+	// Expects a name-analysed AST. Returns false if there were errors.
+	bool check(ProgramNode * root, std::ostream& errors);
+private:
+	size_t myJobs;
+	std::vector<FnDeclNode *> myFunctions;
+};
+
+} //End namespace LIL' C
+
+#endif
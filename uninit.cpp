@@ -0,0 +1,64 @@
+#include <algorithm>
+
+#include "ast.hpp"
+#include "dataflow.hpp"
+#include "lilc_diagnostics.hpp"
+#include "uninit.hpp"
+
+namespace LILC{
+
+void UninitChecker::run(ProgramNode * program){
+	for (DeclNode * decl : program->getDeclList()->getDecls()){
+		FnDeclNode * fn = dynamic_cast<FnDeclNode *>(decl);
+		if (fn != nullptr){
+			run(fn);
+		}
+	}
+}
+
+void UninitChecker::run(FnDeclNode * fn){
+	FlowGraph graph;
+	graph.build(fn);
+	ReachingDefinitions reaching;
+	reaching.run(graph);
+	myVisits += reaching.visits();
+
+	// The earliest read each local's entry value reaches
+	std::vector<IdNode *> first(graph.numVars(), nullptr);
+	std::vector<FlowBlock>& blocks = graph.blocks();
+	for (uint32_t block = 0; block < blocks.size(); block++){
+		BitSet facts = reaching.reachIn(block);
+		uint32_t def = reaching.firstDef(block);
+		for (const FlowEvent& event : blocks[block].events){
+			if (event.kind == FlowEvent::USE && facts.test(event.var)
+				&& !graph.isFormal(event.var)){
+				IdNode *& id = first[event.var];
+				if (id == nullptr || event.id->getLine() < id->getLine()
+					|| (event.id->getLine() == id->getLine()
+					&& event.id->getCol() < id->getCol())){
+					id = event.id;
+				}
+			}
+			reaching.step(event, def, facts);
+		}
+	}
+
+	std::vector<IdNode *> reads;
+	for (IdNode * id : first){
+		if (id != nullptr){
+			reads.push_back(id);
+		}
+	}
+	std::sort(reads.begin(), reads.end(), [](IdNode * a, IdNode * b){
+		return a->getLine() != b->getLine() ? a->getLine() < b->getLine()
+			: a->getCol() < b->getCol();
+	});
+	for (IdNode * id : reads){
+		myDiagnostics->report(Diagnostics::WARNING,
+			Diagnostics::UNINITIALIZED_USE, id->getLine(), id->getCol(), 0,
+			id->getName());
+		myWarnings++;
+	}
+}
+
+} //End namespace LIL' C
@@ -0,0 +1,35 @@
+#ifndef LILC_UNINIT_HPP
+#define LILC_UNINIT_HPP
+
+#include <cstddef>
+
+namespace LILC{
+
+class Diagnostics;
+class ProgramNode;
+class FnDeclNode;
+
+// Warnings for scalar locals that may be read before anything is assigned
+// to them (uninit.cpp). A read is reported when reaching definitions says
+// the local's entry value, the one it has before any write, can reach it.
+// Each local is reported once, at the first such read in the source.
+class UninitChecker{
+public:
+	UninitChecker(Diagnostics * diagnostics){ myDiagnostics = diagnostics; }
+
+	void run(ProgramNode * program);
+
+	size_t warnings(){ return myWarnings; }
+	// Blocks the reaching-definitions solver visited
+	size_t visits(){ return myVisits; }
+private:
+	void run(FnDeclNode * fn);
+
+	Diagnostics * myDiagnostics;
+	size_t myWarnings = 0;
+	size_t myVisits = 0;
+};
+
+} //End namespace LIL' C
+
+#endif
@@ -45,10 +45,21 @@ void FnDeclNode::unparse(std::ostream& out, int indent) {
 	out << "}\n";
 }
 
+void FnDeclNode::unparseInterface(std::ostream& out) {
+	myType->unparse(out, 0);
+	out << " ";
+	myId->unparse(out, 0);
+	out << "(";
+	if (myFormals != nullptr) {
+		myFormals->unparse(out, 0);
+	}
+	out << ") {\n}\n";
+}
+
 void FnBodyNode::unparse(std::ostream& out, int indent) {
-	myDecls->unparse(out, indent + 1);
+	getDecls()->unparse(out, indent + 1);
 
-	myStmts->unparse(out, indent + 1);
+	getStmts()->unparse(out, indent + 1);
 }
 
 void FormalsListNode::unparse(std::ostream& out, int indent) {
@@ -103,6 +114,11 @@ void VoidNode::unparse(std::ostream& out, int indent){
 	out << "void";
 }
 
+void StructNode::unparse(std::ostream& out, int indent){
+	out << "struct ";
+	myId->unparse(out, 0);
+}
+
 // Begin Statement Nodes
 
 void AssignStmtNode::unparse(std::ostream& out, int indent) {
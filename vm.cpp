@@ -0,0 +1,209 @@
+#include <cstring>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "lilc_arith.hpp"
+#include "lilc_runtime.hpp"
+#include "vm.hpp"
+
+#if defined(__GNUC__) && !defined(LILC_VM_SWITCH)
+#define LILC_VM_THREADED 1
+#endif
+
+namespace LILC{
+
+VM::VM(RuntimeIO * io, size_t registers)
+: myRegs(new int32_t[registers]), myFrames(new CallInfo[MAX_CALL_DEPTH]){
+	myIO = io;
+	myNumRegs = registers;
+}
+
+bool VM::threaded(){
+#ifdef LILC_VM_THREADED
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool VM::run(const BytecodeProgram& program, std::ostream& err){
+	if (program.main < 0){
+		err << "***ERROR*** No main function\n";
+		return false;
+	}
+	std::vector<int32_t> globals(program.numGlobals, 0);
+	try {
+		execute(program, globals.data());
+	} catch (RuntimeError& e){
+		myIO->flush();
+		err << e.getLine() << ":" << e.getCol()
+			<< " ***RUNTIME ERROR*** " << e.what() << "\n";
+		return false;
+	}
+	myIO->flush();
+	return true;
+}
+
+static RuntimeError errorAt(const BytecodeFunction * fn, const Insn * pc,
+	const char * msg){
+	const std::pair<size_t, size_t>& pos = fn->positions[pc - fn->code.data()];
+	return RuntimeError(pos.first, pos.second, msg);
+}
+
+void VM::execute(const BytecodeProgram& program, int32_t * globals){
+	const BytecodeFunction * fns = program.functions.data();
+	const BytecodeFunction * fn = &fns[program.main];
+	int32_t * const regsEnd = myRegs.get() + myNumRegs;
+	CallInfo * const framesBase = myFrames.get();
+	CallInfo * const framesEnd = framesBase + MAX_CALL_DEPTH;
+	CallInfo * frame = framesBase;
+	int32_t * r = myRegs.get();
+	if ((size_t)fn->numRegs > myNumRegs){
+		throw RuntimeError(0, 0, "Stack overflow");
+	}
+	memset(r, 0, fn->numRegs * sizeof(int32_t));
+	const Insn * code = fn->code.data();
+	const Insn * pc = code;
+	uint64_t count = 0;
+	size_t calls = 1;
+	int32_t result;
+
+#ifdef LILC_VM_THREADED
+	static const void * const handlers[] = {
+#define LILC_VM_HANDLER(name, a, b, c) &&do_##name,
+		LILC_OPCODES(LILC_VM_HANDLER)
+#undef LILC_VM_HANDLER
+	};
+#define DISPATCH() { count++; goto *handlers[pc->op]; }
+#define CASE(name) do_##name:
+	DISPATCH();
+#else
+#define DISPATCH() continue
+#define CASE(name) case OP_##name:
+	for (;;){
+	count++;
+	switch (pc->op){
+#endif
+#define NEXT() { ++pc; DISPATCH(); }
+#define JUMP(target) { pc = code + (target); DISPATCH(); }
+#define BRANCH(cond) { if (cond){ JUMP(pc->c) } NEXT() }
+
+	CASE(MOV) r[pc->a] = r[pc->b]; NEXT()
+	CASE(LOADK) r[pc->a] = pc->b; NEXT()
+	CASE(LOADG) r[pc->a] = globals[pc->b]; NEXT()
+	CASE(STOREG) globals[pc->b] = r[pc->a]; NEXT()
+	CASE(ADD) r[pc->a] = lilcAdd(r[pc->b], r[pc->c]); NEXT()
+	CASE(SUB) r[pc->a] = lilcSub(r[pc->b], r[pc->c]); NEXT()
+	CASE(MUL) r[pc->a] = lilcMul(r[pc->b], r[pc->c]); NEXT()
+	CASE(DIV)
+		if (r[pc->c] == 0){
+			throw errorAt(fn, pc, "Division by zero");
+		}
+		r[pc->a] = lilcDiv(r[pc->b], r[pc->c]);
+		NEXT()
+	CASE(ADDI) r[pc->a] = lilcAdd(r[pc->b], pc->c); NEXT()
+	CASE(NEG) r[pc->a] = lilcNeg(r[pc->b]); NEXT()
+	CASE(NOT) r[pc->a] = !r[pc->b]; NEXT()
+	CASE(EQ) r[pc->a] = r[pc->b] == r[pc->c]; NEXT()
+	CASE(NE) r[pc->a] = r[pc->b] != r[pc->c]; NEXT()
+	CASE(LT) r[pc->a] = r[pc->b] < r[pc->c]; NEXT()
+	CASE(GT) r[pc->a] = r[pc->b] > r[pc->c]; NEXT()
+	CASE(LE) r[pc->a] = r[pc->b] <= r[pc->c]; NEXT()
+	CASE(GE) r[pc->a] = r[pc->b] >= r[pc->c]; NEXT()
+	CASE(JMP) JUMP(pc->c)
+	CASE(JT) BRANCH(r[pc->a])
+	CASE(JF) BRANCH(!r[pc->a])
+	CASE(JEQ) BRANCH(r[pc->a] == r[pc->b])
+	CASE(JNE) BRANCH(r[pc->a] != r[pc->b])
+	CASE(JLT) BRANCH(r[pc->a] < r[pc->b])
+	CASE(JGT) BRANCH(r[pc->a] > r[pc->b])
+	CASE(JLE) BRANCH(r[pc->a] <= r[pc->b])
+	CASE(JGE) BRANCH(r[pc->a] >= r[pc->b])
+	CASE(JEQI) BRANCH(r[pc->a] == pc->b)
+	CASE(JNEI) BRANCH(r[pc->a] != pc->b)
+	CASE(JLTI) BRANCH(r[pc->a] < pc->b)
+	CASE(JGTI) BRANCH(r[pc->a] > pc->b)
+	CASE(JLEI) BRANCH(r[pc->a] <= pc->b)
+	CASE(JGEI) BRANCH(r[pc->a] >= pc->b)
+	CASE(CALL)
+	{
+		const BytecodeFunction * callee = &fns[pc->b];
+		int32_t * calleeRegs = r + fn->numRegs;
+		if (frame == framesEnd
+		    || callee->numRegs > regsEnd - calleeRegs){
+			throw errorAt(fn, pc, "Stack overflow");
+		}
+		// Arguments sit in the caller's registers c.., below the new frame
+		memcpy(calleeRegs, r + pc->c, callee->numParams * sizeof(int32_t));
+		memset(calleeRegs + callee->numParams, 0,
+			(callee->numRegs - callee->numParams) * sizeof(int32_t));
+		frame->fn = fn;
+		frame->pc = pc;
+		frame->regs = r;
+		frame++;
+		calls++;
+		fn = callee;
+		r = calleeRegs;
+		code = fn->code.data();
+		pc = code;
+		DISPATCH();
+	}
+	CASE(TCALL)
+	{
+		const BytecodeFunction * callee = &fns[pc->b];
+		if (callee->numRegs > regsEnd - r){
+			throw errorAt(fn, pc, "Stack overflow");
+		}
+		// The arguments move down over this frame, which the callee
+		// takes; it returns to this function's caller
+		memmove(r, r + pc->c, callee->numParams * sizeof(int32_t));
+		memset(r + callee->numParams, 0,
+			(callee->numRegs - callee->numParams) * sizeof(int32_t));
+		calls++;
+		fn = callee;
+		code = fn->code.data();
+		pc = code;
+		DISPATCH();
+	}
+	CASE(RET)
+		result = r[pc->a];
+		goto leave;
+	CASE(RET0)
+		result = 0;
+		goto leave;
+	CASE(READ) r[pc->a] = myIO->readInt(); NEXT()
+	CASE(READB) r[pc->a] = myIO->readInt() != 0; NEXT()
+	CASE(WRITE) myIO->writeInt(r[pc->a]); NEXT()
+	CASE(WRITES) myIO->writeString(program.strings[pc->a]); NEXT()
+
+#ifndef LILC_VM_THREADED
+	default:
+		throw errorAt(fn, pc, "Bad opcode");
+	}
+#endif
+
+leave:
+	if (frame == framesBase){
+		myInstructions = count;
+		myCalls = calls;
+		return;
+	}
+	frame--;
+	fn = frame->fn;
+	code = fn->code.data();
+	pc = frame->pc;
+	r = frame->regs;
+	r[pc->a] = result;
+	NEXT()
+#ifndef LILC_VM_THREADED
+	}
+#endif
+
+#undef DISPATCH
+#undef CASE
+#undef NEXT
+#undef JUMP
+#undef BRANCH
+}
+
+} //End namespace LIL' C
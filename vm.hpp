@@ -0,0 +1,58 @@
+#ifndef LILC_VM_HPP
+#define LILC_VM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+namespace LILC{
+
+struct BytecodeProgram;
+struct BytecodeFunction;
+struct Insn;
+class RuntimeIO;
+
+// Runs register bytecode (bytecode.hpp) from main (vm.cpp).
+//
+// Frames are windows onto one register stack and calls push onto a
+// separate call stack of MAX_CALL_DEPTH entries (lilc_runtime.hpp), so the
+// VM never recurses on the native stack.
+// Dispatch is threaded through computed gotos when the compiler has them
+// (GCC and Clang) and a switch loop otherwise; define LILC_VM_SWITCH to
+// force the switch. Semantics, I/O and runtime errors match the
+// tree-walking interpreter (interp.hpp).
+class VM{
+public:
+	static const size_t DEFAULT_REGISTERS = 16 << 20;
+
+	VM(RuntimeIO * io, size_t registers = DEFAULT_REGISTERS);
+
+	// A runtime error stops the program and is reported on err; returns
+	// false if there was one.
+	bool run(const BytecodeProgram& program, std::ostream& err);
+	uint64_t getInstructions(){ return myInstructions; }
+	size_t getCalls(){ return myCalls; }
+	// Whether this build dispatches through computed gotos
+	static bool threaded();
+private:
+	struct CallInfo {
+		const BytecodeFunction * fn;
+		const Insn * pc;
+		int32_t * regs;
+	};
+
+	void execute(const BytecodeProgram& program, int32_t * globals);
+
+	RuntimeIO * myIO;
+	// Left uninitialized so only the part that is used gets paged in
+	std::unique_ptr<int32_t[]> myRegs;
+	size_t myNumRegs;
+	std::unique_ptr<CallInfo[]> myFrames;
+	uint64_t myInstructions = 0;
+	size_t myCalls = 0;
+};
+
+} //End namespace LIL' C
+
+#endif